@@ -26,34 +26,135 @@ typedef struct
   char                  szFullPath[PATH_MAX];
 } sFlyFileInfo_t;
 
+// compact file info, see FlyFileStat()
+typedef struct
+{
+  const char           *szPath;       // path as passed in, not copied
+  uint64_t              size;
+  uint64_t              ino;
+  int64_t               mtimeNs;      // modification time, nanoseconds since 1970
+  uint32_t              mode;         // type and permissions, same as st_mode
+  uint32_t              flags;        // FLYFILESTAT_EXISTS, etc.
+} flyFileStat_t;
+
+#define FLYFILESTAT_EXISTS        0x01  // flags: file or folder exists
+#define FLYFILESTAT_IS_DIR        0x02  // flags: is a folder
+#define FLYFILESTAT_RDONLY        0x04  // flags: not writable
+
+typedef unsigned flyFileStatOpts_t;
+#define FLYFILESTAT_OPT_NOFOLLOW  0x01  // don't follow a final symbolic link
+#define FLYFILESTAT_OPT_ACCESS    0x02  // use access() for FLYFILESTAT_RDONLY rather than mode bits
+
 typedef unsigned flyFileListOpts_t;
 #define FLYFILELIST_OPTS_BEG      0x01  // start matches
 #define FLYFILELIST_OPTS_END      0x02  // end matches
 #define FLYFILELIST_OPTS_NOCASE   0x04  // case insensitive
+#define FLYFILELIST_OPTS_UNSORTED 0x08  // FlyFileListNewExtsEx(): don't sort
+#define FLYFILELIST_OPTS_NATURAL  0x10  // FlyFileListSortEx(): numbers by value, "file2" < "file10"
+#define FLYFILELIST_OPTS_DIRSFIRST 0x20 // FlyFileListSortEx(): folders before files at each level
 
 #define FLYFILELIST_NOT_FOUND     UINT_MAX
 
+typedef unsigned flyFileCopyOpts_t;
+#define FLYFILE_COPY_MODE         0x01  // preserve permissions
+#define FLYFILE_COPY_TIMES        0x02  // preserve access and modification times
+#define FLYFILE_COPY_PRESERVE     (FLYFILE_COPY_MODE | FLYFILE_COPY_TIMES)
+
+typedef unsigned flyFileReadOpts_t;
+#define FLYFILE_READ_LF           0x01  // convert CRLF line endings to LF, strip lone CR
+
+typedef unsigned flyFileWriteOpts_t;
+#define FLYFILE_WRITE_CRLF        0x01  // convert LF line endings to CRLF, strip lone CR
+#define FLYFILE_WRITE_SYNC        0x02  // durable: data is on storage before returning
+
+// entry passed to FlyFileWalk() callback, valid only during the callback
+typedef struct
+{
+  const char           *szPath;       // path including root folder, folders end in slash
+  const char           *szName;       // name only, points into szPath
+  int                   dirFd;        // fd of containing folder, for openat(), fstatat()
+  unsigned              depth;        // 0 = in root folder
+  bool_t                fIsDir;
+  bool_t                fSkip;        // set by callback to not descend into this folder
+} flyFileWalkEntry_t;
+
+typedef unsigned flyFileWalkOpts_t;
+#define FLYFILEWALK_HIDDEN        0x01  // include files and folders starting with "."
+
+typedef bool_t (*pfnFlyFileWalk_t)  (flyFileWalkEntry_t *pEntry, void *pData);
+
 typedef int (*pfnFlyFileSort_t)     (const void *pThis, const void *pThat);
 
 typedef bool_t (*pfnFlyFileListRecurse_t)(const char *szPath, void *pData);
 
+typedef bool_t (*pfnFlyFileProbe_t)  (const char *szPath, void *pData);
+
+// read-only view of a whole file, see FlyFileMap()
+typedef struct
+{
+  const char           *pData;        // file contents, always '\0' terminated
+  size_t                len;          // length of contents, not including '\0'
+  size_t                mapLen;       // private: length of mapping, 0 if read into heap
+} flyFileMap_t;
+
+#define FLYFILEMAP_NORMAL         0x00  // no access hint
+#define FLYFILEMAP_SEQUENTIAL     0x01  // will be read front to back
+#define FLYFILEMAP_RANDOM         0x02  // will be accessed randomly
+#define FLYFILEMAP_WILLNEED       0x04  // start reading the whole file now
+
+typedef bool_t (*pfnFlyFilePipeline_t)(unsigned i, const char *szPath, const flyFileMap_t *pMap, void *pData);
+
+// cached folder entry, see FlyFileCacheDir()
+typedef struct
+{
+  const char           *szName;       // name only, folders end in slash
+  bool_t                fIsDir;
+  unsigned              mode;         // st_mode
+  uint64_t              size;
+  time_t                modTime;
+} flyFileCacheEntry_t;
+
+// streaming content hash state, see FlyFileHashInit()
+typedef struct
+{
+  uint64_t              aLanes[4];
+  uint64_t              totalLen;
+  uint64_t              seed;
+  uint8_t               aBuf[32];     // partial stripe
+  unsigned              bufLen;
+} flyFileHash_t;
+
+typedef unsigned flyFileCacheOpts_t;
+#define FLYFILECACHE_NO_WATCH     0x01  // don't use inotify, check folder mtimes instead
+
 // FlyFile.c for dealing with files (see also getenv() and getcwd()
 char         *FlyFileRead           (const char *szFilename);
+char         *FlyFileReadEx         (const char *szFilename, flyFileReadOpts_t opts);
 uint8_t      *FlyFileReadBin        (const char *szFilename, long *pLen);
+uint8_t      *FlyFileReadBinEx      (const char *szFilename, size_t *pLen);
+size_t        FlyFilePread          (int fd, void *pBuf, size_t len, off_t offset);
+size_t        FlyFilePwrite         (int fd, const void *pData, size_t len, off_t offset);
 bool_t        FlyFileWrite          (const char *szFilename, const char *szContents);
 bool_t        FlyFileWriteBin       (const char *szFilename, const uint8_t *szContents, long len);
+bool_t        FlyFileWriteBinEx     (const char *szFilename, const void *pContents, size_t len);
 bool_t        FlyFileWriteEx        (const char *szFilename, const char *szContents, bool_t fCrLf);
 bool_t        FlyFileCopy           (const char *szOutFilename, const char *szInFilename);
+bool_t        FlyFileCopyEx         (const char *szOutFilename, const char *szInFilename, flyFileCopyOpts_t opts);
 unsigned      FlyFileFullPath       (char *szFullPath, const char *szPartialPath);
 bool_t        FlyFileExists         (const char *szPath, bool_t *fFolder);
 bool_t        FlyFileExistsFile     (const char *szPath);
 bool_t        FlyFileExistsFolder   (const char *szPath);
 bool_t        FlyFileIsSamePath     (const char *szPath1, const char *szPath2);
+bool_t        FlyFileStat           (flyFileStat_t *pStat, const char *szPath, flyFileStatOpts_t opts);
+unsigned      FlyFileStatBatch      (flyFileStat_t *aStats, const char **aszPaths, unsigned n, int dirFd,
+                                     flyFileStatOpts_t opts);
 void          FlyFileInfoInit       (sFlyFileInfo_t *pInfo);
 bool_t        FlyFileInfoGet        (sFlyFileInfo_t *pInfo, const char *szPath);
 bool_t        FlyFileInfoGetEx      (sFlyFileInfo_t *pInfo, const char *szPath);
 bool_t        FlyFileFindInPath     (char *szPath, unsigned size, const char *szBaseName, bool_t cwdFirst);
 bool_t        FlyFileFindInFolder   (char *szPath, unsigned size, const char *szBaseName, const char *szBaseFolder);
+bool_t        FlyFileFindInFolderEx (char *szPath, unsigned size, const char *szBaseName, pfnFlyFileProbe_t pfnProbe,
+                                     void *pData);
 bool_t        FlyFileHomeGet        (char *szPath, unsigned size);
 unsigned      FlyFileHomeGetLen     (void);
 bool_t        FlyFileHomeExpand     (char *szPath, unsigned size);
@@ -62,21 +163,93 @@ bool_t        FlyFileGetCwd         (char *szPath, unsigned size);
 bool_t        FlyFileChangeDir      (const char *szPath);
 int           FlyFileMakeDir        (const char *szPath);
 
+// FlyFileMap.c: zero-copy read-only views of files
+bool_t        FlyFileMap            (flyFileMap_t *pMap, const char *szFilename, unsigned hint);
+bool_t        FlyFileMapIsMapped    (const flyFileMap_t *pMap);
+void          FlyFileUnmap          (flyFileMap_t *pMap);
+
+// FlyFilePrefetch.c: read-ahead of file batches, link with -lpthread
+unsigned      FlyFilePrefetch       (const char **aszPaths, unsigned n);
+unsigned      FlyFilePipeline       (const char **aszPaths, unsigned n, unsigned nAhead,
+                                     pfnFlyFilePipeline_t pfnProcess, void *pData);
+
+// FlyFileAtomic.c: crash safe file writes, individually or in group committed batches
+bool_t        FlyFileWriteAtomic    (const char *szFilename, const void *pData, size_t len, flyFileWriteOpts_t opts);
+void         *FlyFileWriteBatchNew  (flyFileWriteOpts_t opts);
+bool_t        FlyFileWriteBatchAdd  (void *hBatch, const char *szFilename, const void *pData, size_t len);
+bool_t        FlyFileWriteBatchCommit(void *hBatch);
+bool_t        FlyFileWriteBatchIsBatch(void *hBatch);
+void         *FlyFileWriteBatchFree (void *hBatch);
+
+// FlyFileCache.c: in memory cache of folder listings and stats, invalidated by inotify
+void         *FlyFileCacheNew       (flyFileCacheOpts_t opts);
+const flyFileCacheEntry_t *FlyFileCacheDir(void *hCache, const char *szFolder, unsigned *pLen);
+const flyFileCacheEntry_t *FlyFileCacheStat(void *hCache, const char *szPath);
+bool_t        FlyFileCacheFind      (void *hCache, const char *szFolder, const char *szExtList, unsigned maxDepth,
+                                     pfnFlyFileListRecurse_t pfnProcess, void *pData);
+void          FlyFileCacheFlush     (void *hCache);
+bool_t        FlyFileCacheIsCache   (void *hCache);
+void         *FlyFileCacheFree      (void *hCache);
+
+// FlyFileCopyTree.c: parallel folder tree copy (link with -lpthread)
+bool_t        FlyFileCopyTree       (const char *szOutFolder, const char *szInFolder, flyFileCopyOpts_t opts,
+                                     unsigned nThreads);
+
+// FlyFileHash.c: fast 64-bit content fingerprints and a fingerprint database (link with -lpthread)
+void          FlyFileHashInit       (flyFileHash_t *pState, uint64_t seed);
+void          FlyFileHashUpdate     (flyFileHash_t *pState, const void *pData, size_t len);
+uint64_t      FlyFileHashFinal      (const flyFileHash_t *pState);
+uint64_t      FlyFileHashMem        (const void *pData, size_t len);
+bool_t        FlyFileHashFile       (const char *szFilename, uint64_t *pHash);
+unsigned      FlyFileHashFiles      (const char **aszPaths, uint64_t *aHashes, unsigned n, unsigned nThreads);
+void         *FlyFileHashDbNew      (const char *szDbFile);
+bool_t        FlyFileHashDbCheck    (void *hDb, const char *szPath, uint64_t *pHash);
+bool_t        FlyFileHashDbUpdate   (void *hDb, const char *szPath);
+bool_t        FlyFileHashDbSave     (void *hDb);
+bool_t        FlyFileHashDbIsDb     (void *hDb);
+void         *FlyFileHashDbFree     (void *hDb);
+
+// FlyFileLines.c: constant memory line reader for huge text files
+void         *FlyFileLinesNew       (const char *szFilename, size_t bufSize);
+const char   *FlyFileLinesNext      (void *hLines, size_t *pLen);
+size_t        FlyFileLinesLineNum   (void *hLines);
+bool_t        FlyFileLinesError     (void *hLines);
+bool_t        FlyFileLinesIsLines   (void *hLines);
+void         *FlyFileLinesFree      (void *hLines);
+
 // FlyFilelIst.c: for iterating through a file/folder trees/lists
 void         *FlyFileListNew        (const char *szWildPath);
 void         *FlyFileListNewEx      (const char *szWildPath);
 void         *FlyFileListNewExts    (const char *szFolder, const char *szExtList, unsigned maxDepth);
+void         *FlyFileListNewExtsEx  (const char *szFolder, const char *szExtList, unsigned maxDepth, flyFileListOpts_t opts);
 bool_t        FlyFileListRecurse    (const char *szWildPath, unsigned maxDepth, pfnFlyFileListRecurse_t pfnProcess, void *pData);
 void         *FlyFileListFree       (void *hList);
 const char   *FlyFileListGetName    (void *hList, unsigned i);
 const char   *FlyFileListGetNameEx  (void *hList, unsigned i);
 unsigned      FlyFileListGetBasePath(void *hList, char *szPath, unsigned size);
 unsigned      FlyFileListFind       (void *hList, const char *sz, unsigned startIndex, flyFileListOpts_t opts);
+bool_t        FlyFileListIndex      (void *hList);
 bool_t        FlyFileListIsList     (void *hList);
+bool_t        FlyFileListMatchExt   (const char *pszExt, const char *szExtList);
 unsigned      FlyFileListLen        (void *hList);
 unsigned      FlyFileListLenEx      (void *hList);
 void          FlyFileListPrint      (void *hList);
 void          FlyFileListSort       (void *hList, pfnFlyFileSort_t pfnCmpStr);
+bool_t        FlyFileListSortEx     (void *hList, flyFileListOpts_t opts);
+
+// FlyFilePathCache.c: cached FlyFileFindInPath() and FlyFileFindInFolder()
+void         *FlyFilePathCacheNew   (unsigned maxAge);
+bool_t        FlyFilePathCacheFindInPath(void *hCache, char *szPath, unsigned maxSize, const char *szBaseName,
+                                     bool_t cwdFirst);
+bool_t        FlyFilePathCacheFindInFolder(void *hCache, char *szPath, unsigned maxSize, const char *szBaseName,
+                                     const char *szBaseFolder);
+void          FlyFilePathCacheFlush (void *hCache);
+bool_t        FlyFilePathCacheIsCache(void *hCache);
+void         *FlyFilePathCacheFree  (void *hCache);
+
+// FlyFileWalk.c: stream a folder tree to a callback, optionally in parallel (link with -lpthread)
+bool_t        FlyFileWalk           (const char *szFolder, unsigned maxDepth, flyFileWalkOpts_t opts, unsigned nThreads,
+                                     pfnFlyFileWalk_t pfnVisit, void *pData);
 
 #ifdef __cplusplus
   }
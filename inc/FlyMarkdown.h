@@ -43,10 +43,12 @@ size_t  FlyMd2HtmlQLink       (char *szHtml, size_t size, const char **ppszMd);
 size_t  FlyMd2HtmlRef         (char *szHtml, size_t size, const char **ppszMd);
 size_t  FlyMd2HtmlTable       (char *szHtml, size_t size, const char **ppszMd);
 
+size_t  FlyMd2HtmlBlock       (char *szHtml, size_t size, const char **ppszMd);
 size_t  FlyMd2HtmlContent     (char *szHtml, size_t size, const char *szMd, const char *szMdEnd);
 size_t  FlyMd2HtmlFileHead    (char *szHtml, size_t size, const char *szTitle);
 size_t  FlyMd2HtmlFileEnd     (char *szHtml, size_t size);
 size_t  FlyMd2HtmlFile        (char *szHtml, size_t size, const char *szMd, const char *szTitle);
+size_t  FlyMd2HtmlFileToc     (char *szHtml, size_t size, const char *szMd, const char *szTitle, unsigned maxLevel);
 
 typedef enum
 {
@@ -81,6 +83,75 @@ typedef struct
   flyMdRefType_t  refType;
 } flyMdAltLink_t;
 
+typedef enum
+{
+  MD_BLOCK_TYPE_NONE = 0,
+  MD_BLOCK_TYPE_HEADING,      // # Heading, or Heading with === or --- underneath
+  MD_BLOCK_TYPE_BLOCK_QUOTE,  // > block quote
+  MD_BLOCK_TYPE_HORZ_RULE,    // ---
+  MD_BLOCK_TYPE_CODE_BLK,     // ``` fenced or 4 space indented code block
+  MD_BLOCK_TYPE_LIST,         // - item, or 1. item
+  MD_BLOCK_TYPE_TABLE,        // a | b, followed by --- | ---
+  MD_BLOCK_TYPE_PARA          // anything else
+} flyMdBlockType_t;
+
+typedef struct
+{
+  flyMdBlockType_t  type;
+  unsigned          level;    // heading level 1-6, block quote depth, table columns, list 1 if numeric,
+                              // code block 1 if ```all on one line```
+  const char       *szMd;     // 1st line of the block
+  const char       *szMdEnd;  // line after the block
+  const char       *szBody;   // heading text or code block contents, else NULL
+  const char       *szBodyEnd;// end of szBody
+} flyMdBlock_t;
+
+typedef enum
+{
+  MD_INLINE_TYPE_NONE = 0,
+  MD_INLINE_TYPE_TEXT,        // plain text, may contain escapes, e.g. `\*`
+  MD_INLINE_TYPE_CHARS,       // special chars that aren't markdown, e.g. `&` or `*` in `2 * 3`
+  MD_INLINE_TYPE_CODE,        // `inline code`
+  MD_INLINE_TYPE_QLINK,       // <https://site.com>
+  MD_INLINE_TYPE_IMAGE,       // ![alt text](file.png "title")
+  MD_INLINE_TYPE_REF,         // [ref text](site.com/page) or [^footnote]
+  MD_INLINE_TYPE_EM_OPEN,     // opening `**` of **bold**, etc...
+  MD_INLINE_TYPE_EM_CLOSE     // closing `**` of **bold**, etc...
+} flyMdInlineType_t;
+
+typedef struct
+{
+  flyMdInlineType_t type;
+  const char       *szMd;     // markdown for this inline element
+  size_t            len;      // length of markdown, 0 if closing emphasis left open at end of text
+  flyMdEmType_t     emType;   // MD_INLINE_TYPE_EM_OPEN or MD_INLINE_TYPE_EM_CLOSE
+  flyMdAltLink_t    altLink;  // MD_INLINE_TYPE_IMAGE or MD_INLINE_TYPE_REF
+  const char       *szNext;   // private: where parsing continues
+  const char       *szMdEnd;  // private: end of text
+  bool_t            afOpen[MD_EM_TYPE_SIZEOF];  // private: emphasis currently open
+} flyMdInline_t;
+
+typedef struct
+{
+  unsigned          level;      // heading level 1-6
+  const char       *szText;     // heading text in markdown, e.g. "Title" in "## Title"
+  size_t            textLen;    // length of heading text
+  size_t            htmlOffset; // offset of <h1>, <h2>, etc. in HTML
+  size_t            slugOffset; // offset of slug (the heading id) in HTML
+  size_t            slugLen;    // length of slug
+} flyMdHeading_t;
+
+typedef struct
+{
+  flyMdHeading_t   *aHeadings;  // array to fill in, or NULL to just count headings
+  unsigned          maxHeadings;// # of elements in aHeadings
+  unsigned          nHeadings;  // # of headings found, may be more than maxHeadings
+} flyMdToc_t;
+
+// heading index and table of contents
+size_t          FlyMd2HtmlContentEx     (char *szHtml, size_t size, const char *szMd, const char *szMdEnd, flyMdToc_t *pToc);
+size_t          FlyMd2HtmlToc           (char *szHtml, size_t size, const flyMdToc_t *pToc, unsigned maxLevel);
+
 // helper functions do NOT produce HTML code
 bool_t          FlyMd2HtmlIsBlockQuote  (const char *szMd);
 bool_t          FlyMd2HtmlIsBreak       (const char *szMd);
@@ -99,6 +170,24 @@ const char     *FlyMd2HtmlHeadingText   (const char *szLine);
 char           *FlyMdAltLink            (flyMdAltLink_t *pAltLink, const char *szMd);
 char           *FlyMdNPBrk              (const char *sz, const char *szEnd, const char *szAccept);
 
+// parse markdown without producing HTML
+const char     *FlyMdParseBlock         (const char *szMd, flyMdBlock_t *pBlock);
+unsigned        FlyMdParse              (const char *szMd, const char *szMdEnd, flyMdBlock_t *aBlocks, unsigned maxBlocks);
+void            FlyMdInlineFirst        (flyMdInline_t *pInline, const char *szMd, const char *szMdEnd);
+bool_t          FlyMdInlineNext         (flyMdInline_t *pInline);
+size_t          FlyMdBlock2Html         (char *szHtml, size_t size, const flyMdBlock_t *pBlock);
+
+// incremental HTML rendering of a markdown document being edited, see FlyMarkdownDoc.c
+void           *FlyMdDocNew             (const char *szMd);
+void           *FlyMdDocFree            (void *hDoc);
+bool_t          FlyMdDocIsDoc           (void *hDoc);
+bool_t          FlyMdDocEdit            (void *hDoc, size_t offset, size_t delLen, const char *szIns, size_t insLen);
+const char     *FlyMdDocMd              (void *hDoc, size_t *pLen);
+const char     *FlyMdDocHtml            (void *hDoc, size_t *pLen);
+unsigned        FlyMdDocNumBlocks       (void *hDoc);
+const char     *FlyMdDocBlockHtml       (void *hDoc, unsigned i, size_t *pLen);
+unsigned        FlyMdDocRendered        (void *hDoc);
+
 #ifdef __cplusplus
   }
 #endif
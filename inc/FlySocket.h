@@ -63,6 +63,8 @@ int             FlySockErrno        (hFlySock_t hSock);
 
 int             FlySockSend         (hFlySock_t hSock, hFlySockAddr_t hAddr, const uint8_t *pBuf, int bufLen);
 int             FlySockReceive      (hFlySock_t hSock, hFlySockAddr_t hAddr, uint8_t *pBuf, int bufLen);
+size_t          FlySockSendAll      (hFlySock_t hSock, hFlySockAddr_t hAddr, const void *pBuf, size_t len);
+size_t          FlySockReceiveAll   (hFlySock_t hSock, hFlySockAddr_t hAddr, void *pBuf, size_t len);
 
 hFlySockAddr_t  FlySockAddrNew      (hFlySock_t hSock);
 bool_t          FlySockAddrIsAddr   (hFlySockAddr_t hAddr);
@@ -17,10 +17,224 @@
 typedef int  (*pfnSortCmp_t)    (const void *pThis, const void *pThat);
 typedef int  (*pfnSortCmpEx_t)  (void *pArg, const void *pThis, const void *pThat);
 
+// key types for FlySortRadix()
+typedef enum
+{
+  FLYSORT_KEY_U32 = 0,  // uint32_t, unsigned
+  FLYSORT_KEY_I32,      // int32_t, int
+  FLYSORT_KEY_U64,      // uint64_t
+  FLYSORT_KEY_I64,      // int64_t
+  FLYSORT_KEY_DOUBLE    // IEEE-754 double
+} flySortKey_t;
+
+// tuning for FlySortQSort() and FLY_SORT_DEFINE()
+#define FLY_SORT_INSERTION_MAX  24    // insertion sort at or below this many elements
+#define FLY_SORT_NINTHER_MIN    128   // pivot is median of 9 (rather than 3) above this many
+#define FLY_SORT_PARTIAL_MOVES  8     // partial insertion sort gives up after this many moves
+
+/*
+  FLY_SORT_DEFINE(name, type, lessExpr) defines `static void name(type *aBase, size_t n)`, a
+  pattern-defeating quicksort (pdqsort) for an array of a concrete type. The compare is inlined,
+  and elements are moved by assignment, so it's much faster than FlySortQSort() or qsort().
+
+  lessExpr is TRUE if element `*a` sorts before element `*b`, where `a` and `b` are
+  `const type *`. Like FlySortQSort(), the sort is not stable. Examples:
+
+      FLY_SORT_DEFINE(SortInts, int, *a < *b)
+      FLY_SORT_DEFINE(SortByAge, person_t, a->age < b->age || (a->age == b->age && a->id < b->id))
+
+      SortInts(aInts, NumElements(aInts));
+*/
+#define FLY_SORT_DEFINE(name, type, lessExpr)                                                       \
+static inline bool_t name##Less(const type *a, const type *b)                                      \
+{                                                                                                   \
+  return (lessExpr) ? TRUE : FALSE;                                                                 \
+}                                                                                                   \
+static inline void name##Swap(type *a, type *b)                                                    \
+{                                                                                                   \
+  type t_ = *a; *a = *b; *b = t_;                                                                   \
+}                                                                                                   \
+static inline void name##Sort3(type *a, type *b, type *c)                                          \
+{                                                                                                   \
+  if(name##Less(b, a))                                                                              \
+    name##Swap(a, b);                                                                               \
+  if(name##Less(c, b))                                                                              \
+  {                                                                                                 \
+    name##Swap(b, c);                                                                               \
+    if(name##Less(b, a))                                                                            \
+      name##Swap(a, b);                                                                             \
+  }                                                                                                 \
+}                                                                                                   \
+static inline bool_t name##Insertion(type *aBase, size_t n, size_t maxMoves)                       \
+{                                                                                                   \
+  size_t  i, j, moves = 0;                                                                          \
+  type    t_;                                                                                       \
+  for(i = 1; i < n; ++i)                                                                            \
+  {                                                                                                 \
+    if(name##Less(&aBase[i], &aBase[i - 1]))                                                        \
+    {                                                                                               \
+      t_ = aBase[i];                                                                                \
+      j  = i;                                                                                       \
+      do                                                                                            \
+      {                                                                                             \
+        aBase[j] = aBase[j - 1];                                                                    \
+        --j;                                                                                        \
+      } while(j > 0 && name##Less(&t_, &aBase[j - 1]));                                             \
+      aBase[j] = t_;                                                                                \
+      moves += i - j;                                                                               \
+      if(moves > maxMoves)                                                                          \
+        return FALSE;                                                                               \
+    }                                                                                               \
+  }                                                                                                 \
+  return TRUE;                                                                                      \
+}                                                                                                   \
+static inline void name##SiftDown(type *aBase, size_t k, size_t n)                                 \
+{                                                                                                  \
+  size_t  child;                                                                                   \
+  while((child = 2 * k + 1) < n)                                                                   \
+  {                                                                                                \
+    if(child + 1 < n && name##Less(&aBase[child], &aBase[child + 1]))                              \
+      ++child;                                                                                     \
+    if(!name##Less(&aBase[k], &aBase[child]))                                                      \
+      break;                                                                                       \
+    name##Swap(&aBase[k], &aBase[child]);                                                          \
+    k = child;                                                                                     \
+  }                                                                                                \
+}                                                                                                  \
+static inline void name##HeapSort(type *aBase, size_t n)                                           \
+{                                                                                                  \
+  size_t  i;                                                                                       \
+  for(i = n / 2; i > 0; --i)                                                                       \
+    name##SiftDown(aBase, i - 1, n);                                                               \
+  while(n > 1)                                                                                     \
+  {                                                                                                \
+    --n;                                                                                           \
+    name##Swap(&aBase[0], &aBase[n]);                                                              \
+    name##SiftDown(aBase, 0, n);                                                                   \
+  }                                                                                                \
+}                                                                                                  \
+static inline void name##Loop(type *aBase, size_t n, unsigned badAllowed, bool_t fLeftmost)        \
+{                                                                                                   \
+  type    pivot_;                                                                                   \
+  size_t  i, j, mid, nLeft, nRight;                                                                 \
+  bool_t  fPartitioned;                                                                             \
+  while(n > FLY_SORT_INSERTION_MAX)                                                                 \
+  {                                                                                                 \
+    mid = n / 2;                                                                                    \
+    if(n > FLY_SORT_NINTHER_MIN)                                                                    \
+    {                                                                                               \
+      name##Sort3(&aBase[0], &aBase[mid], &aBase[n - 1]);                                           \
+      name##Sort3(&aBase[1], &aBase[mid - 1], &aBase[n - 2]);                                       \
+      name##Sort3(&aBase[2], &aBase[mid + 1], &aBase[n - 3]);                                       \
+      name##Sort3(&aBase[mid - 1], &aBase[mid], &aBase[mid + 1]);                                   \
+      name##Swap(&aBase[0], &aBase[mid]);                                                           \
+    }                                                                                               \
+    else                                                                                            \
+      name##Sort3(&aBase[mid], &aBase[0], &aBase[n - 1]);                                           \
+    pivot_ = aBase[0];                                                                              \
+    if(!fLeftmost && !name##Less(&aBase[-1], &pivot_))                                              \
+    {                                                                                               \
+      i = 0;                                                                                        \
+      j = n;                                                                                        \
+      while(name##Less(&pivot_, &aBase[--j]))                                                       \
+        ;                                                                                           \
+      if(j + 1 == n)                                                                                \
+        while(i < j && !name##Less(&pivot_, &aBase[++i]))                                           \
+          ;                                                                                         \
+      else                                                                                          \
+        while(!name##Less(&pivot_, &aBase[++i]))                                                    \
+          ;                                                                                         \
+      while(i < j)                                                                                  \
+      {                                                                                             \
+        name##Swap(&aBase[i], &aBase[j]);                                                           \
+        while(name##Less(&pivot_, &aBase[--j]))                                                     \
+          ;                                                                                         \
+        while(!name##Less(&pivot_, &aBase[++i]))                                                    \
+          ;                                                                                         \
+      }                                                                                             \
+      aBase[0] = aBase[j];                                                                          \
+      aBase[j] = pivot_;                                                                            \
+      aBase += j + 1;                                                                               \
+      n     -= j + 1;                                                                               \
+      continue;                                                                                     \
+    }                                                                                               \
+    i = 0;                                                                                          \
+    j = n;                                                                                          \
+    while(name##Less(&aBase[++i], &pivot_))                                                         \
+      ;                                                                                             \
+    if(i == 1)                                                                                      \
+      while(i < j && !name##Less(&aBase[--j], &pivot_))                                             \
+        ;                                                                                           \
+    else                                                                                            \
+      while(!name##Less(&aBase[--j], &pivot_))                                                      \
+        ;                                                                                           \
+    fPartitioned = (i >= j) ? TRUE : FALSE;                                                         \
+    while(i < j)                                                                                    \
+    {                                                                                               \
+      name##Swap(&aBase[i], &aBase[j]);                                                             \
+      while(name##Less(&aBase[++i], &pivot_))                                                       \
+        ;                                                                                           \
+      while(!name##Less(&aBase[--j], &pivot_))                                                      \
+        ;                                                                                           \
+    }                                                                                               \
+    mid = i - 1;                                                                                    \
+    aBase[0]   = aBase[mid];                                                                        \
+    aBase[mid] = pivot_;                                                                            \
+    nLeft  = mid;                                                                                   \
+    nRight = n - mid - 1;                                                                           \
+    if(nLeft < n / 8 || nRight < n / 8)                                                             \
+    {                                                                                               \
+      if(--badAllowed == 0)                                                                         \
+      {                                                                                             \
+        name##HeapSort(aBase, n);                                                                   \
+        return;                                                                                     \
+      }                                                                                             \
+      if(nLeft >= FLY_SORT_INSERTION_MAX)                                                           \
+      {                                                                                             \
+        name##Swap(&aBase[0], &aBase[nLeft / 4]);                                                   \
+        name##Swap(&aBase[mid - 1], &aBase[mid - nLeft / 4]);                                       \
+      }                                                                                             \
+      if(nRight >= FLY_SORT_INSERTION_MAX)                                                          \
+      {                                                                                             \
+        name##Swap(&aBase[mid + 1], &aBase[mid + 1 + nRight / 4]);                                  \
+        name##Swap(&aBase[n - 1], &aBase[n - nRight / 4]);                                          \
+      }                                                                                             \
+    }                                                                                               \
+    else if(fPartitioned && name##Insertion(aBase, nLeft, FLY_SORT_PARTIAL_MOVES) &&                \
+            name##Insertion(&aBase[mid + 1], nRight, FLY_SORT_PARTIAL_MOVES))                       \
+      return;                                                                                       \
+    if(nLeft < nRight)                                                                              \
+    {                                                                                               \
+      name##Loop(aBase, nLeft, badAllowed, fLeftmost);                                              \
+      aBase    += mid + 1;                                                                          \
+      n         = nRight;                                                                           \
+      fLeftmost = FALSE;                                                                            \
+    }                                                                                               \
+    else                                                                                            \
+    {                                                                                               \
+      name##Loop(&aBase[mid + 1], nRight, badAllowed, FALSE);                                       \
+      n = nLeft;                                                                                    \
+    }                                                                                               \
+  }                                                                                                 \
+  name##Insertion(aBase, n, SIZE_MAX);                                                              \
+}                                                                                                   \
+static inline void name(type *aBase, size_t n)                                                     \
+{                                                                                                   \
+  unsigned  badAllowed = 1;                                                                         \
+  size_t    m;                                                                                      \
+  for(m = n; m > 1; m /= 2)                                                                         \
+    ++badAllowed;                                                                                   \
+  if(n > 1)                                                                                         \
+    name##Loop(aBase, n, badAllowed, TRUE);                                                         \
+}
+
 // Note: basic compare functions can be found in FlyList
 void    FlySortBubble   (void *pArray, unsigned nElem, unsigned elemSize, pfnSortCmp_t pfnCmp);
 void    FlySortQSort    (void *pArray, size_t nElem, size_t elemSize, void *pArg, pfnSortCmpEx_t pfnCmp);
 void   *FlySortList     (void *pList, bool_t fIsCircular, bool_t fIsDouble, void *pArg, pfnSortCmpEx_t pfnCmp);
+bool_t  FlySortRadix    (void *pArray, size_t nElem, flySortKey_t keyType, void *pScratch);
+bool_t  FlySortRadixEx  (void *pArray, size_t nElem, size_t elemSize, size_t keyOffset, flySortKey_t keyType,
+                         void *pScratch);
 
 #ifndef FLY_FLAG_NO_MATH
 int     FlySortCmpDouble    (const void *pThis, const void *pThat);
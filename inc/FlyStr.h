@@ -72,6 +72,21 @@ typedef enum  // note: used as a bitmask. See FlyStrReplace()
   FLYSTR_REP_ALL_CASE       // replace all found in string, ignoring case
 } flyStrReplaceOpt_t;
 
+// bitmask of chars to escape. See FlyStrHtmlEscape()
+#define FLYSTR_HTML_LT      0x01  // '<' becomes &lt;
+#define FLYSTR_HTML_GT      0x02  // '>' becomes &gt;
+#define FLYSTR_HTML_AMP     0x04  // '&' becomes &amp;
+#define FLYSTR_HTML_QUOTE   0x08  // '"' becomes &quot;
+#define FLYSTR_HTML_APOS    0x10  // '\'' becomes &#39;
+#define FLYSTR_HTML_ALL     0x1f
+
+// line endings. See FlyStrEolConvert()
+typedef enum
+{
+  FLYSTR_EOL_LF = 0,        // "\n"
+  FLYSTR_EOL_CRLF           // "\r\n"
+} flyStrEol_t;
+
 bool_t            FlyCharIsCName      (char c);
 bool_t            FlyCharIsDozenal    (char c);
 bool_t            FlyCharIsEol        (char c);
@@ -105,6 +120,8 @@ char             *FlyStrSkipNumber    (const char *sz);
 const char       *FlyStrSkipString    (const char *sz);
 
 // line handling
+size_t            FlyStrEolConvert    (char *pDst, size_t size, const char *pSrc, size_t srcLen, flyStrEol_t eol,
+                                       size_t *pSrcUsed);
 char             *FlyStrLineBeg       (const char *szFile, const char *sz);
 void              FlyStrLineBlankRemove(char *sz);
 char             *FlyStrLineChr       (const char *sz, char c);
@@ -178,6 +195,7 @@ size_t            FlyStrReplace       (char *szHaystack, size_t size, const char
 bool_t            FlyCharIsSlug       (char c);
 extern const char g_szFlyStrSlugChars [];
 unsigned          FlyStrSlug          (char *szSlug, const char *szSrc, size_t size, size_t srcLen);
+size_t            FlyStrHtmlEscape    (char *szDst, const char *szSrc, size_t size, size_t srcLen, unsigned flags);
 const char       *FlyStrCVer          (void);
 size_t            FlyStrIns           (char *szDst, size_t offset, size_t sizeDst, const char *szSrc);
 int               FlyStrCmp           (const char *szThis, const char *szThat);
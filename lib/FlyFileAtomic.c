@@ -0,0 +1,415 @@
+/**************************************************************************************************
+  FlyFileAtomic.c - Crash safe file writes: all of the new file or all of the old, never a mix
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileAtomic   Crash safe file writes
+
+  FlyFileWrite() and friends open the target file directly, so a crash part way through leaves a
+  truncated file. FlyFileWriteAtomic() writes a temporary file in the same folder, then rename()s
+  it over the target, so readers (and the file system after a crash) see either the old file or
+  the new file.
+
+  1. CRLF conversion is done in large chunks with FlyStrEolConvert(), lone '\r' are stripped
+  2. FLYFILE_WRITE_SYNC makes the write durable (fdatasync() of the file, fsync() of the folder)
+  3. A batch (FlyFileWriteBatchNew()) group commits many files: all are written first, then all
+     synced, then all renamed, then each folder synced once
+
+  @example FlyFileAtomic Write build outputs durably
+
+  ```
+  #include "FlyFile.h"
+
+  void *hBatch = FlyFileWriteBatchNew(FLYFILE_WRITE_SYNC);
+  for(i = 0; i < nOutputs; ++i)
+    FlyFileWriteBatchAdd(hBatch, aOutputs[i].szPath, aOutputs[i].pData, aOutputs[i].len);
+  if(!FlyFileWriteBatchCommit(hBatch))
+    printf("build output failed\n");
+  FlyFileWriteBatchFree(hBatch);
+  ```
+*/
+
+#define FLY_FILEWRITEBATCH_SANCHK   31313
+#define FILEATOMIC_EOL_BUF_SIZE     (64 * 1024)
+#define FILEATOMIC_MAX_OPEN         64    // max files held open waiting to be synced
+#define FILEATOMIC_MAX_TRIES        100
+
+typedef struct
+{
+  char                 *szTmp;
+  char                 *szFinal;
+  int                   fd;       // -1 if closed
+} fileAtomicItem_t;
+
+typedef struct
+{
+  unsigned              sanchk;
+  flyFileWriteOpts_t    opts;
+  fileAtomicItem_t     *aItems;
+  unsigned              nItems;
+  unsigned              maxItems;
+  unsigned              nOpen;    // items with fd still open
+  bool_t                fFailed;
+} sFlyFileWriteBatch_t;
+
+static unsigned         m_tmpCount;   // if threads collide, O_EXCL fails and the next is tried
+
+/*-------------------------------------------------------------------------------------------------
+  Write all of the data, continuing after partial writes. Returns FALSE if failed.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileAtomicWriteAll(int fd, const char *pData, size_t len)
+{
+  ssize_t   n;
+
+  while(len)
+  {
+    n = write(fd, pData, len);
+    if(n < 0 && errno == EINTR)
+      continue;
+    if(n <= 0)
+      return FALSE;
+    pData += n;
+    len   -= (size_t)n;
+  }
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Write the data, optionally converting line endings to CRLF with FlyStrEolConvert(). Converts in
+  FILEATOMIC_EOL_BUF_SIZE chunks, so there is 1 system call per chunk rather than per line.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileAtomicWrite(int fd, const char *pData, size_t len, bool_t fCrLf)
+{
+  char       *pBuf;
+  size_t      outLen;
+  size_t      used;
+  bool_t      fWorked = TRUE;
+
+  if(!fCrLf)
+    return FileAtomicWriteAll(fd, pData, len);
+
+  pBuf = FlyAlloc(FILEATOMIC_EOL_BUF_SIZE);
+  if(!pBuf)
+    return FALSE;
+  while(len && fWorked)
+  {
+    outLen = FlyStrEolConvert(pBuf, FILEATOMIC_EOL_BUF_SIZE, pData, len, FLYSTR_EOL_CRLF, &used);
+    fWorked = FileAtomicWriteAll(fd, pBuf, outLen);
+    pData += used;
+    len   -= used;
+  }
+  FlyFree(pBuf);
+
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Flush file data to storage. Metadata (e.g. times) need not be flushed, only data and size.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileAtomicSyncFd(int fd)
+{
+#ifdef __APPLE__
+  return (fcntl(fd, F_FULLFSYNC) == 0 || fsync(fd) == 0) ? TRUE : FALSE;
+#else
+  return (fdatasync(fd) == 0) ? TRUE : FALSE;
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Sync (if batch is durable) and close all open items.
+-------------------------------------------------------------------------------------------------*/
+static void FileAtomicSyncAll(sFlyFileWriteBatch_t *pBatch)
+{
+  unsigned    i;
+
+  for(i = 0; i < pBatch->nItems; ++i)
+  {
+    if(pBatch->aItems[i].fd >= 0)
+    {
+      if((pBatch->opts & FLYFILE_WRITE_SYNC) && !FileAtomicSyncFd(pBatch->aItems[i].fd))
+        pBatch->fFailed = TRUE;
+      if(close(pBatch->aItems[i].fd) != 0)
+        pBatch->fFailed = TRUE;
+      pBatch->aItems[i].fd = -1;
+    }
+  }
+  pBatch->nOpen = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Fsync the folder containing szPath so the rename() is durable.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileAtomicSyncFolder(const char *szPath)
+{
+  char     *szFolder;
+  char     *psz;
+  int       fd;
+  bool_t    fWorked = FALSE;
+
+  szFolder = FlyStrClone(szPath);
+  if(szFolder)
+  {
+    psz = strrchr(szFolder, '/');
+    if(psz)
+      psz[1] = '\0';
+    else
+      strcpy(szFolder, ".");
+    fd = open(szFolder, O_RDONLY);
+    if(fd >= 0)
+    {
+      fWorked = (fsync(fd) == 0) ? TRUE : FALSE;
+      close(fd);
+    }
+    FlyFree(szFolder);
+  }
+
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Is szPath1 in the same folder as szPath2?
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileAtomicSameFolder(const char *szPath1, const char *szPath2)
+{
+  const char  *psz1 = strrchr(szPath1, '/');
+  const char  *psz2 = strrchr(szPath2, '/');
+  size_t       len1 = psz1 ? (size_t)(psz1 - szPath1) : 0;
+  size_t       len2 = psz2 ? (size_t)(psz2 - szPath2) : 0;
+
+  return (len1 == len2 && strncmp(szPath1, szPath2, len1) == 0) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a pointer to a write batch?
+
+  @param    hBatch    handle from FlyFileWriteBatchNew()
+  @return   TRUE if a write batch handle
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileWriteBatchIsBatch(void *hBatch)
+{
+  sFlyFileWriteBatch_t *pBatch = hBatch;
+  return (pBatch && (pBatch->sanchk == FLY_FILEWRITEBATCH_SANCHK)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Create a batch of atomic file writes. Nothing is visible until FlyFileWriteBatchCommit().
+
+  @param    opts      0, or FLYFILE_WRITE_CRLF and/or FLYFILE_WRITE_SYNC
+  @return   handle to batch, or NULL if not enough memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileWriteBatchNew(flyFileWriteOpts_t opts)
+{
+  sFlyFileWriteBatch_t  *pBatch;
+
+  pBatch = FlyAllocZ(sizeof(*pBatch));
+  if(pBatch)
+  {
+    pBatch->sanchk  = FLY_FILEWRITEBATCH_SANCHK;
+    pBatch->opts    = opts;
+  }
+
+  return pBatch;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Write a file to a temporary file in the same folder. It replaces szFilename on commit.
+
+  If szFilename already exists, the new file gets the same permissions. Otherwise, the permissions
+  are 0666 masked by the umask, just like fopen().
+
+  @param    hBatch      handle from FlyFileWriteBatchNew()
+  @param    szFilename  file to write, e.g. "out/file.txt"
+  @param    pData       contents
+  @param    len         length of contents
+  @return   TRUE if worked, FALSE if failed (the batch can still commit the other files)
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileWriteBatchAdd(void *hBatch, const char *szFilename, const void *pData, size_t len)
+{
+  sFlyFileWriteBatch_t *pBatch = hBatch;
+  fileAtomicItem_t     *pItem;
+  fileAtomicItem_t     *aNew;
+  struct stat           st;
+  size_t                size;
+  unsigned              newMax;
+  unsigned              i;
+  bool_t                fWorked = FALSE;
+
+  if(!FlyFileWriteBatchIsBatch(hBatch) || !szFilename || (!pData && len))
+    return FALSE;
+
+  if(pBatch->nItems >= pBatch->maxItems)
+  {
+    newMax = pBatch->maxItems ? pBatch->maxItems * 2 : 16;
+    aNew = FlyRealloc(pBatch->aItems, newMax * sizeof(fileAtomicItem_t));
+    if(!aNew)
+      return FALSE;
+    pBatch->aItems   = aNew;
+    pBatch->maxItems = newMax;
+  }
+
+  // create a unique temporary file next to the final one, e.g. "file.txt.tmp1234.5"
+  pItem = &pBatch->aItems[pBatch->nItems];
+  size = strlen(szFilename) + 32;
+  pItem->fd      = -1;
+  pItem->szFinal = FlyStrClone(szFilename);
+  pItem->szTmp   = FlyAlloc(size);
+  if(pItem->szFinal && pItem->szTmp)
+  {
+    for(i = 0; pItem->fd < 0 && i < FILEATOMIC_MAX_TRIES; ++i)
+    {
+      snprintf(pItem->szTmp, size, "%s.tmp%ld.%u", szFilename, (long)getpid(), m_tmpCount++);
+      pItem->fd = open(pItem->szTmp, O_WRONLY | O_CREAT | O_EXCL, 0666);
+      if(pItem->fd < 0 && errno != EEXIST)
+        break;
+    }
+  }
+
+  if(pItem->fd >= 0)
+  {
+    fWorked = FileAtomicWrite(pItem->fd, pData, len, (pBatch->opts & FLYFILE_WRITE_CRLF) ? TRUE : FALSE);
+    if(fWorked && stat(szFilename, &st) == 0 && fchmod(pItem->fd, st.st_mode & 07777) != 0)
+      fWorked = FALSE;
+    if(!fWorked || !(pBatch->opts & FLYFILE_WRITE_SYNC))
+    {
+      if(close(pItem->fd) != 0)
+        fWorked = FALSE;
+      pItem->fd = -1;
+    }
+    else
+      ++pBatch->nOpen;
+    if(!fWorked)
+      unlink(pItem->szTmp);
+  }
+
+  if(fWorked)
+  {
+    ++pBatch->nItems;
+    if(pBatch->nOpen >= FILEATOMIC_MAX_OPEN)
+      FileAtomicSyncAll(pBatch);
+  }
+  else
+  {
+    FlyFreeIf(pItem->szFinal);
+    FlyFreeIf(pItem->szTmp);
+  }
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Commit the batch: sync all the files (if FLYFILE_WRITE_SYNC), rename them all into place, then
+  sync each folder once. The batch is empty afterwards and may be reused.
+
+  @param    hBatch    handle from FlyFileWriteBatchNew()
+  @return   TRUE if all files were committed
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileWriteBatchCommit(void *hBatch)
+{
+  sFlyFileWriteBatch_t *pBatch = hBatch;
+  fileAtomicItem_t     *pItem;
+  bool_t                fWorked;
+  unsigned              i;
+
+  if(!FlyFileWriteBatchIsBatch(hBatch))
+    return FALSE;
+
+  // sync file data before any rename, so a crash never exposes an empty file
+  FileAtomicSyncAll(pBatch);
+  for(i = 0; i < pBatch->nItems; ++i)
+  {
+    pItem = &pBatch->aItems[i];
+    if(rename(pItem->szTmp, pItem->szFinal) != 0)
+    {
+      unlink(pItem->szTmp);
+      pBatch->fFailed = TRUE;
+    }
+  }
+
+  // make the renames durable, once per folder
+  if(pBatch->opts & FLYFILE_WRITE_SYNC)
+  {
+    for(i = 0; i < pBatch->nItems; ++i)
+    {
+      pItem = &pBatch->aItems[i];
+      if(i > 0 && FileAtomicSameFolder(pItem->szFinal, pBatch->aItems[i - 1].szFinal))
+        continue;
+      if(!FileAtomicSyncFolder(pItem->szFinal))
+        pBatch->fFailed = TRUE;
+    }
+  }
+
+  for(i = 0; i < pBatch->nItems; ++i)
+  {
+    FlyFree(pBatch->aItems[i].szTmp);
+    FlyFree(pBatch->aItems[i].szFinal);
+  }
+  pBatch->nItems = 0;
+  fWorked = pBatch->fFailed ? FALSE : TRUE;
+  pBatch->fFailed = FALSE;
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free the batch. Any files not yet committed are discarded, leaving the original files alone.
+
+  @param    hBatch    handle from FlyFileWriteBatchNew()
+  @return   NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileWriteBatchFree(void *hBatch)
+{
+  sFlyFileWriteBatch_t *pBatch = hBatch;
+  unsigned              i;
+
+  if(FlyFileWriteBatchIsBatch(hBatch))
+  {
+    for(i = 0; i < pBatch->nItems; ++i)
+    {
+      if(pBatch->aItems[i].fd >= 0)
+        close(pBatch->aItems[i].fd);
+      unlink(pBatch->aItems[i].szTmp);
+      FlyFree(pBatch->aItems[i].szTmp);
+      FlyFree(pBatch->aItems[i].szFinal);
+    }
+    FlyFreeIf(pBatch->aItems);
+    memset(pBatch, 0, sizeof(*pBatch));
+    FlyFree(pBatch);
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Write a file atomically: after a crash, szFilename has either the old or new contents in full.
+
+  @param    szFilename  file to write, e.g. "out/file.txt"
+  @param    pData       contents
+  @param    len         length of contents
+  @param    opts        0, or FLYFILE_WRITE_CRLF (LF to CRLF) and/or FLYFILE_WRITE_SYNC (durable)
+  @return   TRUE if worked, FALSE if failed (and szFilename is unchanged)
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileWriteAtomic(const char *szFilename, const void *pData, size_t len, flyFileWriteOpts_t opts)
+{
+  void     *hBatch;
+  bool_t    fWorked = FALSE;
+
+  hBatch = FlyFileWriteBatchNew(opts);
+  if(hBatch)
+  {
+    if(FlyFileWriteBatchAdd(hBatch, szFilename, pData, len))
+      fWorked = FlyFileWriteBatchCommit(hBatch);
+    FlyFileWriteBatchFree(hBatch);
+  }
+
+  return fWorked;
+}
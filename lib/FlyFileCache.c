@@ -0,0 +1,748 @@
+/**************************************************************************************************
+  FlyFileCache.c - In memory cache of folder listings and file stats for repeated scans
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+  #include <sys/inotify.h>
+#endif
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileCache   In memory cache of folder listings and file stats
+
+  Tools like flymake, file pickers and FlyTabComplete scan the same folder trees over and over.
+  FlyFileCache keeps each folder's listing, with the size, time and type of every entry, in memory
+  keyed by folder path. After the first scan, repeated queries don't touch the file system.
+
+  1. On Linux, each cached folder has an inotify watch, so a folder is reloaded only when
+     something in it actually changed (create, delete, rename, write, attributes)
+  2. Elsewhere, or with FLYFILECACHE_NO_WATCH, a folder is reloaded if its mtime changed (or
+     changed within the last second). This catches create, delete and rename, but not writes to
+     existing files, so sizes and times of files may be out of date
+  3. Checking for changes is one non-blocking read() of the inotify fd per query
+
+  The cache is not thread safe. Entries returned are valid until the next call on the cache.
+
+  @example FlyFileCache List all .c files under src/ many times
+
+  ```
+  #include "FlyFile.h"
+
+  bool_t PrintPath(const char *szPath, void *pData)
+  {
+    printf("%s\n", szPath);
+    return TRUE;
+  }
+
+  void *hCache = FlyFileCacheNew(0);
+  FlyFileCacheFind(hCache, "src/", ".c", UINT_MAX, PrintPath, NULL);   // reads file system
+  FlyFileCacheFind(hCache, "src/", ".c", UINT_MAX, PrintPath, NULL);   // from memory
+  FlyFileCacheFree(hCache);
+  ```
+*/
+
+#define FLY_FILECACHE_SANCHK      15151
+#define FILECACHE_HASH_MIN        64
+
+typedef struct
+{
+  char                 *szPath;       // key, folder path ending in slash (or "" for cwd)
+  uint32_t              hash;
+  flyFileCacheEntry_t  *aEntries;     // sorted by name
+  unsigned              nEntries;
+  char                 *pNames;       // all names packed together
+  struct timespec       mtime;        // of folder, for when not watched
+  int                   wd;           // inotify watch, or -1
+  bool_t                fStale;
+  bool_t                fRacy;        // changed too recently for mtime to be trusted
+} fileCacheDir_t;
+
+typedef struct
+{
+  unsigned              sanchk;
+  flyFileCacheOpts_t    opts;
+  int                   inotifyFd;    // -1 if not watching
+  fileCacheDir_t      **apDirs;       // open address hash table
+  unsigned              nDirs;
+  unsigned              hashSize;     // power of 2
+  fileCacheDir_t      **apWdDirs;     // indexed by inotify watch descriptor
+  unsigned              wdMax;
+} sFlyFileCache_t;
+
+/*-------------------------------------------------------------------------------------------------
+  FNV-1a hash of a string.
+-------------------------------------------------------------------------------------------------*/
+static uint32_t FileCacheHash(const char *sz)
+{
+  uint32_t  hash = 2166136261u;
+
+  while(*sz)
+  {
+    hash ^= (uint8_t)*sz++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Normalize folder to end in a slash, with "." being "". Returns allocated string or NULL.
+-------------------------------------------------------------------------------------------------*/
+static char * FileCacheKey(const char *szFolder)
+{
+  char     *szKey;
+  size_t    len = strlen(szFolder);
+
+  if(strcmp(szFolder, ".") == 0)
+    len = 0;
+  szKey = FlyAlloc(len + 2);
+  if(szKey)
+  {
+    memcpy(szKey, szFolder, len);
+    if(len && !isslash(szKey[len - 1]))
+      szKey[len++] = '/';
+    szKey[len] = '\0';
+  }
+  return szKey;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find slot in the hash table for the key. Returns ptr to slot (which may hold NULL).
+-------------------------------------------------------------------------------------------------*/
+static fileCacheDir_t ** FileCacheSlot(sFlyFileCache_t *pCache, const char *szKey, uint32_t hash)
+{
+  fileCacheDir_t  **ppDir;
+  unsigned          i = hash & (pCache->hashSize - 1);
+
+  while(TRUE)
+  {
+    ppDir = &pCache->apDirs[i];
+    if(*ppDir == NULL || ((*ppDir)->hash == hash && strcmp((*ppDir)->szPath, szKey) == 0))
+      break;
+    i = (i + 1) & (pCache->hashSize - 1);
+  }
+  return ppDir;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Double the hash table (kept at most half full). Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCacheGrow(sFlyFileCache_t *pCache)
+{
+  fileCacheDir_t  **apOld     = pCache->apDirs;
+  unsigned          oldSize   = pCache->hashSize;
+  unsigned          i;
+
+  pCache->hashSize = oldSize ? oldSize * 2 : FILECACHE_HASH_MIN;
+  pCache->apDirs   = FlyAllocZ(pCache->hashSize * sizeof(fileCacheDir_t *));
+  if(!pCache->apDirs)
+  {
+    pCache->apDirs   = apOld;
+    pCache->hashSize = oldSize;
+    return FALSE;
+  }
+  for(i = 0; i < oldSize; ++i)
+  {
+    if(apOld[i])
+      *FileCacheSlot(pCache, apOld[i]->szPath, apOld[i]->hash) = apOld[i];
+  }
+  FlyFreeIf(apOld);
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Read all inotify events (non-blocking) and mark their folders stale.
+-------------------------------------------------------------------------------------------------*/
+static void FileCacheDrainEvents(sFlyFileCache_t *pCache)
+{
+#ifdef __linux__
+  char                    aBuf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  const struct inotify_event *pEvent;
+  ssize_t                 len;
+  ssize_t                 i;
+  unsigned                j;
+
+  if(pCache->inotifyFd < 0)
+    return;
+
+  while((len = read(pCache->inotifyFd, aBuf, sizeof(aBuf))) > 0)
+  {
+    for(i = 0; i < len; i += (ssize_t)(sizeof(struct inotify_event) + pEvent->len))
+    {
+      pEvent = (const struct inotify_event *)&aBuf[i];
+
+      // lost events, so everything is suspect
+      if(pEvent->mask & IN_Q_OVERFLOW)
+      {
+        for(j = 0; j < pCache->hashSize; ++j)
+        {
+          if(pCache->apDirs[j])
+            pCache->apDirs[j]->fStale = TRUE;
+        }
+      }
+      else if(pEvent->wd >= 0 && (unsigned)pEvent->wd < pCache->wdMax && pCache->apWdDirs[pEvent->wd])
+      {
+        pCache->apWdDirs[pEvent->wd]->fStale = TRUE;
+        if(pEvent->mask & IN_IGNORED)
+        {
+          pCache->apWdDirs[pEvent->wd]->wd = -1;
+          pCache->apWdDirs[pEvent->wd] = NULL;
+        }
+      }
+    }
+  }
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Watch the folder for changes. On failure (e.g. out of watches), the mtime check is used.
+-------------------------------------------------------------------------------------------------*/
+static void FileCacheWatch(sFlyFileCache_t *pCache, fileCacheDir_t *pDir)
+{
+#ifdef __linux__
+  fileCacheDir_t  **apNew;
+  unsigned          newMax;
+  int               wd;
+
+  if(pCache->inotifyFd < 0 || pDir->wd >= 0)
+    return;
+
+  wd = inotify_add_watch(pCache->inotifyFd, *pDir->szPath ? pDir->szPath : ".", IN_CREATE | IN_DELETE |
+                         IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF |
+                         IN_ONLYDIR);
+  if(wd < 0)
+    return;
+
+  if((unsigned)wd >= pCache->wdMax)
+  {
+    newMax = pCache->wdMax ? pCache->wdMax : FILECACHE_HASH_MIN;
+    while(newMax <= (unsigned)wd)
+      newMax *= 2;
+    apNew = FlyRealloc(pCache->apWdDirs, newMax * sizeof(fileCacheDir_t *));
+    if(!apNew)
+    {
+      inotify_rm_watch(pCache->inotifyFd, wd);
+      return;
+    }
+    memset(&apNew[pCache->wdMax], 0, (newMax - pCache->wdMax) * sizeof(fileCacheDir_t *));
+    pCache->apWdDirs = apNew;
+    pCache->wdMax    = newMax;
+  }
+
+  // the same folder under another key (e.g. "./src/" and "src/") shares the watch, last one wins
+  if(pCache->apWdDirs[wd] && pCache->apWdDirs[wd] != pDir)
+    pCache->apWdDirs[wd]->wd = -1;
+  pCache->apWdDirs[wd] = pDir;
+  pDir->wd = wd;
+#endif
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Compare entries by name for qsort()
+-------------------------------------------------------------------------------------------------*/
+static int FileCacheCmpEntry(const void *pThis, const void *pThat)
+{
+  return strcmp(((const flyFileCacheEntry_t *)pThis)->szName, ((const flyFileCacheEntry_t *)pThat)->szName);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  (Re)load the folder listing and stats of each entry. Returns FALSE if folder can't be read.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCacheLoad(sFlyFileCache_t *pCache, fileCacheDir_t *pDir)
+{
+  DIR                  *pDirStream;
+  struct dirent        *pDirEnt;
+  struct stat           st;
+  flyFileCacheEntry_t  *aEntries  = NULL;
+  flyFileCacheEntry_t  *aNew;
+  char                 *pNames    = NULL;
+  char                 *pNew;
+  size_t                namesLen  = 0;
+  size_t                namesMax  = 0;
+  size_t                nameLen;
+  unsigned              n         = 0;
+  unsigned              nMax      = 0;
+  unsigned              i;
+  int                   fd;
+  bool_t                fWorked   = TRUE;
+
+  fd = open(*pDir->szPath ? pDir->szPath : ".", O_RDONLY | O_DIRECTORY);
+  if(fd < 0)
+    return FALSE;
+
+  // watch before reading, so no change is missed
+  FileCacheWatch(pCache, pDir);
+  if(fstat(fd, &st) == 0)
+  {
+#ifdef __APPLE__
+    pDir->mtime = st.st_mtimespec;
+#else
+    pDir->mtime = st.st_mtim;
+#endif
+    // file system clocks are coarse, so a change in the same tick may not alter the mtime
+    pDir->fRacy = (st.st_mtime + 1 >= time(NULL)) ? TRUE : FALSE;
+  }
+
+  pDirStream = fdopendir(fd);
+  if(!pDirStream)
+  {
+    close(fd);
+    return FALSE;
+  }
+
+  while(fWorked && (pDirEnt = readdir(pDirStream)) != NULL)
+  {
+    if(strcmp(pDirEnt->d_name, ".") == 0 || strcmp(pDirEnt->d_name, "..") == 0)
+      continue;
+    if(fstatat(fd, pDirEnt->d_name, &st, 0) != 0 && fstatat(fd, pDirEnt->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+      continue;
+
+    // grow entries and names, names are stored as offsets until done
+    nameLen = strlen(pDirEnt->d_name) + (S_ISDIR(st.st_mode) ? 2 : 1);
+    if(n >= nMax)
+    {
+      nMax = nMax ? nMax * 2 : 32;
+      aNew = FlyRealloc(aEntries, nMax * sizeof(flyFileCacheEntry_t));
+      if(!aNew)
+      {
+        fWorked = FALSE;
+        break;
+      }
+      aEntries = aNew;
+    }
+    if(namesLen + nameLen > namesMax)
+    {
+      namesMax = namesMax ? namesMax * 2 : 1024;
+      while(namesMax < namesLen + nameLen)
+        namesMax *= 2;
+      pNew = FlyRealloc(pNames, namesMax);
+      if(!pNew)
+      {
+        fWorked = FALSE;
+        break;
+      }
+      pNames = pNew;
+    }
+
+    strcpy(&pNames[namesLen], pDirEnt->d_name);
+    if(S_ISDIR(st.st_mode))
+      strcat(&pNames[namesLen], "/");
+    memset(&aEntries[n], 0, sizeof(aEntries[n]));
+    aEntries[n].szName  = (const char *)(uintptr_t)namesLen;
+    aEntries[n].fIsDir  = S_ISDIR(st.st_mode) ? TRUE : FALSE;
+    aEntries[n].size    = (uint64_t)st.st_size;
+    aEntries[n].modTime = st.st_mtime;
+    aEntries[n].mode    = (unsigned)st.st_mode;
+    namesLen += nameLen;
+    ++n;
+  }
+  closedir(pDirStream);
+
+  if(!fWorked)
+  {
+    FlyFreeIf(aEntries);
+    FlyFreeIf(pNames);
+    return FALSE;
+  }
+
+  for(i = 0; i < n; ++i)
+    aEntries[i].szName = &pNames[(uintptr_t)aEntries[i].szName];
+  if(n > 1)
+    qsort(aEntries, n, sizeof(flyFileCacheEntry_t), FileCacheCmpEntry);
+
+  FlyFreeIf(pDir->aEntries);
+  FlyFreeIf(pDir->pNames);
+  pDir->aEntries  = aEntries;
+  pDir->nEntries  = n;
+  pDir->pNames    = pNames;
+  pDir->fStale    = FALSE;
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Has an unwatched folder changed since loaded?
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCacheMTimeChanged(fileCacheDir_t *pDir)
+{
+  struct stat   st;
+  bool_t        fChanged = TRUE;
+
+  if(stat(*pDir->szPath ? pDir->szPath : ".", &st) == 0)
+  {
+#ifdef __APPLE__
+    fChanged = (st.st_mtimespec.tv_sec != pDir->mtime.tv_sec || st.st_mtimespec.tv_nsec != pDir->mtime.tv_nsec);
+#else
+    fChanged = (st.st_mtim.tv_sec != pDir->mtime.tv_sec || st.st_mtim.tv_nsec != pDir->mtime.tv_nsec);
+#endif
+  }
+  return fChanged;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Get the cached folder, loading or reloading it if needed. Returns NULL if folder can't be read.
+-------------------------------------------------------------------------------------------------*/
+static fileCacheDir_t * FileCacheGetDir(sFlyFileCache_t *pCache, const char *szFolder)
+{
+  fileCacheDir_t  **ppDir;
+  fileCacheDir_t   *pDir;
+  char             *szKey;
+  uint32_t          hash;
+
+  szKey = FileCacheKey(szFolder);
+  if(!szKey)
+    return NULL;
+  hash = FileCacheHash(szKey);
+
+  if(pCache->nDirs * 2 >= pCache->hashSize && !FileCacheGrow(pCache))
+  {
+    FlyFree(szKey);
+    return NULL;
+  }
+
+  ppDir = FileCacheSlot(pCache, szKey, hash);
+  pDir  = *ppDir;
+  if(pDir)
+  {
+    FlyFree(szKey);
+    if(pDir->wd < 0 && !pDir->fStale && (pDir->fRacy || FileCacheMTimeChanged(pDir)))
+      pDir->fStale = TRUE;
+    if(pDir->fStale && !FileCacheLoad(pCache, pDir))
+      pDir = NULL;
+  }
+  else
+  {
+    pDir = FlyAllocZ(sizeof(*pDir));
+    if(!pDir)
+      FlyFree(szKey);
+    else
+    {
+      pDir->szPath  = szKey;
+      pDir->hash    = hash;
+      pDir->wd      = -1;
+      if(FileCacheLoad(pCache, pDir))
+      {
+        *ppDir = pDir;
+        ++pCache->nDirs;
+      }
+      else
+      {
+        FlyFree(pDir->szPath);
+        FlyFree(pDir);
+        pDir = NULL;
+      }
+    }
+  }
+
+  return pDir;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Free a cached folder
+-------------------------------------------------------------------------------------------------*/
+static void FileCacheDirFree(fileCacheDir_t *pDir)
+{
+  FlyFreeIf(pDir->aEntries);
+  FlyFreeIf(pDir->pNames);
+  FlyFree(pDir->szPath);
+  FlyFree(pDir);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a pointer to a file cache?
+
+  @param    hCache    handle from FlyFileCacheNew()
+  @return   TRUE if a file cache handle
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileCacheIsCache(void *hCache)
+{
+  sFlyFileCache_t *pCache = hCache;
+  return (pCache && (pCache->sanchk == FLY_FILECACHE_SANCHK)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Create a folder listing and file stat cache.
+
+  @param    opts    0, or FLYFILECACHE_NO_WATCH to check folder mtimes rather than use inotify
+  @return   handle to cache, or NULL if out of memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileCacheNew(flyFileCacheOpts_t opts)
+{
+  sFlyFileCache_t *pCache;
+
+  pCache = FlyAllocZ(sizeof(*pCache));
+  if(pCache)
+  {
+    pCache->sanchk    = FLY_FILECACHE_SANCHK;
+    pCache->opts      = opts;
+    pCache->inotifyFd = -1;
+#ifdef __linux__
+    if(!(opts & FLYFILECACHE_NO_WATCH))
+      pCache->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+    if(!FileCacheGrow(pCache))
+      pCache = FlyFileCacheFree(pCache);
+  }
+
+  return pCache;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the listing of a folder, sorted by name. Folder names end in a slash. Includes hidden files,
+  but not "." or "..".
+
+  @param    hCache    handle from FlyFileCacheNew()
+  @param    szFolder  folder, e.g. "src/" or "."
+  @param    pLen      returned # of entries
+  @return   array of entries (valid until next call on cache), or NULL if folder can't be read
+*///-----------------------------------------------------------------------------------------------
+const flyFileCacheEntry_t * FlyFileCacheDir(void *hCache, const char *szFolder, unsigned *pLen)
+{
+  sFlyFileCache_t  *pCache  = hCache;
+  fileCacheDir_t   *pDir    = NULL;
+
+  if(FlyFileCacheIsCache(hCache) && szFolder)
+  {
+    FileCacheDrainEvents(pCache);
+    pDir = FileCacheGetDir(pCache, szFolder);
+  }
+  if(pLen)
+    *pLen = pDir ? pDir->nEntries : 0;
+
+  return pDir ? pDir->aEntries : NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Binary search of sorted folder entries for an exact name, e.g. "file.c" or "sub/".
+-------------------------------------------------------------------------------------------------*/
+static const flyFileCacheEntry_t * FileCacheSearch(const flyFileCacheEntry_t *aEntries, unsigned n,
+                                                   const char *szName)
+{
+  unsigned  lo;
+  unsigned  hi;
+  unsigned  mid;
+  int       cmp;
+
+  for(lo = 0, hi = n; aEntries && lo < hi; )
+  {
+    mid = lo + (hi - lo) / 2;
+    cmp = strcmp(aEntries[mid].szName, szName);
+    if(cmp == 0)
+      return &aEntries[mid];
+    if(cmp < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get cached stats of a file or folder, e.g. "src/file.c" or "src/subfolder/".
+
+  A folder may be given without the trailing slash, e.g. "src/subfolder".
+
+  @param    hCache    handle from FlyFileCacheNew()
+  @param    szPath    path to file or folder
+  @return   ptr to entry (valid until next call on cache), or NULL if not found
+*///-----------------------------------------------------------------------------------------------
+const flyFileCacheEntry_t * FlyFileCacheStat(void *hCache, const char *szPath)
+{
+  const flyFileCacheEntry_t  *aEntries;
+  const flyFileCacheEntry_t  *pFound    = NULL;
+  char                       *szFolder;
+  char                       *szName;
+  size_t                      pathLen;
+  size_t                      nameLen;
+  unsigned                    n;
+
+  if(!FlyFileCacheIsCache(hCache) || !szPath || !*szPath)
+    return NULL;
+
+  // split into folder and name, e.g. "src/sub/" is folder "src/", name "sub/"
+  // room for a copy of the name after the folder, plus a slash, e.g. "src/\0sub/\0"
+  pathLen = strlen(szPath);
+  szFolder = FlyAlloc(2 * pathLen + 3);
+  if(!szFolder)
+    return NULL;
+  nameLen = pathLen;
+  if(isslash(szPath[nameLen - 1]))
+    --nameLen;
+  while(nameLen && !isslash(szPath[nameLen - 1]))
+    --nameLen;
+  memcpy(szFolder, szPath, nameLen);
+  szFolder[nameLen] = '\0';
+  szName = &szFolder[nameLen + 1];
+  strcpy(szName, &szPath[nameLen]);
+
+  // folders are sorted as "sub/", and "sub.c" sorts between "sub" and "sub/", so a folder given
+  // without the slash needs a 2nd search
+  aEntries = FlyFileCacheDir(hCache, szFolder, &n);
+  pFound = FileCacheSearch(aEntries, n, szName);
+  nameLen = strlen(szName);
+  if(!pFound && nameLen && !isslash(szName[nameLen - 1]))
+  {
+    strcpy(&szName[nameLen], "/");
+    pFound = FileCacheSearch(aEntries, n, szName);
+    if(pFound && !pFound->fIsDir)
+      pFound = NULL;
+  }
+  FlyFree(szFolder);
+
+  return pFound;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Recursive part of FlyFileCacheFind(). szPath is a PATH_MAX buffer containing the folder.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCacheFind(sFlyFileCache_t *pCache, char *szPath, const char *szExtList, unsigned maxDepth,
+                            pfnFlyFileListRecurse_t pfnProcess, void *pData)
+{
+  fileCacheDir_t   *pDir;
+  size_t            pathLen = strlen(szPath);
+  unsigned          i;
+  bool_t            fContinue = TRUE;
+
+  pDir = FileCacheGetDir(pCache, szPath);
+  if(!pDir)
+    return TRUE;
+
+  // files in this folder first, then subfolders, like FlyFileListNewExts()
+  for(i = 0; fContinue && i < pDir->nEntries; ++i)
+  {
+    if(pDir->aEntries[i].fIsDir || *pDir->aEntries[i].szName == '.')
+      continue;
+    if(FlyFileListMatchExt(FlyStrPathExt(pDir->aEntries[i].szName), szExtList) &&
+       pathLen + strlen(pDir->aEntries[i].szName) < PATH_MAX)
+    {
+      strcpy(&szPath[pathLen], pDir->aEntries[i].szName);
+      fContinue = (*pfnProcess)(szPath, pData);
+      szPath[pathLen] = '\0';
+    }
+  }
+
+  for(i = 0; fContinue && maxDepth && i < pDir->nEntries; ++i)
+  {
+    if(!pDir->aEntries[i].fIsDir || *pDir->aEntries[i].szName == '.')
+      continue;
+    if(pathLen + strlen(pDir->aEntries[i].szName) < PATH_MAX)
+    {
+      strcpy(&szPath[pathLen], pDir->aEntries[i].szName);
+      fContinue = FileCacheFind(pCache, szPath, szExtList, maxDepth - 1, pfnProcess, pData);
+      szPath[pathLen] = '\0';
+    }
+  }
+
+  return fContinue;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Find files with the given extensions, like FlyFileListNewExts(), but from the cache. Calls
+  pfnProcess with each path, e.g. "src/sub/file.c". Hidden files and folders are skipped.
+
+  @param    hCache      handle from FlyFileCacheNew()
+  @param    szFolder    folder, e.g. "src/" or "."
+  @param    szExtList   list of file extensions, separated by dots, e.g. ".c.h"
+  @param    maxDepth    0 means just the folder, UINT_MAX for all subfolders
+  @param    pfnProcess  called for each matching file, returns FALSE to stop
+  @param    pData       passed to pfnProcess
+  @return   TRUE if finished, FALSE if stopped by pfnProcess, or folder can't be read
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileCacheFind(void *hCache, const char *szFolder, const char *szExtList, unsigned maxDepth,
+                        pfnFlyFileListRecurse_t pfnProcess, void *pData)
+{
+  sFlyFileCache_t  *pCache  = hCache;
+  char             *szPath;
+  bool_t            fWorked = FALSE;
+
+  if(!FlyFileCacheIsCache(hCache) || !szFolder || !szExtList || !pfnProcess)
+    return FALSE;
+
+  szPath = FileCacheKey(szFolder);
+  if(szPath && strlen(szPath) < PATH_MAX)
+  {
+    FileCacheDrainEvents(pCache);
+    if(FileCacheGetDir(pCache, szPath))
+    {
+      // the path grows as subfolders are searched
+      FlyFree(szPath);
+      szPath = FlyAlloc(PATH_MAX);
+      if(szPath)
+      {
+        FlyStrZCpy(szPath, szFolder, PATH_MAX);
+        if(strcmp(szPath, ".") == 0)
+          *szPath = '\0';
+        else if(*szPath && !isslash(FlyStrCharLast(szPath)))
+          FlyStrZCat(szPath, "/", PATH_MAX);
+        fWorked = FileCacheFind(pCache, szPath, szExtList, maxDepth, pfnProcess, pData);
+      }
+    }
+  }
+  FlyFreeIf(szPath);
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Forget all cached folders, e.g. to free memory. The cache can still be used.
+
+  @param    hCache    handle from FlyFileCacheNew()
+  @return   none
+*///-----------------------------------------------------------------------------------------------
+void FlyFileCacheFlush(void *hCache)
+{
+  sFlyFileCache_t  *pCache = hCache;
+  unsigned          i;
+
+  if(FlyFileCacheIsCache(hCache))
+  {
+    for(i = 0; i < pCache->hashSize; ++i)
+    {
+      if(pCache->apDirs[i])
+      {
+#ifdef __linux__
+        if(pCache->apDirs[i]->wd >= 0)
+          inotify_rm_watch(pCache->inotifyFd, pCache->apDirs[i]->wd);
+#endif
+        FileCacheDirFree(pCache->apDirs[i]);
+        pCache->apDirs[i] = NULL;
+      }
+    }
+    pCache->nDirs = 0;
+    if(pCache->apWdDirs)
+      memset(pCache->apWdDirs, 0, pCache->wdMax * sizeof(fileCacheDir_t *));
+  }
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free the cache and its inotify watches.
+
+  @param    hCache    handle from FlyFileCacheNew()
+  @return   NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileCacheFree(void *hCache)
+{
+  sFlyFileCache_t  *pCache = hCache;
+
+  if(FlyFileCacheIsCache(hCache))
+  {
+    FlyFileCacheFlush(hCache);
+    if(pCache->inotifyFd >= 0)
+      close(pCache->inotifyFd);
+    FlyFreeIf(pCache->apDirs);
+    FlyFreeIf(pCache->apWdDirs);
+    memset(pCache, 0, sizeof(*pCache));
+    FlyFree(pCache);
+  }
+
+  return NULL;
+}
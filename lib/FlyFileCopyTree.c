@@ -0,0 +1,323 @@
+/**************************************************************************************************
+  FlyFileCopyTree.c - Copy a whole folder tree, copying files in parallel
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileCopyTree   Copy a whole folder tree, copying files in parallel
+
+  The tree is walked once to create the folders and symbolic links, then the files are copied by a
+  pool of threads using FlyFileCopyEx(), so the kernel fast paths (reflink, copy_file_range(),
+  sendfile()) are used for each file. Link with -lpthread.
+
+  @example FlyFileCopyTree Stage build artifacts
+
+  ```
+  #include "FlyFile.h"
+
+  if(!FlyFileCopyTree("staging/", "build/out/", FLYFILE_COPY_PRESERVE, 0))
+    printf("copy failed\n");
+  ```
+*/
+
+#define FILECOPYTREE_MAX_THREADS  32
+
+typedef struct
+{
+  char                 *szIn;
+  char                 *szOut;
+  mode_t                mode;     // for folders only
+  struct timespec       aTimes[2];
+} fileCopyTreeItem_t;
+
+typedef struct
+{
+  fileCopyTreeItem_t   *aFiles;
+  unsigned              nFiles;
+  unsigned              maxFiles;
+  fileCopyTreeItem_t   *aDirs;
+  unsigned              nDirs;
+  unsigned              maxDirs;
+  dev_t                 outDev;   // don't copy the output folder into itself
+  ino_t                 outIno;
+  flyFileCopyOpts_t     opts;
+  pthread_mutex_t       mutex;
+  unsigned              next;     // next file to copy
+  bool_t                fFailed;
+} fileCopyTree_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Allocate "szFolder/szName" (szFolder has no trailing slash). Returns NULL if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static char * FileCopyTreePath(const char *szFolder, const char *szName)
+{
+  char     *szPath;
+  size_t    size;
+
+  size = strlen(szFolder) + 1 + strlen(szName) + 1;
+  szPath = FlyAlloc(size);
+  if(szPath)
+  {
+    strcpy(szPath, szFolder);
+    FlyStrPathAppend(szPath, szName, size);
+  }
+  return szPath;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Add an item to a growable array. Takes ownership of szIn, szOut. Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCopyTreeAdd(fileCopyTreeItem_t **paItems, unsigned *pnItems, unsigned *pMax,
+                              char *szIn, char *szOut, const struct stat *pSt)
+{
+  fileCopyTreeItem_t   *aNew;
+  unsigned              newMax;
+
+  if(*pnItems >= *pMax)
+  {
+    newMax = *pMax ? *pMax * 2 : 64;
+    aNew = FlyRealloc(*paItems, newMax * sizeof(fileCopyTreeItem_t));
+    if(!aNew)
+    {
+      FlyFree(szIn);
+      FlyFree(szOut);
+      return FALSE;
+    }
+    *paItems = aNew;
+    *pMax    = newMax;
+  }
+
+  (*paItems)[*pnItems].szIn   = szIn;
+  (*paItems)[*pnItems].szOut  = szOut;
+  (*paItems)[*pnItems].mode   = pSt->st_mode & 07777;
+#ifdef __APPLE__
+  (*paItems)[*pnItems].aTimes[0] = pSt->st_atimespec;
+  (*paItems)[*pnItems].aTimes[1] = pSt->st_mtimespec;
+#else
+  (*paItems)[*pnItems].aTimes[0] = pSt->st_atim;
+  (*paItems)[*pnItems].aTimes[1] = pSt->st_mtim;
+#endif
+  ++(*pnItems);
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Create szOut folder, then walk szIn, making subfolders and symlinks and collecting files to copy.
+  Returns FALSE if anything failed.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileCopyTreeWalk(fileCopyTree_t *pTree, const char *szIn, const char *szOut)
+{
+  DIR              *pDir;
+  struct dirent    *pEntry;
+  struct stat       st;
+  char             *szInPath;
+  char             *szOutPath;
+  char              szLink[PATH_MAX];
+  ssize_t           len;
+  bool_t            fWorked = TRUE;
+
+  if(mkdir(szOut, S_IRWXU | S_IRWXG | S_IRWXO) != 0 && !FlyFileExistsFolder(szOut))
+    return FALSE;
+
+  pDir = opendir(szIn);
+  if(!pDir)
+    return FALSE;
+
+  while((pEntry = readdir(pDir)) != NULL)
+  {
+    if(strcmp(pEntry->d_name, ".") == 0 || strcmp(pEntry->d_name, "..") == 0)
+      continue;
+
+    szInPath  = FileCopyTreePath(szIn, pEntry->d_name);
+    szOutPath = FileCopyTreePath(szOut, pEntry->d_name);
+    if(!szInPath || !szOutPath || lstat(szInPath, &st) != 0)
+    {
+      FlyFreeIf(szInPath);
+      FlyFreeIf(szOutPath);
+      fWorked = FALSE;
+      continue;
+    }
+
+    if(S_ISDIR(st.st_mode))
+    {
+      if(st.st_dev == pTree->outDev && st.st_ino == pTree->outIno)
+      {
+        FlyFree(szInPath);
+        FlyFree(szOutPath);
+        continue;
+      }
+      if(!FileCopyTreeWalk(pTree, szInPath, szOutPath))
+        fWorked = FALSE;
+      if(!FileCopyTreeAdd(&pTree->aDirs, &pTree->nDirs, &pTree->maxDirs, szInPath, szOutPath, &st))
+        fWorked = FALSE;
+    }
+    else if(S_ISREG(st.st_mode))
+    {
+      if(!FileCopyTreeAdd(&pTree->aFiles, &pTree->nFiles, &pTree->maxFiles, szInPath, szOutPath, &st))
+        fWorked = FALSE;
+    }
+    else
+    {
+      // symbolic links are recreated, other special files (fifos, devices, sockets) are skipped
+      if(S_ISLNK(st.st_mode))
+      {
+        len = readlink(szInPath, szLink, sizeof(szLink) - 1);
+        if(len >= 0)
+        {
+          szLink[len] = '\0';
+          unlink(szOutPath);
+        }
+        if(len < 0 || symlink(szLink, szOutPath) != 0)
+          fWorked = FALSE;
+      }
+      FlyFree(szInPath);
+      FlyFree(szOutPath);
+    }
+  }
+  closedir(pDir);
+
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Worker thread, copies files until there are none left.
+-------------------------------------------------------------------------------------------------*/
+static void * FileCopyTreeWorker(void *pArg)
+{
+  fileCopyTree_t   *pTree = pArg;
+  unsigned          i;
+
+  while(TRUE)
+  {
+    pthread_mutex_lock(&pTree->mutex);
+    i = pTree->next++;
+    pthread_mutex_unlock(&pTree->mutex);
+    if(i >= pTree->nFiles)
+      break;
+
+    if(!FlyFileCopyEx(pTree->aFiles[i].szOut, pTree->aFiles[i].szIn, pTree->opts))
+    {
+      pthread_mutex_lock(&pTree->mutex);
+      pTree->fFailed = TRUE;
+      pthread_mutex_unlock(&pTree->mutex);
+    }
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Copy a folder tree. Files are copied in parallel using FlyFileCopyEx(). Symbolic links are
+  recreated as links. Other special files are skipped.
+
+  Existing files in szOutFolder are overwritten, other files are left alone. If FLYFILE_COPY_MODE
+  or FLYFILE_COPY_TIMES is set, folders get their mode and times after all files are copied.
+
+  @param    szOutFolder   folder to copy to, created if needed, e.g. "staging/"
+  @param    szInFolder    folder to copy from, e.g. "build/out"
+  @param    opts          0, or FLYFILE_COPY_MODE and/or FLYFILE_COPY_TIMES
+  @param    nThreads      number of threads to copy with, 0 means 1 per CPU
+  @return   TRUE if everything was copied, FALSE if anything failed
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileCopyTree(const char *szOutFolder, const char *szInFolder, flyFileCopyOpts_t opts, unsigned nThreads)
+{
+  fileCopyTree_t    tree;
+  pthread_t         aThreads[FILECOPYTREE_MAX_THREADS];
+  struct stat       st;
+  char             *szIn;
+  char             *szOut;
+  unsigned          nStarted = 0;
+  unsigned          i;
+  long              nCpus;
+
+  if(!FlyFileExistsFolder(szInFolder))
+    return FALSE;
+
+  memset(&tree, 0, sizeof(tree));
+  tree.opts = opts;
+  pthread_mutex_init(&tree.mutex, NULL);
+
+  // walk without trailing slashes, so paths are "folder/name"
+  szIn  = FlyStrClone(szInFolder);
+  szOut = FlyStrClone(szOutFolder);
+  if(!szIn || !szOut)
+  {
+    FlyFreeIf(szIn);
+    FlyFreeIf(szOut);
+    tree.fFailed = TRUE;
+  }
+  else
+  {
+    if(strlen(szIn) > 1 && isslash(FlyStrCharLast(szIn)))
+      szIn[strlen(szIn) - 1] = '\0';
+    if(strlen(szOut) > 1 && isslash(FlyStrCharLast(szOut)))
+      szOut[strlen(szOut) - 1] = '\0';
+    if(mkdir(szOut, S_IRWXU | S_IRWXG | S_IRWXO) != 0 && !FlyFileExistsFolder(szOut))
+      tree.fFailed = TRUE;
+    else if(stat(szOut, &st) == 0)
+    {
+      tree.outDev = st.st_dev;
+      tree.outIno = st.st_ino;
+    }
+    if(!tree.fFailed && !FileCopyTreeWalk(&tree, szIn, szOut))
+      tree.fFailed = TRUE;
+    if(!tree.fFailed && stat(szIn, &st) == 0)
+      FileCopyTreeAdd(&tree.aDirs, &tree.nDirs, &tree.maxDirs, szIn, szOut, &st);
+    else
+    {
+      FlyFree(szIn);
+      FlyFree(szOut);
+    }
+  }
+
+  // copy files in parallel, this thread is also a worker
+  if(nThreads == 0)
+  {
+    nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nThreads = (nCpus > 0) ? (unsigned)nCpus : 1;
+  }
+  if(nThreads > tree.nFiles)
+    nThreads = tree.nFiles ? tree.nFiles : 1;
+  if(nThreads > FILECOPYTREE_MAX_THREADS)
+    nThreads = FILECOPYTREE_MAX_THREADS;
+  for(i = 1; i < nThreads; ++i)
+  {
+    if(pthread_create(&aThreads[nStarted], NULL, FileCopyTreeWorker, &tree) == 0)
+      ++nStarted;
+  }
+  FileCopyTreeWorker(&tree);
+  for(i = 0; i < nStarted; ++i)
+    pthread_join(aThreads[i], NULL);
+
+  // folders are done deepest first, after the files, so read-only folders don't block the copy
+  for(i = 0; i < tree.nDirs; ++i)
+  {
+    if((opts & FLYFILE_COPY_MODE) && chmod(tree.aDirs[i].szOut, tree.aDirs[i].mode) != 0)
+      tree.fFailed = TRUE;
+    if((opts & FLYFILE_COPY_TIMES) && utimensat(AT_FDCWD, tree.aDirs[i].szOut, tree.aDirs[i].aTimes, 0) != 0)
+      tree.fFailed = TRUE;
+    FlyFree(tree.aDirs[i].szIn);
+    FlyFree(tree.aDirs[i].szOut);
+  }
+  for(i = 0; i < tree.nFiles; ++i)
+  {
+    FlyFree(tree.aFiles[i].szIn);
+    FlyFree(tree.aFiles[i].szOut);
+  }
+  FlyFreeIf(tree.aDirs);
+  FlyFreeIf(tree.aFiles);
+  pthread_mutex_destroy(&tree.mutex);
+
+  return tree.fFailed ? FALSE : TRUE;
+}
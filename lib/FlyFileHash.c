@@ -0,0 +1,852 @@
+/**************************************************************************************************
+  FlyFileHash.c - Fast content fingerprints of files, with an optional persisted fingerprint database
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileHash   Fast content fingerprints of files
+
+  A file's modification time alone can't tell if a file really changed: `touch` changes the time
+  but not the contents, and clocks skew between machines. FlyFileHash computes a 64-bit content
+  fingerprint instead.
+
+  1. The hash is XXH64 (non-cryptographic), which runs at memory speed: 4 independent 64-bit lanes
+     let the CPU pipeline the multiplies
+  2. The hash can be streamed (FlyFileHashInit/Update/Final), done on memory, or done on files,
+     which are mapped with FlyFileMap() rather than copied
+  3. FlyFileHashFiles() hashes many files in parallel
+  4. A fingerprint database (FlyFileHashDbNew()) remembers path, size, mtime and hash, so files
+     whose size and mtime haven't changed are not read again
+  5. FlyFileHashDbCheck() only looks. FlyFileHashDbUpdate() records a file once it's been built,
+     so a file whose build failed is still reported changed next time
+
+  Never use this hash for security, see FlySec.h for that.
+
+  @example FlyFileHash Rebuild only sources whose contents changed
+
+  ```
+  #include "FlyFile.h"
+
+  void     *hDb = FlyFileHashDbNew(".flymake.db");
+  uint64_t  hash;
+
+  for(i = 0; i < nSrcs; ++i)
+  {
+    if(FlyFileHashDbCheck(hDb, aszSrcs[i], &hash) && Compile(aszSrcs[i]))
+      FlyFileHashDbUpdate(hDb, aszSrcs[i]);
+  }
+  FlyFileHashDbSave(hDb);
+  FlyFileHashDbFree(hDb);
+  ```
+*/
+
+#define FLY_FILEHASHDB_SANCHK     16161
+#define FILEHASH_MAX_THREADS      32
+#define FILEHASH_DB_HEADER        "flyhashdb 1\n"
+
+#define FILEHASH_P1   11400714785074694791ULL
+#define FILEHASH_P2   14029467366897019727ULL
+#define FILEHASH_P3    1609587929392839161ULL
+#define FILEHASH_P4    9650029242287828579ULL
+#define FILEHASH_P5    2870177450012600261ULL
+
+typedef struct
+{
+  char                 *szPath;
+  uint32_t              pathHash;
+  uint64_t              size;
+  int64_t               mtimeSec;     // 0 if mtime can't be trusted (file changed while hashed)
+  long                  mtimeNsec;
+  uint64_t              hash;
+  bool_t                fDeleted;     // not in database (deleted, or only checked so far)
+  bool_t                fPending;     // pend fields are from FlyFileHashDbCheck(), not yet updated
+  uint64_t              pendSize;
+  int64_t               pendSec;
+  long                  pendNsec;
+  uint64_t              pendHash;
+} fileHashRec_t;
+
+typedef struct
+{
+  unsigned              sanchk;
+  char                 *szDbFile;     // NULL if in memory only
+  fileHashRec_t        *aRecs;
+  unsigned              nRecs;
+  unsigned              maxRecs;
+  unsigned             *aIndex;       // open address hash table of indexes into aRecs
+  unsigned              indexSize;    // power of 2
+  bool_t                fDirty;
+} sFlyFileHashDb_t;
+
+typedef struct
+{
+  const char          **aszPaths;
+  uint64_t             *aHashes;
+  unsigned              n;
+  unsigned              next;
+  unsigned              nHashed;
+  pthread_mutex_t       mutex;
+} fileHashJob_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Rotate left
+-------------------------------------------------------------------------------------------------*/
+static inline uint64_t FileHashRotl(uint64_t x, unsigned r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Read unaligned little endian 64 and 32 bit values
+-------------------------------------------------------------------------------------------------*/
+static inline uint64_t FileHashRead64(const uint8_t *p)
+{
+  uint64_t  val;
+  memcpy(&val, p, sizeof(val));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  val = __builtin_bswap64(val);
+#endif
+  return val;
+}
+
+static inline uint32_t FileHashRead32(const uint8_t *p)
+{
+  uint32_t  val;
+  memcpy(&val, p, sizeof(val));
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  val = __builtin_bswap32(val);
+#endif
+  return val;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Mix one 64-bit input into a lane
+-------------------------------------------------------------------------------------------------*/
+static inline uint64_t FileHashRound(uint64_t acc, uint64_t input)
+{
+  acc += input * FILEHASH_P2;
+  acc  = FileHashRotl(acc, 31);
+  return acc * FILEHASH_P1;
+}
+
+static inline uint64_t FileHashMerge(uint64_t acc, uint64_t val)
+{
+  acc ^= FileHashRound(0, val);
+  return acc * FILEHASH_P1 + FILEHASH_P4;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Process whole 32 byte stripes. Returns ptr past last stripe.
+-------------------------------------------------------------------------------------------------*/
+static const uint8_t * FileHashStripes(uint64_t aLanes[4], const uint8_t *p, const uint8_t *pEnd)
+{
+  uint64_t  v1 = aLanes[0];
+  uint64_t  v2 = aLanes[1];
+  uint64_t  v3 = aLanes[2];
+  uint64_t  v4 = aLanes[3];
+
+  while(pEnd - p >= 32)
+  {
+    v1 = FileHashRound(v1, FileHashRead64(p));
+    v2 = FileHashRound(v2, FileHashRead64(p + 8));
+    v3 = FileHashRound(v3, FileHashRead64(p + 16));
+    v4 = FileHashRound(v4, FileHashRead64(p + 24));
+    p += 32;
+  }
+  aLanes[0] = v1;
+  aLanes[1] = v2;
+  aLanes[2] = v3;
+  aLanes[3] = v4;
+
+  return p;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Start a streaming hash.
+
+  @param    pState    state to initialize
+  @param    seed      seed, usually 0
+  @return   none
+*///-----------------------------------------------------------------------------------------------
+void FlyFileHashInit(flyFileHash_t *pState, uint64_t seed)
+{
+  memset(pState, 0, sizeof(*pState));
+  pState->seed      = seed;
+  pState->aLanes[0] = seed + FILEHASH_P1 + FILEHASH_P2;
+  pState->aLanes[1] = seed + FILEHASH_P2;
+  pState->aLanes[2] = seed;
+  pState->aLanes[3] = seed - FILEHASH_P1;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Add data to a streaming hash. The result is the same no matter how the data is split up.
+
+  @param    pState    state from FlyFileHashInit()
+  @param    pData     data to hash
+  @param    len       length of data
+  @return   none
+*///-----------------------------------------------------------------------------------------------
+void FlyFileHashUpdate(flyFileHash_t *pState, const void *pData, size_t len)
+{
+  const uint8_t  *p     = pData;
+  const uint8_t  *pEnd  = p + len;
+  size_t          n;
+
+  pState->totalLen += len;
+
+  // finish a partial stripe from the last update
+  if(pState->bufLen)
+  {
+    n = sizeof(pState->aBuf) - pState->bufLen;
+    if(n > len)
+      n = len;
+    memcpy(&pState->aBuf[pState->bufLen], p, n);
+    pState->bufLen += (unsigned)n;
+    p += n;
+    if(pState->bufLen < sizeof(pState->aBuf))
+      return;
+    FileHashStripes(pState->aLanes, pState->aBuf, pState->aBuf + sizeof(pState->aBuf));
+    pState->bufLen = 0;
+  }
+
+  p = FileHashStripes(pState->aLanes, p, pEnd);
+  if(p < pEnd)
+  {
+    memcpy(pState->aBuf, p, (size_t)(pEnd - p));
+    pState->bufLen = (unsigned)(pEnd - p);
+  }
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the hash of all data added so far. The state is not changed, so more data may be added.
+
+  @param    pState    state from FlyFileHashInit()
+  @return   64-bit hash
+*///-----------------------------------------------------------------------------------------------
+uint64_t FlyFileHashFinal(const flyFileHash_t *pState)
+{
+  const uint8_t  *p     = pState->aBuf;
+  const uint8_t  *pEnd  = p + pState->bufLen;
+  uint64_t        h;
+
+  if(pState->totalLen >= 32)
+  {
+    h = FileHashRotl(pState->aLanes[0], 1) + FileHashRotl(pState->aLanes[1], 7) +
+        FileHashRotl(pState->aLanes[2], 12) + FileHashRotl(pState->aLanes[3], 18);
+    h = FileHashMerge(h, pState->aLanes[0]);
+    h = FileHashMerge(h, pState->aLanes[1]);
+    h = FileHashMerge(h, pState->aLanes[2]);
+    h = FileHashMerge(h, pState->aLanes[3]);
+  }
+  else
+    h = pState->seed + FILEHASH_P5;
+  h += pState->totalLen;
+
+  while(pEnd - p >= 8)
+  {
+    h ^= FileHashRound(0, FileHashRead64(p));
+    h  = FileHashRotl(h, 27) * FILEHASH_P1 + FILEHASH_P4;
+    p += 8;
+  }
+  if(pEnd - p >= 4)
+  {
+    h ^= (uint64_t)FileHashRead32(p) * FILEHASH_P1;
+    h  = FileHashRotl(h, 23) * FILEHASH_P2 + FILEHASH_P3;
+    p += 4;
+  }
+  while(p < pEnd)
+  {
+    h ^= (*p++) * FILEHASH_P5;
+    h  = FileHashRotl(h, 11) * FILEHASH_P1;
+  }
+
+  // avalanche
+  h ^= h >> 33;
+  h *= FILEHASH_P2;
+  h ^= h >> 29;
+  h *= FILEHASH_P3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Hash a block of memory (XXH64 with seed 0).
+
+  @param    pData     data to hash
+  @param    len       length of data
+  @return   64-bit hash
+*///-----------------------------------------------------------------------------------------------
+uint64_t FlyFileHashMem(const void *pData, size_t len)
+{
+  flyFileHash_t   state;
+
+  FlyFileHashInit(&state, 0);
+  FlyFileHashUpdate(&state, pData, len);
+  return FlyFileHashFinal(&state);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Hash the contents of a file. The file is mapped, not copied. Same as FlyFileHashMem() of contents.
+
+  @param    szFilename    file to hash
+  @param    pHash         returned hash
+  @return   TRUE if worked, FALSE if file couldn't be read
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileHashFile(const char *szFilename, uint64_t *pHash)
+{
+  flyFileMap_t  map;
+
+  if(!FlyFileMap(&map, szFilename, FLYFILEMAP_SEQUENTIAL | FLYFILEMAP_WILLNEED))
+    return FALSE;
+  *pHash = FlyFileHashMem(map.pData, map.len);
+  FlyFileUnmap(&map);
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Worker thread, hashes files until there are none left.
+-------------------------------------------------------------------------------------------------*/
+static void * FileHashWorker(void *pArg)
+{
+  fileHashJob_t  *pJob = pArg;
+  unsigned        i;
+  bool_t          fWorked;
+
+  while(TRUE)
+  {
+    pthread_mutex_lock(&pJob->mutex);
+    i = pJob->next++;
+    pthread_mutex_unlock(&pJob->mutex);
+    if(i >= pJob->n)
+      break;
+
+    fWorked = FlyFileHashFile(pJob->aszPaths[i], &pJob->aHashes[i]);
+    if(!fWorked)
+      pJob->aHashes[i] = 0;
+    pthread_mutex_lock(&pJob->mutex);
+    if(fWorked)
+      ++pJob->nHashed;
+    pthread_mutex_unlock(&pJob->mutex);
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Hash many files in parallel. Link with -lpthread.
+
+  @param    aszPaths    array of n file paths
+  @param    aHashes     returned array of n hashes, 0 for files that couldn't be read
+  @param    n           number of files
+  @param    nThreads    number of threads, 0 means 1 per CPU
+  @return   number of files hashed (n if all worked)
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyFileHashFiles(const char **aszPaths, uint64_t *aHashes, unsigned n, unsigned nThreads)
+{
+  fileHashJob_t   job;
+  pthread_t       aThreads[FILEHASH_MAX_THREADS];
+  unsigned        nStarted = 0;
+  unsigned        i;
+  long            nCpus;
+
+  memset(&job, 0, sizeof(job));
+  job.aszPaths  = aszPaths;
+  job.aHashes   = aHashes;
+  job.n         = n;
+  pthread_mutex_init(&job.mutex, NULL);
+
+  // this thread is also a worker
+  if(nThreads == 0)
+  {
+    nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+    nThreads = (nCpus > 0) ? (unsigned)nCpus : 1;
+  }
+  if(nThreads > n)
+    nThreads = n ? n : 1;
+  if(nThreads > FILEHASH_MAX_THREADS)
+    nThreads = FILEHASH_MAX_THREADS;
+  for(i = 1; i < nThreads; ++i)
+  {
+    if(pthread_create(&aThreads[nStarted], NULL, FileHashWorker, &job) == 0)
+      ++nStarted;
+  }
+  FileHashWorker(&job);
+  for(i = 0; i < nStarted; ++i)
+    pthread_join(aThreads[i], NULL);
+  pthread_mutex_destroy(&job.mutex);
+
+  return job.nHashed;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  FNV-1a hash of a path, for the database index
+-------------------------------------------------------------------------------------------------*/
+static uint32_t FileHashPathHash(const char *sz)
+{
+  uint32_t  hash = 2166136261u;
+
+  while(*sz)
+  {
+    hash ^= (uint8_t)*sz++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find the index slot for a path. Returns ptr to slot, which is UINT_MAX if path not in database.
+-------------------------------------------------------------------------------------------------*/
+static unsigned * FileHashDbSlot(sFlyFileHashDb_t *pDb, const char *szPath, uint32_t pathHash)
+{
+  unsigned   *pSlot;
+  unsigned    i = pathHash & (pDb->indexSize - 1);
+
+  while(TRUE)
+  {
+    pSlot = &pDb->aIndex[i];
+    if(*pSlot == UINT_MAX ||
+       (pDb->aRecs[*pSlot].pathHash == pathHash && strcmp(pDb->aRecs[*pSlot].szPath, szPath) == 0))
+      break;
+    i = (i + 1) & (pDb->indexSize - 1);
+  }
+  return pSlot;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Double the index (kept at most half full). Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileHashDbGrow(sFlyFileHashDb_t *pDb)
+{
+  unsigned   *aNewIndex;
+  unsigned    newSize;
+  unsigned    i;
+
+  newSize = pDb->indexSize ? pDb->indexSize * 2 : 256;
+  aNewIndex = FlyAlloc(newSize * sizeof(unsigned));
+  if(!aNewIndex)
+    return FALSE;
+  memset(aNewIndex, 0xff, newSize * sizeof(unsigned));
+  FlyFreeIf(pDb->aIndex);
+  pDb->aIndex     = aNewIndex;
+  pDb->indexSize  = newSize;
+  for(i = 0; i < pDb->nRecs; ++i)
+    *FileHashDbSlot(pDb, pDb->aRecs[i].szPath, pDb->aRecs[i].pathHash) = i;
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Add a record (path not already in database). Takes ownership of szPath. Returns record or NULL.
+-------------------------------------------------------------------------------------------------*/
+static fileHashRec_t * FileHashDbAdd(sFlyFileHashDb_t *pDb, char *szPath)
+{
+  fileHashRec_t  *aNewRecs;
+  unsigned        newSize;
+  uint32_t        pathHash;
+
+  if(!szPath)
+    return NULL;
+  pathHash = FileHashPathHash(szPath);
+  if((pDb->nRecs + 1) * 2 > pDb->indexSize && !FileHashDbGrow(pDb))
+  {
+    FlyFree(szPath);
+    return NULL;
+  }
+  if(pDb->nRecs >= pDb->maxRecs)
+  {
+    newSize = pDb->maxRecs ? pDb->maxRecs * 2 : 128;
+    aNewRecs = FlyRealloc(pDb->aRecs, newSize * sizeof(fileHashRec_t));
+    if(!aNewRecs)
+    {
+      FlyFree(szPath);
+      return NULL;
+    }
+    pDb->aRecs    = aNewRecs;
+    pDb->maxRecs  = newSize;
+  }
+
+  *FileHashDbSlot(pDb, szPath, pathHash) = pDb->nRecs;
+  memset(&pDb->aRecs[pDb->nRecs], 0, sizeof(fileHashRec_t));
+  pDb->aRecs[pDb->nRecs].szPath   = szPath;
+  pDb->aRecs[pDb->nRecs].pathHash = pathHash;
+
+  return &pDb->aRecs[pDb->nRecs++];
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Load the database file. Each line is "hash size sec.nsec path". Bad lines are ignored.
+-------------------------------------------------------------------------------------------------*/
+static void FileHashDbLoad(sFlyFileHashDb_t *pDb)
+{
+  flyFileMap_t    map;
+  fileHashRec_t  *pRec;
+  const char     *szLine;
+  const char     *pEol;
+  char           *pEnd;
+  char           *szPath;
+  uint64_t        hash;
+  uint64_t        size;
+  int64_t         sec;
+  long            nsec;
+
+  if(!FlyFileMap(&map, pDb->szDbFile, FLYFILEMAP_SEQUENTIAL))
+    return;
+
+  if(strncmp(map.pData, FILEHASH_DB_HEADER, strlen(FILEHASH_DB_HEADER)) == 0)
+  {
+    for(szLine = map.pData + strlen(FILEHASH_DB_HEADER); *szLine; szLine = pEol + 1)
+    {
+      pEol = strchr(szLine, '\n');
+      if(!pEol)
+        break;
+      hash = strtoull(szLine, &pEnd, 16);
+      if(*pEnd != ' ')
+        continue;
+      size = strtoull(pEnd + 1, &pEnd, 10);
+      if(*pEnd != ' ')
+        continue;
+      sec = strtoll(pEnd + 1, &pEnd, 10);
+      if(*pEnd != '.')
+        continue;
+      nsec = strtol(pEnd + 1, &pEnd, 10);
+      if(*pEnd != ' ' || pEnd + 1 >= pEol)
+        continue;
+      szPath = FlyStrAllocN(pEnd + 1, (size_t)(pEol - (pEnd + 1)));
+      if(szPath && *FileHashDbSlot(pDb, szPath, FileHashPathHash(szPath)) != UINT_MAX)
+      {
+        FlyFree(szPath);
+        continue;
+      }
+      if(!szPath || (pRec = FileHashDbAdd(pDb, szPath)) == NULL)
+        break;
+      pRec->hash      = hash;
+      pRec->size      = size;
+      pRec->mtimeSec  = sec;
+      pRec->mtimeNsec = nsec;
+    }
+  }
+
+  FlyFileUnmap(&map);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a pointer to a fingerprint database?
+
+  @param    hDb     handle from FlyFileHashDbNew()
+  @return   TRUE if a fingerprint database handle
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileHashDbIsDb(void *hDb)
+{
+  sFlyFileHashDb_t *pDb = hDb;
+  return (pDb && (pDb->sanchk == FLY_FILEHASHDB_SANCHK)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Open a fingerprint database. The file is loaded if it exists, otherwise the database starts empty.
+
+  @param    szDbFile    file to load from and save to, or NULL for in memory only
+  @return   handle to database, or NULL if out of memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileHashDbNew(const char *szDbFile)
+{
+  sFlyFileHashDb_t *pDb;
+
+  pDb = FlyAllocZ(sizeof(*pDb));
+  if(pDb)
+  {
+    pDb->sanchk = FLY_FILEHASHDB_SANCHK;
+    if(!FileHashDbGrow(pDb))
+      pDb = FlyFileHashDbFree(pDb);
+    else if(szDbFile)
+    {
+      pDb->szDbFile = FlyStrClone(szDbFile);
+      if(!pDb->szDbFile)
+        pDb = FlyFileHashDbFree(pDb);
+      else
+        FileHashDbLoad(pDb);
+    }
+  }
+
+  return pDb;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Get size and mtime of a regular file. Returns FALSE if not a regular file or can't stat.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileHashDbStat(const char *szPath, uint64_t *pSize, int64_t *pSec, long *pNsec)
+{
+  struct stat   st;
+
+  if(stat(szPath, &st) != 0 || !S_ISREG(st.st_mode))
+    return FALSE;
+
+  *pSize = (uint64_t)st.st_size;
+#ifdef __APPLE__
+  *pSec  = (int64_t)st.st_mtimespec.tv_sec;
+  *pNsec = st.st_mtimespec.tv_nsec;
+#else
+  *pSec  = (int64_t)st.st_mtim.tv_sec;
+  *pNsec = st.st_mtim.tv_nsec;
+#endif
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find the record for a path, or NULL if not in database.
+-------------------------------------------------------------------------------------------------*/
+static fileHashRec_t * FileHashDbFind(sFlyFileHashDb_t *pDb, const char *szPath)
+{
+  unsigned  i = *FileHashDbSlot(pDb, szPath, FileHashPathHash(szPath));
+  return (i == UINT_MAX) ? NULL : &pDb->aRecs[i];
+}
+
+/*-------------------------------------------------------------------------------------------------
+  File system clocks are coarse: a file changed within the same second may keep its mtime, so
+  an mtime that recent can't be trusted to mean the same contents later.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileHashDbIsRacy(int64_t sec)
+{
+  return (sec + 1 >= (int64_t)time(NULL)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Has the file's contents changed since it was last updated with FlyFileHashDbUpdate()? The file
+  is read only if its size or modification time differs from the database, so a touched file with
+  the same contents is reported unchanged, and an unchanged file is not read at all.
+
+  A file not yet in the database, or that can't be read, is reported as changed.
+
+  New contents are not recorded, so checking a changed file again still reports it changed until
+  FlyFileHashDbUpdate() is called, for example after the file was successfully built.
+
+  @param    hDb       handle from FlyFileHashDbNew()
+  @param    szPath    path to file
+  @param    pHash     returned hash of file, 0 if it can't be read (may be NULL)
+  @return   TRUE if changed, FALSE if same contents as last update
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileHashDbCheck(void *hDb, const char *szPath, uint64_t *pHash)
+{
+  sFlyFileHashDb_t *pDb       = hDb;
+  fileHashRec_t    *pRec;
+  uint64_t          size;
+  uint64_t          hash      = 0;
+  int64_t           sec;
+  long              nsec;
+  bool_t            fChanged  = TRUE;
+
+  if(!FlyFileHashDbIsDb(hDb) || !szPath || !*szPath)
+    return TRUE;
+
+  pRec = FileHashDbFind(pDb, szPath);
+  if(FileHashDbStat(szPath, &size, &sec, &nsec))
+  {
+    // same size and time, don't read the file
+    if(pRec && !pRec->fDeleted && pRec->mtimeSec && pRec->size == size && pRec->mtimeSec == sec &&
+       pRec->mtimeNsec == nsec)
+    {
+      hash = pRec->hash;
+      fChanged = FALSE;
+    }
+
+    // checked before, and not changed since
+    else if(pRec && pRec->fPending && pRec->pendSize == size && pRec->pendSec == sec && pRec->pendNsec == nsec)
+    {
+      hash = pRec->pendHash;
+      fChanged = (!pRec->fDeleted && pRec->hash == hash) ? FALSE : TRUE;
+    }
+
+    else if(FlyFileHashFile(szPath, &hash))
+    {
+      // remember the hash for FlyFileHashDbUpdate(). A new path isn't saved until then
+      if(!pRec && strchr(szPath, '\n') == NULL)
+      {
+        pRec = FileHashDbAdd(pDb, FlyStrClone(szPath));
+        if(pRec)
+          pRec->fDeleted = TRUE;
+      }
+
+      // same contents (e.g. touched), refresh size and time so it isn't read next time
+      if(pRec && !pRec->fDeleted && pRec->hash == hash)
+      {
+        fChanged        = FALSE;
+        pRec->size      = size;
+        pRec->mtimeSec  = FileHashDbIsRacy(sec) ? 0 : sec;
+        pRec->mtimeNsec = nsec;
+        pDb->fDirty     = TRUE;
+      }
+      else if(pRec)
+      {
+        pRec->fPending  = FileHashDbIsRacy(sec) ? FALSE : TRUE;
+        pRec->pendSize  = size;
+        pRec->pendSec   = sec;
+        pRec->pendNsec  = nsec;
+        pRec->pendHash  = hash;
+      }
+    }
+  }
+
+  if(pHash)
+    *pHash = hash;
+  return fChanged;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Record the file's current contents in the database, usually after it was successfully built.
+  Afterwards, FlyFileHashDbCheck() reports it unchanged until its contents change again. A file
+  that no longer exists is removed from the database.
+
+  The hash found by FlyFileHashDbCheck() is reused if the file hasn't changed since, so the file is
+  not read twice.
+
+  @param    hDb       handle from FlyFileHashDbNew()
+  @param    szPath    path to file
+  @return   TRUE if recorded, FALSE if the file couldn't be read or out of memory
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileHashDbUpdate(void *hDb, const char *szPath)
+{
+  sFlyFileHashDb_t *pDb       = hDb;
+  fileHashRec_t    *pRec;
+  uint64_t          size;
+  uint64_t          hash;
+  int64_t           sec;
+  long              nsec;
+
+  if(!FlyFileHashDbIsDb(hDb) || !szPath || !*szPath)
+    return FALSE;
+
+  pRec = FileHashDbFind(pDb, szPath);
+  if(!FileHashDbStat(szPath, &size, &sec, &nsec))
+  {
+    if(pRec && !pRec->fDeleted)
+    {
+      pRec->fDeleted = TRUE;
+      pDb->fDirty = TRUE;
+    }
+    return TRUE;
+  }
+
+  // already recorded
+  if(pRec && !pRec->fDeleted && pRec->mtimeSec && pRec->size == size && pRec->mtimeSec == sec &&
+     pRec->mtimeNsec == nsec)
+  {
+    return TRUE;
+  }
+
+  if(pRec && pRec->fPending && pRec->pendSize == size && pRec->pendSec == sec && pRec->pendNsec == nsec)
+    hash = pRec->pendHash;
+  else if(!FlyFileHashFile(szPath, &hash))
+    return FALSE;
+
+  if(!pRec)
+  {
+    if(strchr(szPath, '\n') != NULL)
+      return FALSE;
+    pRec = FileHashDbAdd(pDb, FlyStrClone(szPath));
+    if(!pRec)
+      return FALSE;
+  }
+
+  pRec->hash      = hash;
+  pRec->size      = size;
+  pRec->mtimeSec  = FileHashDbIsRacy(sec) ? 0 : sec;
+  pRec->mtimeNsec = nsec;
+  pRec->fDeleted  = FALSE;
+  pRec->fPending  = FALSE;
+  pDb->fDirty     = TRUE;
+
+  return TRUE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Save the database, if anything changed, with FlyFileWriteAtomic().
+
+  @param    hDb     handle from FlyFileHashDbNew()
+  @return   TRUE if saved (or nothing to save), FALSE if write failed
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileHashDbSave(void *hDb)
+{
+  sFlyFileHashDb_t *pDb     = hDb;
+  char             *szDb;
+  char             *szNew;
+  size_t            size;
+  size_t            len;
+  unsigned          i;
+  int               n;
+  bool_t            fWorked = TRUE;
+
+  if(!FlyFileHashDbIsDb(hDb))
+    return FALSE;
+  if(!pDb->szDbFile || !pDb->fDirty)
+    return TRUE;
+
+  size = 4096;
+  szDb = FlyAlloc(size);
+  if(!szDb)
+    return FALSE;
+  len = strlen(FILEHASH_DB_HEADER);
+  memcpy(szDb, FILEHASH_DB_HEADER, len + 1);
+  for(i = 0; i < pDb->nRecs; ++i)
+  {
+    if(pDb->aRecs[i].fDeleted)
+      continue;
+    while(TRUE)
+    {
+      n = snprintf(&szDb[len], size - len, "%016llx %llu %lld.%09ld %s\n",
+                   (unsigned long long)pDb->aRecs[i].hash, (unsigned long long)pDb->aRecs[i].size,
+                   (long long)pDb->aRecs[i].mtimeSec, pDb->aRecs[i].mtimeNsec, pDb->aRecs[i].szPath);
+      if(n >= 0 && (size_t)n < size - len)
+        break;
+      szNew = FlyRealloc(szDb, size * 2);
+      if(!szNew)
+      {
+        FlyFree(szDb);
+        return FALSE;
+      }
+      szDb  = szNew;
+      size *= 2;
+    }
+    len += (size_t)n;
+  }
+
+  fWorked = FlyFileWriteAtomic(pDb->szDbFile, szDb, len, 0);
+  if(fWorked)
+    pDb->fDirty = FALSE;
+  FlyFree(szDb);
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free the database. Does not save it, see FlyFileHashDbSave().
+
+  @param    hDb     handle from FlyFileHashDbNew()
+  @return   NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileHashDbFree(void *hDb)
+{
+  sFlyFileHashDb_t *pDb = hDb;
+  unsigned          i;
+
+  if(FlyFileHashDbIsDb(hDb))
+  {
+    for(i = 0; i < pDb->nRecs; ++i)
+      FlyFree(pDb->aRecs[i].szPath);
+    FlyFreeIf(pDb->aRecs);
+    FlyFreeIf(pDb->aIndex);
+    FlyFreeIf(pDb->szDbFile);
+    memset(pDb, 0, sizeof(*pDb));
+    FlyFree(pDb);
+  }
+
+  return NULL;
+}
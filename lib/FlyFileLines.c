@@ -0,0 +1,333 @@
+/**************************************************************************************************
+  FlyFileLines.c - Constant memory, buffered line reader for text files of any size
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileLines   Constant memory, buffered line reader for text files of any size
+
+  FlyFileRead() followed by FlyStrLineNext() needs the whole file in memory. FlyFileLines reads
+  the file through a single fixed size buffer instead, so files larger than RAM (e.g. 100 GB logs)
+  can be processed at disk speed with a fixed memory footprint.
+
+  1. Lines may end in LF, CRLF or CR, or the end of the file
+  2. Each line is returned as a '\0' terminated view into the buffer, without the line ending
+  3. The view is valid only until the next call to FlyFileLinesNext()
+  4. Lines longer than the buffer are spilled into a growable buffer, so are still returned whole
+
+  @example FlyFileLines Print lines containing "error"
+
+  ```
+  #include "FlyFile.h"
+
+  void         *hLines;
+  const char   *szLine;
+  size_t        len;
+
+  hLines = FlyFileLinesNew("big.log", 0);
+  while((szLine = FlyFileLinesNext(hLines, &len)) != NULL)
+  {
+    if(strstr(szLine, "error"))
+      printf("%zu: %s\n", FlyFileLinesLineNum(hLines), szLine);
+  }
+  FlyFileLinesFree(hLines);
+  ```
+*/
+
+#define FLY_FILELINES_SANCHK      14141
+#define FILELINES_BUF_DEFAULT     (256 * 1024)
+#define FILELINES_BUF_MIN         16
+
+typedef struct
+{
+  unsigned              sanchk;
+  int                   fd;
+  bool_t                fClose;   // close fd when done (not stdin)
+  bool_t                fEof;
+  bool_t                fError;
+  char                 *pBuf;     // bufSize + 1 bytes, room for '\0'
+  size_t                bufSize;
+  size_t                pos;      // start of next line in pBuf
+  size_t                scan;     // where to continue looking for line ending
+  size_t                end;      // end of data in pBuf
+  char                 *pSpill;   // for lines longer than pBuf
+  size_t                spillSize;
+  size_t                spillLen;
+  size_t                lineNum;
+} sFlyFileLines_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Find the 1st line ending (LF, CRLF or CR) in p through pEnd using memchr(), which is vectorized in
+  most C libraries. Returns ptr to line ending and its length in *pEolLen, or NULL if not found.
+-------------------------------------------------------------------------------------------------*/
+static char * FileLinesEol(char *p, char *pEnd, size_t *pEolLen)
+{
+  char   *pLf;
+  char   *pCr;
+
+  pLf = memchr(p, '\n', (size_t)(pEnd - p));
+  pCr = memchr(p, '\r', (size_t)((pLf ? pLf : pEnd) - p));
+  if(pCr)
+  {
+    *pEolLen = (pCr + 1 == pLf) ? 2 : 1;
+    return pCr;
+  }
+  *pEolLen = 1;
+  return pLf;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Append to the spill buffer, growing it as needed. Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileLinesSpill(sFlyFileLines_t *pLines, const char *p, size_t len)
+{
+  char     *pNew;
+  size_t    size;
+
+  if(pLines->spillLen + len + 1 > pLines->spillSize)
+  {
+    size = pLines->spillSize ? pLines->spillSize : pLines->bufSize;
+    while(size < pLines->spillLen + len + 1)
+      size *= 2;
+    pNew = FlyRealloc(pLines->pSpill, size);
+    if(!pNew)
+      return FALSE;
+    pLines->pSpill    = pNew;
+    pLines->spillSize = size;
+  }
+  memcpy(&pLines->pSpill[pLines->spillLen], p, len);
+  pLines->spillLen += len;
+  pLines->pSpill[pLines->spillLen] = '\0';
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Make room in the buffer and read more data. Sets fEof at end of file or on error.
+-------------------------------------------------------------------------------------------------*/
+static void FileLinesFill(sFlyFileLines_t *pLines, bool_t *pfSpilled)
+{
+  size_t    keep;
+  ssize_t   n;
+
+  // move partial line to front of buffer
+  if(pLines->pos > 0)
+  {
+    pLines->end -= pLines->pos;
+    pLines->scan -= pLines->pos;
+    memmove(pLines->pBuf, &pLines->pBuf[pLines->pos], pLines->end);
+    pLines->pos = 0;
+  }
+
+  // line is longer than the buffer, spill it, but keep a trailing CR as it may be part of CRLF
+  else if(pLines->end == pLines->bufSize)
+  {
+    keep = (pLines->pBuf[pLines->end - 1] == '\r') ? 1 : 0;
+    if(!FileLinesSpill(pLines, pLines->pBuf, pLines->end - keep))
+    {
+      pLines->fEof = pLines->fError = TRUE;
+      return;
+    }
+    *pfSpilled = TRUE;
+    if(keep)
+      pLines->pBuf[0] = '\r';
+    pLines->end  = keep;
+    pLines->scan = 0;
+  }
+
+  do
+  {
+    n = read(pLines->fd, &pLines->pBuf[pLines->end], pLines->bufSize - pLines->end);
+  } while(n < 0 && errno == EINTR);
+
+  if(n <= 0)
+  {
+    pLines->fEof = TRUE;
+    if(n < 0)
+      pLines->fError = TRUE;
+  }
+  else
+    pLines->end += (size_t)n;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a pointer to a FlyFileLines reader?
+
+  @param    hLines    handle from FlyFileLinesNew()
+  @return   TRUE if a FlyFileLines handle
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileLinesIsLines(void *hLines)
+{
+  sFlyFileLines_t *pLines = hLines;
+  return (pLines && (pLines->sanchk == FLY_FILELINES_SANCHK)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Open a text file for reading line by line with a fixed size buffer.
+
+  @param    szFilename    file to read, or NULL for stdin
+  @param    bufSize       size of read buffer, or 0 for default (256K)
+  @return   handle to reader, or NULL if file couldn't be opened or not enough memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileLinesNew(const char *szFilename, size_t bufSize)
+{
+  sFlyFileLines_t  *pLines;
+
+  if(bufSize == 0)
+    bufSize = FILELINES_BUF_DEFAULT;
+  if(bufSize < FILELINES_BUF_MIN)
+    bufSize = FILELINES_BUF_MIN;
+
+  pLines = FlyAllocZ(sizeof(*pLines));
+  if(pLines)
+  {
+    pLines->sanchk  = FLY_FILELINES_SANCHK;
+    pLines->bufSize = bufSize;
+    pLines->pBuf    = FlyAlloc(bufSize + 1);
+    if(szFilename)
+    {
+      pLines->fd      = open(szFilename, O_RDONLY);
+      pLines->fClose  = TRUE;
+    }
+    else
+      pLines->fd = STDIN_FILENO;
+
+    if(!pLines->pBuf || pLines->fd < 0)
+      pLines = FlyFileLinesFree(pLines);
+#ifdef POSIX_FADV_SEQUENTIAL
+    else
+      (void)posix_fadvise(pLines->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  }
+
+  return pLines;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the next line. The line ending is not included in the line.
+
+  The returned line is '\0' terminated and valid only until the next call to FlyFileLinesNext() or
+  FlyFileLinesFree(). The line may contain '\0' bytes if the file is binary, so use *pLen.
+
+  @param    hLines    handle from FlyFileLinesNew()
+  @param    pLen      returned length of line (may be NULL)
+  @return   ptr to line, or NULL at end of file (or on a read error, see FlyFileLinesError())
+*///-----------------------------------------------------------------------------------------------
+const char * FlyFileLinesNext(void *hLines, size_t *pLen)
+{
+  sFlyFileLines_t  *pLines   = hLines;
+  char             *pLine    = NULL;
+  char             *pEol;
+  size_t            eolLen;
+  size_t            len      = 0;
+  bool_t            fSpilled = FALSE;
+
+  if(!FlyFileLinesIsLines(hLines))
+    return NULL;
+
+  pLines->spillLen = 0;
+  while(!pLine)
+  {
+    pEol = FileLinesEol(&pLines->pBuf[pLines->scan], &pLines->pBuf[pLines->end], &eolLen);
+
+    // a CR at end of buffer may be the start of a CRLF, so read more to find out
+    if(pEol && !(eolLen == 1 && *pEol == '\r' && pEol + 1 == &pLines->pBuf[pLines->end] && !pLines->fEof))
+    {
+      pLine = &pLines->pBuf[pLines->pos];
+      len   = (size_t)(pEol - pLine);
+      pLines->pos = pLines->scan = (size_t)(pEol - pLines->pBuf) + eolLen;
+    }
+
+    // last line has no line ending
+    else if(pLines->fEof)
+    {
+      if(pLines->pos == pLines->end && !fSpilled)
+        break;
+      pLine = &pLines->pBuf[pLines->pos];
+      pEol  = &pLines->pBuf[pLines->end];
+      len   = pLines->end - pLines->pos;
+      pLines->pos = pLines->scan = pLines->end;
+    }
+
+    else
+    {
+      pLines->scan = pEol ? (size_t)(pEol - pLines->pBuf) : pLines->end;
+      FileLinesFill(pLines, &fSpilled);
+      if(pLines->fError)
+        break;
+    }
+  }
+
+  if(pLine)
+  {
+    *pEol = '\0';
+    if(fSpilled)
+    {
+      if(!FileLinesSpill(pLines, pLine, len))
+      {
+        pLines->fError = TRUE;
+        return NULL;
+      }
+      pLine = pLines->pSpill;
+      len   = pLines->spillLen;
+    }
+    ++pLines->lineNum;
+  }
+
+  if(pLen)
+    *pLen = len;
+  return pLine;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the 1-based line number of the line last returned by FlyFileLinesNext().
+
+  @param    hLines    handle from FlyFileLinesNew()
+  @return   line number, or 0 if no lines read yet
+*///-----------------------------------------------------------------------------------------------
+size_t FlyFileLinesLineNum(void *hLines)
+{
+  sFlyFileLines_t *pLines = hLines;
+  return FlyFileLinesIsLines(hLines) ? pLines->lineNum : 0;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Did FlyFileLinesNext() stop because of a read error or out of memory, rather than end of file?
+
+  @param    hLines    handle from FlyFileLinesNew()
+  @return   TRUE if error
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileLinesError(void *hLines)
+{
+  sFlyFileLines_t *pLines = hLines;
+  return FlyFileLinesIsLines(hLines) ? pLines->fError : TRUE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Close the file and free the reader.
+
+  @param    hLines    handle from FlyFileLinesNew()
+  @return   NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileLinesFree(void *hLines)
+{
+  sFlyFileLines_t *pLines = hLines;
+
+  if(FlyFileLinesIsLines(hLines))
+  {
+    if(pLines->fClose && pLines->fd >= 0)
+      close(pLines->fd);
+    FlyFreeIf(pLines->pBuf);
+    FlyFreeIf(pLines->pSpill);
+    memset(pLines, 0, sizeof(*pLines));
+    FlyFree(pLines);
+  }
+
+  return NULL;
+}
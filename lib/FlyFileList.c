@@ -3,6 +3,9 @@
   Copyright (c) 2024 Drew Gislason
   license: <https://mit-license.org>
 *///***********************************************************************************************
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
 #include <glob.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -29,8 +32,67 @@ typedef struct
   unsigned              sanchk;
   unsigned              len;      // size of string array
   const char          **aszPath;  // array of string pointers
+  void                 *pIndex;   // optional index for FlyFileListFind(), see FlyFileListIndex()
 } sFlyFileList_t;
 
+// one way of keying the list, built the first time FlyFileListFind() needs it
+typedef struct
+{
+  char                 *pKeys;    // keys, packed in list order
+  const char          **apKeys;   // key of each list entry
+  unsigned             *aSorted;  // list indexes, sorted by key then index, for BEG/END
+  unsigned             *aHash;    // open address table of 1st list index with a key, for exact
+  unsigned             *aNext;    // next list index with same key, or UINT_MAX
+  unsigned              hashSize; // power of 2, 0 if no hash
+} fflIndexKind_t;
+
+#define FFL_INDEX_NOCASE  0x01    // keys are folded to lower case
+#define FFL_INDEX_REVERSE 0x02    // keys are reversed, so suffixes become prefixes
+#define FFL_INDEX_KINDS   4
+
+typedef struct
+{
+  fflIndexKind_t        aKinds[FFL_INDEX_KINDS];
+  bool_t                afBuilt[FFL_INDEX_KINDS];
+} fflIndex_t;
+
+// used for sorting keys by key then by list index
+typedef struct
+{
+  const char           *szKey;
+  unsigned              i;
+} fflIndexSort_t;
+
+// path and its sort key, for FlyFileListSortEx()
+typedef struct
+{
+  const char           *szKey;
+  const char           *szPath;
+} fflSortRec_t;
+
+// packed '\0' terminated strings, referred to by offset as pStrs may move when grown
+typedef struct
+{
+  char                 *pStrs;
+  size_t                strsLen;
+  size_t                strsMax;
+  size_t               *aOffsets;
+  size_t                n;
+  size_t                offsetsMax;
+} fflArena_t;
+
+// state for building a list in FlyFileListNewExtsEx()
+typedef struct
+{
+  fflArena_t            files;    // matching files, with path
+  fflArena_t            dirs;     // stack of subfolder names waiting to be read
+  const char          **apScratch;
+  size_t                scratchMax;
+  const char           *szExtList;
+  bool_t                fSorted;
+  bool_t                fFailed;
+} fflBuild_t;
+
 /*!------------------------------------------------------------------------------------------------
   Is this a pointer to an ::sFlyFileList_t structure?
 
@@ -135,6 +197,7 @@ void * FlyFileListNew(const char *pszWildPath)
         // fill in structure
         pFileList->sanchk   = FLY_FILELIST_SANCHK;
         pFileList->len      = (unsigned)globbuf.gl_pathc;
+        pFileList->pIndex   = NULL;
 
         // array of pointers
         pFileList->aszPath  = (void *)(pFileList + 1);
@@ -171,14 +234,14 @@ void * FlyFileListNew(const char *pszWildPath)
   return pFileList;
 }
 
-/*-------------------------------------------------------------------------------------------------
+/*!------------------------------------------------------------------------------------------------
   Does the extenion match something in the szExtList?
 
   @param  pszExt      an extension, e.g. ".c" or ".c++" or NULL, meaning no extension
   @param  szExtList   list of file extensions, separated by dots, e.g. ".c++.cpp.cxx.cc.C"
   @return Returns TRUE if matches
 *///-----------------------------------------------------------------------------------------------
-static bool_t FflMatchExt(const char *pszExt, const char *szExtList)
+bool_t FlyFileListMatchExt(const char *pszExt, const char *szExtList)
 {
   const char *psz;
   const char *pszEnd;
@@ -211,125 +274,175 @@ static bool_t FflMatchExt(const char *pszExt, const char *szExtList)
 }
 
 /*-------------------------------------------------------------------------------------------------
-  Append the matching list of files to the existing list
-
-  @param  pList     An existing list of 0 or more files
-  @param  szFolder  A folder in a working PATH_MAX buffer, e.g. "folder/", "~/folder", "./"
-  @param  szExts    List of file extensions, separated by dots, e.g. ".c++.cpp.cxx.cc.C"
-  @return Pointer to fileList (probably changed since reallocated)
+  Grow a buffer geometrically so it can hold at least n more items of the given size.
+
+  @param  ppBuf     ptr to buffer ptr (may point to NULL)
+  @param  pMax      ptr to current capacity in items
+  @param  len       current length in items
+  @param  n         # of items to add
+  @param  itemSize  sizeof each item
+  @return TRUE if worked, FALSE if out of memory
 *///-----------------------------------------------------------------------------------------------
-static sFlyFileList_t * FflAppend(sFlyFileList_t *pFileList, char *szFolder, const char *szExtList)
+static bool_t FflGrow(void **ppBuf, size_t *pMax, size_t len, size_t n, size_t itemSize)
 {
-  void       *hList;
-  const char *szPath;
-  unsigned    i;
-  size_t      size;
-  unsigned    len;
-  unsigned    nMatched;
-  unsigned    n;
+  void     *pNew;
+  size_t    newMax;
 
-  // make a wildmask from folder, e.g. "folder/*"
-  len = strlen(szFolder);
-  FlyStrPathAppend(szFolder, "*", PATH_MAX);
-
-  // look for files that match folder
-  hList = FlyFileListNew(szFolder);
-  if(hList)
+  if(len + n > *pMax)
   {
-    // count the # of entries that match
-    nMatched = 0;
-    for(i = 0; i < FlyFileListLen(hList); ++i)
-    {
-      szPath = FlyFileListGetName(hList, i);
-      if(!FlyStrPathIsFolder(szPath))
-      {
-        if(FflMatchExt(FlyStrPathExt(szPath), szExtList))
-          ++nMatched;
-      }
-    }
+    newMax = *pMax ? *pMax : 64;
+    while(newMax < len + n)
+      newMax *= 2;
+    pNew = FlyRealloc(*ppBuf, newMax * itemSize);
+    if(!pNew)
+      return FALSE;
+    *ppBuf = pNew;
+    *pMax  = newMax;
+  }
 
-    // reallocate memory to allow for more files in the list
-    if(nMatched)
-    {
-      size = sizeof(*pFileList) + (sizeof(char *) * ((size_t)pFileList->len + nMatched));
-      pFileList = FlyRealloc(pFileList, size);
-      pFileList->aszPath  = (void *)(pFileList + 1);
-    }
+  return TRUE;
+}
 
-    // add the new files to list
-    if(nMatched && pFileList)
-    {
-      n = 0;
-      for(i = 0; i < FlyFileListLen(hList); ++i)
-      {
-        szPath = FlyFileListGetName(hList, i);
-        if(!FlyStrPathIsFolder(szPath))
-        {
-          if(FflMatchExt(FlyStrPathExt(szPath), szExtList))
-          {
-            pFileList->aszPath[pFileList->len + n] = FlyStrAlloc(szPath);
-            ++n;
-          }
-        }
-      }
-      pFileList->len += nMatched;
-    }
+/*-------------------------------------------------------------------------------------------------
+  Add a string to an arena (packed '\0' terminated strings) and its offset to an offset array.
 
-    FlyFileListFree(hList);
+  @param  pArena    arena to append to
+  @param  szPrefix  prefix (e.g. folder), may be ""
+  @param  prefixLen length of prefix
+  @param  szName    name to append after prefix
+  @return TRUE if worked, FALSE if out of memory
+*///-----------------------------------------------------------------------------------------------
+static bool_t FflArenaAdd(fflArena_t *pArena, const char *szPrefix, size_t prefixLen, const char *szName)
+{
+  size_t    nameLen = strlen(szName);
+
+  if(!FflGrow((void **)&pArena->pStrs, &pArena->strsMax, pArena->strsLen, prefixLen + nameLen + 1, 1) ||
+     !FflGrow((void **)&pArena->aOffsets, &pArena->offsetsMax, pArena->n, 1, sizeof(size_t)))
+  {
+    return FALSE;
   }
 
-  // remove '*' that was added to folder path
-  szFolder[len] = '\0';
+  pArena->aOffsets[pArena->n++] = pArena->strsLen;
+  memcpy(&pArena->pStrs[pArena->strsLen], szPrefix, prefixLen);
+  memcpy(&pArena->pStrs[pArena->strsLen + prefixLen], szName, nameLen + 1);
+  pArena->strsLen += prefixLen + nameLen + 1;
 
-  return pFileList;
+  return TRUE;
 }
 
 /*-------------------------------------------------------------------------------------------------
-  Append the matching list of files to the existing list
+  Compare two strings for qsort()
+-------------------------------------------------------------------------------------------------*/
+static int FflCmpPtr(const void *ppThis, const void *ppThat)
+{
+  return strcmp(*(const char **)ppThis, *(const char **)ppThat);
+}
 
-  @param  pFileList   An existing list of 0 or more files
-  @param  szFolder    A file folder to check
-  @param  maxDepth    depth to add 
-  @return Returns handle to file list or NULL if invalid folder
-*///-----------------------------------------------------------------------------------------------
-sFlyFileList_t * FflRecurse(sFlyFileList_t *pFileList, char * szFolder, const char *szExtList, unsigned maxDepth)
+/*-------------------------------------------------------------------------------------------------
+  Sort arena offsets [first, n) by the strings they point to.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FflArenaSort(fflBuild_t *pBuild, fflArena_t *pArena, size_t first)
 {
-  void       *hList;
-  const char *szPath;
-  unsigned    i;
-  unsigned    len;
+  size_t    n = pArena->n - first;
+  size_t    i;
 
-  // printf("FflRecurse(%p, %s, %s, %u)\n", pFileList, szFolder, szExtList, maxDepth); 
+  if(n < 2)
+    return TRUE;
+  if(!FflGrow((void **)&pBuild->apScratch, &pBuild->scratchMax, 0, n, sizeof(const char *)))
+    return FALSE;
 
-  // make a wildmask from folder, e.g. "folder/*"
-  len = strlen(szFolder);
-  FlyStrPathAppend(szFolder, "*", PATH_MAX);
+  for(i = 0; i < n; ++i)
+    pBuild->apScratch[i] = &pArena->pStrs[pArena->aOffsets[first + i]];
+  qsort(pBuild->apScratch, n, sizeof(const char *), FflCmpPtr);
+  for(i = 0; i < n; ++i)
+    pArena->aOffsets[first + i] = (size_t)(pBuild->apScratch[i] - pArena->pStrs);
 
-  // look for files that match folder
-  hList = FlyFileListNew(szFolder);
-  if(hList)
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Read folder fd exactly once: matching files go into the file arena, subfolders onto the folder
+  stack. Then the files are sorted (optional) and each subfolder is read the same way. Closes fd.
+
+  @param  pBuild    build state
+  @param  fd        open folder
+  @param  szPath    folder path (PATH_MAX buffer) as it prefixes each file, e.g. "", "folder/"
+  @param  maxDepth  0 means this folder only
+  @return none
+*///-----------------------------------------------------------------------------------------------
+static void FflReadDir(fflBuild_t *pBuild, int fd, char *szPath, unsigned maxDepth)
+{
+  DIR              *pDir;
+  struct dirent    *pEntry;
+  struct stat       st;
+  size_t            pathLen   = strlen(szPath);
+  size_t            firstFile = pBuild->files.n;
+  size_t            firstDir  = pBuild->dirs.n;
+  size_t            dirsLen   = pBuild->dirs.strsLen;
+  size_t            i;
+  const char       *szName;
+  bool_t            fIsDir;
+  int               subFd;
+
+  pDir = fdopendir(fd);
+  if(!pDir)
   {
-    // add all folders
-    for(i = 0; i < FlyFileListLen(hList); ++i)
+    close(fd);
+    return;
+  }
+
+  while(!pBuild->fFailed && (pEntry = readdir(pDir)) != NULL)
+  {
+    // hidden files are skipped, like glob()
+    if(pEntry->d_name[0] == '.')
+      continue;
+
+    // symbolic links to folders are folders, like glob()
+#ifdef DT_DIR
+    if(pEntry->d_type != DT_UNKNOWN && pEntry->d_type != DT_LNK)
+      fIsDir = (pEntry->d_type == DT_DIR) ? TRUE : FALSE;
+    else
+#endif
+      fIsDir = (fstatat(dirfd(pDir), pEntry->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode)) ? TRUE : FALSE;
+
+    if(fIsDir)
     {
-      szFolder[len] = '\0';
-      szPath = FlyFileListGetName(hList, i);
-      if(FlyStrPathIsFolder(szPath))
-      {
-        strcpy(szFolder, szPath);
-        pFileList = FflAppend(pFileList, szFolder, szExtList);
-        if(!pFileList)
-          break;
-        if(maxDepth)
-          pFileList = FflRecurse(pFileList, szFolder, szExtList, maxDepth - 1);
-      }
+      if(maxDepth && !FflArenaAdd(&pBuild->dirs, "", 0, pEntry->d_name))
+        pBuild->fFailed = TRUE;
+    }
+    else if(FlyFileListMatchExt(FlyStrPathExt(pEntry->d_name), pBuild->szExtList))
+    {
+      if(!FflArenaAdd(&pBuild->files, szPath, pathLen, pEntry->d_name))
+        pBuild->fFailed = TRUE;
     }
+  }
 
-    FlyFileListFree(hList);
+  if(pBuild->fSorted && !pBuild->fFailed)
+  {
+    if(!FflArenaSort(pBuild, &pBuild->files, firstFile) || !FflArenaSort(pBuild, &pBuild->dirs, firstDir))
+      pBuild->fFailed = TRUE;
   }
 
-  szFolder[len] = '\0';
-  return pFileList;
+  // recurse into subfolders, relative to this one
+  for(i = firstDir; !pBuild->fFailed && i < pBuild->dirs.n; ++i)
+  {
+    szName = &pBuild->dirs.pStrs[pBuild->dirs.aOffsets[i]];
+    if(pathLen + strlen(szName) + 2 > PATH_MAX)
+      continue;
+    subFd = openat(dirfd(pDir), szName, O_RDONLY | O_DIRECTORY);
+    if(subFd >= 0)
+    {
+      strcpy(&szPath[pathLen], szName);
+      strcat(&szPath[pathLen], "/");
+      FflReadDir(pBuild, subFd, szPath, maxDepth - 1);
+      szPath[pathLen] = '\0';
+    }
+  }
+
+  // pop this folder's subfolders
+  pBuild->dirs.n       = firstDir;
+  pBuild->dirs.strsLen = dirsLen;
+  closedir(pDir);
 }
 
 /*!------------------------------------------------------------------------------------------------
@@ -353,34 +466,53 @@ sFlyFileList_t * FflRecurse(sFlyFileList_t *pFileList, char * szFolder, const ch
   The file extensions are listed with a prepended dot. For example, to find files with ".c", ".h"
   and with no file extension, use ".c.h.".
 
+  Files are sorted within each folder, and a folder's files come before its subfolders. See
+  FlyFileListNewExtsEx() for an unsorted, slightly faster, list.
+
   @param  szFolder  A folder to check for the given file extensions, e.g. "..", or "~/Folder/" 
   @param  szExts    List of file extensions, separated by dots, e.g. ".c++.cpp.cxx.cc.C"
   @param  maxDepth  0 means just the folder, 1 means go depth 1 into subfolders, etc...
   @return Returns handle to file list or NULL if invalid folder or parameters
 *///-----------------------------------------------------------------------------------------------
 void * FlyFileListNewExts(const char *szFolder, const char *szExtList, unsigned maxDepth)
+{
+  return FlyFileListNewExtsEx(szFolder, szExtList, maxDepth, 0);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Same as FlyFileListNewExts(), but with options.
+
+  Each folder is read exactly once, with matches packed into a geometrically grown string arena.
+  The resulting list is a single allocation, just like FlyFileListNew().
+
+  @param  szFolder  A folder to check for the given file extensions, e.g. "..", or "~/Folder/" 
+  @param  szExts    List of file extensions, separated by dots, e.g. ".c++.cpp.cxx.cc.C"
+  @param  maxDepth  0 means just the folder, 1 means go depth 1 into subfolders, etc...
+  @param  opts      0 or FLYFILELIST_OPTS_UNSORTED (files are in directory order)
+  @return Returns handle to file list or NULL if invalid folder or parameters
+*///-----------------------------------------------------------------------------------------------
+void * FlyFileListNewExtsEx(const char *szFolder, const char *szExtList, unsigned maxDepth, flyFileListOpts_t opts)
 {
   sFlyFileList_t *pFileList = NULL;
+  fflBuild_t      build;
   char           *szPath;
+  char           *szOpen;
+  char           *sz;
+  int             fd      = -1;
+  unsigned        i;
 
   // cannot proceed without both folder and extension list
   if(!szFolder || !szExtList || *szExtList != '.')
     return NULL;
 
-  pFileList = FlyAllocZ(sizeof(*pFileList));
+  memset(&build, 0, sizeof(build));
+  build.szExtList = szExtList;
+  build.fSorted   = (opts & FLYFILELIST_OPTS_UNSORTED) ? FALSE : TRUE;
+
   szPath = FlyAlloc(PATH_MAX);
-  if(szPath == NULL || pFileList == NULL)
-  {
-    szPath = FlyFreeIf(szPath);
-    pFileList = FlyFreeIf(pFileList);
-  }
-  else if(*szExtList)
+  szOpen = FlyAlloc(PATH_MAX);
+  if(szPath && szOpen)
   {
-    // fill in structure
-    pFileList->sanchk   = FLY_FILELIST_SANCHK;
-    pFileList->len      = 0;
-    pFileList->aszPath  = (void *)(pFileList + 1);
-
     // special case: if folder is ".", use empty folder "", but not for "./"
     FlyStrZCpy(szPath, szFolder, PATH_MAX);
     if(strcmp(szPath, ".") == 0)
@@ -388,17 +520,289 @@ void * FlyFileListNewExts(const char *szFolder, const char *szExtList, unsigned
     else if(*szPath && !isslash(FlyStrCharLast(szPath)))
       FlyStrZCat(szPath, "/", PATH_MAX);
 
-    // fill in the top level files/folders
-    pFileList = FflAppend(pFileList, szPath, szExtList);
+    // names keep "~/", but the folder opened is in $HOME
+    FlyStrZCpy(szOpen, *szPath ? szPath : ".", PATH_MAX);
+    if(*szOpen == '~')
+      FlyFileHomeExpand(szOpen, PATH_MAX);
+    fd = open(szOpen, O_RDONLY | O_DIRECTORY);
+  }
+
+  if(fd >= 0)
+  {
+    FflReadDir(&build, fd, szPath, maxDepth);
 
-    // recurse if requested
-    if(pFileList && maxDepth)
-      pFileList = FflRecurse(pFileList, szPath, szExtList, maxDepth - 1);
+    // all 3 objects together in 1 malloc (structure, table of str ptrs, strings)
+    if(!build.fFailed)
+      pFileList = FlyAlloc(sizeof(sFlyFileList_t) + (build.files.n * sizeof(const char *)) + build.files.strsLen);
+    if(pFileList)
+    {
+      pFileList->sanchk   = FLY_FILELIST_SANCHK;
+      pFileList->len      = (unsigned)build.files.n;
+      pFileList->pIndex   = NULL;
+      pFileList->aszPath  = (void *)(pFileList + 1);
+      sz = (char *)(&pFileList->aszPath[pFileList->len]);
+      if(build.files.strsLen)
+        memcpy(sz, build.files.pStrs, build.files.strsLen);
+      for(i = 0; i < pFileList->len; ++i)
+        pFileList->aszPath[i] = &sz[build.files.aOffsets[i]];
+    }
   }
 
+  FlyFreeIf(szPath);
+  FlyFreeIf(szOpen);
+  FlyFreeIf(build.files.pStrs);
+  FlyFreeIf(build.files.aOffsets);
+  FlyFreeIf(build.dirs.pStrs);
+  FlyFreeIf(build.dirs.aOffsets);
+  FlyFreeIf(build.apScratch);
+
   return pFileList;
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Free all built kinds of the index. The index stays enabled and is rebuilt as needed.
+-------------------------------------------------------------------------------------------------*/
+static void FflIndexClear(fflIndex_t *pIndex)
+{
+  fflIndexKind_t   *pKind;
+  unsigned          k;
+
+  if(!pIndex)
+    return;
+  for(k = 0; k < FFL_INDEX_KINDS; ++k)
+  {
+    pKind = &pIndex->aKinds[k];
+    FlyFreeIf(pKind->pKeys);
+    FlyFreeIf(pKind->apKeys);
+    FlyFreeIf(pKind->aSorted);
+    FlyFreeIf(pKind->aHash);
+    FlyFreeIf(pKind->aNext);
+    memset(pKind, 0, sizeof(*pKind));
+    pIndex->afBuilt[k] = FALSE;
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Make the key for a string: folded to lower case and/or reversed. szKey must be len + 1 bytes.
+-------------------------------------------------------------------------------------------------*/
+static void FflIndexKey(char *szKey, const char *sz, size_t len, unsigned kind)
+{
+  size_t    i;
+
+  for(i = 0; i < len; ++i)
+  {
+    szKey[i] = (kind & FFL_INDEX_REVERSE) ? sz[len - 1 - i] : sz[i];
+    if(kind & FFL_INDEX_NOCASE)
+      szKey[i] = (char)tolower((unsigned char)szKey[i]);
+  }
+  szKey[len] = '\0';
+}
+
+/*-------------------------------------------------------------------------------------------------
+  FNV-1a hash of a key
+-------------------------------------------------------------------------------------------------*/
+static uint32_t FflIndexHash(const char *sz)
+{
+  uint32_t  hash = 2166136261u;
+
+  while(*sz)
+  {
+    hash ^= (uint8_t)*sz++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Compare keys, then list indexes, for qsort()
+-------------------------------------------------------------------------------------------------*/
+static int FflIndexCmp(const void *pThis, const void *pThat)
+{
+  const fflIndexSort_t *pA = pThis;
+  const fflIndexSort_t *pB = pThat;
+  int                   ret;
+
+  ret = strcmp(pA->szKey, pB->szKey);
+  if(ret == 0)
+    ret = (pA->i < pB->i) ? -1 : (pA->i > pB->i);
+  return ret;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Build one kind of index: keys, sorted order and (for forward keys) the hash of exact keys.
+  Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FflIndexBuild(sFlyFileList_t *pList, fflIndexKind_t *pKind, unsigned kind)
+{
+  fflIndexSort_t   *aSort;
+  unsigned         *pSlot;
+  size_t            size = 0;
+  size_t            len;
+  unsigned          i;
+
+  for(i = 0; i < pList->len; ++i)
+    size += strlen(pList->aszPath[i]) + 1;
+  pKind->pKeys    = FlyAlloc(size ? size : 1);
+  pKind->apKeys   = FlyAlloc((pList->len + 1) * sizeof(char *));
+  pKind->aSorted  = FlyAlloc((pList->len + 1) * sizeof(unsigned));
+  aSort           = FlyAlloc((pList->len + 1) * sizeof(fflIndexSort_t));
+  if(!pKind->pKeys || !pKind->apKeys || !pKind->aSorted || !aSort)
+  {
+    FlyFreeIf(aSort);
+    return FALSE;
+  }
+
+  for(size = 0, i = 0; i < pList->len; ++i)
+  {
+    len = strlen(pList->aszPath[i]);
+    FflIndexKey(&pKind->pKeys[size], pList->aszPath[i], len, kind);
+    pKind->apKeys[i] = aSort[i].szKey = &pKind->pKeys[size];
+    aSort[i].i = i;
+    size += len + 1;
+  }
+  qsort(aSort, pList->len, sizeof(fflIndexSort_t), FflIndexCmp);
+  for(i = 0; i < pList->len; ++i)
+    pKind->aSorted[i] = aSort[i].i;
+  FlyFree(aSort);
+
+  // exact keys: hash to 1st list index, then chain to later indexes with same key
+  if(!(kind & FFL_INDEX_REVERSE))
+  {
+    pKind->hashSize = 16;
+    while(pKind->hashSize < pList->len * 2)
+      pKind->hashSize *= 2;
+    pKind->aHash = FlyAlloc(pKind->hashSize * sizeof(unsigned));
+    pKind->aNext = FlyAlloc((pList->len + 1) * sizeof(unsigned));
+    if(!pKind->aHash || !pKind->aNext)
+      return FALSE;
+    memset(pKind->aHash, 0xff, pKind->hashSize * sizeof(unsigned));
+
+    // aSorted has equal keys in index order, so each chain is in index order
+    for(i = 0; i < pList->len; ++i)
+    {
+      pKind->aNext[pKind->aSorted[i]] = UINT_MAX;
+      if(i > 0 && strcmp(pKind->apKeys[pKind->aSorted[i - 1]], pKind->apKeys[pKind->aSorted[i]]) == 0)
+        pKind->aNext[pKind->aSorted[i - 1]] = pKind->aSorted[i];
+      else
+      {
+        pSlot = &pKind->aHash[FflIndexHash(pKind->apKeys[pKind->aSorted[i]]) & (pKind->hashSize - 1)];
+        while(*pSlot != UINT_MAX)
+        {
+          if(++pSlot == &pKind->aHash[pKind->hashSize])
+            pSlot = pKind->aHash;
+        }
+        *pSlot = pKind->aSorted[i];
+      }
+    }
+  }
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find using the index, building the kind of index needed on first use. Returns 0-n index or
+  FLYFILELIST_NOT_FOUND, or FFL_INDEX_UNUSABLE if out of memory or string too long, in which case
+  the caller searches linearly.
+-------------------------------------------------------------------------------------------------*/
+#define FFL_INDEX_UNUSABLE  (UINT_MAX - 1)
+static unsigned FflIndexFind(sFlyFileList_t *pList, const char *sz, unsigned startIndex, flyFileListOpts_t opts)
+{
+  fflIndex_t       *pIndex  = pList->pIndex;
+  fflIndexKind_t   *pKind;
+  char              szKey[PATH_MAX];
+  size_t            len     = strlen(sz);
+  unsigned          kind    = 0;
+  unsigned          found   = FLYFILELIST_NOT_FOUND;
+  unsigned          i;
+  unsigned          lo;
+  unsigned          hi;
+  unsigned          mid;
+
+  if(len >= sizeof(szKey))
+    return FFL_INDEX_UNUSABLE;
+
+  if(opts & FLYFILELIST_OPTS_NOCASE)
+    kind |= FFL_INDEX_NOCASE;
+  if((opts & FLYFILELIST_OPTS_END) && !(opts & FLYFILELIST_OPTS_BEG))
+    kind |= FFL_INDEX_REVERSE;
+  pKind = &pIndex->aKinds[kind];
+  if(!pIndex->afBuilt[kind])
+  {
+    if(!FflIndexBuild(pList, pKind, kind))
+    {
+      FflIndexClear(pIndex);
+      return FFL_INDEX_UNUSABLE;
+    }
+    pIndex->afBuilt[kind] = TRUE;
+  }
+  FflIndexKey(szKey, sz, len, kind);
+
+  // exact: hash lookup, then the 1st in the chain at or after startIndex
+  if(!(opts & (FLYFILELIST_OPTS_BEG | FLYFILELIST_OPTS_END)))
+  {
+    i = FflIndexHash(szKey) & (pKind->hashSize - 1);
+    while(pKind->aHash[i] != UINT_MAX)
+    {
+      if(strcmp(pKind->apKeys[pKind->aHash[i]], szKey) == 0)
+      {
+        for(found = pKind->aHash[i]; found != UINT_MAX && found < startIndex; found = pKind->aNext[found])
+          ;
+        break;
+      }
+      i = (i + 1) & (pKind->hashSize - 1);
+    }
+  }
+
+  // beginning or end: all keys with the prefix are together in sorted order, O(log n + k)
+  else
+  {
+    lo = 0;
+    hi = pList->len;
+    while(lo < hi)
+    {
+      mid = lo + (hi - lo) / 2;
+      if(strncmp(pKind->apKeys[pKind->aSorted[mid]], szKey, len) < 0)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    for(i = lo; i < pList->len && strncmp(pKind->apKeys[pKind->aSorted[i]], szKey, len) == 0; ++i)
+    {
+      if(pKind->aSorted[i] >= startIndex && pKind->aSorted[i] < found)
+      {
+        found = pKind->aSorted[i];
+        if(found == startIndex)
+          break;
+      }
+    }
+  }
+
+  return found;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Add an index to the list, so FlyFileListFind() is a hash lookup (exact) or binary search
+  (FLYFILELIST_OPTS_BEG, FLYFILELIST_OPTS_END) rather than a scan of the whole list. Use this if
+  the list will be searched many times, e.g. matching sources to objects.
+
+  Each kind of search (exact/beginning, end, and case insensitive versions of each) is indexed
+  the first time it's used. The index is freed with the list. FlyFileListSort() rebuilds it.
+
+  @param    hList     A list previously allocated with FlyFileListNew()
+  @return   TRUE if worked, FALSE if out of memory (FlyFileListFind() still works without index)
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileListIndex(void *hList)
+{
+  sFlyFileList_t *pFileList = hList;
+
+  if(!FlyFileListIsList(hList))
+    return FALSE;
+  if(!pFileList->pIndex)
+    pFileList->pIndex = FlyAllocZ(sizeof(fflIndex_t));
+
+  return pFileList->pIndex ? TRUE : FALSE;
+}
+
 /*!------------------------------------------------------------------------------------------------
   Free a list of files that was made using FlyFileListNew().
 
@@ -407,8 +811,14 @@ void * FlyFileListNewExts(const char *szFolder, const char *szExtList, unsigned
 *///-----------------------------------------------------------------------------------------------
 void * FlyFileListFree(void *hList)
 {
+  sFlyFileList_t *pFileList = hList;
+
   if(FlyFileListIsList(hList))
+  {
+    FflIndexClear(pFileList->pIndex);
+    FlyFreeIf(pFileList->pIndex);
     FlyFree(hList);
+  }
   return NULL;
 }
 
@@ -506,12 +916,21 @@ const char * FlyFileListGetName(void *hList, unsigned i)
 *///-----------------------------------------------------------------------------------------------
 unsigned FlyFileListFind(void *hList, const char *sz, unsigned startIndex, flyFileListOpts_t opts)
 {
+  sFlyFileList_t *pFileList = hList;
   const char *szEntry;
   size_t      lenEntry;
   size_t      len = strlen(sz);
   unsigned    i;
   bool_t      fFound = FALSE;
 
+  // use index if there is one, see FlyFileListIndex()
+  if(FlyFileListIsList(hList) && pFileList->pIndex)
+  {
+    i = FflIndexFind(pFileList, sz, startIndex, opts);
+    if(i != FFL_INDEX_UNUSABLE)
+      return i;
+  }
+
   for(i = startIndex; i < FlyFileListLen(hList); ++i)
   {
     szEntry = FlyFileListGetName(hList, i);
@@ -651,6 +1070,200 @@ static int FflCmpStr(const void *ppThis_, const void *ppThat_)
   return strcmp(*ppThis, *ppThat);
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Make the sort key for a path, or just get its length if pKey is NULL. Keys are never longer
+  than 4 * strlen(szPath) and compare bytewise (unsigned) in the order wanted:
+
+  * FLYFILELIST_OPTS_NOCASE: letters are folded to lower case
+  * FLYFILELIST_OPTS_NATURAL: each run of digits becomes '0', its length without leading zeros,
+    then the digits, so "file2" < "file10"
+  * FLYFILELIST_OPTS_DIRSFIRST: each path component is prefixed by \2 if a folder (followed by
+    a slash) or \3 if a file, and slashes become \1, so folders come before files at each level
+
+  @param  pKey    buffer for key, or NULL
+  @param  szPath  path to make key from
+  @param  opts    sort options
+  @return length of key, not including '\0'
+*///-----------------------------------------------------------------------------------------------
+static size_t FflSortKey(char *pKey, const char *szPath, flyFileListOpts_t opts)
+{
+  const char *psz   = szPath;
+  const char *pszEnd;
+  size_t      len   = 0;
+  size_t      digits;
+
+  #define FFL_KEY_PUT(c)  do { if(pKey) pKey[len] = (char)(c); ++len; } while(0)
+
+  while(*psz)
+  {
+    // start of a component
+    if((opts & FLYFILELIST_OPTS_DIRSFIRST) && (psz == szPath || psz[-1] == '/') && *psz != '/')
+      FFL_KEY_PUT(strchr(psz, '/') ? '\2' : '\3');
+
+    if((opts & FLYFILELIST_OPTS_NATURAL) && isdigit((unsigned char)*psz))
+    {
+      while(*psz == '0' && isdigit((unsigned char)psz[1]))
+        ++psz;
+      pszEnd = psz;
+      while(isdigit((unsigned char)*pszEnd))
+        ++pszEnd;
+
+      // lengths over 255 digits are split, so order of such numbers is approximate
+      while(psz < pszEnd)
+      {
+        digits = (size_t)(pszEnd - psz);
+        if(digits > 255)
+          digits = 255;
+        FFL_KEY_PUT('0');
+        FFL_KEY_PUT(digits);
+        for(; digits; --digits, ++psz)
+          FFL_KEY_PUT(*psz);
+      }
+    }
+    else if(*psz == '/' && (opts & FLYFILELIST_OPTS_DIRSFIRST))
+    {
+      FFL_KEY_PUT('\1');
+      ++psz;
+    }
+    else
+    {
+      FFL_KEY_PUT((opts & FLYFILELIST_OPTS_NOCASE) ? tolower((unsigned char)*psz) : *psz);
+      ++psz;
+    }
+  }
+  if(pKey)
+    pKey[len] = '\0';
+
+  #undef FFL_KEY_PUT
+
+  return len;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Compare two sort records from the given key depth, with path as tie breaker.
+-------------------------------------------------------------------------------------------------*/
+static int FflSortCmp(const fflSortRec_t *pA, const fflSortRec_t *pB, size_t depth)
+{
+  int   ret = strcmp(&pA->szKey[depth], &pB->szKey[depth]);
+  if(ret == 0)
+    ret = strcmp(pA->szPath, pB->szPath);
+  return ret;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Compare sort records by path only, for qsort()
+-------------------------------------------------------------------------------------------------*/
+static int FflSortCmpPath(const void *pThis, const void *pThat)
+{
+  return strcmp(((const fflSortRec_t *)pThis)->szPath, ((const fflSortRec_t *)pThat)->szPath);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Insertion sort for small ranges, where all keys share the first depth bytes.
+-------------------------------------------------------------------------------------------------*/
+static void FflSortSmall(fflSortRec_t *aRecs, size_t n, size_t depth)
+{
+  fflSortRec_t  rec;
+  size_t        i;
+  size_t        j;
+
+  for(i = 1; i < n; ++i)
+  {
+    rec = aRecs[i];
+    for(j = i; j > 0 && FflSortCmp(&aRecs[j - 1], &rec, depth) > 0; --j)
+      aRecs[j] = aRecs[j - 1];
+    aRecs[j] = rec;
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Multikey quicksort (Bentley and Sedgewick) of sort records by key, starting at byte depth.
+
+  Each pass partitions by one byte into <, = and > the pivot byte, so a shared prefix is looked
+  at once per record rather than once per compare, and there is no indirect call per compare.
+  The two smaller partitions are recursed into, the largest is looped on, so the stack is at
+  most log2(n) deep.
+-------------------------------------------------------------------------------------------------*/
+static void FflSortMkqs(fflSortRec_t *aRecs, size_t n, size_t depth)
+{
+  fflSortRec_t  rec;
+  size_t        lt;
+  size_t        gt;
+  size_t        i;
+  size_t        nLt;
+  size_t        nGt;
+  uint8_t       pivot;
+  uint8_t       a, b, c;
+  uint8_t       ch;
+
+  #define FFL_CH(i) ((uint8_t)aRecs[i].szKey[depth])
+
+  while(n > 16)
+  {
+    // median of 3 pivot byte
+    a = FFL_CH(0);
+    b = FFL_CH(n / 2);
+    c = FFL_CH(n - 1);
+    pivot = (a < b) ? ((b < c) ? b : (a < c) ? c : a) : ((a < c) ? a : (b < c) ? c : b);
+
+    // 3-way partition: [0, lt) < pivot, [lt, gt) == pivot, [gt, n) > pivot
+    lt = i = 0;
+    gt = n;
+    while(i < gt)
+    {
+      ch = FFL_CH(i);
+      if(ch < pivot)
+      {
+        rec = aRecs[lt]; aRecs[lt] = aRecs[i]; aRecs[i] = rec;
+        ++lt;
+        ++i;
+      }
+      else if(ch > pivot)
+      {
+        --gt;
+        rec = aRecs[gt]; aRecs[gt] = aRecs[i]; aRecs[i] = rec;
+      }
+      else
+        ++i;
+    }
+    nLt = lt;
+    nGt = n - gt;
+
+    // equal keys: only the path can order them
+    if(pivot == 0 && gt - lt > 1)
+      qsort(&aRecs[lt], gt - lt, sizeof(fflSortRec_t), FflSortCmpPath);
+
+    // recurse into the 2 smaller partitions, loop on the largest
+    if(pivot != 0 && gt - lt >= nLt && gt - lt >= nGt)
+    {
+      FflSortMkqs(aRecs, nLt, depth);
+      FflSortMkqs(&aRecs[gt], nGt, depth);
+      aRecs = &aRecs[lt];
+      n     = gt - lt;
+      ++depth;
+    }
+    else if(nLt >= nGt)
+    {
+      if(pivot != 0)
+        FflSortMkqs(&aRecs[lt], gt - lt, depth + 1);
+      FflSortMkqs(&aRecs[gt], nGt, depth);
+      n = nLt;
+    }
+    else
+    {
+      if(pivot != 0)
+        FflSortMkqs(&aRecs[lt], gt - lt, depth + 1);
+      FflSortMkqs(aRecs, nLt, depth);
+      aRecs = &aRecs[gt];
+      n     = nGt;
+    }
+  }
+
+  #undef FFL_CH
+
+  FflSortSmall(aRecs, n, depth);
+}
+
 /*!------------------------------------------------------------------------------------------------
   Sort the list of files in the list (in case OS doesn't).
 
@@ -665,7 +1278,101 @@ void FlyFileListSort(void *hList, pfnFlyFileSort_t pfnCmpStr)
 {
   sFlyFileList_t *pList = hList;
   if(FlyFileListIsList(hList))
-    qsort(pList->aszPath, pList->len, sizeof(char *), pfnCmpStr ? pfnCmpStr : FflCmpStr);
+  {
+    if(pfnCmpStr || !FlyFileListSortEx(hList, 0))
+      qsort(pList->aszPath, pList->len, sizeof(char *), pfnCmpStr ? pfnCmpStr : FflCmpStr);
+    FflIndexClear(pList->pIndex);
+  }
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Sort the list with a multikey quicksort on the path bytes, which is faster than a qsort()
+  compare function on large lists. The strings are then repacked in sorted order, so walking the
+  sorted list walks memory in order.
+
+  With no options, the order is the same as strcmp(). Options (may be combined):
+
+  * FLYFILELIST_OPTS_NOCASE: case insensitive, e.g. "b.c" < "B.h" < "c.c"
+  * FLYFILELIST_OPTS_NATURAL: numbers sort by value, e.g. "file2.c" < "file10.c"
+  * FLYFILELIST_OPTS_DIRSFIRST: folders (ending in slash) come before files at each level
+
+  Paths that have the same key (e.g. "file02" and "file2" when natural) are ordered by strcmp().
+
+  @param    hList     List created with FlyFileListNew() or FlyFileListNewExts()
+  @param    opts      0 or FLYFILELIST_OPTS_NOCASE, FLYFILELIST_OPTS_NATURAL, FLYFILELIST_OPTS_DIRSFIRST
+  @return   TRUE if worked, FALSE if not a list or out of memory (list is unchanged)
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileListSortEx(void *hList, flyFileListOpts_t opts)
+{
+  sFlyFileList_t *pList   = hList;
+  fflSortRec_t   *aRecs   = NULL;
+  char           *pKeys   = NULL;
+  char           *pStrs   = NULL;
+  char           *sz;
+  size_t          keysLen = 0;
+  size_t          strsLen = 0;
+  size_t          len;
+  unsigned        i;
+  bool_t          fKeyed;
+
+  if(!FlyFileListIsList(hList))
+    return FALSE;
+  if(pList->len < 2)
+    return TRUE;
+
+  // strings are packed after the pointers, see FlyFileListNew()
+  fKeyed = (opts & (FLYFILELIST_OPTS_NOCASE | FLYFILELIST_OPTS_NATURAL | FLYFILELIST_OPTS_DIRSFIRST)) ? TRUE : FALSE;
+  for(i = 0; i < pList->len; ++i)
+  {
+    strsLen += strlen(pList->aszPath[i]) + 1;
+    if(fKeyed)
+      keysLen += FflSortKey(NULL, pList->aszPath[i], opts) + 1;
+  }
+  aRecs = FlyAlloc(pList->len * sizeof(fflSortRec_t));
+  pStrs = FlyAlloc(strsLen);
+  if(fKeyed)
+    pKeys = FlyAlloc(keysLen);
+  if(!aRecs || !pStrs || (fKeyed && !pKeys))
+  {
+    FlyFreeIf(aRecs);
+    FlyFreeIf(pStrs);
+    FlyFreeIf(pKeys);
+    return FALSE;
+  }
+
+  for(keysLen = 0, i = 0; i < pList->len; ++i)
+  {
+    aRecs[i].szPath = pList->aszPath[i];
+    aRecs[i].szKey  = pList->aszPath[i];
+    if(fKeyed)
+    {
+      aRecs[i].szKey = &pKeys[keysLen];
+      keysLen += FflSortKey(&pKeys[keysLen], pList->aszPath[i], opts) + 1;
+    }
+  }
+  FflSortMkqs(aRecs, pList->len, 0);
+
+  // repack strings in sorted order
+  for(sz = pStrs, i = 0; i < pList->len; ++i)
+  {
+    len = strlen(aRecs[i].szPath) + 1;
+    memcpy(sz, aRecs[i].szPath, len);
+    sz += len;
+  }
+  sz = (char *)(&pList->aszPath[pList->len]);
+  memcpy(sz, pStrs, strsLen);
+  for(i = 0; i < pList->len; ++i)
+  {
+    pList->aszPath[i] = sz;
+    sz += strlen(sz) + 1;
+  }
+
+  FlyFree(aRecs);
+  FlyFree(pStrs);
+  FlyFreeIf(pKeys);
+  FflIndexClear(pList->pIndex);
+
+  return TRUE;
 }
 
 /*!------------------------------------------------------------------------------------------------
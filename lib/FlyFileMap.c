@@ -0,0 +1,209 @@
+/**************************************************************************************************
+  FlyFileMap.c - Read-only, zero-copy views of whole files using mmap()
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileMap   Read-only, zero-copy views of whole files
+
+  FlyFileRead() copies the whole file into heap memory. FlyFileMap() instead maps the file into
+  memory, so a multi-GB JSON, TOML or markdown file costs no copy and only the pages actually
+  touched are read from disk.
+
+  1. The view is read-only and always '\0' terminated, so it works with both the asciiz and the
+     (sz, szEnd) string APIs (e.g. FlyMd2HtmlContent(), FlyStrNChrMatch())
+  2. Pipes, /dev/fd/n, /proc files and other special files fall back to read() into heap memory
+  3. Hints tell the kernel how the view will be accessed (sequential, random, willneed)
+
+  Note: if another process truncates a mapped file, touching the missing pages raises SIGBUS.
+
+  @example FlyFileMap Count lines in a file
+
+  ```
+  #include "FlyFile.h"
+
+  flyFileMap_t  map;
+  const char   *psz;
+  size_t        lines = 0;
+
+  if(FlyFileMap(&map, "big.json", FLYFILEMAP_SEQUENTIAL))
+  {
+    for(psz = map.pData; (psz = strchr(psz, '\n')) != NULL; ++psz)
+      ++lines;
+    FlyFileUnmap(&map);
+  }
+  ```
+*/
+
+#define FILEMAP_READ_CHUNK    (64 * 1024)
+
+/*-------------------------------------------------------------------------------------------------
+  Apply the access hint to the mapping. Hints are advisory, so failures are ignored.
+-------------------------------------------------------------------------------------------------*/
+static void FileMapAdvise(void *pMem, size_t len, unsigned hint)
+{
+  if(hint & FLYFILEMAP_SEQUENTIAL)
+    (void)madvise(pMem, len, MADV_SEQUENTIAL);
+  else if(hint & FLYFILEMAP_RANDOM)
+    (void)madvise(pMem, len, MADV_RANDOM);
+  if(hint & FLYFILEMAP_WILLNEED)
+    (void)madvise(pMem, len, MADV_WILLNEED);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Map len bytes of the file, followed by at least 1 zeroed byte for the '\0' terminator.
+
+  Reserves an anonymous zero-filled region one byte longer than the file (rounded to a page), then
+  maps the file over the front of it. The bytes past end of file in the last file page are zero
+  by mmap() definition, and if the file is an exact multiple of the page size the '\0' comes from
+  the anonymous page that follows.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileMapMmap(flyFileMap_t *pMap, int fd, size_t len, unsigned hint)
+{
+  size_t    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+  size_t    mapLen;
+  void     *pMem;
+
+  mapLen = ((len + 1 + pageSize - 1) / pageSize) * pageSize;
+  pMem   = mmap(NULL, mapLen, PROT_READ, MAP_PRIVATE | MAP_ANON, -1, 0);
+  if(pMem == MAP_FAILED)
+    return FALSE;
+  if(mmap(pMem, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED)
+  {
+    munmap(pMem, mapLen);
+    return FALSE;
+  }
+
+  FileMapAdvise(pMem, len, hint);
+  pMap->pData   = pMem;
+  pMap->len     = len;
+  pMap->mapLen  = mapLen;
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Read the whole file into heap memory, for pipes and special files that can't be mapped. sizeHint
+  is the expected size (may be 0 if unknown).
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileMapRead(flyFileMap_t *pMap, int fd, size_t sizeHint)
+{
+  char     *pData   = NULL;
+  char     *pNew;
+  size_t    size    = sizeHint + 1 > FILEMAP_READ_CHUNK ? sizeHint + 1 : FILEMAP_READ_CHUNK;
+  size_t    len     = 0;
+  ssize_t   n;
+
+  pData = FlyAlloc(size);
+  while(pData)
+  {
+    if(len + 1 >= size)
+    {
+      size *= 2;
+      pNew = FlyRealloc(pData, size);
+      if(!pNew)
+      {
+        FlyFree(pData);
+        pData = NULL;
+        break;
+      }
+      pData = pNew;
+    }
+
+    n = read(fd, &pData[len], size - len - 1);
+    if(n == 0)
+      break;
+    if(n < 0)
+    {
+      if(errno == EINTR)
+        continue;
+      FlyFree(pData);
+      pData = NULL;
+      break;
+    }
+    len += (size_t)n;
+  }
+
+  if(!pData)
+    return FALSE;
+
+  pData[len]    = '\0';
+  pMap->pData   = pData;
+  pMap->len     = len;
+  pMap->mapLen  = 0;
+  return TRUE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Map a whole file into memory as a read-only, '\0' terminated view. No copy is made for regular
+  files. Pipes and special files are read into heap memory instead. Either way, free the view with
+  FlyFileUnmap().
+
+  The contents are pMap->pData through pMap->pData + pMap->len, and pMap->pData[pMap->len] is
+  always '\0'. Binary files may contain '\0' bytes, so use pMap->len rather than strlen().
+
+  @param    pMap        pointer to map structure to fill in
+  @param    szFilename  file to map
+  @param    hint        FLYFILEMAP_NORMAL, or FLYFILEMAP_SEQUENTIAL or FLYFILEMAP_RANDOM, optionally
+                        or'd with FLYFILEMAP_WILLNEED
+  @return   TRUE if worked, FALSE if file could not be opened or read, or not enough memory
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileMap(flyFileMap_t *pMap, const char *szFilename, unsigned hint)
+{
+  struct stat   st;
+  int           fd;
+  bool_t        fWorked = FALSE;
+
+  memset(pMap, 0, sizeof(*pMap));
+  fd = open(szFilename, O_RDONLY);
+  if(fd < 0)
+    return FALSE;
+
+  if(fstat(fd, &st) == 0 && !S_ISDIR(st.st_mode))
+  {
+    // empty regular files may be special (e.g. /proc), so read them to be sure
+    if(S_ISREG(st.st_mode) && st.st_size > 0 && (uint64_t)st.st_size < SIZE_MAX)
+      fWorked = FileMapMmap(pMap, fd, (size_t)st.st_size, hint);
+    if(!fWorked)
+      fWorked = FileMapRead(pMap, fd, S_ISREG(st.st_mode) ? (size_t)st.st_size : 0);
+  }
+  close(fd);
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this view memory-mapped (TRUE) or was it read into heap memory (FALSE)?
+
+  @param    pMap    pointer to a map filled in by FlyFileMap()
+  @return   TRUE if mapped
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileMapIsMapped(const flyFileMap_t *pMap)
+{
+  return (pMap->pData && pMap->mapLen) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free a view created by FlyFileMap(). Safe to call more than once, or on a failed map.
+
+  @param    pMap    pointer to a map filled in by FlyFileMap()
+  @return   none
+*///-----------------------------------------------------------------------------------------------
+void FlyFileUnmap(flyFileMap_t *pMap)
+{
+  if(pMap->pData)
+  {
+    if(pMap->mapLen)
+      munmap((void *)pMap->pData, pMap->mapLen);
+    else
+      FlyFree((void *)pMap->pData);
+  }
+  memset(pMap, 0, sizeof(*pMap));
+}
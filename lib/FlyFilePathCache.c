@@ -0,0 +1,508 @@
+/**************************************************************************************************
+  FlyFilePathCache.c - Cached versions of FlyFileFindInPath() and FlyFileFindInFolder()
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFilePathCache   Cached versions of FlyFileFindInPath() and FlyFileFindInFolder()
+
+  FlyFileFindInPath() splits $PATH and checks every folder on each call. FlyFileFindInFolder()
+  checks every parent folder on each call. Build tools call these for every tool they run.
+
+  1. The $PATH folders are read once into a hash table of name to path, so a lookup is a hash hit
+     (or miss) with no system calls
+  2. The table is rebuilt if $PATH changes, or if a $PATH folder's mtime changed (checked at most
+     once every maxAge seconds)
+  3. FlyFilePathCacheFindInFolder() remembers each probe (found or not found), so repeated
+     lookups are hash hits. Probes are forgotten every maxAge seconds
+
+  Results may be up to maxAge seconds out of date. Use FlyFilePathCacheFlush() after creating or
+  deleting files the cache needs to see. The cache is not thread safe.
+
+  @example FlyFilePathCache Find compiler for each file to build
+
+  ```
+  #include "FlyFile.h"
+
+  void *hCache = FlyFilePathCacheNew(1);
+  char  szCc[PATH_MAX];
+
+  for(i = 0; i < nFiles; ++i)
+  {
+    if(FlyFilePathCacheFindInPath(hCache, szCc, sizeof(szCc), "cc", FALSE))
+      Compile(szCc, aszFiles[i]);
+  }
+  FlyFilePathCacheFree(hCache);
+  ```
+*/
+
+#define FLY_FILEPATHCACHE_SANCHK  17171
+#define PATHCACHE_TABLE_MIN       256
+
+typedef struct
+{
+  char                 *szKey;        // NULL if slot is empty
+  char                 *szVal;        // NULL means "not found"
+  uint32_t              hash;
+} pathCacheEntry_t;
+
+typedef struct
+{
+  pathCacheEntry_t     *aEntries;     // open address hash table
+  unsigned              n;
+  unsigned              size;         // power of 2
+} pathCacheTable_t;
+
+typedef struct
+{
+  unsigned              sanchk;
+  unsigned              maxAge;       // seconds before checking for changes
+  char                 *szEnvPath;    // $PATH the table was built from
+  char                **aszDirs;      // $PATH folders
+  int64_t              *aDirTimes;    // mtime of each folder, in ns
+  unsigned              nDirs;
+  time_t                dirsChecked;  // time folder mtimes were last checked
+  pathCacheTable_t      names;        // name to full path of all $PATH files
+  pathCacheTable_t      probes;       // path to "" if file exists, NULL if not
+  pathCacheTable_t      folders;      // base folder to full path
+  time_t                probesTime;   // time probes were started
+} sFlyFilePathCache_t;
+
+/*-------------------------------------------------------------------------------------------------
+  FNV-1a hash of a string.
+-------------------------------------------------------------------------------------------------*/
+static uint32_t PathCacheHash(const char *sz)
+{
+  uint32_t  hash = 2166136261u;
+
+  while(*sz)
+  {
+    hash ^= (uint8_t)*sz++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find the slot for a key. The returned slot has szKey NULL if key is not in the table.
+-------------------------------------------------------------------------------------------------*/
+static pathCacheEntry_t * PathCacheSlot(pathCacheTable_t *pTable, const char *szKey, uint32_t hash)
+{
+  pathCacheEntry_t   *pEntry;
+  unsigned            i = hash & (pTable->size - 1);
+
+  while(TRUE)
+  {
+    pEntry = &pTable->aEntries[i];
+    if(pEntry->szKey == NULL || (pEntry->hash == hash && strcmp(pEntry->szKey, szKey) == 0))
+      break;
+    i = (i + 1) & (pTable->size - 1);
+  }
+  return pEntry;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Look up a key. Returns entry or NULL if not in table.
+-------------------------------------------------------------------------------------------------*/
+static const pathCacheEntry_t * PathCacheLookup(pathCacheTable_t *pTable, const char *szKey)
+{
+  pathCacheEntry_t   *pEntry;
+
+  if(pTable->size == 0)
+    return NULL;
+  pEntry = PathCacheSlot(pTable, szKey, PathCacheHash(szKey));
+  return pEntry->szKey ? pEntry : NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Add a key (not already in table) and value (may be NULL). Both are copied. Returns FALSE if out
+  of memory, in which case the lookup just won't be cached.
+-------------------------------------------------------------------------------------------------*/
+static bool_t PathCacheAdd(pathCacheTable_t *pTable, const char *szKey, const char *szVal)
+{
+  pathCacheEntry_t   *aOld    = pTable->aEntries;
+  pathCacheEntry_t   *pEntry;
+  unsigned            oldSize = pTable->size;
+  unsigned            i;
+  uint32_t            hash;
+
+  // keep at most half full
+  if((pTable->n + 1) * 2 > pTable->size)
+  {
+    pTable->size = oldSize ? oldSize * 2 : PATHCACHE_TABLE_MIN;
+    pTable->aEntries = FlyAllocZ(pTable->size * sizeof(pathCacheEntry_t));
+    if(!pTable->aEntries)
+    {
+      pTable->aEntries = aOld;
+      pTable->size = oldSize;
+      return FALSE;
+    }
+    for(i = 0; i < oldSize; ++i)
+    {
+      if(aOld[i].szKey)
+        *PathCacheSlot(pTable, aOld[i].szKey, aOld[i].hash) = aOld[i];
+    }
+    FlyFreeIf(aOld);
+  }
+
+  hash = PathCacheHash(szKey);
+  pEntry = PathCacheSlot(pTable, szKey, hash);
+  pEntry->szKey = FlyStrClone(szKey);
+  pEntry->szVal = szVal ? FlyStrClone(szVal) : NULL;
+  if(!pEntry->szKey || (szVal && !pEntry->szVal))
+  {
+    FlyFreeIf(pEntry->szKey);
+    FlyFreeIf(pEntry->szVal);
+    pEntry->szKey = pEntry->szVal = NULL;
+    return FALSE;
+  }
+  pEntry->hash = hash;
+  ++pTable->n;
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Free everything in the table. The table can still be used.
+-------------------------------------------------------------------------------------------------*/
+static void PathCacheClear(pathCacheTable_t *pTable)
+{
+  unsigned    i;
+
+  for(i = 0; i < pTable->size; ++i)
+  {
+    FlyFreeIf(pTable->aEntries[i].szKey);
+    FlyFreeIf(pTable->aEntries[i].szVal);
+  }
+  FlyFreeIf(pTable->aEntries);
+  memset(pTable, 0, sizeof(*pTable));
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Forget the $PATH table
+-------------------------------------------------------------------------------------------------*/
+static void PathCacheClearDirs(sFlyFilePathCache_t *pCache)
+{
+  unsigned    i;
+
+  PathCacheClear(&pCache->names);
+  for(i = 0; i < pCache->nDirs; ++i)
+    FlyFree(pCache->aszDirs[i]);
+  FlyFreeIf(pCache->aszDirs);
+  FlyFreeIf(pCache->aDirTimes);
+  pCache->szEnvPath = FlyFreeIf(pCache->szEnvPath);
+  pCache->aszDirs   = NULL;
+  pCache->aDirTimes = NULL;
+  pCache->nDirs     = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Add all files in this $PATH folder not already found in an earlier folder.
+-------------------------------------------------------------------------------------------------*/
+static void PathCacheReadDir(sFlyFilePathCache_t *pCache, const char *szDir)
+{
+  DIR              *pDir;
+  struct dirent    *pEntry;
+  struct stat       st;
+  char              szPath[PATH_MAX];
+  bool_t            fIsFile;
+
+  pDir = opendir(*szDir ? szDir : "/");
+  if(!pDir)
+    return;
+
+  while((pEntry = readdir(pDir)) != NULL)
+  {
+    if(pEntry->d_name[0] == '.' && (pEntry->d_name[1] == '\0' || strcmp(pEntry->d_name, "..") == 0))
+      continue;
+    if(PathCacheLookup(&pCache->names, pEntry->d_name))
+      continue;
+
+    // links and unknown types need a stat() to see if they are files
+#ifdef DT_REG
+    if(pEntry->d_type == DT_REG)
+      fIsFile = TRUE;
+    else if(pEntry->d_type == DT_LNK || pEntry->d_type == DT_UNKNOWN)
+#endif
+      fIsFile = (fstatat(dirfd(pDir), pEntry->d_name, &st, 0) == 0 && S_ISREG(st.st_mode)) ? TRUE : FALSE;
+#ifdef DT_REG
+    else
+      fIsFile = FALSE;
+#endif
+
+    // same form as FlyFileFindInPath(): folder as listed in $PATH, then slash, then name
+    if(fIsFile && (size_t)snprintf(szPath, sizeof(szPath), "%s/%s", szDir, pEntry->d_name) < sizeof(szPath))
+      PathCacheAdd(&pCache->names, pEntry->d_name, szPath);
+  }
+  closedir(pDir);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Rebuild the $PATH table from $PATH. Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t PathCacheBuild(sFlyFilePathCache_t *pCache, const char *szEnvPath)
+{
+  flyFileStat_t   stat;
+  const char     *psz;
+  const char     *pszEnd;
+  unsigned        nDirs = 1;
+  unsigned        i;
+
+  PathCacheClearDirs(pCache);
+
+  for(psz = szEnvPath; *psz; ++psz)
+  {
+    if(*psz == ':')
+      ++nDirs;
+  }
+  pCache->szEnvPath = FlyStrClone(szEnvPath);
+  pCache->aszDirs   = FlyAllocZ(nDirs * sizeof(char *));
+  pCache->aDirTimes = FlyAllocZ(nDirs * sizeof(int64_t));
+  if(!pCache->szEnvPath || !pCache->aszDirs || !pCache->aDirTimes)
+  {
+    PathCacheClearDirs(pCache);
+    return FALSE;
+  }
+
+  // mtime is taken before reading, so a change while reading is seen next time
+  for(psz = szEnvPath, i = 0; i < nDirs; ++i, psz = pszEnd + 1)
+  {
+    pszEnd = strchr(psz, ':');
+    if(!pszEnd)
+      pszEnd = psz + strlen(psz);
+    pCache->aszDirs[i] = FlyStrAllocN(psz, (size_t)(pszEnd - psz));
+    if(!pCache->aszDirs[i])
+      break;
+    ++pCache->nDirs;
+    if(FlyFileStat(&stat, *pCache->aszDirs[i] ? pCache->aszDirs[i] : "/", 0))
+      pCache->aDirTimes[i] = stat.mtimeNs;
+    PathCacheReadDir(pCache, pCache->aszDirs[i]);
+  }
+  pCache->dirsChecked = time(NULL);
+
+  return (pCache->nDirs == nDirs) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Make sure the $PATH table is up to date. Returns FALSE if it can't be built.
+-------------------------------------------------------------------------------------------------*/
+static bool_t PathCacheCheckDirs(sFlyFilePathCache_t *pCache)
+{
+  flyFileStat_t   stat;
+  const char     *szEnvPath;
+  time_t          now;
+  unsigned        i;
+
+  szEnvPath = getenv("PATH");
+  if(!szEnvPath)
+    szEnvPath = "";
+  if(!pCache->szEnvPath || strcmp(pCache->szEnvPath, szEnvPath) != 0)
+    return PathCacheBuild(pCache, szEnvPath);
+
+  now = time(NULL);
+  if(now - pCache->dirsChecked >= (time_t)pCache->maxAge)
+  {
+    pCache->dirsChecked = now;
+    for(i = 0; i < pCache->nDirs; ++i)
+    {
+      if(!FlyFileStat(&stat, *pCache->aszDirs[i] ? pCache->aszDirs[i] : "/", 0))
+        stat.mtimeNs = 0;
+      if(stat.mtimeNs != pCache->aDirTimes[i])
+        return PathCacheBuild(pCache, szEnvPath);
+    }
+  }
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Does this file exist? Remembers the answer until the probes expire.
+-------------------------------------------------------------------------------------------------*/
+static bool_t PathCacheProbe(const char *szPath, void *pData)
+{
+  sFlyFilePathCache_t    *pCache  = pData;
+  const pathCacheEntry_t *pEntry;
+  bool_t                  fExists;
+
+  pEntry = PathCacheLookup(&pCache->probes, szPath);
+  if(pEntry)
+    return pEntry->szVal ? TRUE : FALSE;
+
+  fExists = FlyFileExistsFile(szPath);
+  PathCacheAdd(&pCache->probes, szPath, fExists ? "" : NULL);
+
+  return fExists;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a pointer to a path cache?
+
+  @param    hCache    handle from FlyFilePathCacheNew()
+  @return   TRUE if a path cache handle
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFilePathCacheIsCache(void *hCache)
+{
+  sFlyFilePathCache_t *pCache = hCache;
+  return (pCache && (pCache->sanchk == FLY_FILEPATHCACHE_SANCHK)) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Create a cache for FlyFilePathCacheFindInPath() and FlyFilePathCacheFindInFolder().
+
+  @param    maxAge    seconds before checking for changes, e.g. 1. 0 checks folder times on each
+                      lookup and doesn't remember probes
+  @return   handle to cache, or NULL if out of memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyFilePathCacheNew(unsigned maxAge)
+{
+  sFlyFilePathCache_t *pCache;
+
+  pCache = FlyAllocZ(sizeof(*pCache));
+  if(pCache)
+  {
+    pCache->sanchk  = FLY_FILEPATHCACHE_SANCHK;
+    pCache->maxAge  = maxAge;
+  }
+
+  return pCache;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Same as FlyFileFindInPath(), but looks up szBaseName in a table of all files in all $PATH
+  folders, built on first use. See FlyFileFindInPath().
+
+  @param    hCache          handle from FlyFilePathCacheNew()
+  @param    szPath          destination path string
+  @param    maxSize         sizeof(szPath) buffer
+  @param    szBaseName      file to look for (could be exec name for example)
+  @param    cwdFirst        Look at cwd first, before scanning path for file
+  @return   TRUE and path in szPath if found, FALSE if not found.
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFilePathCacheFindInPath(void *hCache, char *szPath, unsigned maxSize, const char *szBaseName,
+                                  bool_t cwdFirst)
+{
+  sFlyFilePathCache_t    *pCache  = hCache;
+  const pathCacheEntry_t *pEntry;
+
+  if(!FlyFilePathCacheIsCache(hCache))
+    return FALSE;
+
+  // the table holds names, not partial paths
+  if(!szBaseName || (cwdFirst && FlyFileExistsFile(szBaseName)) || strchr(szBaseName, '/') ||
+     !PathCacheCheckDirs(pCache))
+  {
+    return FlyFileFindInPath(szPath, maxSize, szBaseName, cwdFirst);
+  }
+
+  pEntry = PathCacheLookup(&pCache->names, szBaseName);
+  if(!szPath || !pEntry || strlen(pEntry->szVal) >= maxSize)
+    return FALSE;
+  strcpy(szPath, pEntry->szVal);
+
+  return TRUE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Same as FlyFileFindInFolder(), but remembers which files exist, so repeated lookups don't touch
+  the file system. See FlyFileFindInFolder().
+
+  @param    hCache          handle from FlyFilePathCacheNew()
+  @param    szPath          destination path string
+  @param    maxSize         sizeof(szPath) buffer
+  @param    szBaseName      name of file to look for
+  @param    szBaseFolder    starting folder to search (will search parent folders also)
+  @return   TRUE and path in szPath if found, FALSE if not found.
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFilePathCacheFindInFolder(void *hCache, char *szPath, unsigned maxSize, const char *szBaseName,
+                                    const char *szBaseFolder)
+{
+  sFlyFilePathCache_t    *pCache  = hCache;
+  const pathCacheEntry_t *pEntry;
+  time_t                  now;
+
+  if(!FlyFilePathCacheIsCache(hCache) || !szBaseName || !szPath || !maxSize)
+    return FALSE;
+
+  now = time(NULL);
+  if(pCache->maxAge == 0 || now - pCache->probesTime >= (time_t)pCache->maxAge)
+  {
+    PathCacheClear(&pCache->probes);
+    PathCacheClear(&pCache->folders);
+    pCache->probesTime = now;
+  }
+
+  // find base path, remembering the full path of the base folder
+  if(!szBaseFolder)
+  {
+    if(getcwd(szPath, maxSize) == NULL)
+      return FALSE;
+  }
+  else
+  {
+    pEntry = PathCacheLookup(&pCache->folders, szBaseFolder);
+    if(pEntry)
+    {
+      if(!pEntry->szVal || strlen(pEntry->szVal) >= maxSize)
+        return FALSE;
+      strcpy(szPath, pEntry->szVal);
+    }
+    else
+    {
+      if(strlen(szBaseFolder) >= maxSize || !FlyFileFullPath(szPath, szBaseFolder))
+      {
+        PathCacheAdd(&pCache->folders, szBaseFolder, NULL);
+        return FALSE;
+      }
+      PathCacheAdd(&pCache->folders, szBaseFolder, szPath);
+    }
+  }
+
+  return FlyFileFindInFolderEx(szPath, maxSize, szBaseName, PathCacheProbe, pCache);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Forget everything, e.g. after creating or deleting files. The cache can still be used.
+
+  @param    hCache    handle from FlyFilePathCacheNew()
+  @return   none
+*///-----------------------------------------------------------------------------------------------
+void FlyFilePathCacheFlush(void *hCache)
+{
+  sFlyFilePathCache_t *pCache = hCache;
+
+  if(FlyFilePathCacheIsCache(hCache))
+  {
+    PathCacheClearDirs(pCache);
+    PathCacheClear(&pCache->probes);
+    PathCacheClear(&pCache->folders);
+  }
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free the cache.
+
+  @param    hCache    handle from FlyFilePathCacheNew()
+  @return   NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyFilePathCacheFree(void *hCache)
+{
+  sFlyFilePathCache_t *pCache = hCache;
+
+  if(FlyFilePathCacheIsCache(hCache))
+  {
+    FlyFilePathCacheFlush(hCache);
+    memset(pCache, 0, sizeof(*pCache));
+    FlyFree(pCache);
+  }
+
+  return NULL;
+}
@@ -0,0 +1,275 @@
+/**************************************************************************************************
+  FlyFilePrefetch.c - Read-ahead of file batches, so reading overlaps processing
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFilePrefetch   Read-ahead of file batches
+
+  Tools that read thousands of files one after another with FlyFileRead() or FlyFileMap() wait
+  on storage for every file, while the CPU sits idle. FlyFilePrefetch gets the next files into
+  the page cache before they are needed.
+
+  1. FlyFilePrefetch() asks the kernel to start reading files now (posix_fadvise() WILLNEED, or
+     F_RDADVISE on macOS), without waiting for them. Call it on the next N files of a batch
+  2. FlyFilePipeline() maps files on a reader thread, up to N files ahead, while the caller's
+     function processes each file in order on the calling thread
+  3. Files that can't be read are still passed to the process function, with a NULL map
+
+  Link with -lpthread.
+
+  @example FlyFilePrefetch Count lines in every file of a list, reading ahead
+
+  ```
+  #include "FlyFile.h"
+
+  bool_t CountLines(unsigned i, const char *szPath, const flyFileMap_t *pMap, void *pData)
+  {
+    const char *psz;
+
+    if(pMap)
+    {
+      for(psz = pMap->pData; (psz = strchr(psz, '\n')) != NULL; ++psz)
+        ++(*(size_t *)pData);
+    }
+    return TRUE;
+  }
+
+  void         *hList = FlyFileListNewExts("src/", ".c.h", UINT_MAX);
+  const char  **aszPaths = FlyAlloc(FlyFileListLen(hList) * sizeof(char *));
+  size_t        lines = 0;
+
+  for(i = 0; i < FlyFileListLen(hList); ++i)
+    aszPaths[i] = FlyFileListGetName(hList, i);
+  FlyFilePipeline(aszPaths, FlyFileListLen(hList), 0, CountLines, &lines);
+  ```
+*/
+
+#define FILEPREFETCH_AHEAD      8     // default # of files mapped ahead
+#define FILEPREFETCH_MAX_AHEAD  64
+#define FILEPREFETCH_PAGE       4096  // touch stride, no larger than any page size
+
+typedef struct
+{
+  flyFileMap_t          map;
+  bool_t                fMapped;
+} filePrefetchSlot_t;
+
+typedef struct
+{
+  const char          **aszPaths;
+  unsigned              n;
+  unsigned              nAhead;
+  filePrefetchSlot_t   *aSlots;       // ring of nAhead slots, file i is in slot i % nAhead
+  unsigned              nRead;        // files [0, nRead) have been mapped by the reader
+  unsigned              nDone;        // files [0, nDone) have been processed and unmapped
+  bool_t                fStop;
+  pthread_mutex_t       mutex;
+  pthread_cond_t        cond;
+} filePrefetchPipe_t;
+
+/*!------------------------------------------------------------------------------------------------
+  Start reading files into the page cache, without waiting. Use this on the next few files of a
+  batch before reading the current one. Paths that don't exist are skipped. A no-op (returns 0) on
+  systems with neither posix_fadvise() nor F_RDADVISE.
+
+  @param    aszPaths    array of n file paths
+  @param    n           number of files
+  @return   number of files for which read-ahead was started
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyFilePrefetch(const char **aszPaths, unsigned n)
+{
+  unsigned          nStarted = 0;
+  unsigned          i;
+  int               fd;
+#if !defined(POSIX_FADV_WILLNEED) && defined(F_RDADVISE)
+  struct stat       st;
+  struct radvisory  ra;
+#endif
+
+  for(i = 0; i < n; ++i)
+  {
+    fd = open(aszPaths[i], O_RDONLY | O_NONBLOCK);
+    if(fd >= 0)
+    {
+#if defined(POSIX_FADV_WILLNEED)
+      if(posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED) == 0)
+        ++nStarted;
+#elif defined(F_RDADVISE)
+      if(fstat(fd, &st) == 0)
+      {
+        ra.ra_offset = 0;
+        ra.ra_count  = (st.st_size > INT_MAX) ? INT_MAX : (int)st.st_size;
+        if(fcntl(fd, F_RDADVISE, &ra) != -1)
+          ++nStarted;
+      }
+#endif
+      close(fd);
+    }
+  }
+
+  return nStarted;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Touch each page of a mapping so it's read in now, on this thread, rather than on first use.
+-------------------------------------------------------------------------------------------------*/
+static void FilePrefetchTouch(const flyFileMap_t *pMap)
+{
+  const volatile char  *p = pMap->pData;
+  size_t                i;
+  char                  c = 0;
+
+  for(i = 0; i < pMap->len; i += FILEPREFETCH_PAGE)
+    c ^= p[i];
+  (void)c;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Reader thread: maps files in order, staying at most nAhead files ahead of processing.
+-------------------------------------------------------------------------------------------------*/
+static void * FilePrefetchReader(void *pArg)
+{
+  filePrefetchPipe_t   *pPipe = pArg;
+  filePrefetchSlot_t   *pSlot;
+  unsigned              i;
+  bool_t                fStop;
+
+  for(i = 0; i < pPipe->n; ++i)
+  {
+    pthread_mutex_lock(&pPipe->mutex);
+    while(!pPipe->fStop && i - pPipe->nDone >= pPipe->nAhead)
+      pthread_cond_wait(&pPipe->cond, &pPipe->mutex);
+    fStop = pPipe->fStop;
+    pthread_mutex_unlock(&pPipe->mutex);
+    if(fStop)
+      break;
+
+    // slot i is free: file i - nAhead was processed and unmapped
+    pSlot = &pPipe->aSlots[i % pPipe->nAhead];
+    pSlot->fMapped = FlyFileMap(&pSlot->map, pPipe->aszPaths[i], FLYFILEMAP_SEQUENTIAL | FLYFILEMAP_WILLNEED);
+    if(pSlot->fMapped)
+      FilePrefetchTouch(&pSlot->map);
+
+    pthread_mutex_lock(&pPipe->mutex);
+    pPipe->nRead = i + 1;
+    pthread_cond_broadcast(&pPipe->cond);
+    pthread_mutex_unlock(&pPipe->mutex);
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Process a batch of files in order, while a reader thread maps the next nAhead files, so reading
+  file i+1 overlaps processing file i.
+
+  The process function is called on the calling thread, once per file in order, with the file
+  mapped (see FlyFileMap()), or pMap NULL if the file couldn't be read. The map is only valid
+  during the call. Return FALSE from the function to stop early.
+
+  ```c
+  typedef bool_t (*pfnFlyFilePipeline_t)(unsigned i, const char *szPath, const flyFileMap_t *pMap, void *pData);
+  ```
+
+  If the reader thread can't be started, files are mapped and processed on the calling thread.
+
+  @param    aszPaths    array of n file paths
+  @param    n           number of files
+  @param    nAhead      max files mapped ahead, 0 for default (8)
+  @param    pfnProcess  called for each file in order
+  @param    pData       passed through to pfnProcess
+  @return   number of files processed
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyFilePipeline(const char **aszPaths, unsigned n, unsigned nAhead, pfnFlyFilePipeline_t pfnProcess, void *pData)
+{
+  filePrefetchPipe_t    pipe;
+  filePrefetchSlot_t   *pSlot;
+  pthread_t             thread;
+  flyFileMap_t          map;
+  unsigned              i;
+  unsigned              j;
+  bool_t                fThread = FALSE;
+  bool_t                fContinue = TRUE;
+
+  memset(&pipe, 0, sizeof(pipe));
+  if(nAhead == 0)
+    nAhead = FILEPREFETCH_AHEAD;
+  if(nAhead > FILEPREFETCH_MAX_AHEAD)
+    nAhead = FILEPREFETCH_MAX_AHEAD;
+  pipe.aszPaths = aszPaths;
+  pipe.n        = n;
+  pipe.nAhead   = nAhead;
+  pipe.aSlots   = FlyAllocZ(nAhead * sizeof(filePrefetchSlot_t));
+  if(pipe.aSlots && n > 1)
+  {
+    pthread_mutex_init(&pipe.mutex, NULL);
+    pthread_cond_init(&pipe.cond, NULL);
+    if(pthread_create(&thread, NULL, FilePrefetchReader, &pipe) == 0)
+      fThread = TRUE;
+    else
+    {
+      pthread_cond_destroy(&pipe.cond);
+      pthread_mutex_destroy(&pipe.mutex);
+    }
+  }
+
+  for(i = 0; fContinue && i < n; ++i)
+  {
+    // no reader thread, do it all here
+    if(!fThread)
+    {
+      if(FlyFileMap(&map, aszPaths[i], FLYFILEMAP_SEQUENTIAL))
+      {
+        fContinue = pfnProcess(i, aszPaths[i], &map, pData);
+        FlyFileUnmap(&map);
+      }
+      else
+        fContinue = pfnProcess(i, aszPaths[i], NULL, pData);
+      continue;
+    }
+
+    pthread_mutex_lock(&pipe.mutex);
+    while(pipe.nRead <= i)
+      pthread_cond_wait(&pipe.cond, &pipe.mutex);
+    pthread_mutex_unlock(&pipe.mutex);
+
+    pSlot = &pipe.aSlots[i % nAhead];
+    fContinue = pfnProcess(i, aszPaths[i], pSlot->fMapped ? &pSlot->map : NULL, pData);
+    if(pSlot->fMapped)
+      FlyFileUnmap(&pSlot->map);
+    pSlot->fMapped = FALSE;
+
+    pthread_mutex_lock(&pipe.mutex);
+    pipe.nDone = i + 1;
+    if(!fContinue)
+      pipe.fStop = TRUE;
+    pthread_cond_broadcast(&pipe.cond);
+    pthread_mutex_unlock(&pipe.mutex);
+  }
+
+  // unmap anything read ahead that wasn't processed
+  if(fThread)
+  {
+    pthread_join(thread, NULL);
+    for(j = i; j < pipe.nRead; ++j)
+    {
+      pSlot = &pipe.aSlots[j % nAhead];
+      if(pSlot->fMapped)
+        FlyFileUnmap(&pSlot->map);
+    }
+    pthread_cond_destroy(&pipe.cond);
+    pthread_mutex_destroy(&pipe.mutex);
+  }
+  FlyFreeIf(pipe.aSlots);
+
+  return i;
+}
@@ -0,0 +1,369 @@
+/**************************************************************************************************
+  FlyFileWalk.c - Fast, optionally parallel, walk of a folder tree
+  Copyright (c) 2024 Drew Gislason
+  license: <https://mit-license.org>
+*///***********************************************************************************************
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyFile.h"
+
+/*!
+  @defgroup   FlyFileWalk   Fast, optionally parallel, walk of a folder tree
+
+  FlyFileListRecurse() builds each level with glob(), which stats and sorts every entry and
+  rebuilds full paths for every subfolder. FlyFileWalk() instead streams each entry to a callback
+  as it is read from the folder:
+
+  1. Folders are opened relative to their parent (openat()), not by full path
+  2. The entry type comes from readdir() d_type (getdents64() on Linux), so there is no stat() per
+     entry, except on the few file systems that don't fill in d_type
+  3. Optionally, subfolders are handed out to a pool of threads
+  4. The callback gets the folder's fd, so it can use openat()/fstatat() on the entry
+  5. Symbolic links are reported, but never followed, so there are no loops
+
+  Entries are not sorted. Folders end in a slash, like FlyFileListNew(), and are reported before
+  their contents. With more than 1 thread, the callback is called from multiple threads at once.
+
+  @example FlyFileWalk Count .c files
+
+  ```
+  #include "FlyFile.h"
+
+  bool_t CountC(flyFileWalkEntry_t *pEntry, void *pData)
+  {
+    if(!pEntry->fIsDir && strcmp(FlyStrPathExt(pEntry->szName), ".c") == 0)
+      ++(*(unsigned *)pData);
+    return TRUE;
+  }
+
+  unsigned count = 0;
+  FlyFileWalk("src/", UINT_MAX, 0, 1, CountC, &count);
+  ```
+*/
+
+#define FILEWALK_MAX_THREADS      64
+
+typedef struct
+{
+  char                 *szPath;   // folder path from root, ends in slash
+  unsigned              depth;
+} fileWalkDir_t;
+
+typedef struct
+{
+  const char           *szRoot;
+  int                   rootFd;
+  unsigned              maxDepth;
+  flyFileWalkOpts_t     opts;
+  pfnFlyFileWalk_t      pfnVisit;
+  void                 *pData;
+  bool_t                fThreaded;
+  pthread_mutex_t       mutex;
+  pthread_cond_t        cond;
+  fileWalkDir_t        *aQueue;   // folders waiting to be walked (threaded only)
+  unsigned              nQueue;
+  unsigned              maxQueue;
+  unsigned              nBusy;    // threads walking a folder
+  bool_t                fAbort;
+  bool_t                fFailed;
+} fileWalk_t;
+
+static bool_t FileWalkDir(fileWalk_t *pWalk, int fd, const char *szPath, unsigned depth);
+
+/*-------------------------------------------------------------------------------------------------
+  Mark the walk as failed or aborted. Thread safe.
+-------------------------------------------------------------------------------------------------*/
+static void FileWalkSetFlag(fileWalk_t *pWalk, bool_t *pfFlag)
+{
+  if(pWalk->fThreaded)
+    pthread_mutex_lock(&pWalk->mutex);
+  *pfFlag = TRUE;
+  if(pWalk->fThreaded)
+    pthread_mutex_unlock(&pWalk->mutex);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Queue a folder for a worker thread. Takes ownership of szPath. Returns FALSE if out of memory.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileWalkQueue(fileWalk_t *pWalk, char *szPath, unsigned depth)
+{
+  fileWalkDir_t  *aNew;
+  unsigned        newMax;
+  bool_t          fWorked = TRUE;
+
+  pthread_mutex_lock(&pWalk->mutex);
+  if(pWalk->nQueue >= pWalk->maxQueue)
+  {
+    newMax = pWalk->maxQueue ? pWalk->maxQueue * 2 : 64;
+    aNew = FlyRealloc(pWalk->aQueue, newMax * sizeof(fileWalkDir_t));
+    if(!aNew)
+      fWorked = FALSE;
+    else
+    {
+      pWalk->aQueue   = aNew;
+      pWalk->maxQueue = newMax;
+    }
+  }
+  if(fWorked)
+  {
+    pWalk->aQueue[pWalk->nQueue].szPath = szPath;
+    pWalk->aQueue[pWalk->nQueue].depth  = depth;
+    ++pWalk->nQueue;
+    pthread_cond_signal(&pWalk->cond);
+  }
+  pthread_mutex_unlock(&pWalk->mutex);
+
+  if(!fWorked)
+    FlyFree(szPath);
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Report each entry in the open folder fd, then walk (or queue) its subfolders. Closes fd.
+  Returns FALSE if the walk was aborted.
+-------------------------------------------------------------------------------------------------*/
+static bool_t FileWalkDir(fileWalk_t *pWalk, int fd, const char *szPath, unsigned depth)
+{
+  flyFileWalkEntry_t  entry;
+  struct dirent      *pDirEnt;
+  struct stat         st;
+  DIR                *pDir;
+  char               *szEntry;
+  char               *szSub;
+  size_t              pathLen = strlen(szPath);
+  size_t              nameLen;
+  int                 subFd;
+  bool_t              fIsDir;
+  bool_t              fContinue = TRUE;
+
+  pDir = fdopendir(fd);
+  if(!pDir)
+  {
+    close(fd);
+    FileWalkSetFlag(pWalk, &pWalk->fFailed);
+    return TRUE;
+  }
+
+  // room for path + any name + slash
+  szEntry = FlyAlloc(pathLen + NAME_MAX + 2);
+  if(!szEntry)
+  {
+    closedir(pDir);
+    FileWalkSetFlag(pWalk, &pWalk->fFailed);
+    return TRUE;
+  }
+  memcpy(szEntry, szPath, pathLen);
+
+  while(fContinue && (pDirEnt = readdir(pDir)) != NULL)
+  {
+    if(pDirEnt->d_name[0] == '.')
+    {
+      if(pDirEnt->d_name[1] == '\0' || (pDirEnt->d_name[1] == '.' && pDirEnt->d_name[2] == '\0'))
+        continue;
+      if(!(pWalk->opts & FLYFILEWALK_HIDDEN))
+        continue;
+    }
+
+    // only stat if the file system doesn't tell us the type
+#ifdef DT_DIR
+    if(pDirEnt->d_type != DT_UNKNOWN)
+      fIsDir = (pDirEnt->d_type == DT_DIR) ? TRUE : FALSE;
+    else
+#endif
+      fIsDir = (fstatat(dirfd(pDir), pDirEnt->d_name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode));
+
+    nameLen = strlen(pDirEnt->d_name);
+    memcpy(&szEntry[pathLen], pDirEnt->d_name, nameLen);
+    if(fIsDir)
+      szEntry[pathLen + nameLen++] = '/';
+    szEntry[pathLen + nameLen] = '\0';
+
+    memset(&entry, 0, sizeof(entry));
+    entry.szPath  = szEntry;
+    entry.szName  = &szEntry[pathLen];
+    entry.dirFd   = dirfd(pDir);
+    entry.depth   = depth;
+    entry.fIsDir  = fIsDir;
+    if(!(*pWalk->pfnVisit)(&entry, pWalk->pData))
+    {
+      FileWalkSetFlag(pWalk, &pWalk->fAbort);
+      fContinue = FALSE;
+      break;
+    }
+
+    if(!fIsDir || entry.fSkip || depth >= pWalk->maxDepth)
+      continue;
+
+    // walk the subfolder now, or hand it to the thread pool
+    if(pWalk->fThreaded)
+    {
+      szSub = FlyStrClone(szEntry);
+      if(!szSub || !FileWalkQueue(pWalk, szSub, depth + 1))
+        FileWalkSetFlag(pWalk, &pWalk->fFailed);
+    }
+    else
+    {
+      subFd = openat(dirfd(pDir), pDirEnt->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+      if(subFd < 0)
+        pWalk->fFailed = TRUE;
+      else
+        fContinue = FileWalkDir(pWalk, subFd, szEntry, depth + 1);
+    }
+  }
+
+  FlyFree(szEntry);
+  closedir(pDir);
+
+  return fContinue;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Worker thread, walks queued folders until there are none left and no thread is busy (so no more
+  can be queued).
+-------------------------------------------------------------------------------------------------*/
+static void * FileWalkWorker(void *pArg)
+{
+  fileWalk_t     *pWalk = pArg;
+  fileWalkDir_t   dir;
+  const char     *szRel;
+  int             fd;
+
+  pthread_mutex_lock(&pWalk->mutex);
+  while(TRUE)
+  {
+    while(!pWalk->fAbort && pWalk->nQueue == 0 && pWalk->nBusy > 0)
+      pthread_cond_wait(&pWalk->cond, &pWalk->mutex);
+    if(pWalk->fAbort || pWalk->nQueue == 0)
+      break;
+
+    // newest first keeps the queue short, like a depth first walk
+    dir = pWalk->aQueue[--pWalk->nQueue];
+    ++pWalk->nBusy;
+    pthread_mutex_unlock(&pWalk->mutex);
+
+    // folders are opened relative to the root, not the current folder
+    szRel = &dir.szPath[strlen(pWalk->szRoot)];
+    fd = openat(pWalk->rootFd, *szRel ? szRel : ".", O_RDONLY | O_DIRECTORY | O_NOFOLLOW);
+    if(fd < 0)
+      FileWalkSetFlag(pWalk, &pWalk->fFailed);
+    else
+      FileWalkDir(pWalk, fd, dir.szPath, dir.depth);
+    FlyFree(dir.szPath);
+
+    pthread_mutex_lock(&pWalk->mutex);
+    --pWalk->nBusy;
+  }
+  pthread_cond_broadcast(&pWalk->cond);
+  pthread_mutex_unlock(&pWalk->mutex);
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Walk a folder tree, calling pfnVisit for each file and folder. The root folder itself is not
+  reported. See also FlyFileListRecurse().
+
+  pfnVisit returns FALSE to stop the walk, or may set pEntry->fSkip to not descend into a folder.
+  pEntry and its strings are only valid during the callback.
+
+  @param    szFolder    root folder, e.g. "src/". Entries are prefixed by this path, except for "."
+  @param    maxDepth    0 = root folder only, 1 = root and its subfolders, UINT_MAX for all
+  @param    opts        0 or FLYFILEWALK_HIDDEN to include files and folders starting with "."
+  @param    nThreads    0 or 1 = walk in this thread, otherwise walk subfolders in parallel
+  @param    pfnVisit    callback function
+  @param    pData       passed to pfnVisit
+  @return   TRUE if whole tree was walked, FALSE if aborted or any folder couldn't be read
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyFileWalk(const char *szFolder, unsigned maxDepth, flyFileWalkOpts_t opts, unsigned nThreads,
+                   pfnFlyFileWalk_t pfnVisit, void *pData)
+{
+  fileWalk_t    walk;
+  pthread_t     aThreads[FILEWALK_MAX_THREADS];
+  char         *szRoot;
+  char         *szSub;
+  size_t        size;
+  unsigned      nStarted  = 0;
+  unsigned      i;
+  int           fd;
+
+  if(!szFolder || !pfnVisit)
+    return FALSE;
+
+  // root prefix, e.g. "" for ".", or "src/" for "src"
+  size = strlen(szFolder) + 2;
+  szRoot = FlyAlloc(size);
+  if(!szRoot)
+    return FALSE;
+  if(strcmp(szFolder, ".") == 0 || strcmp(szFolder, "./") == 0)
+    *szRoot = '\0';
+  else
+  {
+    strcpy(szRoot, szFolder);
+    if(*szRoot && !isslash(FlyStrCharLast(szRoot)))
+      strcat(szRoot, "/");
+  }
+
+  memset(&walk, 0, sizeof(walk));
+  walk.szRoot     = szRoot;
+  walk.maxDepth   = maxDepth;
+  walk.opts       = opts;
+  walk.pfnVisit   = pfnVisit;
+  walk.pData      = pData;
+  walk.fThreaded  = (nThreads > 1) ? TRUE : FALSE;
+  walk.rootFd     = open(*szRoot ? szRoot : ".", O_RDONLY | O_DIRECTORY);
+  if(walk.rootFd < 0)
+  {
+    FlyFree(szRoot);
+    return FALSE;
+  }
+
+  if(!walk.fThreaded)
+  {
+    fd = dup(walk.rootFd);
+    if(fd < 0)
+      walk.fFailed = TRUE;
+    else
+      FileWalkDir(&walk, fd, szRoot, 0);
+  }
+  else
+  {
+    pthread_mutex_init(&walk.mutex, NULL);
+    pthread_cond_init(&walk.cond, NULL);
+    if(nThreads > FILEWALK_MAX_THREADS)
+      nThreads = FILEWALK_MAX_THREADS;
+
+    // the root is the first queued folder, this thread is also a worker
+    szSub = FlyStrClone(szRoot);
+    if(!szSub || !FileWalkQueue(&walk, szSub, 0))
+      walk.fFailed = TRUE;
+    else
+    {
+      for(i = 1; i < nThreads; ++i)
+      {
+        if(pthread_create(&aThreads[nStarted], NULL, FileWalkWorker, &walk) == 0)
+          ++nStarted;
+      }
+      FileWalkWorker(&walk);
+      for(i = 0; i < nStarted; ++i)
+        pthread_join(aThreads[i], NULL);
+    }
+
+    // anything left after an abort
+    for(i = 0; i < walk.nQueue; ++i)
+      FlyFree(walk.aQueue[i].szPath);
+    FlyFreeIf(walk.aQueue);
+    pthread_cond_destroy(&walk.cond);
+    pthread_mutex_destroy(&walk.mutex);
+  }
+
+  close(walk.rootFd);
+  FlyFree(szRoot);
+
+  return (walk.fAbort || walk.fFailed) ? FALSE : TRUE;
+}
@@ -114,14 +114,130 @@ typedef struct
   bool_t        afOpen[MD_EM_TYPE_SIZEOF];
 } mdEmphasis_t;
 
+// character classes, see m_aMdClass[]
+#define MD_CLASS_SPECIAL    0x0001  // may start inline markdown: * = ~ ^ & < ! [ `
+#define MD_CLASS_TICK       0x0002  // `
+#define MD_CLASS_BRACKET    0x0004  // ]
+#define MD_CLASS_LINK_END   0x0008  // ends a link: space, tab, " or )
+#define MD_CLASS_EM_STAR    0x0010  // emphasis markers, one bit each so MdEmMatch() can find its own
+#define MD_CLASS_EM_EQUAL   0x0020
+#define MD_CLASS_EM_TILDE   0x0040
+#define MD_CLASS_EM_CARET   0x0080
+#define MD_CLASS_EM         (MD_CLASS_EM_STAR | MD_CLASS_EM_EQUAL | MD_CLASS_EM_TILDE | MD_CLASS_EM_CARET)
+#define MD_CLASS_PARA_END   0x0100  // 1st char of a line that may end a paragraph
+#define MD_CLASS_STOP       0x0200  // '\0' and '\\', always examined by MdPBrk()
+#define MD_CLASS_EOL        0x0400  // '\r' and '\n'
+#define MD_CLASS_ACCEPT     0x0800  // not in m_aMdClass[], used by FlyMdNPBrk() for caller's set
+
 // prototypes
 static const char  *MdListType    (const char *szLine, mdListType_t *pType, unsigned *pCheckbox);
-static size_t       MdListMake    (char *szHtml, size_t size, const char **ppszMdList, unsigned indent, unsigned level);
+static size_t       MdListMake    (char *szHtml, size_t size, const char **ppszMdList, const char *szMdEnd,
+                                   mdListType_t type, unsigned indent, unsigned level);
 
 static const char   m_szQuote[]       = "\"";
 static const char   m_szEndBracket[]  = ">";
 static const char   m_szTripleTicks[] = "```";
 static const char   m_szSpace[]       = " ";
+static const char   m_szHtmlHorzRule[] = "<p><hr></p>\r\n";
+
+// class of every byte, so scanning for any set of chars is a single lookup per byte
+static const uint16_t m_aMdClass[256] =
+{
+  ['\0'] = MD_CLASS_STOP,
+  ['\\'] = MD_CLASS_STOP,
+  ['\r'] = MD_CLASS_EOL,
+  ['\n'] = MD_CLASS_EOL,
+  ['*']  = MD_CLASS_SPECIAL | MD_CLASS_EM_STAR  | MD_CLASS_PARA_END,
+  ['=']  = MD_CLASS_SPECIAL | MD_CLASS_EM_EQUAL,
+  ['~']  = MD_CLASS_SPECIAL | MD_CLASS_EM_TILDE,
+  ['^']  = MD_CLASS_SPECIAL | MD_CLASS_EM_CARET,
+  ['&']  = MD_CLASS_SPECIAL,
+  ['<']  = MD_CLASS_SPECIAL,
+  ['!']  = MD_CLASS_SPECIAL,
+  ['[']  = MD_CLASS_SPECIAL,
+  ['`']  = MD_CLASS_SPECIAL | MD_CLASS_TICK     | MD_CLASS_PARA_END,
+  [']']  = MD_CLASS_BRACKET,
+  [' ']  = MD_CLASS_LINK_END | MD_CLASS_PARA_END,
+  ['\t'] = MD_CLASS_LINK_END | MD_CLASS_PARA_END,
+  ['"']  = MD_CLASS_LINK_END,
+  [')']  = MD_CLASS_LINK_END,
+  ['#']  = MD_CLASS_PARA_END,
+  ['-']  = MD_CLASS_PARA_END,
+  ['_']  = MD_CLASS_PARA_END,
+};
+#define MdClass(c)  m_aMdClass[(uint8_t)(c)]
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMdNPBrk() and MdLinePBrk(). Like strpbrk(), but understands `in-line code` and
+  escaped chars.
+
+  Plain bytes (the vast majority of text) are skipped with a tight table lookup loop. Only bytes
+  that are in the accept class or that may start an escape, code span or end of line are examined
+  further.
+
+  @param  sz        string to search
+  @param  szEnd     end of search, or NULL to search to end of line
+  @param  aClass    class table, usually m_aMdClass
+  @param  accept    class(es) to break on, e.g. MD_CLASS_BRACKET
+  Returns ptr to found accept character or NULL if not found
+*///-----------------------------------------------------------------------------------------------
+static char * MdPBrk(const char *sz, const char *szEnd, const uint16_t *aClass, uint16_t accept)
+{
+  const char   *szFound     = NULL;
+  bool_t        fInLineCode = FALSE;
+  bool_t        fCodeOk     = TRUE;
+  bool_t        fLine       = szEnd ? FALSE : TRUE;
+  uint16_t      stop;
+
+  // searching for backticks, don't worry about inline code
+  if(aClass['`'] & accept)
+    fCodeOk = FALSE;
+
+  // stop on any accept char, and on chars that need special handling
+  stop = accept | MD_CLASS_STOP;
+  if(fCodeOk)
+    stop |= MD_CLASS_TICK;
+  if(fLine)
+    stop |= MD_CLASS_EOL;
+
+  while(fLine || sz < szEnd)
+  {
+    // skip plain text, '\0' is always a stop char so this always ends
+    if(fLine)
+    {
+      while(!(aClass[(uint8_t)*sz] & stop))
+        ++sz;
+      if(*sz == '\r' || *sz == '\n')
+        break;
+    }
+    else
+    {
+      while(sz < szEnd && !(aClass[(uint8_t)*sz] & stop))
+        ++sz;
+      if(sz >= szEnd)
+        break;
+    }
+    if(*sz == '\0')
+      break;
+
+    // don't find escaped characters
+    if(*sz == '\\' && (fLine || sz + 1 < szEnd) && (sz[1] > ' ' && sz[1] <= '~'))
+      sz += 2;
+    else
+    {
+      if(fCodeOk && *sz == '`')
+        fInLineCode = !fInLineCode;
+      if(!fInLineCode && (aClass[(uint8_t)*sz] & accept))
+      {
+        szFound = sz;
+        break;
+      }
+      ++sz;
+    }
+  }
+
+  return (char *)szFound;
+}
 
 /*!-------------------------------------------------------------------------------------------------
   Similar to strpbrk(), but for a substring and understands `in-line code` and escaped \] chars.
@@ -146,33 +262,17 @@ static const char   m_szSpace[]       = " ";
 *///-----------------------------------------------------------------------------------------------
 char * FlyMdNPBrk(const char *sz, const char *szEnd, const char *szAccept)
 {
-  const char *szFound     = NULL;
-  bool_t      fInLineCode = FALSE;
-  bool_t      fCodeOk     = TRUE;
+  uint16_t  aClass[256];
 
-  // searching for backticks, don't worry about inline code
-  if(strchr(szAccept, '`'))
-    fCodeOk = FALSE;
-
-  while(sz < szEnd && *sz)
+  // caller's set is arbitrary, so add it to a copy of the class table
+  memcpy(aClass, m_aMdClass, sizeof(aClass));
+  while(*szAccept)
   {
-    // don't find escaped characters
-    if(*sz == '\\' && (sz + 1 < szEnd) && (sz[1] > ' ' && sz[1] <= '~'))
-      sz += 2;
-    else
-    {
-      if(fCodeOk && *sz == '`')
-        fInLineCode = !fInLineCode;
-      if(!fInLineCode && strchr(szAccept, *sz))
-      {
-        szFound = sz;
-        break;
-      }
-      ++sz;
-    }
+    aClass[(uint8_t)*szAccept] |= MD_CLASS_ACCEPT;
+    ++szAccept;
   }
 
-  return (char *)szFound;
+  return MdPBrk(sz, szEnd, aClass, MD_CLASS_ACCEPT);
 }
 
 /*!------------------------------------------------------------------------------------------------
@@ -184,12 +284,12 @@ char * FlyMdNPBrk(const char *sz, const char *szEnd, const char *szAccept)
                      ^
 
   @param  szHaystack    ptr to UTF-8 (or Markdown) string
-  @param  szNeedles     pointer to a list of chars to stop on
+  @param  accept        class(es) of chars to stop on, e.g. MD_CLASS_BRACKET
   @return len of resulting bytes
 *///-----------------------------------------------------------------------------------------------
-static char * MdLinePBrk(const char *sz, const char *szAccept)
+static char * MdLinePBrk(const char *sz, uint16_t accept)
 {
-  return FlyMdNPBrk(sz, FlyStrLineEnd(sz), szAccept);
+  return MdPBrk(sz, NULL, m_aMdClass, accept);
 }
 
 /*-------------------------------------------------------------------------------------------------
@@ -890,8 +990,7 @@ static const mdEmTypeInfo_t m_aEmMdTypeInfo[] =
   { MD_EM_TYPE_SUB,            1, '~', "<sub>", "</sub>"},     // ~subscript~
   { MD_EM_TYPE_SUPER,          1, '^', "<sup>", "</sup>"},     // ^superscript^
 };
-static const char m_szMdEmMarkers[] = "*=~^";
-static const char m_szMdSpecial[]   = "*=~^&<![`";  // make sure to include all of m_szMdEmMarkers
+static const char m_szMdEmMarkers[] = "*=~^";  // make sure MD_CLASS_EM in m_aMdClass[] matches
 
 /*-------------------------------------------------------------------------------------------------
   Finds the mdEmTypeInfo_t for bold, italics, both, highlight, strikethrough, subscript, superscript.
@@ -1046,12 +1145,11 @@ bool_t FlyMd2HtmlIsHorzRule(const char *szMdLine)
 *///-----------------------------------------------------------------------------------------------
 size_t FlyMd2HtmlHorzRule(char *szHtml, size_t size, const char **ppszMd)
 {
-  const char szHtmlHorzRule[] = "<p><hr></p>\r\n";
   size_t  htmlLen = 0;
 
   if(FlyMd2HtmlIsHorzRule(*ppszMd))
   {
-    htmlLen = FlyStrZCpy(szHtml, szHtmlHorzRule, size);
+    htmlLen = FlyStrZCpy(szHtml, m_szHtmlHorzRule, size);
     *ppszMd = FlyStrLineNext(*ppszMd);
   }
 
@@ -1114,41 +1212,31 @@ bool_t FlyMd2HtmlIsBlockQuote(const char *szMd)
   return (level && level <= FLYMD2HTM_BLOCK_QUOTE_MAX) ? TRUE : FALSE;
 }
 
-/*!------------------------------------------------------------------------------------------------
-  Convert block quotes into appropriate HTML.
-
-  This:
-
-  ```
-    > Block quote 1
-    >> Indented block quote para 1
-    >>
-    >> Indented block quote para 2
-    > Block quote 2a.  
-    > Block quote 2b. 
-  ```
-
-  Becomes That:
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlBlockQuote() and FlyMdParseBlock(). Block quote continues while lines start
+  with '>'.
 
-  ```
-  <div class="w3-panel w3-leftbar">
-    <p>block quote 1</p>
-    <div class="w3-panel w3-leftbar">
-      <p>Indented block quote para 1</p>
-      <p>Indented block quote para 2</p>
-    <p>Block quote 2a. Block quote 2b.</p>
-    </div> 
-  </div> 
-```
+  @param  szLine    ptr to 1st line of a block quote
+  @return ptr to line after block quote
+*///-----------------------------------------------------------------------------------------------
+static const char * MdBlockQuoteEnd(const char *szLine)
+{
+  while(*szLine == '>')
+    szLine = FlyStrLineNext(szLine);
+  return szLine;
+}
 
-  ppszMd is both input and output. It's advanced to end of "consumed" markdown
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlBlockQuote() and FlyMdBlock2Html(). Converts the block quote from szMd up to
+  szMdEnd, which must be the end found by MdBlockQuoteEnd().
 
   @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
   @param  size      sizeof(szHtml)
-  @param  ppszMd    ptr markdown block quote
-  @return length of szHtml output, 0 if not block quote
+  @param  szMd      1st line of block quote
+  @param  szMdEnd   line after block quote
+  @return length of szHtml output
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlBlockQuote(char *szHtml, size_t size, const char **ppszMd)
+static size_t MdBlockQuoteMake(char *szHtml, size_t size, const char *szMd, const char *szMdEnd)
 {
   const char  szOpenBlockQuote[]  = "<div class=\"w3-panel w3-leftbar\">\r\n";
   const char  szCloseBlockQuote[] = "</div>\r\n";
@@ -1169,102 +1257,146 @@ size_t FlyMd2HtmlBlockQuote(char *szHtml, size_t size, const char **ppszMd)
   bool_t        fIndented;
 
   // 0 means normal paragraph, 1-n means block quote paragraph
-  szLine = *ppszMd;
-  if(FlyMd2HtmlIsBlockQuote(szLine))
-  {
-    if(szHtml)
-      *szHtml = '\0';
+  szLine = szMd;
+  if(szHtml)
+    *szHtml = '\0';
 
 #if MD_DEBUG_BLOCK_QUOTE
-    FlyDbgPrintf("FlyMd2HtmlBlockQuote(%.*s)\n", (int)FlyStrLineLen(szLine), szLine);
+  FlyDbgPrintf("FlyMd2HtmlBlockQuote(%.*s)\n", (int)FlyStrLineLen(szLine), szLine);
 #endif
 
-    while(TRUE)
-    {
-      // get block quote level for this line
-      level = FlyStrChrCount(szLine, '>');
+  while(TRUE)
+  {
+    // get block quote level for this line, 0 at end of block
+    level = (szLine < szMdEnd) ? FlyStrChrCount(szLine, '>') : 0;
 
-      // increasing level by 1 or more
-      while(lastLevel < level)
+    // increasing level by 1 or more
+    while(lastLevel < level)
+    {
+      if(lastLevel)
       {
-        if(lastLevel)
-        {
-          FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * lastLevel);
-          htmlLen += FlyStrZCat(szHtml, szIndent, size);
-        }
-        htmlLen += FlyStrZCat(szHtml, szOpenBlockQuote, size);
-        ++lastLevel;
+        FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * lastLevel);
+        htmlLen += FlyStrZCat(szHtml, szIndent, size);
       }
+      htmlLen += FlyStrZCat(szHtml, szOpenBlockQuote, size);
+      ++lastLevel;
+    }
 
-      // reducing level by 1 or more
-      while(lastLevel > level)
+    // reducing level by 1 or more
+    while(lastLevel > level)
+    {
+      --lastLevel;
+      if(lastLevel)
       {
-        --lastLevel;
-        if(lastLevel)
-        {
-          FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * lastLevel);
-          htmlLen += FlyStrZCat(szHtml, szIndent, size);
-        }
-        htmlLen += FlyStrZCat(szHtml, szCloseBlockQuote, size);
+        FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * lastLevel);
+        htmlLen += FlyStrZCat(szHtml, szIndent, size);
       }
+      htmlLen += FlyStrZCat(szHtml, szCloseBlockQuote, size);
+    }
 
-      // at this point, lastLevel == level
-
-      // no longer in block quotes
-      if(level == 0)
-        break;
+    // at this point, lastLevel == level
 
-      // find text (if any)
-      pszMd = szLine = FlyStrSkipWhite(&szLine[level]);
-      FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * level);
+    // no longer in block quotes
+    if(level == 0)
+      break;
 
-      fIndented = FALSE;
-      if(!fInPara)
-      {
-        htmlLen += FlyStrZCat(szHtml, szIndent, size);
-        if(FlyMd2HtmlIsRef(szLine) == MD_REF_TYPE_FOOTNOTE)
-        {
-          szHtml = MdAdjust(szHtml, &size);
-          htmlLen += FlyMd2HtmlRef(szHtml, size, &pszMd);
-        }
-        else
-          htmlLen += FlyStrZCat(szHtml, szOpenPara, size);
-        fInPara = TRUE;
-        fIndented = TRUE;
-      }
+    // find text (if any)
+    pszMd = szLine = FlyStrSkipWhite(&szLine[level]);
+    FlyStrZFill(szIndent, ' ', sizeof(szIndent), 2 * level);
 
-      szLineEnd = FlyStrLineEnd(szLine);
-      if(szLineEnd > szLine)
+    fIndented = FALSE;
+    if(!fInPara)
+    {
+      htmlLen += FlyStrZCat(szHtml, szIndent, size);
+      if(FlyMd2HtmlIsRef(szLine) == MD_REF_TYPE_FOOTNOTE)
       {
-        if(!fIndented)
-          htmlLen += FlyStrZCat(szHtml, szIndent, size);
         szHtml = MdAdjust(szHtml, &size);
-        htmlLen += FlyMd2HtmlTextLine(szHtml, size, &pszMd, szLineEnd);
-
-        if(FlyMd2HtmlIsBreak(szLine))
-          htmlLen += FlyStrZCat(szHtml, "<br>", size);
+        htmlLen += FlyMd2HtmlRef(szHtml, size, &pszMd);
       }
+      else
+        htmlLen += FlyStrZCat(szHtml, szOpenPara, size);
+      fInPara = TRUE;
+      fIndented = TRUE;
+    }
 
-      // end the paragraph if:
-      // 1. this line is blank
-      // 2. next line is at different level
-      szLineNext = FlyStrLineNext(szLine);
-      nextLevel = FlyStrChrCount(szLineNext, '>');
-      if(FlyStrLineIsBlank(szLine) || nextLevel != level)
-      {
-        htmlLen += FlyStrZCat(szHtml, szClosePara, size);
-        fInPara = FALSE;
-      }
+    szLineEnd = FlyStrLineEnd(szLine);
+    if(szLineEnd > szLine)
+    {
+      if(!fIndented)
+        htmlLen += FlyStrZCat(szHtml, szIndent, size);
+      szHtml = MdAdjust(szHtml, &size);
+      htmlLen += FlyMd2HtmlTextLine(szHtml, size, &pszMd, szLineEnd);
+
+      if(FlyMd2HtmlIsBreak(szLine))
+        htmlLen += FlyStrZCat(szHtml, "<br>", size);
+    }
 
-      // end the line whether still in a paragraph or not
-      if(!(nextLevel && FlyStrLineIsBlank(&szLineNext[nextLevel])))
-        htmlLen += FlyStrZCat(szHtml, szEndLine, size);
-      szLine = szLineNext;
+    // end the paragraph if:
+    // 1. this line is blank
+    // 2. next line is at different level
+    szLineNext = FlyStrLineNext(szLine);
+    nextLevel = (szLineNext < szMdEnd) ? FlyStrChrCount(szLineNext, '>') : 0;
+    if(FlyStrLineIsBlank(szLine) || nextLevel != level)
+    {
+      htmlLen += FlyStrZCat(szHtml, szClosePara, size);
+      fInPara = FALSE;
     }
+
+    // end the line whether still in a paragraph or not
+    if(!(nextLevel && FlyStrLineIsBlank(&szLineNext[nextLevel])))
+      htmlLen += FlyStrZCat(szHtml, szEndLine, size);
+    szLine = szLineNext;
+  }
+
+  return htmlLen;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Convert block quotes into appropriate HTML.
+
+  This:
+
+  ```
+    > Block quote 1
+    >> Indented block quote para 1
+    >>
+    >> Indented block quote para 2
+    > Block quote 2a.  
+    > Block quote 2b. 
+  ```
+
+  Becomes That:
+
+  ```
+  <div class="w3-panel w3-leftbar">
+    <p>block quote 1</p>
+    <div class="w3-panel w3-leftbar">
+      <p>Indented block quote para 1</p>
+      <p>Indented block quote para 2</p>
+    <p>Block quote 2a. Block quote 2b.</p>
+    </div> 
+  </div> 
+```
+
+  ppszMd is both input and output. It's advanced to end of "consumed" markdown
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  ppszMd    ptr markdown block quote
+  @return length of szHtml output, 0 if not block quote
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlBlockQuote(char *szHtml, size_t size, const char **ppszMd)
+{
+  const char   *szMdEnd;
+  size_t        htmlLen = 0;
+
+  if(FlyMd2HtmlIsBlockQuote(*ppszMd))
+  {
+    szMdEnd = MdBlockQuoteEnd(*ppszMd);
+    htmlLen = MdBlockQuoteMake(szHtml, size, *ppszMd, szMdEnd);
+    *ppszMd = szMdEnd;
   }
 
-  if(htmlLen)
-    *ppszMd = szLine;
   return htmlLen;
 }
 
@@ -1290,7 +1422,7 @@ size_t FlyMd2HtmlCodeIn(char *szHtml, size_t size, const char **ppszMd)
   if(*szMd == '`')
   {
     // end of code will be next backtick or end of line
-    psz = MdLinePBrk(szMd + 1, "`");
+    psz = MdLinePBrk(szMd + 1, MD_CLASS_TICK);
     if(!psz)
       psz = FlyStrLineEnd(szMd);
     mdLen += (unsigned)(psz - (szMd + 1));
@@ -1299,8 +1431,10 @@ size_t FlyMd2HtmlCodeIn(char *szHtml, size_t size, const char **ppszMd)
     if(mdLen)
     {
       htmlLen += FlyStrZCpy(szHtml, szCodeOpen, size);
-      htmlLen += FlyStrZNCat(szHtml, szMd + 1, size, mdLen);
-      htmlLen += FlyStrZCat(szHtml, szCodeClose, size);
+      szHtml   = MdAdjust(szHtml, &size);
+      htmlLen += FlyStrHtmlEscape(szHtml, szMd + 1, size, mdLen, FLYSTR_HTML_LT);
+      szHtml   = MdAdjust(szHtml, &size);
+      htmlLen += FlyStrZCpy(szHtml, szCodeClose, size);
       ++mdLen;
       if(*psz == '`')
         ++mdLen;
@@ -1337,41 +1471,31 @@ static size_t MsCodeLineSegment(char *szHtml, size_t size, const char **ppszMd,
   if(szHtml)
     *szHtml = '\0';
 
-  psz = szLine;
-  if(!FlyStrLineIsBlank(psz))
+  if(!FlyStrLineIsBlank(szLine))
   {
-    pszText = psz;
-    while(*psz && psz < pszLineEnd)
+    pszText = szLine;
+    while(pszText < pszLineEnd)
     {
-      if(*psz == ' ' || *psz == '<')
+      // escape everything up to the next space in one go
+      psz = memchr(pszText, ' ', (size_t)(pszLineEnd - pszText));
+      if(!psz)
+        psz = pszLineEnd;
+      htmlLen += FlyStrHtmlEscape(szHtml, pszText, size, (size_t)(psz - pszText), FLYSTR_HTML_LT);
+      szHtml = MdAdjust(szHtml, &size);
+      if(psz < pszLineEnd)
       {
-        htmlLen += FlyStrZNCat(szHtml, pszText, size, (psz - pszText));
-        if(*psz == ' ')
-        {
-          // if line starts with space, use non-breaking space so HTML doesn't ignore it
-          // if many spaces, intermix with non-breaking space
-          nSpaces = FlyStrChrCount(psz, ' ');
-          if(psz == szLine && nSpaces == 1)
-            htmlLen += FlyStrZCat(szHtml, "&nbsp;", size);
-          else
-            htmlLen += MdCatSpaces(szHtml, nSpaces, size);
-          psz += nSpaces;
-        }
+        // if line starts with space, use non-breaking space so HTML doesn't ignore it
+        // if many spaces, intermix with non-breaking space
+        nSpaces = FlyStrChrCount(psz, ' ');
+        if(psz == szLine && nSpaces == 1)
+          htmlLen += FlyStrZCat(szHtml, "&nbsp;", size);
         else
-        {
-          htmlLen += FlyStrZCat(szHtml, "&lt;", size);
-          ++psz;
-        }
-        pszText = psz;
-      }
-      else
-      {
-        ++psz;
-        continue;
+          htmlLen += MdCatSpaces(szHtml, nSpaces, size);
+        szHtml = MdAdjust(szHtml, &size);
+        psz += nSpaces;
       }
+      pszText = psz;
     }
-
-    htmlLen += FlyStrZNCat(szHtml, pszText, size, (psz - pszText));
   }
 
   htmlLen += FlyStrZCat(szHtml, szBreakEnd, size);
@@ -1406,25 +1530,80 @@ size_t FlyMd2HtmlCodeLine(char *szHtml, size_t size, const char **ppszMd)
   return htmlLen;
 }
 
-/*!------------------------------------------------------------------------------------------------
-  Create a visual HTML code block from a markdown code block. A code block starts with triple
-  backticks or is indented 4 spaces or a tab.
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlCodeBlk() and FlyMdParseBlock(). Find the contents and end of a code block.
+
+  @param  szLine          ptr to 1st line of a code block
+  @param  fIsBackTicks    TRUE if code block started with triple ticks, FALSE if indented
+  @param  ppszBlockStart  return value, start of code block contents
+  @param  ppszBlockEnd    return value, end of code block contents
+  @param  pfOneLine       return value, TRUE if ```all on one line```
+  @return ptr to line after code block
+*///-----------------------------------------------------------------------------------------------
+static const char * MdCodeBlkExtents(const char *szLine, bool_t fIsBackTicks, const char **ppszBlockStart,
+                                     const char **ppszBlockEnd, bool_t *pfOneLine)
+{
+  const char *pszBlockStart = szLine;
+  const char *pszBlockEnd;
+  const char *pszMdEnd;
+  const char *szLinePrev;
+  bool_t      fOneLine      = FALSE;
 
-  ppszMd is both input and output. It's advanced to end of "consumed" markdown
+  // code block started with triple ticks, must end with the same, or end of file
+  if(fIsBackTicks)
+  {
+    pszBlockStart = FlyStrSkipChars(szLine, " \t`");
+    pszBlockEnd = strstr(pszBlockStart, m_szTripleTicks);
+    if(pszBlockEnd == NULL)
+      pszBlockEnd = FlyStrLineEof(pszBlockStart);
+    if(pszBlockEnd < FlyStrLineEnd(pszBlockStart))
+    {
+      fOneLine = TRUE;
+    }
+    else
+    {
+      pszBlockStart = FlyStrLineNext(pszBlockStart);
+      pszBlockEnd = FlyStrLineBeg(pszBlockStart, pszBlockEnd);
+    }
 
-  Note: uses W3.CSS class "w3-panel w3-card" if szTitle,
+    // always ends on the next line after tripple ticks
+    pszMdEnd = FlyStrLineNext(pszBlockEnd);
+  }
 
-  Uses 1st line of code block to determine indent to remove. In this way, the code block is always
-  flush left. It's up to any higher layer to add back in some indent if needed.
+  // indented code block ends on non-blank, non-indented line
+  else
+  {
+    pszMdEnd = szLine;
+    while(*pszMdEnd && (FlyStrLineIsBlank(pszMdEnd) || FlyStrLineIndent(pszMdEnd, FLY_STR_TAB_SIZE) >= 4))
+      pszMdEnd = FlyStrLineNext(pszMdEnd);
+    pszBlockEnd = pszMdEnd;
+    szLinePrev = FlyStrLinePrev(szLine, pszMdEnd);
+    if(FlyStrLineIsBlank(szLinePrev))
+      pszBlockEnd = szLinePrev;
+  }
 
-  @param  szHtml      ptr to char array or NULL to just get length of resulting HTML
-  @param  size        sizeof(szHtml)
-  @param  ppszMd      ptr line of markdown
-  @param  szTitle     optional title "Some Title", NULL for no h5 title
-  @param  szW3Color   optional color class, default w3-light-grey if NULL
-  @return length HTML, or 0 if not a code block
+  *ppszBlockStart = pszBlockStart;
+  *ppszBlockEnd   = pszBlockEnd;
+  *pfOneLine      = fOneLine;
+  return pszMdEnd;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlCodeBlk() and FlyMdBlock2Html(). Converts a code block whose contents were
+  found by MdCodeBlkExtents(). See FlyMd2HtmlCodeBlk().
+
+  @param  szHtml          ptr to char array or NULL to just get length of resulting HTML
+  @param  size            sizeof(szHtml)
+  @param  szMd            1st line of code block, used for indent
+  @param  pszBlockStart   start of code block contents
+  @param  pszBlockEnd     end of code block contents
+  @param  fOneLine        TRUE if ```all on one line```
+  @param  szTitle         optional title "Some Title", NULL for no h5 title
+  @param  szW3Color       optional color class, default w3-light-grey if NULL
+  @return length HTML
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlCodeBlk(char *szHtml, size_t size, const char **ppszMd, const char *szTitle, const char *szW3Color)
+static size_t MdCodeBlkMake(char *szHtml, size_t size, const char *szMd, const char *pszBlockStart,
+                            const char *pszBlockEnd, bool_t fOneLine, const char *szTitle, const char *szW3Color)
 {
   const char  szDivOpen1[]      = "<div class=\"w3-code ";
   const char  szDivOpen2[]      = " notranslate\">\r\n";
@@ -1438,132 +1617,122 @@ size_t FlyMd2HtmlCodeBlk(char *szHtml, size_t size, const char **ppszMd, const c
   const char  szDivEndTitle[]   = "  </div>\r\n";
   const char  szDivEnd[]        = "</div>\r\n";
 
-  bool_t      fIsBackTicks;
   unsigned    indent;
   const char *szLine;
-  const char *szLinePrev;
   const char *pszThisLine;
-  const char *pszBlockStart;
-  const char *pszBlockEnd;
-  const char *pszMdEnd        = *ppszMd;
   unsigned    htmlLen         = 0;
-  bool_t      fOneLine        = FALSE;
 
   if(szW3Color == NULL)
     szW3Color = "w3-light-grey";
 
-  szLine = *ppszMd;
-  if(FlyMd2HtmlIsCodeBlk(szLine, &fIsBackTicks))
+  indent = FlyStrLineIndent(szMd, 1);
+  // FlyDbgPrintf("CodeBlk indent %u\n", indent);
+
+  // debugging
+#if MD_DEBUG_CODE
+  if(fFlyMarkdownDebug && g_szMd)
+  {
+    unsigned row, col;
+    row = FlyStrLinePos(g_szMd, pszBlockStart, &col);
+    FlyDbgPrintf("BlockStart %u:%u\n", row, col);
+    row = FlyStrLinePos(g_szMd, pszBlockEnd, &col);
+    FlyDbgPrintf("BlockEnd   %u:%u\n", row, col);
+  }
+#endif
+
+  // copy front matter
+  if(szTitle)
   {
-    indent = FlyStrLineIndent(szLine, 1);
-    // FlyDbgPrintf("CodeBlk indent %u\n", indent);
+    // <div id="my-title" class="w3-panel w3-card w3-light-grey"> 
+    //   <h5 id="Example-FLyJsonPut">Example: FlyJsonPut</h5>
+    //   <div class="w3-code notranslate">
+    htmlLen += FlyStrZCpy(szHtml, szDivOpenTitle1, size);
+    htmlLen += FlyStrZCat(szHtml, szW3Color, size);
+    htmlLen += FlyStrZCat(szHtml, szDivOpenTitle2, size);
+
+    htmlLen += FlyStrZCat(szHtml, szDivTitle1, size);
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyStrSlug(szHtml, szTitle, size, strlen(szTitle));
+    htmlLen += FlyStrZCat(szHtml, szDivTitle2, size);
+    htmlLen += FlyStrZCat(szHtml, szTitle, size);
+    htmlLen += FlyStrZCat(szHtml, szDivTitle3, size);
+  }
+  else
+  {
+    // <div class=\"w3-code w3-light-grey notranslate\">
+    htmlLen += FlyStrZCpy(szHtml, szDivOpen1, size);
+    htmlLen += FlyStrZCat(szHtml, szW3Color, size);
+    htmlLen += FlyStrZCat(szHtml, szDivOpen2, size);
+  }
 
-    // find start of code block contents
-    pszBlockStart = szLine;
+  if(fOneLine)
+  {
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += MsCodeLineSegment(szHtml, size, &pszBlockStart, pszBlockEnd);
+  }
 
-    // code block started with triple ticks, must end with the same, or end of file
-    if(fIsBackTicks)
+  else
+  {
+    // copy code lines
+    szLine = pszBlockStart;
+    while(*szLine && szLine < pszBlockEnd)
     {
-      pszBlockStart = FlyStrSkipChars(szLine, " \t`");
-      pszBlockEnd = strstr(pszBlockStart, m_szTripleTicks);
-      if(pszBlockEnd == NULL)
-        pszBlockEnd = FlyStrLineEof(pszBlockStart);
-      if(pszBlockEnd < FlyStrLineEnd(pszBlockStart))
-      {
-        fOneLine = TRUE;
-      }
+      if(FlyStrLineLen(szLine) < indent || FlyStrLineIsBlank(szLine))
+        pszThisLine = "\n";
       else
-      {
-        pszBlockStart = FlyStrLineNext(pszBlockStart);
-        pszBlockEnd = FlyStrLineBeg(pszBlockStart, pszBlockEnd);
-      }
-
-      // always ends on the next line after tripple ticks
-      pszMdEnd = FlyStrLineNext(pszBlockEnd);
-    }
+        pszThisLine = &szLine[indent];
 
-    // indented code block ends on non-blank, non-indented line
-    else
-    {
-      while(*szLine && (FlyStrLineIsBlank(szLine) || FlyStrLineIndent(szLine, FLY_STR_TAB_SIZE) >= 4))
-        szLine = FlyStrLineNext(szLine);
-      pszMdEnd = pszBlockEnd = szLine;
-      szLinePrev = FlyStrLinePrev(*ppszMd, szLine);
-      if(FlyStrLineIsBlank(szLinePrev))
-        pszBlockEnd = szLinePrev;
+      htmlLen += FlyStrZCat(szHtml, szIndent, size);
+      if(szTitle)
+        htmlLen += FlyStrZCat(szHtml, szIndent, size);
+      szHtml = MdAdjust(szHtml, &size);
+      htmlLen += FlyMd2HtmlCodeLine(szHtml, size, &pszThisLine);
+      szLine = FlyStrLineNext(szLine);
     }
+  }
 
-    // debugging
-#if MD_DEBUG_CODE
-    if(fFlyMarkdownDebug && g_szMd)
-    {
-      unsigned row, col;
-      row = FlyStrLinePos(g_szMd, pszBlockStart, &col);
-      FlyDbgPrintf("BlockStart %u:%u\n", row, col);
-      row = FlyStrLinePos(g_szMd, pszBlockEnd, &col);
-      FlyDbgPrintf("BlockEnd   %u:%u\n", row, col);
-    }
-#endif
+  // final matter
+  if(szTitle)
+    htmlLen += FlyStrZCat(szHtml, szDivEndTitle, size);
+  htmlLen += FlyStrZCat(szHtml, szDivEnd, size);
 
-    // copy front matter
-    if(szTitle)
-    {
-      // <div id="my-title" class="w3-panel w3-card w3-light-grey"> 
-      //   <h5 id="Example-FLyJsonPut">Example: FlyJsonPut</h5>
-      //   <div class="w3-code notranslate">
-      htmlLen += FlyStrZCpy(szHtml, szDivOpenTitle1, size);
-      htmlLen += FlyStrZCat(szHtml, szW3Color, size);
-      htmlLen += FlyStrZCat(szHtml, szDivOpenTitle2, size);
-
-      htmlLen += FlyStrZCat(szHtml, szDivTitle1, size);
-      szHtml = MdAdjust(szHtml, &size);
-      htmlLen += FlyStrSlug(szHtml, szTitle, size, strlen(szTitle));
-      htmlLen += FlyStrZCat(szHtml, szDivTitle2, size);
-      htmlLen += FlyStrZCat(szHtml, szTitle, size);
-      htmlLen += FlyStrZCat(szHtml, szDivTitle3, size);
-    }
-    else
-    {
-      // <div class=\"w3-code w3-light-grey notranslate\">
-      htmlLen += FlyStrZCpy(szHtml, szDivOpen1, size);
-      htmlLen += FlyStrZCat(szHtml, szW3Color, size);
-      htmlLen += FlyStrZCat(szHtml, szDivOpen2, size);
-    }
+  return htmlLen;
+}
 
-    if(fOneLine)
-    {
-      szHtml = MdAdjust(szHtml, &size);
-      htmlLen += MsCodeLineSegment(szHtml, size, &pszBlockStart, pszBlockEnd);
-    }
+/*!------------------------------------------------------------------------------------------------
+  Create a visual HTML code block from a markdown code block. A code block starts with triple
+  backticks or is indented 4 spaces or a tab.
 
-    else
-    {
-      // copy code lines
-      szLine = pszBlockStart;
-      while(*szLine && szLine < pszBlockEnd)
-      {
-        if(FlyStrLineLen(szLine) < indent || FlyStrLineIsBlank(szLine))
-          pszThisLine = "\n";
-        else
-          pszThisLine = &szLine[indent];
+  ppszMd is both input and output. It's advanced to end of "consumed" markdown
 
-        htmlLen += FlyStrZCat(szHtml, szIndent, size);
-        if(szTitle)
-          htmlLen += FlyStrZCat(szHtml, szIndent, size);
-        szHtml = MdAdjust(szHtml, &size);
-        htmlLen += FlyMd2HtmlCodeLine(szHtml, size, &pszThisLine);
-        szLine = FlyStrLineNext(szLine);
-      }
-    }
+  Note: uses W3.CSS class "w3-panel w3-card" if szTitle,
+
+  Uses 1st line of code block to determine indent to remove. In this way, the code block is always
+  flush left. It's up to any higher layer to add back in some indent if needed.
+
+  @param  szHtml      ptr to char array or NULL to just get length of resulting HTML
+  @param  size        sizeof(szHtml)
+  @param  ppszMd      ptr line of markdown
+  @param  szTitle     optional title "Some Title", NULL for no h5 title
+  @param  szW3Color   optional color class, default w3-light-grey if NULL
+  @return length HTML, or 0 if not a code block
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlCodeBlk(char *szHtml, size_t size, const char **ppszMd, const char *szTitle, const char *szW3Color)
+{
+  const char *pszBlockStart;
+  const char *pszBlockEnd;
+  const char *pszMdEnd;
+  size_t      htmlLen   = 0;
+  bool_t      fIsBackTicks;
+  bool_t      fOneLine;
 
-    // final matter
-    if(szTitle)
-      htmlLen += FlyStrZCat(szHtml, szDivEndTitle, size);
-    htmlLen += FlyStrZCat(szHtml, szDivEnd, size);
+  if(FlyMd2HtmlIsCodeBlk(*ppszMd, &fIsBackTicks))
+  {
+    pszMdEnd = MdCodeBlkExtents(*ppszMd, fIsBackTicks, &pszBlockStart, &pszBlockEnd, &fOneLine);
+    htmlLen  = MdCodeBlkMake(szHtml, size, *ppszMd, pszBlockStart, pszBlockEnd, fOneLine, szTitle, szW3Color);
+    *ppszMd  = pszMdEnd;
   }
 
-  if(htmlLen)
-    *ppszMd = pszMdEnd;
   return htmlLen;
 }
 
@@ -1620,7 +1789,7 @@ char * FlyMdAltLink(flyMdAltLink_t *pAltLink, const char *szMarkdown)
   if(fOk)
   {
     ++pszMd;
-    pszEnd = MdLinePBrk(pszMd, "]");
+    pszEnd = MdLinePBrk(pszMd, MD_CLASS_BRACKET);
     if(!pszEnd)
       fOk = FALSE;
     else
@@ -1676,7 +1845,7 @@ char * FlyMdAltLink(flyMdAltLink_t *pAltLink, const char *szMarkdown)
 
       if(fOk)
       {
-        pszEnd = MdLinePBrk(pszMd, " \t\")");
+        pszEnd = MdLinePBrk(pszMd, MD_CLASS_LINK_END);
 
         // must have space (before title) or end of reference
         if(!pszEnd || (!isblank(*pszEnd) && *pszEnd != ')'))
@@ -1751,6 +1920,77 @@ char * FlyMdAltLink(flyMdAltLink_t *pAltLink, const char *szMarkdown)
   return (char *)pszRefEnd;
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlImage() and FlyMd2HtmlTextLine(). Converts an already parsed image reference
+  into HTML.
+
+  @param  szHtml    ptr to char array or NULL to just get length of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  pAltLink  a parsed MD_REF_TYPE_IMAGE
+  @return len of resulting "<img ...>"
+*///-----------------------------------------------------------------------------------------------
+static size_t MdImage(char *szHtml, size_t size, const flyMdAltLink_t *pAltLink)
+{
+  // HTML
+  static const char   szImgOpen[]     = "<img src=\"";
+  static const char   szAltOpen[]     = " alt=\"";
+  static const char   szStyle150px[]  = "\" style=\"width:150px\"";
+  static const char   szClassOpen[]   = " class=\"";
+  static const char   szTitleOpen[]   = " title=\"";
+
+  size_t              htmlLen         = 0;
+
+  // string must always end in '\0'
+  if(szHtml)
+    *szHtml = '\0';
+
+  // src=
+  htmlLen += FlyStrZCpy(szHtml, szImgOpen, size);
+  htmlLen += FlyStrZNCat(szHtml, pAltLink->szLink, size, pAltLink->linkLen);
+  htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
+
+  // alt=
+  htmlLen += FlyStrZCat(szHtml, szAltOpen, size);
+  htmlLen += FlyStrZNCat(szHtml, pAltLink->szAlt, size, pAltLink->altLen);
+  htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
+
+  // 1. If no title, then no class or style
+  // e.g. <img src=image.png alt="alt">
+  if(pAltLink->szTitle)
+  {
+    // 2. If title begins with "w3_", then class= the string and style="width:150px"
+    // e.g. <img src=image.png alt="alt" class="w3-circle">
+    if(strncmp(pAltLink->szTitle, "w3-", 3) == 0)
+    {
+      htmlLen += FlyStrZCat(szHtml, szClassOpen, size);
+      htmlLen += FlyStrZNCat(szHtml, pAltLink->szTitle , size, pAltLink->titleLen);
+      htmlLen += FlyStrZCat(szHtml, szStyle150px, size);
+    }
+
+    // 3. If title is anything else, is copied as-is to be used for class and style
+    // e.g. <img src=image.png alt="alt" class="w3-circle" style="width:80%">
+    else if(FlyStrNStr(pAltLink->szTitle, "class", pAltLink->titleLen) || 
+            FlyStrNStr(pAltLink->szTitle, "style", pAltLink->titleLen))
+    {
+      htmlLen += FlyStrZCat(szHtml, m_szSpace, size);
+      htmlLen += MdNCat(szHtml, pAltLink->szTitle, size, pAltLink->titleLen);
+    }
+
+    // 4. Otherwise title only, no special attributes
+    // e.g. <img src=image.png alt="alt" title="some title">
+    else
+    {
+      htmlLen += FlyStrZCat(szHtml, szTitleOpen, size);
+      htmlLen += FlyStrZNCat(szHtml, pAltLink->szTitle , size, pAltLink->titleLen);
+      htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
+    }
+  }
+
+  htmlLen += FlyStrZCat(szHtml, m_szEndBracket, size);
+
+  return htmlLen;
+}
+
 /*!------------------------------------------------------------------------------------------------
   Converts from markdown img link ![alt](link "title") to HTML
 
@@ -1787,13 +2027,6 @@ char * FlyMdAltLink(flyMdAltLink_t *pAltLink, const char *szMarkdown)
 *///-----------------------------------------------------------------------------------------------
 size_t FlyMd2HtmlImage(char *szHtml, size_t size, const char **ppszMd)
 {
-  // HTML
-  static const char   szImgOpen[]     = "<img src=\"";
-  static const char   szAltOpen[]     = " alt=\"";
-  static const char   szStyle150px[]  = "\" style=\"width:150px\"";
-  static const char   szClassOpen[]   = " class=\"";
-  static const char   szTitleOpen[]   = " title=\"";
-
   flyMdAltLink_t      altLink;
   const char         *szRefEnd;
   size_t              htmlLen         = 0;
@@ -1805,50 +2038,91 @@ size_t FlyMd2HtmlImage(char *szHtml, size_t size, const char **ppszMd)
   szRefEnd = FlyMdAltLink(&altLink, *ppszMd);
   if(szRefEnd && altLink.refType == MD_REF_TYPE_IMAGE)
   {
-    // src=
-    htmlLen += FlyStrZCpy(szHtml, szImgOpen, size);
-    htmlLen += FlyStrZNCat(szHtml, altLink.szLink, size, altLink.linkLen);
-    htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
+    htmlLen = MdImage(szHtml, size, &altLink);
+    *ppszMd = szRefEnd;
+  }
 
-    // alt=
-    htmlLen += FlyStrZCat(szHtml, szAltOpen, size);
-    htmlLen += FlyStrZNCat(szHtml, altLink.szAlt, size, altLink.altLen);
-    htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
+  return htmlLen;
+}
 
-    // 1. If no title, then no class or style
-    // e.g. <img src=image.png alt="alt">
-    if(altLink.szTitle)
-    {
-      // 2. If title begins with "w3_", then class= the string and style="width:150px"
-      // e.g. <img src=image.png alt="alt" class="w3-circle">
-      if(strncmp(altLink.szTitle, "w3-", 3) == 0)
-      {
-        htmlLen += FlyStrZCat(szHtml, szClassOpen, size);
-        htmlLen += FlyStrZNCat(szHtml, altLink.szTitle , size, altLink.titleLen);
-        htmlLen += FlyStrZCat(szHtml, szStyle150px, size);
-      }
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlRef() and FlyMd2HtmlTextLine(). Converts an already parsed reference into
+  HTML.
 
-      // 3. If title is anything else, is copied as-is to be used for class and style
-      // e.g. <img src=image.png alt="alt" class="w3-circle" style="width:80%">
-      else if(FlyStrNStr(altLink.szTitle, "class", altLink.titleLen) || 
-              FlyStrNStr(altLink.szTitle, "style", altLink.titleLen))
-      {
-        htmlLen += FlyStrZCat(szHtml, m_szSpace, size);
-        htmlLen += MdNCat(szHtml, altLink.szTitle, size, altLink.titleLen);
-      }
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  pAltLink  a parsed reference, e.g. MD_REF_TYPE_REF
+  @return len of resulting HTML
+*///-----------------------------------------------------------------------------------------------
+static size_t MdRef(char *szHtml, size_t size, const flyMdAltLink_t *pAltLink)
+{
+  static const char   szRefOpen[]       = "<a href=\"";
+  static const char   szRefMiddle[]     = "\">";
+  static const char   szRefClose[]      = "</a>";
 
-      // 4. Otherwise title only, no special attributes
-      // e.g. <img src=image.png alt="alt" title="some title">
-      else
-      {
-        htmlLen += FlyStrZCat(szHtml, szTitleOpen, size);
-        htmlLen += FlyStrZNCat(szHtml, altLink.szTitle , size, altLink.titleLen);
-        htmlLen += FlyStrZCat(szHtml, m_szQuote, size);
-      }
+  static const char   szRefFootMiddle[] = "\">[";   // szRefFootOpen[] is same as szRefOpen[]
+  static const char   szRefFootClose[]  = "]</a>";
+
+  static const char   szFootnoteOpen[]  = "<p id=\"";
+  static const char   szFootnoteClose[] = "\">";
+
+  size_t              htmlLen     = 0;
+#if MD_DEBUG_REF
+  char               *szHtmlOrg   = szHtml;
+#endif
+
+  // handle image separatelty
+  if(pAltLink->refType == MD_REF_TYPE_IMAGE)
+    htmlLen = MdImage(szHtml, size, pAltLink);
+
+  // [ref text](site.com/page)  =>
+  // <a href="site.com/page">ref text</a>
+  else if(pAltLink->refType == MD_REF_TYPE_REF)
+  {
+    FlyAssert(pAltLink->szLink && pAltLink->linkLen);
+    htmlLen += FlyStrZCpy(szHtml, szRefOpen, size);
+    htmlLen += FlyStrZNCat(szHtml, pAltLink->szLink, size, pAltLink->linkLen);
+    htmlLen += FlyStrZCat(szHtml, szRefMiddle, size);
+    htmlLen += FlyStrZNCat(szHtml, pAltLink->szAlt, size, pAltLink->altLen);
+    htmlLen += FlyStrZCat(szHtml, szRefClose, size);
+  }
+
+  // [^footnote]  =>
+  // <a href="#footnote"><[^footnote]</a>
+  else if(pAltLink->refType == MD_REF_TYPE_FOOT_REF)
+  {
+    FlyAssert(pAltLink->szAlt && pAltLink->altLen > 1);
+    htmlLen += FlyStrZCpy(szHtml, szRefOpen, size);
+    htmlLen += FlyStrZCat(szHtml, "#", size);
+    szHtml = MdAdjust(szHtml, &size);
+#if MD_DEBUG_REF
+    if(szHtmlOrg)
+      FlyDbgPrintf("Footnote b4 slug: %s", szHtmlOrg);
+#endif
+    htmlLen += FlyStrSlug(szHtml, pAltLink->szAlt, size, pAltLink->altLen);
+#if MD_DEBUG_REF
+    if(szHtmlOrg)
+      FlyDbgPrintf("Footnote af slug: %s", szHtmlOrg);
+#endif
+    htmlLen += FlyStrZCat(szHtml, szRefFootMiddle, size);
+    htmlLen += FlyStrZNCat(szHtml, pAltLink->szAlt, size, pAltLink->altLen);
+    htmlLen += FlyStrZCat(szHtml, szRefFootClose, size);
+#if MD_DEBUG_REF
+    if(szHtmlOrg)
+      FlyDbgPrintf("Footnote Ref: %s", szHtmlOrg);
+#endif
     }
 
-    htmlLen += FlyStrZCat(szHtml, m_szEndBracket, size);
-    *ppszMd = szRefEnd;
+  // [^footnote]: paragraph text of footnote
+  // becomes <p id="footnote">
+  // note: paragraph is not closed, just given an id
+  else if(pAltLink->refType == MD_REF_TYPE_FOOTNOTE)
+  {
+    FlyAssert(pAltLink->szAlt && pAltLink->altLen > 1);
+    htmlLen += FlyStrZCpy(szHtml, szFootnoteOpen, size);
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyStrSlug(szHtml, pAltLink->szAlt, size, pAltLink->altLen);
+    htmlLen += FlyStrZCat(szHtml, szFootnoteClose, size);
   }
 
   return htmlLen;
@@ -1880,87 +2154,89 @@ size_t FlyMd2HtmlImage(char *szHtml, size_t size, const char **ppszMd)
 *///-----------------------------------------------------------------------------------------------
 size_t FlyMd2HtmlRef(char *szHtml, size_t size, const char **ppszMd)
 {
-  static const char   szRefOpen[]       = "<a href=\"";
-  static const char   szRefMiddle[]     = "\">";
-  static const char   szRefClose[]      = "</a>";
-
-  static const char   szRefFootMiddle[] = "\">[";   // szRefFootOpen[] is same as szRefOpen[]
-  static const char   szRefFootClose[]  = "]</a>";
-
-  static const char   szFootnoteOpen[]  = "<p id=\"";
-  static const char   szFootnoteClose[] = "\">";
-
   flyMdAltLink_t      altLink;
   const char         *szRefEnd;
-  const char         *psz;
   size_t              htmlLen     = 0;
-#if MD_DEBUG_REF
-  char               *szHtmlOrg   = szHtml;
-#endif
 
   szRefEnd = FlyMdAltLink(&altLink, *ppszMd);
   if(szRefEnd && altLink.refType != MD_REF_TYPE_NONE)
-  {
-    // handle image separatelty
-    if(altLink.refType == MD_REF_TYPE_IMAGE)
-    {
-      psz = *ppszMd;
-      htmlLen = FlyMd2HtmlImage(szHtml, size, &psz);
-    }
+    htmlLen = MdRef(szHtml, size, &altLink);
 
-    // [ref text](site.com/page)  =>
-    // <a href="site.com/page">ref text</a>
-    else if(altLink.refType == MD_REF_TYPE_REF)
-    {
-      FlyAssert(altLink.szLink && altLink.linkLen);
-      htmlLen += FlyStrZCpy(szHtml, szRefOpen, size);
-      htmlLen += FlyStrZNCat(szHtml, altLink.szLink, size, altLink.linkLen);
-      htmlLen += FlyStrZCat(szHtml, szRefMiddle, size);
-      htmlLen += FlyStrZNCat(szHtml, altLink.szAlt, size, altLink.altLen);
-      htmlLen += FlyStrZCat(szHtml, szRefClose, size);
-    }
+  if(htmlLen)
+    *ppszMd = szRefEnd;
+  return htmlLen;
+}
 
-    // [^footnote]  =>
-    // <a href="#footnote"><[^footnote]</a>
-    else if(altLink.refType == MD_REF_TYPE_FOOT_REF)
-    {
-      FlyAssert(altLink.szAlt && altLink.altLen > 1);
-      htmlLen += FlyStrZCpy(szHtml, szRefOpen, size);
-      htmlLen += FlyStrZCat(szHtml, "#", size);
-      szHtml = MdAdjust(szHtml, &size);
-#if MD_DEBUG_REF
-      if(szHtmlOrg)
-        FlyDbgPrintf("Footnote b4 slug: %s", szHtmlOrg);
-#endif
-      htmlLen += FlyStrSlug(szHtml, altLink.szAlt, size, altLink.altLen);
-#if MD_DEBUG_REF
-      if(szHtmlOrg)
-        FlyDbgPrintf("Footnote af slug: %s", szHtmlOrg);
-#endif
-      htmlLen += FlyStrZCat(szHtml, szRefFootMiddle, size);
-      htmlLen += FlyStrZNCat(szHtml, altLink.szAlt, size, altLink.altLen);
-      htmlLen += FlyStrZCat(szHtml, szRefFootClose, size);
-#if MD_DEBUG_REF
-      if(szHtmlOrg)
-        FlyDbgPrintf("Footnote Ref: %s", szHtmlOrg);
-#endif
-      }
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlHeading() and FlyMdParseBlock(). Given a heading line and its level from
+  MdIsHeading(), return ptr to the heading text.
+-------------------------------------------------------------------------------------------------*/
+static const char * MdHeadingText(const char *szLine, unsigned level)
+{
+  return (*szLine == '#') ? FlyStrSkipWhite(&szLine[level]) : szLine;
+}
 
-    // [^footnote]: paragraph text of footnote
-    // becomes <p id="footnote">
-    // note: paragraph is not closed, just given an id
-    else if(altLink.refType == MD_REF_TYPE_FOOTNOTE)
-    {
-      FlyAssert(altLink.szAlt && altLink.altLen > 1);
-      htmlLen += FlyStrZCpy(szHtml, szFootnoteOpen, size);
-      szHtml = MdAdjust(szHtml, &size);
-      htmlLen += FlyStrSlug(szHtml, altLink.szAlt, size, altLink.altLen);
-      htmlLen += FlyStrZCat(szHtml, szFootnoteClose, size);
-    }
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlHeading() and FlyMdBlock2Html(). Converts the heading and optionally fills
+  in the heading index entry in the same pass. Offsets in pHeading are relative to szHtml.
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  level     heading level 1-6
+  @param  szText    heading text
+  @param  szTextEnd end of heading text
+  @param  szW3Color optional color class, e.g. "w3-red", or NULL for none
+  @param  pHeading  optional heading index entry to fill in, or NULL
+  @return length of HTML heading
+*///-----------------------------------------------------------------------------------------------
+static size_t MdHeadingMake(char *szHtml, size_t size, unsigned level, const char *szText, const char *szTextEnd,
+                            const char *szW3Color, flyMdHeading_t *pHeading)
+{
+  const char    szFmtHdrOpen[]   = "<h%u id=\"";
+  const char    szFmtHdrClass[]  = "\" class=\"";
+  const char    szHdrMiddle[]    = "\">";
+  const char    szFmtHdrClose[]  = "</h%u>\r\n";
+  char          szTag[sizeof(szFmtHdrOpen) + 2];   // e.g. "<h2 id=\"
+  size_t        htmlLen   = 0;
+  size_t        textLen   = (size_t)(szTextEnd - szText);
+  size_t        slugLen;
+  size_t        len;
+
+  // heading open
+  sprintf(szTag, szFmtHdrOpen, level);
+  htmlLen += FlyStrZCpy(szHtml, szTag, size);
+
+  // heading ID
+  szHtml = MdAdjust(szHtml, &size);
+  slugLen = FlyStrSlug(szHtml, szText, size, textLen);
+  if(pHeading)
+  {
+    pHeading->level       = level;
+    pHeading->szText      = szText;
+    pHeading->textLen     = textLen;
+    pHeading->htmlOffset  = 0;
+    pHeading->slugOffset  = htmlLen;
+    pHeading->slugLen     = slugLen;
   }
+  htmlLen += slugLen;
+
+  // optional heading color
+  if(szW3Color)
+  {
+    len = strlen(szW3Color);
+    FlyStrZCat(szHtml, szFmtHdrClass, size);
+    FlyStrZCat(szHtml, szW3Color, size);
+    htmlLen += strlen(szFmtHdrClass) + len;
+  }
+
+  // end the tag and copy title in text form
+  htmlLen += FlyStrZCat(szHtml, szHdrMiddle, size);
+  htmlLen += FlyStrZNCat(szHtml, szText, size, textLen);
+
+  // end the tag
+  sprintf(szTag, szFmtHdrClose, level);
+  htmlLen += FlyStrZCat(szHtml, szTag, size);
 
-  if(htmlLen)
-    *ppszMd = szRefEnd;
   return htmlLen;
 }
 
@@ -1979,50 +2255,17 @@ size_t FlyMd2HtmlRef(char *szHtml, size_t size, const char **ppszMd)
 *///-----------------------------------------------------------------------------------------------
 size_t FlyMd2HtmlHeading(char *szHtml, size_t size, const char **ppszMd, const char *szW3Color)
 {
-  const char    szFmtHdrOpen[]   = "<h%u id=\"";
-  const char    szFmtHdrClass[]  = "\" class=\"";
-  const char    szHdrMiddle[]    = "\">";
-  const char    szFmtHdrClose[]  = "</h%u>\r\n";
   const char   *pszEndHdr;
   const char   *pszHdrText;
-  char          szTag[sizeof(szFmtHdrOpen) + 2];   // e.g. "<h2 id=\"
   size_t        htmlLen   = 0;
   unsigned      level;
-  size_t        len;
 
   // level is limited to 6
   pszEndHdr = MdIsHeading(*ppszMd, &level);
   if(pszEndHdr)
   {
-    // heading open
-    sprintf(szTag, szFmtHdrOpen, level);
-    htmlLen += FlyStrZCpy(szHtml, szTag, size);
-
-    // heading ID
-    pszHdrText = FlyMd2HtmlHeadingText(*ppszMd);
-    FlyAssert(pszHdrText);
-    szHtml = MdAdjust(szHtml, &size);
-    htmlLen += FlyStrSlug(szHtml, pszHdrText, size, FlyStrLineLen(pszHdrText));
-
-    // optional heading color
-    if(szW3Color)
-    {
-      len = strlen(szW3Color);
-      FlyStrZCat(szHtml, szFmtHdrClass, size);
-      FlyStrZCat(szHtml, szW3Color, size);
-      htmlLen += strlen(szFmtHdrClass) + len;
-    }
-
-    // end the tag and copy title in text form
-    htmlLen += FlyStrZCat(szHtml, szHdrMiddle, size);
-    len = FlyStrLineEnd(pszHdrText) - pszHdrText;
-    htmlLen += FlyStrZNCat(szHtml, pszHdrText, size, len);
-
-    // end the tag
-    sprintf(szTag, szFmtHdrClose, level);
-    htmlLen += FlyStrZCat(szHtml, szTag, size);
-
-    // on to next line
+    pszHdrText = MdHeadingText(*ppszMd, level);
+    htmlLen = MdHeadingMake(szHtml, size, level, pszHdrText, FlyStrLineEnd(pszHdrText), szW3Color, NULL);
     *ppszMd = pszEndHdr;
   }
 
@@ -2030,25 +2273,44 @@ size_t FlyMd2HtmlHeading(char *szHtml, size_t size, const char **ppszMd, const c
 }
 
 /*-------------------------------------------------------------------------------------------------
-  Recursive helper function to FlyMd2HtmlList(). 
+  Helper to FlyMd2HtmlList() and FlyMdParseBlock(). A list continues until a non-list line or a
+  line less indented than the first.
+
+  @param  szLine    ptr to 1st line of a list
+  @return ptr to line after list
+*///-----------------------------------------------------------------------------------------------
+static const char * MdListEnd(const char *szLine)
+{
+  unsigned  indent = FlyStrLineIndent(szLine, FLY_STR_TAB_SIZE);
+
+  while(FlyMd2HtmlIsList(szLine, NULL) && FlyStrLineIndent(szLine, FLY_STR_TAB_SIZE) >= indent)
+    szLine = FlyStrLineNext(szLine);
+  return szLine;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Recursive helper function to FlyMd2HtmlList() and FlyMdBlock2Html().
 
   This function creates HTML list for one level from markdown, and recurses to handle deeper levels.
+  Every line up to szMdEnd must be a list line, as found by MdListEnd().
 
   @param  szHtml        ptr to char array or NULL to just get size of resulting HTML
   @param  size          
   @param  ppszMdList    ptr to a list line in markdown string
+  @param  szMdEnd       line after the whole list
+  @param  type          FLY_MD_LIST_TYPE_ORDERED or FLY_MD_LIST_TYPE_UNORDERED
   @param  indent        indent level (e.g. 2 or 4 bytes)
   @param  level         0-n
   @return ptr to line after list in szMd
 *///-----------------------------------------------------------------------------------------------
-static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, unsigned indent, unsigned level)
+static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, const char *szMdEnd,
+                         mdListType_t type, unsigned indent, unsigned level)
 {
   const char   *szMdListLine = *ppszMdList;
   const char   *szLine;
   const char   *szItem;
   unsigned      thisIndent;
   unsigned      checkbox;
-  mdListType_t  type;
   mdListType_t  thisType;
   const char    szOrdered[]       = "<ol>\r\n";
   const char    szOrderedEnd[]    = "</ol>\r\n";
@@ -2063,13 +2325,8 @@ static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, uns
   bool_t        fEndListItem;
   size_t        htmlLen = 0;
 
-  // validate parameters
-  szMdListLine = *ppszMdList;
-  FlyAssert(FlyMd2HtmlIsList(szMdListLine, NULL));
-
   // open the list
   htmlLen += FlyStrZCatFill(szHtml, ' ', size, level * 2);
-  MdListType(szMdListLine, &type, NULL);
   if(type == FLY_MD_LIST_TYPE_ORDERED)
     htmlLen += FlyStrZCat(szHtml, szOrdered, size);
   else
@@ -2078,7 +2335,7 @@ static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, uns
   // fill in the list line items
   szLine = szMdListLine;
   fEndListItem = FALSE;
-  while(FlyMd2HtmlIsList(szLine, NULL))
+  while(szLine < szMdEnd)
   {
     thisIndent = FlyStrLineIndent(szLine, FLY_STR_TAB_SIZE);
     szItem = MdListType(szLine, &thisType, &checkbox);
@@ -2088,7 +2345,7 @@ static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, uns
     {
       htmlLen += FlyStrZCat(szHtml, szLineEnd, size);
       szHtml = MdAdjust(szHtml, &size);
-      htmlLen += MdListMake(szHtml, size, &szLine, thisIndent, level + 1);
+      htmlLen += MdListMake(szHtml, size, &szLine, szMdEnd, thisType, thisIndent, level + 1);
       htmlLen += FlyStrZCatFill(szHtml, ' ', size, level * 2);
       fEndListItem = TRUE;
     }
@@ -2112,7 +2369,8 @@ static size_t MdListMake(char *szHtml, size_t size, const char **ppszMdList, uns
           htmlLen += FlyStrZCat(szHtml, szChecked, size);
         htmlLen += FlyStrZCat(szHtml, szCheckBoxEnd, size);
       }
-      htmlLen += FlyMd2HtmlTextLine(szHtml ? szHtml + strlen(szHtml) : szHtml, size, &szItem, FlyStrLineEnd(szItem));
+      szHtml = MdAdjust(szHtml, &size);
+      htmlLen += FlyMd2HtmlTextLine(szHtml, size, &szItem, FlyStrLineEnd(szItem));
       fEndListItem = TRUE;
       szLine = FlyStrLineNext(szLine);
     }
@@ -2154,13 +2412,15 @@ size_t FlyMd2HtmlList(char *szHtml, size_t size, const char **ppszMd)
   const char   *szMd = *ppszMd;
   unsigned      orgIndent;
   size_t        htmlLen = 0;
+  mdListType_t  type;
 
-  if(FlyMd2HtmlIsList(szMd, NULL) && size > 1)
+  MdListType(szMd, &type, NULL);
+  if(type != FLY_MD_LIST_TYPE_NOT_LIST && size > 1)
   {
     orgIndent = FlyStrLineIndent(szMd, FLY_STR_TAB_SIZE);
     if(szHtml)
       *szHtml = '\0';
-    htmlLen = MdListMake(szHtml, size, &szMd, orgIndent, 0);
+    htmlLen = MdListMake(szHtml, size, &szMd, MdListEnd(szMd), type, orgIndent, 0);
   }
 
   if(htmlLen)
@@ -2182,20 +2442,18 @@ size_t FlyMd2HtmlList(char *szHtml, size_t size, const char **ppszMd)
 *///-----------------------------------------------------------------------------------------------
 static char * MdEmMatch(const mdEmTypeInfo_t *pTypeInfo, const char *szMd, const char *szMdEnd)
 {
-  char        szAccept[2];
+  uint16_t    accept  = MdClass(pTypeInfo->marker) & MD_CLASS_EM;
   const char *szFound = NULL;
   unsigned    count;
 
-  szAccept[0] = pTypeInfo->marker;
-  szAccept[1] = '\0';
   szMd += pTypeInfo->len;
 
   while(szMd < szMdEnd)
   {
-    szFound = FlyMdNPBrk(szMd, szMdEnd, szAccept);
+    szFound = MdPBrk(szMd, szMdEnd, m_aMdClass, accept);
     if(!szFound)
       break;
-    count = FlyStrChrCount(szFound, *szAccept);
+    count = FlyStrChrCount(szFound, pTypeInfo->marker);
     if(count == pTypeInfo->len)
       break;
     else
@@ -2207,258 +2465,362 @@ static char * MdEmMatch(const mdEmTypeInfo_t *pTypeInfo, const char *szMd, const
 
 
 /*!------------------------------------------------------------------------------------------------
-  Convert a line or less of text from markdown into HTML.
+  Start parsing a line or less of text into inline elements: text, `code`, **emphasis**, links,
+  images, etc... Call FlyMdInlineNext() to get each element in turn.
 
-  Converts [text](link.com), `code`, **bold**, \` etc...
-
-  This does NOT add the <br> at the end of the line for 2 spaces.
+  This is the parse half of FlyMd2HtmlTextLine(). Use it to produce something other than HTML from
+  paragraphs, list items or table cells, such as plain text or ANSI colored text.
 
-  This is used to convert paragraph lines, list items, table cells.
+  Example:
 
-  Param `ppszMd` is both input and output. It is advanced to end of "consumed" markdown.
+  ```c
+  const char    szMd[] = "Some **bold** `code`";
+  flyMdInline_t mdInline;
 
-  Note: `if(*szMdEnd == ']')` then it won't process references, as reference text can't contain a
-  reference.
+  FlyMdInlineFirst(&mdInline, szMd, szMd + strlen(szMd));
+  while(FlyMdInlineNext(&mdInline))
+  {
+    if(mdInline.type == MD_INLINE_TYPE_TEXT)
+      printf("%.*s", (int)mdInline.len, mdInline.szMd);
+  }
+  ```
 
-  @param  szHtml    ptr to char array or NULL to just get length of resulting HTML
-  @param  size      size of szHtml
-  @param  ppszMd    both input and output, start of markdown
+  @param  pInline   parse state, filled in by each call to FlyMdInlineNext()
+  @param  szMd      start of markdown text
   @param  szMdEnd   ptr to byte AFTER end of text
-  @return length of output HTML
+  @return none
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlTextLine(char *szHtml, size_t size, const char **ppszMd, const char *szMdEnd)
+void FlyMdInlineFirst(flyMdInline_t *pInline, const char *szMd, const char *szMdEnd)
 {
-  char                 *szHtmlOrg = szHtml;
-  const char           *psz;
-  const char           *psz2;
-  size_t                n;
-  size_t                htmlLen = 0;
-  flyMdRefType_t        refType;
-  const mdEmTypeInfo_t *pEmTypeInfo;
-  bool_t                afClose[MD_EM_TYPE_SIZEOF];
-  unsigned              i;
+  memset(pInline, 0, sizeof(*pInline));
+  pInline->szNext   = szMd;
+  pInline->szMdEnd  = szMdEnd;
+}
 
-  // do NOT allow bad markdown ptrs
-  FlyAssert(*ppszMd && szMdEnd && *ppszMd < szMdEnd);
+/*!------------------------------------------------------------------------------------------------
+  Get the next inline element of text started with FlyMdInlineFirst().
 
-  // start with a zero terminated string, as we will be concatinating
-  (void)szHtmlOrg;    // debugging
-  if(szHtml)
-    *szHtml = '\0';  
+  Emphasis is only opened if there is a matching close on the text. Any emphasis still open at the
+  end of the text is closed with an MD_INLINE_TYPE_EM_CLOSE of len 0.
+
+  Note: an element may extend past szMdEnd, for example `code` in a table cell.
+
+  @param  pInline   parse state from FlyMdInlineFirst()
+  @return TRUE if pInline has the next element, FALSE if no more elements
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyMdInlineNext(flyMdInline_t *pInline)
+{
+  const mdEmTypeInfo_t *pEmTypeInfo;
+  const char           *psz     = pInline->szNext;
+  const char           *szMdEnd = pInline->szMdEnd;
+  const char           *psz2;
+  const char           *pszRefEnd;
+  size_t                len     = 1;
+  bool_t                fFound  = TRUE;
+  unsigned              i;
 
-// if(szHtmlOrg) // BUGBUG
-//   FlyDbgPrintf("FlyMd2HtmlTextLine(%.*s), size %zu\n", (unsigned)(szMdEnd - *ppszMd), *ppszMd, size);
+  pInline->type   = MD_INLINE_TYPE_CHARS;
+  pInline->szMd   = psz;
+  pInline->emType = MD_EM_TYPE_NONE;
 
-  // psz2 = FlyStrLineChrMatch(psz, "`![<"
-  memset(afClose, 0, sizeof(afClose));
-  psz = psz2 = *ppszMd;
-  while(psz < szMdEnd)
+  // end of text, close any emphasis still open
+  if(psz >= szMdEnd)
   {
-    // if(szHtmlOrg && *szHtmlOrg) // BUGBUG
-    //   FlyDbgPrintf("  %s, size %zu, md %s, htmlLen %zu\n", szHtmlOrg, size, psz, htmlLen);
+    fFound = FALSE;
+    for(i = 1; i < NumElements(pInline->afOpen); ++i)
+    {
+      if(pInline->afOpen[i])
+      {
+        pInline->afOpen[i]  = FALSE;
+        pInline->type       = MD_INLINE_TYPE_EM_CLOSE;
+        pInline->emType     = (flyMdEmType_t)i;
+        pInline->szMd       = szMdEnd;
+        len                 = 0;
+        fFound              = TRUE;
+        break;
+      }
+    }
+    if(!fFound)
+      len = 0;
+  }
 
+  else
+  {
     // find potential next special sequence not just plain (or escaped) text
-    psz2 = FlyMdNPBrk(psz, szMdEnd, m_szMdSpecial);
+    psz2 = MdPBrk(psz, szMdEnd, m_aMdClass, MD_CLASS_SPECIAL);
     if(psz2 == NULL)
       psz2 = szMdEnd;
-    // else
-    //   FlyDbgPrintf("special %.*s\n", (int)FlyStrLineLen(psz2), psz2);
     if(psz2 > psz)
     {
-      htmlLen += MdNCat(szHtml, psz, size, psz2 - psz);
-      szHtml = MdAdjust(szHtml, &size);
+      pInline->type = MD_INLINE_TYPE_TEXT;
+      len = psz2 - psz;
     }
-    if(psz2 == szMdEnd)
-      break;
 
     // this may span multiple other types of things, so do inline `code` 1st
-    // backtick starts `code`
-    if(*psz2 == '`')
-      htmlLen += FlyMd2HtmlCodeIn(szHtml, size, &psz2);
-
-    // handle quick links, e.g. <me@mysite.com>, <https://www.w3schools.com/css/css_intro.asp> <#local_link>
-    else if(FlyMd2HtmlIsQLink(psz2))
-      htmlLen += FlyMd2HtmlQLink(szHtml, size, &psz2);
-
-    // image or reference, e.g. [ref text](link.com) or ![image text](file.png "opt title")
-    else if(*psz2 == '!' || *psz2 == '[')
+    // backtick starts `code`, but `` is just 2 backticks
+    else if(*psz == '`')
     {
-      // is this a valid reference?
-      refType = FlyMd2HtmlIsRef(psz2);
-      // handles image, reference, footnote reference
-      if(refType == MD_REF_TYPE_IMAGE)
-        htmlLen += FlyMd2HtmlImage(szHtml, size, &psz2);
-      else if(refType == MD_REF_TYPE_REF ||  refType == MD_REF_TYPE_FOOT_REF)
-        htmlLen += FlyMd2HtmlRef(szHtml, size, &psz2);
-
-      // MD_REF_TYPE_FOOTNOTE already handled at paragraph level
-      // however, if user wrote a bad line such as:
-      // [^footnote]: some text [^bad footnote, must be on different line]: more text
-      else
-      {
-        refType = MD_REF_TYPE_NONE;
-      }
-
-      // not a valid reference, just copy the "![" or "[" sequence, and process after that
-      if(refType == MD_REF_TYPE_NONE)
+      psz2 = MdLinePBrk(psz + 1, MD_CLASS_TICK);
+      if(!psz2)
+        psz2 = FlyStrLineEnd(psz);
+      if(psz2 > psz + 1)
       {
-        if(*psz2 == '!')
-        {
-          htmlLen += FlyStrZCat(szHtml, "!", size);
-          ++psz2;
-        }
-        if(*psz2 == '[')
-        {
-          htmlLen += FlyStrZCat(szHtml, "[", size);
-          ++psz2;
-        }
+        pInline->type = MD_INLINE_TYPE_CODE;
+        len = (psz2 - psz) + (*psz2 == '`' ? 1 : 0);
       }
+      else if(*psz2 == '`')
+        len = 2;
     }
 
-    // handle emphasis characters, e.g. **bold** or ==highlight==
-    else if(strchr(m_szMdEmMarkers, *psz2))
+    // handle quick links, e.g. <me@mysite.com>, <https://www.w3schools.com/css/css_intro.asp> <#local_link>
+    else if(FlyMd2HtmlIsQLink(psz))
     {
-      pEmTypeInfo = MdEmTypeInfoGet(psz2);
-      if(pEmTypeInfo)
-      {
-        // if opening, there must be a pair, or it's not emphasis
-        if(!afClose[pEmTypeInfo->type] && !MdEmMatch(pEmTypeInfo, psz2, szMdEnd))
-          pEmTypeInfo = NULL;
-        else
-        {
-          // open or close the emphasis by type
-          htmlLen += FlyMd2HtmlEmphasis(szHtml, size, &psz2, afClose[pEmTypeInfo->type]);
-          afClose[pEmTypeInfo->type] = afClose[pEmTypeInfo->type] ? FALSE : TRUE;
-        }
-      }
-      if(!pEmTypeInfo)
-      {
-        n = FlyStrChrCount(psz2, *psz2);
-        htmlLen += FlyStrZFill(szHtml, *psz2, size, n);
-        psz2 += n;
-      }
+      pInline->type = MD_INLINE_TYPE_QLINK;
+      len = (FlyStrLineChr(psz, '>') - psz) + 1;
     }
 
-    // handle special characters to not confuse HTML
-    else if(*psz2 == '&')
-    {
-      htmlLen += FlyStrZCat(szHtml, "&amp;", size);
-      ++psz2;
-    }
-    else if(*psz2 == '<')
+    // image or reference, e.g. [ref text](link.com) or ![image text](file.png "opt title")
+    // MD_REF_TYPE_FOOTNOTE already handled at paragraph level, so here it's just text
+    else if(*psz == '!' || *psz == '[')
     {
-      htmlLen += FlyStrZCat(szHtml, "&lt;", size);
-      ++psz2;
+      pszRefEnd = FlyMdAltLink(&pInline->altLink, psz);
+      if(pszRefEnd && pInline->altLink.refType == MD_REF_TYPE_IMAGE)
+        pInline->type = MD_INLINE_TYPE_IMAGE;
+      else if(pszRefEnd && (pInline->altLink.refType == MD_REF_TYPE_REF || pInline->altLink.refType == MD_REF_TYPE_FOOT_REF))
+        pInline->type = MD_INLINE_TYPE_REF;
+      if(pInline->type != MD_INLINE_TYPE_CHARS)
+        len = pszRefEnd - psz;
+
+      // not a valid reference, just the "![" or "[" sequence
+      else if(psz[0] == '!' && psz[1] == '[')
+        len = 2;
     }
 
-    // should never get here, as it should have been handled above
-    else
+    // emphasis characters, e.g. **bold** or ==highlight==
+    // if opening, there must be a pair, or it's not emphasis
+    else if(strchr(m_szMdEmMarkers, *psz))
     {
-      FlyAssertFail("Missing Special");
+      pEmTypeInfo = MdEmTypeInfoGet(psz);
+      if(pEmTypeInfo && (pInline->afOpen[pEmTypeInfo->type] || MdEmMatch(pEmTypeInfo, psz, szMdEnd)))
+      {
+        pInline->type   = pInline->afOpen[pEmTypeInfo->type] ? MD_INLINE_TYPE_EM_CLOSE : MD_INLINE_TYPE_EM_OPEN;
+        pInline->emType = pEmTypeInfo->type;
+        pInline->afOpen[pEmTypeInfo->type] = !pInline->afOpen[pEmTypeInfo->type];
+        len = pEmTypeInfo->len;
+      }
+      else
+        len = FlyStrChrCount(psz, *psz);
     }
 
-    // for things that don't concatenate
-    szHtml = MdAdjust(szHtml, &size);
-
-    psz = psz2;
+    // otherwise it's special char '&' or '<' which must be escaped for HTML
   }
 
-  // but endings on all markers still open on the line
-  for(i = 1; i < NumElements(afClose); ++i)
+  pInline->len    = len;
+  pInline->szNext = psz + len;
+  if(!fFound)
+    pInline->type = MD_INLINE_TYPE_NONE;
+
+  return fFound;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Convert a line or less of text from markdown into HTML.
+
+  Converts [text](link.com), `code`, **bold**, \` etc...
+
+  This does NOT add the <br> at the end of the line for 2 spaces.
+
+  This is used to convert paragraph lines, list items, table cells.
+
+  Param `ppszMd` is both input and output. It is advanced to end of "consumed" markdown.
+
+  Note: `if(*szMdEnd == ']')` then it won't process references, as reference text can't contain a
+  reference.
+
+  @param  szHtml    ptr to char array or NULL to just get length of resulting HTML
+  @param  size      size of szHtml
+  @param  ppszMd    both input and output, start of markdown
+  @param  szMdEnd   ptr to byte AFTER end of text
+  @return length of output HTML
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlTextLine(char *szHtml, size_t size, const char **ppszMd, const char *szMdEnd)
+{
+  const char           *psz;
+  size_t                htmlLen = 0;
+  flyMdInline_t         mdInline;
+
+  // do NOT allow bad markdown ptrs
+  FlyAssert(*ppszMd && szMdEnd && *ppszMd < szMdEnd);
+
+  // start with a zero terminated string, as we will be concatinating
+  if(szHtml)
+    *szHtml = '\0';  
+
+  FlyMdInlineFirst(&mdInline, *ppszMd, szMdEnd);
+  while(FlyMdInlineNext(&mdInline))
   {
-    char szMdType[4];
-    if(afClose[i])
+    psz = mdInline.szMd;
+    switch(mdInline.type)
     {
-      pEmTypeInfo = &m_aEmMdTypeInfo[i - 1];
-      FlyStrZFill(szMdType, pEmTypeInfo->marker, sizeof(szMdType), pEmTypeInfo->len);
-      psz = szMdType;
-      htmlLen += FlyMd2HtmlEmphasis(szHtml, size, &psz, afClose[i]);
-      szHtml = MdAdjust(szHtml, &size);
+      case MD_INLINE_TYPE_TEXT:
+        htmlLen += MdNCat(szHtml, psz, size, mdInline.len);
+      break;
+
+      case MD_INLINE_TYPE_CODE:
+        htmlLen += FlyMd2HtmlCodeIn(szHtml, size, &psz);
+      break;
+
+      case MD_INLINE_TYPE_QLINK:
+        htmlLen += FlyMd2HtmlQLink(szHtml, size, &psz);
+      break;
+
+      case MD_INLINE_TYPE_IMAGE:
+      case MD_INLINE_TYPE_REF:
+        htmlLen += MdRef(szHtml, size, &mdInline.altLink);
+      break;
+
+      case MD_INLINE_TYPE_EM_OPEN:
+        htmlLen += FlyStrZCpy(szHtml, m_aEmMdTypeInfo[mdInline.emType - 1].szHtmlOpen, size);
+      break;
+
+      case MD_INLINE_TYPE_EM_CLOSE:
+        htmlLen += FlyStrZCpy(szHtml, m_aEmMdTypeInfo[mdInline.emType - 1].szHtmlClose, size);
+      break;
+
+      // handle special characters to not confuse HTML, szHtml is already at end of string
+      default:
+        htmlLen += FlyStrHtmlEscape(szHtml, psz, size, mdInline.len, FLYSTR_HTML_LT | FLYSTR_HTML_AMP);
+      break;
     }
+
+    // for things that don't concatenate
+    szHtml = MdAdjust(szHtml, &size);
   }
 
   *ppszMd = szMdEnd;
   return htmlLen;
 }
 
-/*!------------------------------------------------------------------------------------------------
-  Convert markdown paragraph into HTML. Converts [text](ref) and `code`, and `  ` line break
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlPara() and FlyMdParseBlock(). A paragraph ends on a blank line, or a line that
+  starts a triple tick code block, heading or horizontal rule.
 
-  On input, *ppszMd must point to a non-blank line.
+  Only a line starting with an MD_CLASS_PARA_END char, or followed by a `===` or `---` line, can do that,
+  so most lines are checked with a single table lookup.
 
-  Stops on first blank line, or on a triple tick line, or on #Heading lines.
+  @param  szLine    ptr to 1st line of a paragraph
+  @return ptr to line after paragraph
+*///-----------------------------------------------------------------------------------------------
+static const char * MdParaEnd(const char *szLine)
+{
+  const char   *szNextLine;
+  bool_t        fBackTicks;
 
-  ppszMd is both input and output. It is advanced to end of "consumed" markdown
+  while(*szLine && !FlyStrLineIsBlank(szLine))
+  {
+    szNextLine = FlyStrLineNext(szLine);
+    if((MdClass(*szLine) & MD_CLASS_PARA_END) || *szNextLine == '=' || *szNextLine == '-')
+    {
+      if(FlyMd2HtmlIsCodeBlk(szLine, &fBackTicks) && fBackTicks)
+        break;
+      if(FlyMd2HtmlIsHeading(szLine, NULL))
+        break;
+      if(FlyMd2HtmlIsHorzRule(szLine))
+        break;
+    }
+    szLine = szNextLine;
+  }
+
+  return szLine;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlPara() and FlyMdBlock2Html(). Converts the paragraph from szMd up to szMdEnd,
+  which must be the end found by MdParaEnd().
 
   @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
-  @param  pSize     both input/output
-  @param  ppszMd    ptr to ptr to markdown string, advanced forward
-  @return size of HTML, or 0 if not a paragraph (blank line)
+  @param  size      sizeof(szHtml)
+  @param  szMd      1st line of paragraph
+  @param  szMdEnd   line after paragraph
+  @return size of HTML
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlPara(char *szHtml, size_t size, const char **ppszMd)
+static size_t MdParaMake(char *szHtml, size_t size, const char *szMd, const char *szMdEnd)
 {
-  const char  *szMd         = *ppszMd;
   const char  *psz;
   const char  *szLine;
   const char  *szNextLine;
   size_t      htmlLen       = 0;
-  bool_t      fBackTicks;
 
-  // paragraph must start on non-blank
   szLine = szMd;
-  if(szLine && !FlyStrLineIsBlank(szLine))
-  {
-    if(szHtml)
-      *szHtml = '\0';
+  if(szHtml)
+    *szHtml = '\0';
 
 #if MD_DEBUG_PARA
-    FlyDbgPrintf("FlyMd2HtmlPara(%.*s)\n", (int)FlyStrLineLen(szLine), szLine);
+  FlyDbgPrintf("FlyMd2HtmlPara(%.*s)\n", (int)FlyStrLineLen(szLine), szLine);
 #endif
 
-    // open the paragraph, possibly with id
-    if(FlyMd2HtmlIsRef(szLine) == MD_REF_TYPE_FOOTNOTE)
-    {
+  // open the paragraph, possibly with id
+  if(FlyMd2HtmlIsRef(szLine) == MD_REF_TYPE_FOOTNOTE)
+  {
 #if MD_DEBUG_PARA
-    FlyDbgPrintf("  ...is footnote\n");
+  FlyDbgPrintf("  ...is footnote\n");
 #endif
-      psz = szLine;
-      htmlLen += FlyMd2HtmlRef(szHtml, size, &psz);
-    }
-    else
-    {
+    psz = szLine;
+    htmlLen += FlyMd2HtmlRef(szHtml, size, &psz);
+  }
+  else
+  {
 #if MD_DEBUG_PARA
-    FlyDbgPrintf("  ...is normal\n");
+  FlyDbgPrintf("  ...is normal\n");
 #endif
-      htmlLen += FlyStrZCpy(szHtml, "<p>", size);
-    }
+    htmlLen += FlyStrZCpy(szHtml, "<p>", size);
+  }
 
-    while(*szLine && !FlyStrLineIsBlank(szLine))
-    {
-      // don't count indented blank lines as they may be part of the paragraph
-      if(FlyMd2HtmlIsCodeBlk(szLine, &fBackTicks) && fBackTicks)
-        break;
-      if(FlyMd2HtmlIsHeading(szLine, NULL))
-        break;
-      if(FlyMd2HtmlIsHorzRule(szLine))
-        break;
+  while(szLine < szMdEnd)
+  {
+    szNextLine = FlyStrLineNext(szLine);
+    psz = szLine;
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyMd2HtmlTextLine(szHtml, size, &psz, FlyStrLineEnd(szLine));
+    if(FlyMd2HtmlIsBreak(szLine))
+      htmlLen += FlyStrZCat(szHtml, "<br>", size);
 
-      szNextLine = FlyStrLineNext(szLine);
-      psz = szLine;
-      htmlLen += FlyMd2HtmlTextLine(szHtml ? szHtml + strlen(szHtml) : szHtml, size, &psz, FlyStrLineEnd(szLine));
-      if(FlyMd2HtmlIsBreak(szLine))
-        htmlLen += FlyStrZCat(szHtml, "<br>", size);
+    // end paragraph on same line as last text
+    if(!FlyStrLineIsBlank(szNextLine))
+      htmlLen += FlyStrZCat(szHtml, "\r\n", size);
 
-      // end paragraph on same line as last text
-      if(!FlyStrLineIsBlank(szNextLine))
-        htmlLen += FlyStrZCat(szHtml, "\r\n", size);
+    szLine = szNextLine;
+  }
+  htmlLen += FlyStrZCat(szHtml, "</p>\r\n", size);
+
+  return htmlLen;
+}
 
-      szLine = szNextLine;
+/*!------------------------------------------------------------------------------------------------
+  Convert markdown paragraph into HTML. Converts [text](ref) and `code`, and `  ` line break
 
-      // if(szHtml)
-      //   FlyStrDump(szHtml, strlen(szHtml) + 1);
-    }
-    htmlLen += FlyStrZCat(szHtml, "</p>\r\n", size);
-    *ppszMd = szLine;
+  On input, *ppszMd must point to a non-blank line.
+
+  Stops on first blank line, or on a triple tick line, or on #Heading lines.
+
+  ppszMd is both input and output. It is advanced to end of "consumed" markdown
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  pSize     both input/output
+  @param  ppszMd    ptr to ptr to markdown string, advanced forward
+  @return size of HTML, or 0 if not a paragraph (blank line)
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlPara(char *szHtml, size_t size, const char **ppszMd)
+{
+  const char  *szMdEnd;
+  size_t      htmlLen       = 0;
+
+  // paragraph must start on non-blank
+  if(*ppszMd && !FlyStrLineIsBlank(*ppszMd))
+  {
+    szMdEnd = MdParaEnd(*ppszMd);
+    htmlLen = MdParaMake(szHtml, size, *ppszMd, szMdEnd);
+    *ppszMd = szMdEnd;
   }
 
   return htmlLen;
@@ -2521,27 +2883,32 @@ size_t FlyMd2HtmlQLink(char *szHtml, size_t size, const char **ppszMd)
   return htmlLen;
 }
 
-/*!------------------------------------------------------------------------------------------------
-  Convert markdown tabls into an HTML tables using W3.
-
-  ppszMd is both input and output. It is advanced to end of "consumed" markdown
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlTable() and FlyMdParseBlock(). Skips the header and alignment lines, then the
+  table continues while lines contain a '|'.
 
-  Name | Occupation | Salary
-  :--- | :--------: | -----:
-  Bob  | Plumber    | 100K
-  Joe  | Salesman   | 120K
-  Jane | Programmer | 150K
+  @param  szLine    ptr to 1st line of a table
+  @return ptr to line after table
+*///-----------------------------------------------------------------------------------------------
+static const char * MdTableEnd(const char *szLine)
+{
+  szLine = FlyStrLineNext(FlyStrLineNext(szLine));
+  while(MdLineChr(szLine, '|') != NULL)
+    szLine = FlyStrLineNext(szLine);
+  return szLine;
+}
 
-  a|b|c
-  ---|---|---
-  d|e|f
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlTable() and FlyMdBlock2Html(). Converts the table from szMd up to szMdEnd,
+  which must be the end found by MdTableEnd(). See FlyMd2HtmlTable().
 
   @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
-  @param  pSize     both input/output
-  @param  ppszMd    ptr to ptr to markdown string
-  @return ptr to line after list, or szMd if not a list
+  @param  size      sizeof(szHtml)
+  @param  szMd      1st line of table, the header
+  @param  szMdEnd   line after table
+  @return size of HTML
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
+static size_t MdTableMake(char *szHtml, size_t size, const char *szMd, const char *szMdEnd)
 {
   static const char szTableOpen[]   = "<table class=\"w3-table-all\" style=\"width:auto\">\r\n";
   static const char szRowOpen[]     = "<tr>\r\n";
@@ -2568,7 +2935,7 @@ size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
   if(szHtml)
     *szHtml = '\0';
 
-  szLine = *ppszMd;
+  szLine = szMd;
   nCols = MdTableGetCols(szLine, NumElements(aColType), aColType);
   if(nCols)
   {
@@ -2600,7 +2967,7 @@ size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
     // ---- | :---------:
     szLine = FlyStrLineNext(FlyStrLineNext(szLine));
 
-    while(MdLineChr(szLine, '|') != NULL)
+    while(szLine < szMdEnd)
     {
       // FlyDbgPrintf("A len %zu, szHtml =\n%s\n", strlen(szHtml), szHtml);
       htmlLen += FlyStrZCat(szHtml, szRowOpen, size);
@@ -2622,7 +2989,10 @@ size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
 
         // FlyDbgPrintf("C len %zu, szHtml =\n%s\n", strlen(szHtml), szHtml);
         if(cellLen)
-          htmlLen += FlyMd2HtmlTextLine(szHtml ? szHtml + strlen(szHtml) : szHtml, size - htmlLen, &szCell, szCell + cellLen);
+        {
+          szHtml = MdAdjust(szHtml, &size);
+          htmlLen += FlyMd2HtmlTextLine(szHtml, size, &szCell, szCell + cellLen);
+        }
 
         // FlyDbgPrintf("D len %zu, szHtml =\n%s\n", strlen(szHtml), szHtml);
         htmlLen += FlyStrZCat(szHtml, szCellClose, size);
@@ -2634,7 +3004,6 @@ size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
     }
 
     htmlLen += FlyStrZCat(szHtml, szTableClose, size);
-    *ppszMd = szLine;
   }
 
   // FlyDbgPrintf("Z len %zu, szHtml =\n%s\n", strlen(szHtml), szHtml);
@@ -2642,133 +3011,350 @@ size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
 }
 
 /*!------------------------------------------------------------------------------------------------
-  Convert markdown string to an HTML string using W3.CSS. Does not contain front/end matter.
+  Convert markdown tabls into an HTML tables using W3.
 
-  Note: this is expected to put content inside a W3.CSS HTML framework.
+  ppszMd is both input and output. It is advanced to end of "consumed" markdown
 
-  @param  szHtml    ptr to char buffer or NULL to just get size of resulting HTML
-  @param  size      sizeof(szHtml) or SIZE_MAX
-  @param  szMd      ptr to HTML string
-  @return len of resulting HTML (1-n)
+  Name | Occupation | Salary
+  :--- | :--------: | -----:
+  Bob  | Plumber    | 100K
+  Joe  | Salesman   | 120K
+  Jane | Programmer | 150K
+
+  a|b|c
+  ---|---|---
+  d|e|f
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  pSize     both input/output
+  @param  ppszMd    ptr to ptr to markdown string
+  @return ptr to line after list, or szMd if not a list
 *///-----------------------------------------------------------------------------------------------
-size_t FlyMd2HtmlContent(char *szHtml, size_t size, const char *szMd, const char *szMdEnd)
+size_t FlyMd2HtmlTable(char *szHtml, size_t size, const char **ppszMd)
 {
-  const char *szLine;
-  char       *pszHtml   = szHtml;
-  size_t      htmlLen   = 0;
-  size_t      sizeLeft  = size;
-  size_t      thisLen;
+  const char   *szMdEnd;
+  size_t        htmlLen = 0;
 
-  // for debugging
-  g_szMd = szMd;
+  if(szHtml)
+    *szHtml = '\0';
 
-  // need room for terminating '\0'
-  if(size == SIZE_MAX)
-    --size;
+  if(MdTableGetCols(*ppszMd, FLYMD2HTML_TABLE_COL_MAX, NULL))
+  {
+    szMdEnd = MdTableEnd(*ppszMd);
+    htmlLen = MdTableMake(szHtml, size, *ppszMd, szMdEnd);
+    *ppszMd = szMdEnd;
+  }
 
-#if MD_DEBUG_CONTENT > 1
-  FlyDbgPrintf("FlyMd2HtmlContent(szHtml=%p, size %zu, szMd=%p, szMdEnd=%p)\n", szHtml, size, szMd, szMdEnd);
-#endif
+  return htmlLen;
+}
 
-  szLine = szMd;
-  while(*szLine && szLine < szMdEnd)
-  {
-    // skip empty lines to get to something interesting
-    szLine = FlyStrLineSkipBlank(szLine);
-    if(szLine >= szMdEnd)
-      break;
+/*!------------------------------------------------------------------------------------------------
+  Parse one block of markdown (heading, block quote, horizontal rule, code block, list, table or
+  paragraph) without converting it. Skips any blank lines before the block.
 
-#if MD_DEBUG_CONTENT
-    if(fFlyMarkdownDebug)
-    {
-      unsigned  row, col;
-      row = FlyStrLinePos(szMd, szLine, &col);      
-      FlyDbgPrintf("\n-- %u:%u: %.*s\n", row, col, (int)FlyStrLineLen(szLine), szLine);
-    }
-#endif
+  The extents are found by the same helpers the FlyMd2Html...() functions use, and FlyMdBlock2Html()
+  renders from them directly, so the block is only scanned once. The block can also be used for
+  some other output such as a table of contents.
 
-    // # Headter Title
-    if(FlyMd2HtmlIsHeading(szLine, NULL))
+  @param  szMd      ptr to markdown, at the start of a line
+  @param  pBlock    returned block
+  @return ptr to line after the block, or NULL if no more blocks
+*///-----------------------------------------------------------------------------------------------
+const char * FlyMdParseBlock(const char *szMd, flyMdBlock_t *pBlock)
+{
+  const char       *szLine;
+  const char       *szMdEnd   = NULL;
+  const char       *szBody    = NULL;
+  const char       *szBodyEnd = NULL;
+  flyMdBlockType_t  type      = MD_BLOCK_TYPE_NONE;
+  unsigned          level     = 0;
+  bool_t            fIsBackTicks;
+  bool_t            fIsNumeric;
+  bool_t            fOneLine;
+
+  szLine = FlyStrLineSkipBlank(szMd);
+  if(*szLine)
+  {
+    // # Heading Title
+    szMdEnd = MdIsHeading(szLine, &level);
+    if(szMdEnd)
     {
-#if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isHeading\n");
-#endif
-      thisLen = FlyMd2HtmlHeading(pszHtml, sizeLeft, &szLine, NULL);
+      type      = MD_BLOCK_TYPE_HEADING;
+      szBody    = MdHeadingText(szLine, level);
+      szBodyEnd = FlyStrLineEnd(szBody);
     }
 
-    // > block quote
+    // > block quote, continues while lines start with '>'
     else if(FlyMd2HtmlIsBlockQuote(szLine))
     {
-#if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isBlockQuote\n");
-#endif
-      thisLen = FlyMd2HtmlBlockQuote(pszHtml, sizeLeft, &szLine);
+      type    = MD_BLOCK_TYPE_BLOCK_QUOTE;
+      level   = FlyStrChrCount(szLine, '>');
+      szMdEnd = MdBlockQuoteEnd(szLine);
     }
 
     // ---
     else if(FlyMd2HtmlIsHorzRule(szLine))
     {
-#if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isHorzRule\n");
-#endif
-      thisLen = FlyMd2HtmlHorzRule(pszHtml, sizeLeft, &szLine);
+      type    = MD_BLOCK_TYPE_HORZ_RULE;
+      szMdEnd = FlyStrLineNext(szLine);
     }
 
     // ```
     // code
     // ```
-    else if(FlyMd2HtmlIsCodeBlk(szLine, NULL))
+    else if(FlyMd2HtmlIsCodeBlk(szLine, &fIsBackTicks))
     {
-#if MD_DEBUG_CONTENT
-      const char *szNextLine;
-      if(fFlyMarkdownDebug)
-      {
-        szNextLine = FlyStrLineNext(szLine);
-        FlyDbgPrintf("isCodeBlock %.*s\n", (int)FlyStrLineLen(szNextLine), szNextLine);
-      }
-#endif
-#if MD_DEBUG_CONTENT
-      FlyDbgPrintf("szLine before: %p\n", szLine);
-#endif
-      thisLen = FlyMd2HtmlCodeBlk(pszHtml, sizeLeft, &szLine, NULL, NULL);
-#if MD_DEBUG_CONTENT
-      FlyDbgPrintf("szLine after : %p\n", szLine);
-#endif
+      type    = MD_BLOCK_TYPE_CODE_BLK;
+      szMdEnd = MdCodeBlkExtents(szLine, fIsBackTicks, &szBody, &szBodyEnd, &fOneLine);
+      level   = fOneLine ? 1 : 0;
     }
 
-    // 1. List item
-    else if(FlyMd2HtmlIsList(szLine, NULL))
+    // 1. List item, continues until a non-list line or a line less indented than the first
+    else if(FlyMd2HtmlIsList(szLine, &fIsNumeric))
     {
-#if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isList\n");
-#endif
-      thisLen = FlyMd2HtmlList(pszHtml, sizeLeft, &szLine);
+      type    = MD_BLOCK_TYPE_LIST;
+      level   = fIsNumeric ? 1 : 0;
+      szMdEnd = MdListEnd(szLine);
     }
 
     // Left | Middle | Right
     // :--- | :----: | ----:
     // a    |   b    |    c
-    else if(FlyMd2HtmlIsTable(szLine))
+    else if((level = MdTableGetCols(szLine, FLYMD2HTML_TABLE_COL_MAX, NULL)) != 0)
     {
-#if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isTable\n");
-#endif
-      thisLen = FlyMd2HtmlTable(pszHtml, sizeLeft, &szLine);
+      type    = MD_BLOCK_TYPE_TABLE;
+      szMdEnd = MdTableEnd(szLine);
     }
 
+    // paragraph, ends on blank line, or a line that starts a code block, heading or rule
     else
     {
+      type    = MD_BLOCK_TYPE_PARA;
+      szMdEnd = MdParaEnd(szLine);
+    }
+  }
+
+  pBlock->type      = type;
+  pBlock->level     = level;
+  pBlock->szMd      = szLine;
+  pBlock->szMdEnd   = szMdEnd ? szMdEnd : szLine;
+  pBlock->szBody    = szBody;
+  pBlock->szBodyEnd = szBodyEnd;
+  return szMdEnd;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Parse a markdown document into an array of blocks without converting it.
+
+  Example:
+
+  ```c
+  flyMdBlock_t  *aBlocks;
+  unsigned       nBlocks;
+
+  nBlocks = FlyMdParse(szMd, szMd + strlen(szMd), NULL, 0);
+  aBlocks = FlyAlloc(nBlocks * sizeof(*aBlocks));
+  FlyMdParse(szMd, szMd + strlen(szMd), aBlocks, nBlocks);
+  ```
+
+  @param  szMd        ptr to markdown
+  @param  szMdEnd     end of markdown
+  @param  aBlocks     array of blocks to fill in, or NULL to just count them
+  @param  maxBlocks   NumElements(aBlocks)
+  @return number of blocks in the markdown (may be larger than maxBlocks)
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyMdParse(const char *szMd, const char *szMdEnd, flyMdBlock_t *aBlocks, unsigned maxBlocks)
+{
+  flyMdBlock_t  block;
+  unsigned      nBlocks = 0;
+
+  while(szMd < szMdEnd)
+  {
+    szMd = FlyMdParseBlock(szMd, &block);
+    if(!szMd || block.szMd >= szMdEnd)
+      break;
+    if(aBlocks && nBlocks < maxBlocks)
+      aBlocks[nBlocks] = block;
+    ++nBlocks;
+  }
+
+  return nBlocks;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Convert one block parsed by FlyMdParseBlock() to HTML.
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  pBlock    a parsed block
+  @return len of resulting HTML, or 0 if nothing could be converted
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMdBlock2Html(char *szHtml, size_t size, const flyMdBlock_t *pBlock)
+{
+  const char *szLine  = pBlock->szMd;
+  size_t      htmlLen = 0;
+
 #if MD_DEBUG_CONTENT
-      if(fFlyMarkdownDebug)
-        FlyDbgPrintf("isPara\n");
+  if(fFlyMarkdownDebug)
+    FlyDbgPrintf("block type %u, level %u\n", pBlock->type, pBlock->level);
+#endif
+
+  switch(pBlock->type)
+  {
+    case MD_BLOCK_TYPE_HEADING:
+      htmlLen = MdHeadingMake(szHtml, size, pBlock->level, pBlock->szBody, pBlock->szBodyEnd, NULL, NULL);
+    break;
+    case MD_BLOCK_TYPE_BLOCK_QUOTE:
+      htmlLen = MdBlockQuoteMake(szHtml, size, pBlock->szMd, pBlock->szMdEnd);
+    break;
+    case MD_BLOCK_TYPE_HORZ_RULE:
+      htmlLen = FlyStrZCpy(szHtml, m_szHtmlHorzRule, size);
+    break;
+    case MD_BLOCK_TYPE_CODE_BLK:
+      htmlLen = MdCodeBlkMake(szHtml, size, pBlock->szMd, pBlock->szBody, pBlock->szBodyEnd,
+                              pBlock->level ? TRUE : FALSE, NULL, NULL);
+    break;
+    case MD_BLOCK_TYPE_LIST:
+      if(size > 1)
+      {
+        if(szHtml)
+          *szHtml = '\0';
+        htmlLen = MdListMake(szHtml, size, &szLine, pBlock->szMdEnd,
+                             pBlock->level ? FLY_MD_LIST_TYPE_ORDERED : FLY_MD_LIST_TYPE_UNORDERED,
+                             FlyStrLineIndent(pBlock->szMd, FLY_STR_TAB_SIZE), 0);
+      }
+    break;
+    case MD_BLOCK_TYPE_TABLE:
+      if(szHtml)
+        *szHtml = '\0';
+      htmlLen = MdTableMake(szHtml, size, pBlock->szMd, pBlock->szMdEnd);
+    break;
+    case MD_BLOCK_TYPE_PARA:
+      htmlLen = MdParaMake(szHtml, size, pBlock->szMd, pBlock->szMdEnd);
+    break;
+    default:
+    break;
+  }
+
+  return htmlLen;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Convert one block of markdown (heading, block quote, horizontal rule, code block, list, table or
+  paragraph) to HTML.
+
+  On input, *ppszMd must point to the start of a line. Any blank lines are skipped. ppszMd is both
+  input and output. It is advanced to the line after the block.
+
+  The output of a block depends only on the markdown from *ppszMd forward, which is what allows
+  FlyMdDoc to re-render only those blocks affected by an edit.
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  ppszMd    ptr to ptr to markdown string, advanced forward
+  @return len of resulting HTML, or 0 if nothing could be converted
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlBlock(char *szHtml, size_t size, const char **ppszMd)
+{
+  flyMdBlock_t  block;
+  size_t        thisLen = 0;
+
+  if(FlyMdParseBlock(*ppszMd, &block))
+  {
+#if MD_DEBUG_CONTENT
+    if(fFlyMarkdownDebug && g_szMd)
+    {
+      unsigned  row, col;
+      row = FlyStrLinePos(g_szMd, block.szMd, &col);
+      FlyDbgPrintf("\n-- %u:%u: %.*s\n", row, col, (int)FlyStrLineLen(block.szMd), block.szMd);
+    }
+#endif
+    thisLen = FlyMdBlock2Html(szHtml, size, &block);
+  }
+
+  if(thisLen)
+    *ppszMd = block.szMdEnd;
+  return thisLen;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Convert markdown string to an HTML string using W3.CSS. Does not contain front/end matter.
+
+  Note: this is expected to put content inside a W3.CSS HTML framework.
+
+  @param  szHtml    ptr to char buffer or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml) or SIZE_MAX
+  @param  szMd      ptr to HTML string
+  @return len of resulting HTML (1-n)
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlContent(char *szHtml, size_t size, const char *szMd, const char *szMdEnd)
+{
+  return FlyMd2HtmlContentEx(szHtml, size, szMd, szMdEnd, NULL);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Same as FlyMd2HtmlContent(), but also collects a heading index in the same pass, which can be
+  used to make a table of contents with FlyMd2HtmlToc().
+
+  pToc->aHeadings may be NULL to just count headings. pToc->nHeadings is the number of headings
+  found, which may be more than pToc->maxHeadings. Only the first maxHeadings are filled in.
+  Offsets in each heading are from szHtml.
+
+  @param  szHtml    ptr to char buffer or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml) or SIZE_MAX
+  @param  szMd      ptr to HTML string
+  @param  szMdEnd   end of markdown
+  @param  pToc      heading index to fill in, or NULL
+  @return len of resulting HTML (1-n)
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlContentEx(char *szHtml, size_t size, const char *szMd, const char *szMdEnd, flyMdToc_t *pToc)
+{
+  const char     *szLine;
+  char           *pszHtml   = szHtml;
+  size_t          htmlLen   = 0;
+  size_t          sizeLeft  = size;
+  size_t          thisLen;
+  flyMdBlock_t    block;
+  flyMdHeading_t  heading;
+
+  // for debugging, only set if debugging so multiple threads can convert markdown at once
+  if(fFlyMarkdownDebug)
+    g_szMd = szMd;
+
+  // need room for terminating '\0'
+  if(size == SIZE_MAX)
+    --size;
+
+  if(pToc)
+    pToc->nHeadings = 0;
+
+#if MD_DEBUG_CONTENT > 1
+  FlyDbgPrintf("FlyMd2HtmlContentEx(szHtml=%p, size %zu, szMd=%p, szMdEnd=%p)\n", szHtml, size, szMd, szMdEnd);
 #endif
-      thisLen = FlyMd2HtmlPara(pszHtml, sizeLeft, &szLine);
+
+  szLine = szMd;
+  while(*szLine && szLine < szMdEnd)
+  {
+    // skips empty lines to get to something interesting
+    if(!FlyMdParseBlock(szLine, &block) || block.szMd >= szMdEnd)
+      break;
+    szLine = block.szMdEnd;
+
+    // headings are indexed as they are converted
+    if(pToc && block.type == MD_BLOCK_TYPE_HEADING)
+    {
+      thisLen = MdHeadingMake(pszHtml, sizeLeft, block.level, block.szBody, block.szBodyEnd, NULL, &heading);
+      if(thisLen)
+      {
+        heading.htmlOffset  = htmlLen;
+        heading.slugOffset += htmlLen;
+        if(pToc->aHeadings && pToc->nHeadings < pToc->maxHeadings)
+          pToc->aHeadings[pToc->nHeadings] = heading;
+        ++pToc->nHeadings;
+      }
     }
+    else
+      thisLen = FlyMdBlock2Html(pszHtml, sizeLeft, &block);
 
 #if MD_DEBUG_CONTENT > 1
       if(szHtml)
@@ -2781,22 +3367,122 @@ size_t FlyMd2HtmlContent(char *szHtml, size_t size, const char *szMd, const char
 
     htmlLen += thisLen;
     if(szHtml)
+    {
+      // HTML buffer is full, don't write past it
+      if(thisLen + 1 >= sizeLeft)
+        break;
       pszHtml += thisLen;
+    }
     if(thisLen > sizeLeft)
       thisLen = sizeLeft;
     sizeLeft -= thisLen;
   }
 
   // done
-  g_szMd = NULL;
+  if(fFlyMarkdownDebug)
+    g_szMd = NULL;
 
 #if MD_DEBUG_CONTENT
-  FlyDbgPrintf("End FlyMd2HtmlContent() => htmlLen %zu\n\n", htmlLen);  
+  FlyDbgPrintf("End FlyMd2HtmlContentEx() => htmlLen %zu\n\n", htmlLen);  
 #endif
 
   return htmlLen;
 }
 
+/*!------------------------------------------------------------------------------------------------
+  Make a nested table of contents from the heading index collected by FlyMd2HtmlContentEx(). Each
+  entry links to its heading by slug.
+
+      <ul>
+      <li><a href="#title">Title</a>
+      <ul>
+      <li><a href="#sub-title">Sub Title</a></li>
+      </ul></li>
+      </ul>
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  pToc      heading index from FlyMd2HtmlContentEx()
+  @param  maxLevel  deepest heading level to include, 1-6, e.g. 3 includes #, ## and ###
+  @return len of resulting HTML, 0 if no headings
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlToc(char *szHtml, size_t size, const flyMdToc_t *pToc, unsigned maxLevel)
+{
+  static const char     szListOpen[]    = "<ul>\r\n";
+  static const char     szListClose[]   = "</ul>";
+  static const char     szItemOpen[]    = "<li><a href=\"#";
+  static const char     szItemMiddle[]  = "\">";
+  static const char     szItemClose[]   = "</li>\r\n";
+  const flyMdHeading_t *pHeading;
+  unsigned              aLevels[6];
+  unsigned              depth   = 0;
+  unsigned              nHeadings;
+  unsigned              i;
+  size_t                htmlLen = 0;
+
+  if(szHtml && size)
+    *szHtml = '\0';
+
+  nHeadings = pToc->nHeadings;
+  if(nHeadings > pToc->maxHeadings)
+    nHeadings = pToc->maxHeadings;
+  for(i = 0; pToc->aHeadings && i < nHeadings; ++i)
+  {
+    pHeading = &pToc->aHeadings[i];
+    if(pHeading->level > maxLevel)
+      continue;
+
+    // deeper heading nests a list inside the open item, otherwise close only those lists whose
+    // parent item is at the same level or deeper, e.g. # A, ### C, ## B nests both C and B in A
+    if(depth == 0 || pHeading->level > aLevels[depth - 1])
+    {
+      if(depth)
+        htmlLen += FlyStrZCat(szHtml, "\r\n", size);
+      htmlLen += FlyStrZCat(szHtml, szListOpen, size);
+      aLevels[depth++] = pHeading->level;
+    }
+    else
+    {
+      htmlLen += FlyStrZCat(szHtml, szItemClose, size);
+      while(depth > 1 && pHeading->level <= aLevels[depth - 2])
+      {
+        htmlLen += FlyStrZCat(szHtml, szListClose, size);
+        htmlLen += FlyStrZCat(szHtml, szItemClose, size);
+        --depth;
+      }
+      aLevels[depth - 1] = pHeading->level;
+    }
+    szHtml = MdAdjust(szHtml, &size);
+
+    // <li><a href="#slug">Heading Text</a>
+    htmlLen += FlyStrZCpy(szHtml, szItemOpen, size);
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyStrSlug(szHtml, pHeading->szText, size, pHeading->textLen);
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyStrZCpy(szHtml, szItemMiddle, size);
+    szHtml = MdAdjust(szHtml, &size);
+    htmlLen += FlyStrHtmlEscape(szHtml, pHeading->szText, size, pHeading->textLen, FLYSTR_HTML_LT | FLYSTR_HTML_AMP);
+    htmlLen += FlyStrZCat(szHtml, "</a>", size);
+    szHtml = MdAdjust(szHtml, &size);
+  }
+
+  // close any open items and lists
+  if(depth)
+  {
+    htmlLen += FlyStrZCat(szHtml, szItemClose, size);
+    while(depth > 1)
+    {
+      htmlLen += FlyStrZCat(szHtml, szListClose, size);
+      htmlLen += FlyStrZCat(szHtml, szItemClose, size);
+      --depth;
+    }
+    htmlLen += FlyStrZCat(szHtml, szListClose, size);
+    htmlLen += FlyStrZCat(szHtml, "\r\n", size);
+  }
+
+  return htmlLen;
+}
+
 /*!------------------------------------------------------------------------------------------------
   Write the head of an HTML file to the szHtml string
 
@@ -2863,7 +3549,85 @@ size_t FlyMd2HtmlFile(char *szHtml, size_t size, const char *szMd, const char *s
 
   htmlLen += FlyMd2HtmlHead(szHtml, size, szTitle);
   htmlLen += FlyMd2HtmlContent(szHtml ? &szHtml[htmlLen] : szHtml, size - htmlLen, szMd, szMd + strlen(szMd));
+  if(szHtml && htmlLen >= size)
+    return htmlLen;
   htmlLen += FlyMd2HtmlEnd(szHtml ? &szHtml[htmlLen] : szHtml, size - htmlLen);
 
   return htmlLen;
 }
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyMd2HtmlFileToc(). Returns the most headings there could be in the markdown, which is
+  the number of lines that start with `#`, `=` or `-`.
+*///-----------------------------------------------------------------------------------------------
+static unsigned MdTocMaxHeadings(const char *szMd)
+{
+  const char *szLine  = szMd;
+  unsigned    n       = 0;
+
+  while(*szLine)
+  {
+    if(*szLine == '#' || *szLine == '=' || *szLine == '-')
+      ++n;
+    szLine = FlyStrLineNext(szLine);
+  }
+  return n;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Same as FlyMd2HtmlFile(), but with a nested table of contents at the top, before the content.
+
+  The markdown is rendered only once. The headings are indexed while rendering, then the content is
+  moved down to make room for the table of contents.
+
+  @param  szHtml    ptr to char array or NULL to just get size of resulting HTML
+  @param  size      sizeof(szHtml)
+  @param  szMd      ptr to markdown string
+  @param  szTitle   optional Title, may be NULL for "No Title"
+  @param  maxLevel  deepest heading level to include in table of contents, 1-6
+  @return len of resulting HTML (1-n), or 0 if out of memory
+*///-----------------------------------------------------------------------------------------------
+size_t FlyMd2HtmlFileToc(char *szHtml, size_t size, const char *szMd, const char *szTitle, unsigned maxLevel)
+{
+  flyMdToc_t  toc;
+  size_t      headLen;
+  size_t      tocLen;
+  size_t      contentLen;
+  size_t      moveLen;
+  size_t      htmlLen;
+  char        c;
+
+  memset(&toc, 0, sizeof(toc));
+  toc.maxHeadings = MdTocMaxHeadings(szMd);
+  if(toc.maxHeadings)
+  {
+    toc.aHeadings = FlyAlloc(toc.maxHeadings * sizeof(flyMdHeading_t));
+    if(!toc.aHeadings)
+      return 0;
+  }
+
+  // render head and content, indexing headings along the way
+  htmlLen = headLen = FlyMd2HtmlHead(szHtml, size, szTitle);
+  contentLen = FlyMd2HtmlContentEx(szHtml ? &szHtml[headLen] : szHtml, size - headLen, szMd, szMd + strlen(szMd), &toc);
+  tocLen = FlyMd2HtmlToc(NULL, SIZE_MAX, &toc, maxLevel);
+
+  // move content down to make room for the table of contents, truncating if needed
+  if(szHtml && headLen + tocLen < size)
+  {
+    moveLen = contentLen;
+    if(headLen + tocLen + moveLen >= size)
+      moveLen = size - 1 - headLen - tocLen;
+    memmove(&szHtml[headLen + tocLen], &szHtml[headLen], moveLen);
+    szHtml[headLen + tocLen + moveLen] = '\0';
+    c = szHtml[headLen + tocLen];
+    FlyMd2HtmlToc(&szHtml[headLen], tocLen + 1, &toc, maxLevel);
+    szHtml[headLen + tocLen] = c;
+  }
+  htmlLen += tocLen + contentLen;
+  if(!szHtml || htmlLen < size)
+    htmlLen += FlyMd2HtmlEnd(szHtml ? &szHtml[htmlLen] : szHtml, size - htmlLen);
+
+  FlyFreeIf(toc.aHeadings);
+
+  return htmlLen;
+}
@@ -0,0 +1,600 @@
+/**************************************************************************************************
+  FlyMarkdownDoc.c - Incremental markdown to HTML rendering for documents being edited
+  Copyright 2024 Drew Gislason
+  license: <https://mit-license.org>
+**************************************************************************************************/
+#include "FlyMarkdown.h"
+#include "FlyMem.h"
+#include "FlyStr.h"
+
+/*!
+  @defgroup FlyMdDoc  Incremental markdown to HTML for editors with a live preview
+
+  Editors built on flylibc can keep a live HTML preview of the markdown being edited. Calling
+  FlyMd2HtmlFile() on every keystroke re-renders the whole document. A FlyMdDoc instead keeps the
+  document as a list of blocks (headings, paragraphs, lists, tables, code blocks, etc...), each
+  with a hash of its markdown and its cached HTML. An edit only re-parses and re-renders the
+  blocks it touches, so preview latency is proportional to the size of the edit, not the size of
+  the document.
+
+  How an edit is processed:
+
+  1. The markdown text is updated in place
+  2. The first block whose markdown (plus the lines after it that the renderer examines) overlaps
+     the edit is found with a binary search
+  3. Blocks are re-parsed from there until a new block starts exactly where an old block after
+     the edit starts. From that point on the markdown is identical, so the old blocks are kept
+  4. Re-parsed blocks whose hash and length match the old block at the same position reuse the
+     cached HTML rather than being rendered again
+
+  Fenced code blocks need no special case: an unterminated "```" block extends to the end of the
+  document, so opening or closing a fence naturally widens the re-parse until the block
+  boundaries line up again. FlyMarkdown has no deferred `[text][ref]` links, and footnote ids are
+  made from the footnote's own text, so no block's HTML depends on a definition elsewhere.
+
+  The HTML is always identical to FlyMd2HtmlContent() on the entire markdown document.
+
+  @example FlyMdDoc  Keep a live preview up to date
+
+  ```c
+  #include "FlyMarkdown.h"
+
+  void *hDoc = FlyMdDocNew("# Title\n\nSome text\n");
+  FlyMdDocEdit(hDoc, 17, 4, "words", 5);   // "text" becomes "words"
+  printf("%s", FlyMdDocHtml(hDoc, NULL));
+  FlyMdDocFree(hDoc);
+  ```
+*/
+
+#define FLY_MDDOC_SANCHK    7351
+#define MDDOC_LOOKAHEAD     2       // lines after a block the renderer may examine
+#define MDDOC_BLOCKS_MIN    16
+
+typedef struct
+{
+  size_t          offset;           // offset of block in markdown
+  size_t          len;              // length of block markdown
+  size_t          spanLen;          // len + lookahead lines: all markdown this block's HTML depends on
+  uint64_t        hash;             // hash of the span
+  char           *szHtml;           // cached HTML for this block
+  size_t          htmlLen;
+} mdDocBlock_t;
+
+typedef struct
+{
+  unsigned        sanchk;
+  char           *szMd;             // markdown, always '\0' terminated
+  size_t          mdLen;
+  size_t          mdSize;
+  mdDocBlock_t   *aBlocks;
+  unsigned        nBlocks;
+  unsigned        maxBlocks;
+  char           *szHtml;           // all blocks combined, rebuilt only when needed
+  size_t          htmlLen;
+  bool_t          fHtmlDirty;
+  unsigned        nRendered;        // # of blocks rendered by last FlyMdDocNew() or FlyMdDocEdit()
+} flyMdDoc_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Hash a span of markdown (64-bit FNV-1a).
+
+  @param  p       ptr to markdown
+  @param  len     length of markdown
+  @return the hash
+*///-----------------------------------------------------------------------------------------------
+static uint64_t MdDocHash(const char *p, size_t len)
+{
+  uint64_t  hash = 14695981039346656037ULL;
+
+  while(len)
+  {
+    hash ^= (uint8_t)*p++;
+    hash *= 1099511628211ULL;
+    --len;
+  }
+
+  return hash;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Make sure there is room for at least n blocks.
+
+  @param  pDoc    ptr to a valid doc
+  @param  n       number of blocks needed
+  @return TRUE if worked, FALSE if out of memory
+*///-----------------------------------------------------------------------------------------------
+static bool_t MdDocBlocksNeed(flyMdDoc_t *pDoc, unsigned n)
+{
+  mdDocBlock_t   *aBlocks;
+  unsigned        maxBlocks;
+  bool_t          fWorked = TRUE;
+
+  if(n > pDoc->maxBlocks)
+  {
+    maxBlocks = pDoc->maxBlocks ? pDoc->maxBlocks : MDDOC_BLOCKS_MIN;
+    while(maxBlocks < n)
+      maxBlocks *= 2;
+    aBlocks = FlyRealloc(pDoc->aBlocks, maxBlocks * sizeof(mdDocBlock_t));
+    if(!aBlocks)
+      fWorked = FALSE;
+    else
+    {
+      pDoc->aBlocks   = aBlocks;
+      pDoc->maxBlocks = maxBlocks;
+    }
+  }
+
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Parse one block starting at offset (which may be at blank lines). Does not render it.
+
+  @param  pDoc      ptr to a valid doc
+  @param  offset    where to start looking for a block
+  @param  pBlock    returned block, with offset, len, spanLen and hash filled in
+  @return TRUE if a block was found, FALSE if at end of markdown
+*///-----------------------------------------------------------------------------------------------
+static bool_t MdDocParse(flyMdDoc_t *pDoc, size_t offset, mdDocBlock_t *pBlock)
+{
+  flyMdBlock_t  mdBlock;
+  const char   *szSpanEnd;
+  unsigned      i;
+  bool_t        fFound  = FALSE;
+
+  szSpanEnd = FlyMdParseBlock(&pDoc->szMd[offset], &mdBlock);
+  if(szSpanEnd && szSpanEnd > mdBlock.szMd)
+  {
+    for(i = 0; i < MDDOC_LOOKAHEAD; ++i)
+      szSpanEnd = FlyStrLineNext(szSpanEnd);
+
+    memset(pBlock, 0, sizeof(*pBlock));
+    pBlock->offset  = (size_t)(mdBlock.szMd - pDoc->szMd);
+    pBlock->len     = (size_t)(mdBlock.szMdEnd - mdBlock.szMd);
+    pBlock->spanLen = (size_t)(szSpanEnd - mdBlock.szMd);
+    pBlock->hash    = MdDocHash(mdBlock.szMd, pBlock->spanLen);
+    fFound = TRUE;
+  }
+
+  return fFound;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Render the HTML for a parsed block.
+
+  @param  pDoc      ptr to a valid doc
+  @param  pBlock    a block filled in by MdDocParse()
+  @return TRUE if worked, FALSE if out of memory
+*///-----------------------------------------------------------------------------------------------
+static bool_t MdDocRender(flyMdDoc_t *pDoc, mdDocBlock_t *pBlock)
+{
+  flyMdBlock_t  mdBlock;
+  bool_t        fWorked = FALSE;
+
+  FlyMdParseBlock(&pDoc->szMd[pBlock->offset], &mdBlock);
+  pBlock->htmlLen = FlyMdBlock2Html(NULL, SIZE_MAX - 1, &mdBlock);
+  pBlock->szHtml  = FlyAlloc(pBlock->htmlLen + 1);
+  if(pBlock->szHtml)
+  {
+    *pBlock->szHtml = '\0';
+    FlyMdBlock2Html(pBlock->szHtml, pBlock->htmlLen + 1, &mdBlock);
+    ++pDoc->nRendered;
+    fWorked = TRUE;
+  }
+
+  return fWorked;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Free the cached HTML in a range of blocks.
+
+  @param  pDoc      ptr to a valid doc
+  @param  first     first block to free
+  @param  last      1 past last block to free
+  @return none
+*///-----------------------------------------------------------------------------------------------
+static void MdDocBlocksFree(flyMdDoc_t *pDoc, unsigned first, unsigned last)
+{
+  while(first < last)
+  {
+    if(pDoc->aBlocks[first].szHtml)
+    {
+      FlyFree(pDoc->aBlocks[first].szHtml);
+      pDoc->aBlocks[first].szHtml = NULL;
+    }
+    ++first;
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Re-parse and re-render blocks after an edit.
+
+  Old blocks [iFirst, iClean) overlap the edit. Old blocks [iClean, nBlocks) are after the edit
+  and have already been shifted to their new offsets.
+
+  @param  pDoc      ptr to a valid doc
+  @param  iFirst    first block affected by the edit
+  @param  iClean    first block after the edit
+  @param  editOff   offset of the edit (unchanged blocks before this keep their offset)
+  @return TRUE if worked, FALSE if out of memory
+*///-----------------------------------------------------------------------------------------------
+static bool_t MdDocReparse(flyMdDoc_t *pDoc, unsigned iFirst, unsigned iClean, size_t editOff)
+{
+  mdDocBlock_t   *aNew      = NULL;
+  mdDocBlock_t   *pOld;
+  mdDocBlock_t    block;
+  unsigned        nNew      = 0;
+  unsigned        maxNew    = 0;
+  unsigned        j         = iFirst;
+  unsigned        nKept;
+  size_t          offset;
+  size_t          oldOffset;
+  bool_t          fResync   = FALSE;
+  bool_t          fWorked   = TRUE;
+
+  offset = iFirst ? pDoc->aBlocks[iFirst - 1].offset + pDoc->aBlocks[iFirst - 1].len : 0;
+  while(MdDocParse(pDoc, offset, &block))
+  {
+    // old blocks that start before this one were merged into a previous block or deleted
+    while(j < pDoc->nBlocks)
+    {
+      oldOffset = pDoc->aBlocks[j].offset;
+      if(j < iClean && oldOffset >= editOff)
+        ++j;
+      else if(oldOffset < block.offset)
+        ++j;
+      else
+        break;
+    }
+
+    // block boundaries line up again after the edit, the rest of the old blocks are still good
+    if(j >= iClean && j < pDoc->nBlocks && pDoc->aBlocks[j].offset == block.offset)
+    {
+      fResync = TRUE;
+      break;
+    }
+
+    // same markdown at same place, reuse the HTML
+    pOld = (j < pDoc->nBlocks) ? &pDoc->aBlocks[j] : NULL;
+    if(pOld && pOld->szHtml && pOld->offset == block.offset && pOld->hash == block.hash &&
+       pOld->len == block.len && pOld->spanLen == block.spanLen)
+    {
+      block.szHtml  = pOld->szHtml;
+      block.htmlLen = pOld->htmlLen;
+      pOld->szHtml  = NULL;
+    }
+    else if(!MdDocRender(pDoc, &block))
+    {
+      fWorked = FALSE;
+      break;
+    }
+
+    if(nNew >= maxNew)
+    {
+      maxNew = maxNew ? 2 * maxNew : MDDOC_BLOCKS_MIN;
+      pOld = FlyRealloc(aNew, maxNew * sizeof(mdDocBlock_t));
+      if(!pOld)
+      {
+        FlyFree(block.szHtml);
+        fWorked = FALSE;
+        break;
+      }
+      aNew = pOld;
+    }
+    aNew[nNew++] = block;
+    offset = block.offset + block.len;
+  }
+
+  // failed, HTML would be incomplete, so drop all blocks
+  if(!fWorked)
+  {
+    MdDocBlocksFree(pDoc, 0, pDoc->nBlocks);
+    pDoc->nBlocks = 0;
+  }
+
+  // splice new blocks in between the blocks before and after the edit
+  else
+  {
+    if(!fResync)
+      j = pDoc->nBlocks;
+    MdDocBlocksFree(pDoc, iFirst, j);
+    nKept = pDoc->nBlocks - j;
+    if(!MdDocBlocksNeed(pDoc, iFirst + nNew + nKept))
+      fWorked = FALSE;
+    else
+    {
+      if(nKept)
+        memmove(&pDoc->aBlocks[iFirst + nNew], &pDoc->aBlocks[j], nKept * sizeof(mdDocBlock_t));
+      if(nNew)
+        memcpy(&pDoc->aBlocks[iFirst], aNew, nNew * sizeof(mdDocBlock_t));
+      pDoc->nBlocks = iFirst + nNew + nKept;
+    }
+  }
+
+  if(aNew)
+  {
+    if(!fWorked)
+    {
+      while(nNew)
+        FlyFreeIf(aNew[--nNew].szHtml);
+    }
+    FlyFree(aNew);
+  }
+  pDoc->fHtmlDirty = TRUE;
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Create a new markdown document for incremental rendering. The markdown is copied, then fully
+  rendered.
+
+  @param  szMd    markdown text, may be NULL or "" for an empty document
+  @return handle to the document, or NULL if out of memory
+*///-----------------------------------------------------------------------------------------------
+void * FlyMdDocNew(const char *szMd)
+{
+  flyMdDoc_t   *pDoc;
+
+  pDoc = FlyAlloc(sizeof(*pDoc));
+  if(pDoc)
+  {
+    memset(pDoc, 0, sizeof(*pDoc));
+    pDoc->sanchk      = FLY_MDDOC_SANCHK;
+    pDoc->fHtmlDirty  = TRUE;
+    pDoc->mdSize      = 1;
+    pDoc->szMd        = FlyAllocZ(pDoc->mdSize);
+    if(!pDoc->szMd || !FlyMdDocEdit(pDoc, 0, 0, szMd, szMd ? strlen(szMd) : 0))
+      pDoc = FlyMdDocFree(pDoc);
+  }
+
+  return pDoc;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Is this a valid markdown document handle?
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @return TRUE if valid document
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyMdDocIsDoc(void *hDoc)
+{
+  flyMdDoc_t   *pDoc = hDoc;
+  return (pDoc && pDoc->sanchk == FLY_MDDOC_SANCHK) ? TRUE : FALSE;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Free a markdown document and all its cached HTML.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @return NULL
+*///-----------------------------------------------------------------------------------------------
+void * FlyMdDocFree(void *hDoc)
+{
+  flyMdDoc_t   *pDoc = hDoc;
+
+  if(FlyMdDocIsDoc(hDoc))
+  {
+    if(pDoc->aBlocks)
+    {
+      MdDocBlocksFree(pDoc, 0, pDoc->nBlocks);
+      FlyFree(pDoc->aBlocks);
+    }
+    FlyFreeIf(pDoc->szMd);
+    FlyFreeIf(pDoc->szHtml);
+    memset(pDoc, 0, sizeof(*pDoc));
+    FlyFree(pDoc);
+  }
+
+  return NULL;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Edit the markdown document: delete delLen bytes at offset, then insert szIns there. Only the
+  blocks affected by the edit are re-rendered.
+
+  To insert only, use delLen of 0. To delete only, use insLen of 0.
+
+  @param  hDoc      handle from FlyMdDocNew()
+  @param  offset    offset into markdown (0 - len)
+  @param  delLen    # of bytes to delete, truncated to end of markdown
+  @param  szIns     text to insert (need not be '\0' terminated), may be NULL if insLen is 0
+  @param  insLen    length of szIns
+  @return TRUE if worked, FALSE if bad parameters or out of memory
+*///-----------------------------------------------------------------------------------------------
+bool_t FlyMdDocEdit(void *hDoc, size_t offset, size_t delLen, const char *szIns, size_t insLen)
+{
+  flyMdDoc_t   *pDoc    = hDoc;
+  char         *szMd;
+  size_t        newLen;
+  size_t        mdSize;
+  size_t        editEnd;
+  unsigned      lo, hi, mid;
+  unsigned      iFirst;
+  unsigned      iClean;
+  unsigned      i;
+  bool_t        fWorked = FALSE;
+
+  if(FlyMdDocIsDoc(hDoc) && offset <= pDoc->mdLen && (szIns || insLen == 0))
+  {
+    fWorked = TRUE;
+    if(delLen > pDoc->mdLen - offset)
+      delLen = pDoc->mdLen - offset;
+    editEnd = offset + delLen;
+
+    // make room for new text
+    newLen = pDoc->mdLen - delLen + insLen;
+    if(newLen + 1 > pDoc->mdSize)
+    {
+      mdSize = pDoc->mdSize;
+      while(mdSize < newLen + 1)
+        mdSize *= 2;
+      szMd = FlyRealloc(pDoc->szMd, mdSize);
+      if(!szMd)
+        fWorked = FALSE;
+      else
+      {
+        pDoc->szMd   = szMd;
+        pDoc->mdSize = mdSize;
+      }
+    }
+
+    if(fWorked)
+    {
+      // change the markdown text, including the '\0' terminator
+      memmove(&pDoc->szMd[offset + insLen], &pDoc->szMd[editEnd], (pDoc->mdLen - editEnd) + 1);
+      if(insLen)
+        memcpy(&pDoc->szMd[offset], szIns, insLen);
+      pDoc->mdLen = newLen;
+
+      // find 1st block whose span reaches the edit (spans are in ascending order)
+      lo = 0;
+      hi = pDoc->nBlocks;
+      while(lo < hi)
+      {
+        mid = lo + (hi - lo) / 2;
+        if(pDoc->aBlocks[mid].offset + pDoc->aBlocks[mid].spanLen < offset)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      iFirst = lo;
+
+      // find 1st block that starts after the edit, and shift it and all following blocks
+      hi = pDoc->nBlocks;
+      while(lo < hi)
+      {
+        mid = lo + (hi - lo) / 2;
+        if(pDoc->aBlocks[mid].offset < editEnd)
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      iClean = lo;
+      for(i = iClean; i < pDoc->nBlocks; ++i)
+        pDoc->aBlocks[i].offset = (pDoc->aBlocks[i].offset - delLen) + insLen;
+
+      pDoc->nRendered = 0;
+      fWorked = MdDocReparse(pDoc, iFirst, iClean, offset);
+    }
+  }
+
+  return fWorked;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the current markdown text of the document.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @param  pLen    returned length of markdown, may be NULL
+  @return ptr to '\0' terminated markdown, valid until next FlyMdDocEdit(), or NULL if bad handle
+*///-----------------------------------------------------------------------------------------------
+const char * FlyMdDocMd(void *hDoc, size_t *pLen)
+{
+  flyMdDoc_t   *pDoc  = hDoc;
+  const char   *szMd  = NULL;
+
+  if(FlyMdDocIsDoc(hDoc))
+  {
+    szMd = pDoc->szMd;
+    if(pLen)
+      *pLen = pDoc->mdLen;
+  }
+
+  return szMd;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the HTML for the entire document. Same as FlyMd2HtmlContent() on the markdown.
+
+  Only the combined string is rebuilt (no rendering) if blocks have changed since the last call.
+  Editors that update their preview block by block can use FlyMdDocBlockHtml() instead.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @param  pLen    returned length of HTML, may be NULL
+  @return ptr to '\0' terminated HTML, valid until next FlyMdDocEdit(), or NULL if out of memory
+*///-----------------------------------------------------------------------------------------------
+const char * FlyMdDocHtml(void *hDoc, size_t *pLen)
+{
+  flyMdDoc_t   *pDoc    = hDoc;
+  const char   *szHtml  = NULL;
+  char         *psz;
+  size_t        htmlLen = 0;
+  unsigned      i;
+
+  if(FlyMdDocIsDoc(hDoc))
+  {
+    if(pDoc->fHtmlDirty)
+    {
+      for(i = 0; i < pDoc->nBlocks; ++i)
+        htmlLen += pDoc->aBlocks[i].htmlLen;
+      FlyFreeIf(pDoc->szHtml);
+      pDoc->szHtml = FlyAlloc(htmlLen + 1);
+      if(pDoc->szHtml)
+      {
+        psz = pDoc->szHtml;
+        for(i = 0; i < pDoc->nBlocks; ++i)
+        {
+          memcpy(psz, pDoc->aBlocks[i].szHtml, pDoc->aBlocks[i].htmlLen);
+          psz += pDoc->aBlocks[i].htmlLen;
+        }
+        *psz = '\0';
+        pDoc->htmlLen    = htmlLen;
+        pDoc->fHtmlDirty = FALSE;
+      }
+    }
+    szHtml = pDoc->szHtml;
+    if(szHtml && pLen)
+      *pLen = pDoc->htmlLen;
+  }
+
+  return szHtml;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the number of blocks (headings, paragraphs, lists, etc...) in the document.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @return number of blocks
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyMdDocNumBlocks(void *hDoc)
+{
+  flyMdDoc_t   *pDoc = hDoc;
+  return FlyMdDocIsDoc(hDoc) ? pDoc->nBlocks : 0;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the cached HTML for a single block.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @param  i       index of block (0 - FlyMdDocNumBlocks() - 1)
+  @param  pLen    returned length of HTML, may be NULL
+  @return ptr to '\0' terminated HTML, or NULL if bad handle or index
+*///-----------------------------------------------------------------------------------------------
+const char * FlyMdDocBlockHtml(void *hDoc, unsigned i, size_t *pLen)
+{
+  flyMdDoc_t   *pDoc    = hDoc;
+  const char   *szHtml  = NULL;
+
+  if(FlyMdDocIsDoc(hDoc) && i < pDoc->nBlocks)
+  {
+    szHtml = pDoc->aBlocks[i].szHtml;
+    if(pLen)
+      *pLen = pDoc->aBlocks[i].htmlLen;
+  }
+
+  return szHtml;
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Get the number of blocks rendered by the last FlyMdDocNew() or FlyMdDocEdit(). Useful for
+  verifying an edit was incremental.
+
+  @param  hDoc    handle from FlyMdDocNew()
+  @return number of blocks rendered
+*///-----------------------------------------------------------------------------------------------
+unsigned FlyMdDocRendered(void *hDoc)
+{
+  flyMdDoc_t   *pDoc = hDoc;
+  return FlyMdDocIsDoc(hDoc) ? pDoc->nRendered : 0;
+}
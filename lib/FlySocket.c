@@ -12,6 +12,7 @@
 #include <ifaddrs.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include "Fly.h"
@@ -32,6 +33,7 @@
 */
 #define FLY_SOCK_SANCHK         45454
 #define FLY_SOCK_ADDR_SANCHK    45455
+#define FLY_SOCK_IO_MAX         (1024L * 1024L * 1024L)  // max bytes per send()/recv() call
 
 typedef struct
 {
@@ -534,6 +536,129 @@ int FlySockSend(hFlySock_t hSock, hFlySockAddr_t hAddr, const uint8_t *pBuf, int
   return len;
 }
 
+/*------------------------------------------------------------------------------------------------
+  Get the TCP file descriptor for sending or receiving, the same one FlySockSend() and
+  FlySockReceive() would use. Returns -1 if not a TCP socket.
+------------------------------------------------------------------------------------------------*/
+static int SockTcpFd(sFlySock_t *pSock, sFlySockAddr_t *pAddr, bool_t fSend)
+{
+  int   sockFd = -1;
+
+  if(FlySockIsSock(pSock) && FlySockAddrIsAddr(pAddr) && pSock->fTcp)
+  {
+    if(fSend && !pSock->fServer)
+      sockFd = pSock->sAddr.sockFd;
+    else
+      sockFd = pAddr->sockFd;
+  }
+
+  return sockFd;
+}
+
+/*------------------------------------------------------------------------------------------------
+  After EINTR, or EAGAIN on a non-blocking socket, wait until the socket is ready again. Returns
+  FALSE if a real error.
+------------------------------------------------------------------------------------------------*/
+static bool_t SockRetry(sFlySock_t *pSock, int sockFd, short events)
+{
+  struct pollfd   pfd;
+
+  pSock->errNum = errno;
+  if(pSock->errNum == EINTR)
+    return TRUE;
+  if(pSock->errNum != EAGAIN && pSock->errNum != EWOULDBLOCK)
+    return FALSE;
+
+  pfd.fd      = sockFd;
+  pfd.events  = events;
+  pfd.revents = 0;
+  return (poll(&pfd, 1, -1) >= 0 || errno == EINTR) ? TRUE : FALSE;
+}
+
+/*!-----------------------------------------------------------------------------------------------
+  Send all of a buffer, of any size, on a TCP socket. Loops internally over send() in large
+  pieces, continuing after partial sends and interrupts, so a multi-GB buffer is one call. On a
+  non-blocking socket, waits for the socket to be writable rather than returning early.
+
+  TCP only, as UDP datagrams can't be split. For UDP use FlySockSend().
+
+  @param    hSock       The hSock returned from FlySockNew()
+  @param    hAddr       The hAddr returned from FlySockAccept() or FlySockAddrNew()
+  @param    pBuf        Buffer to send
+  @param    len         Length of buffer in bytes
+  @return   number of bytes sent, less than len if error or other side closed, see FlySockErrno()
+*///-----------------------------------------------------------------------------------------------
+size_t FlySockSendAll(hFlySock_t hSock, hFlySockAddr_t hAddr, const void *pBuf, size_t len)
+{
+  sFlySock_t       *pSock   = hSock;
+  const uint8_t    *p       = pBuf;
+  size_t            sent    = 0;
+  size_t            chunk;
+  ssize_t           n;
+  int               sockFd;
+
+  sockFd = SockTcpFd(hSock, hAddr, TRUE);
+  if(sockFd < 0 || !pBuf)
+    return 0;
+
+  pSock->errNum = 0;
+  while(sent < len)
+  {
+    chunk = len - sent;
+    if(chunk > FLY_SOCK_IO_MAX)
+      chunk = FLY_SOCK_IO_MAX;
+    n = send(sockFd, &p[sent], chunk, 0);
+    if(n > 0)
+      sent += (size_t)n;
+    else if(n == 0 || !SockRetry(pSock, sockFd, POLLOUT))
+      break;
+  }
+
+  return sent;
+}
+
+/*!-----------------------------------------------------------------------------------------------
+  Receive exactly len bytes on a TCP socket, of any size. Loops internally over recv() in large
+  pieces until the buffer is full, the other side closes or there is an error. On a non-blocking
+  socket, waits for more data rather than returning early.
+
+  TCP only. For UDP use FlySockReceive().
+
+  @param    hSock       The hSock returned from FlySockNew()
+  @param    hAddr       The hAddr returned from FlySockAccept() or FlySockAddrNew()
+  @param    pBuf        Buffer to hold received data
+  @param    len         Number of bytes to receive
+  @return   number of bytes received, less than len if error or other side closed
+*///-----------------------------------------------------------------------------------------------
+size_t FlySockReceiveAll(hFlySock_t hSock, hFlySockAddr_t hAddr, void *pBuf, size_t len)
+{
+  sFlySock_t       *pSock   = hSock;
+  uint8_t          *p       = pBuf;
+  size_t            got     = 0;
+  size_t            chunk;
+  ssize_t           n;
+  int               sockFd;
+
+  sockFd = SockTcpFd(hSock, hAddr, FALSE);
+  if(sockFd < 0 || !pBuf)
+    return 0;
+
+  pSock->errNum = 0;
+  while(got < len)
+  {
+    chunk = len - got;
+    if(chunk > FLY_SOCK_IO_MAX)
+      chunk = FLY_SOCK_IO_MAX;
+    n = recv(sockFd, &p[got], chunk, 0);
+    if(n > 0)
+      got += (size_t)n;
+    else if(n == 0 || !SockRetry(pSock, sockFd, POLLIN))
+      break;
+  }
+
+  return got;
+}
+
 /*!-----------------------------------------------------------------------------------------------
   Return last errno. Note a successful call will set this to 0.
 
@@ -3,6 +3,7 @@
   Copyright 2024 Drew Gislason  
   license: <https://mit-license.org>
 *///***********************************************************************************************
+#include "FlyMem.h"
 #include "FlySort.h"
 
 /*!
@@ -12,7 +13,9 @@
 
   * Sort any data types, both native and struct, unions
   * Bubble sort for smallest code (moves objects/data around)
-  * QSort for reasonably fast sort for random data (moves objects/data around)
+  * QSort for fast sort of any data (pattern-defeating quicksort, moves objects/data around)
+  * FLY_SORT_DEFINE() makes a typed sort with the compare inlined, fastest for arrays
+  * Radix sort for large arrays of integers, doubles or structs with a numeric key (stable)
   * Sort (via merge sort) linked list or array structures in-place. Links change only.
   * Provide comparison function (with arg if needed) to sort forward, backward or any criteria 
   * Prebuilt comparison functions for common built-in C types
@@ -89,24 +92,290 @@ void FlySortBubble(void *pArray, unsigned nElem, unsigned elemSize, pfnSortCmp_t
   }
 }
 
+typedef struct
+{
+  size_t          elemSize;
+  void           *pArg;
+  pfnSortCmpEx_t  pfnCmp;
+  bool_t          fWords;     // elements are size_t aligned and sized, swap by words
+} flySortQ_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Swap two elements of the array being sorted.
+-------------------------------------------------------------------------------------------------*/
+static inline void SortQSwap(const flySortQ_t *pQ, uint8_t *pThis, uint8_t *pThat)
+{
+  size_t   *pwThis;
+  size_t   *pwThat;
+  size_t    w;
+  size_t    size = pQ->elemSize;
+  uint8_t   tmp;
+
+  if(pThis == pThat)
+    return;
+  if(pQ->fWords)
+  {
+    pwThis = (size_t *)pThis;
+    pwThat = (size_t *)pThat;
+    do
+    {
+      w = *pwThis;
+      *pwThis++ = *pwThat;
+      *pwThat++ = w;
+    } while((size -= sizeof(size_t)) > 0);
+  }
+  else
+  {
+    do
+    {
+      tmp = *pThis;
+      *pThis++ = *pThat;
+      *pThat++ = tmp;
+    } while(--size > 0);
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Is pThis less than pThat?
+-------------------------------------------------------------------------------------------------*/
+static inline bool_t SortQLess(const flySortQ_t *pQ, const uint8_t *pThis, const uint8_t *pThat)
+{
+  return (pQ->pfnCmp(pQ->pArg, pThis, pThat) < 0) ? TRUE : FALSE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Sort 3 elements in place.
+-------------------------------------------------------------------------------------------------*/
+static void SortQSort3(const flySortQ_t *pQ, uint8_t *a, uint8_t *b, uint8_t *c)
+{
+  if(SortQLess(pQ, b, a))
+    SortQSwap(pQ, a, b);
+  if(SortQLess(pQ, c, b))
+  {
+    SortQSwap(pQ, b, c);
+    if(SortQLess(pQ, b, a))
+      SortQSwap(pQ, a, b);
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Insertion sort. Gives up (returns FALSE) if more than maxMoves elements are moved.
+-------------------------------------------------------------------------------------------------*/
+static bool_t SortQInsertion(const flySortQ_t *pQ, uint8_t *pBase, size_t n, size_t maxMoves)
+{
+  size_t    size  = pQ->elemSize;
+  size_t    moves = 0;
+  size_t    i, j;
+
+  for(i = 1; i < n; ++i)
+  {
+    for(j = i; j > 0 && SortQLess(pQ, pBase + j * size, pBase + (j - 1) * size); --j)
+      SortQSwap(pQ, pBase + j * size, pBase + (j - 1) * size);
+    moves += i - j;
+    if(moves > maxMoves)
+      return FALSE;
+  }
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Sift element k down the heap of n elements.
+-------------------------------------------------------------------------------------------------*/
+static void SortQSiftDown(const flySortQ_t *pQ, uint8_t *pBase, size_t k, size_t n)
+{
+  size_t    size = pQ->elemSize;
+  size_t    child;
+
+  while((child = 2 * k + 1) < n)
+  {
+    if(child + 1 < n && SortQLess(pQ, pBase + child * size, pBase + (child + 1) * size))
+      ++child;
+    if(!SortQLess(pQ, pBase + k * size, pBase + child * size))
+      break;
+    SortQSwap(pQ, pBase + k * size, pBase + child * size);
+    k = child;
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Heap sort, the fallback when partitions keep coming out unbalanced. Always O(n log n).
+-------------------------------------------------------------------------------------------------*/
+static void SortQHeapSort(const flySortQ_t *pQ, uint8_t *pBase, size_t n)
+{
+  size_t    i;
+
+  for(i = n / 2; i > 0; --i)
+    SortQSiftDown(pQ, pBase, i - 1, n);
+  while(n > 1)
+  {
+    --n;
+    SortQSwap(pQ, pBase, pBase + n * pQ->elemSize);
+    SortQSiftDown(pQ, pBase, 0, n);
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  The pattern-defeating quicksort loop. The pivot is kept at pBase[0] while partitioning, so no
+  temporary element is needed. Recurses on the smaller side, loops on the larger.
+-------------------------------------------------------------------------------------------------*/
+static void SortQLoop(const flySortQ_t *pQ, uint8_t *pBase, size_t n, unsigned badAllowed, bool_t fLeftmost)
+{
+  size_t    size = pQ->elemSize;
+  size_t    i, j, mid, nLeft, nRight;
+  bool_t    fPartitioned;
+
+  #define SQ(k)   (pBase + (k) * size)
+
+  while(n > FLY_SORT_INSERTION_MAX)
+  {
+    // choose pivot, move it to pBase[0]
+    mid = n / 2;
+    if(n > FLY_SORT_NINTHER_MIN)
+    {
+      SortQSort3(pQ, SQ(0), SQ(mid), SQ(n - 1));
+      SortQSort3(pQ, SQ(1), SQ(mid - 1), SQ(n - 2));
+      SortQSort3(pQ, SQ(2), SQ(mid + 1), SQ(n - 3));
+      SortQSort3(pQ, SQ(mid - 1), SQ(mid), SQ(mid + 1));
+      SortQSwap(pQ, SQ(0), SQ(mid));
+    }
+    else
+      SortQSort3(pQ, SQ(mid), SQ(0), SQ(n - 1));
+
+    // pivot is equal to the element just left of this range: put all equal elements on the left
+    // and skip them, so many duplicate keys sort in linear time
+    if(!fLeftmost && !SortQLess(pQ, pBase - size, SQ(0)))
+    {
+      i = 0;
+      j = n;
+      while(SortQLess(pQ, SQ(0), SQ(--j)))
+        ;
+      if(j + 1 == n)
+        while(i < j && !SortQLess(pQ, SQ(0), SQ(++i)))
+          ;
+      else
+        while(!SortQLess(pQ, SQ(0), SQ(++i)))
+          ;
+      while(i < j)
+      {
+        SortQSwap(pQ, SQ(i), SQ(j));
+        while(SortQLess(pQ, SQ(0), SQ(--j)))
+          ;
+        while(!SortQLess(pQ, SQ(0), SQ(++i)))
+          ;
+      }
+      SortQSwap(pQ, SQ(0), SQ(j));
+      pBase = SQ(j + 1);
+      n    -= j + 1;
+      continue;
+    }
+
+    // partition: less than pivot on the left, greater or equal on the right
+    i = 0;
+    j = n;
+    while(SortQLess(pQ, SQ(++i), SQ(0)))
+      ;
+    if(i == 1)
+      while(i < j && !SortQLess(pQ, SQ(--j), SQ(0)))
+        ;
+    else
+      while(!SortQLess(pQ, SQ(--j), SQ(0)))
+        ;
+    fPartitioned = (i >= j) ? TRUE : FALSE;
+    while(i < j)
+    {
+      SortQSwap(pQ, SQ(i), SQ(j));
+      while(SortQLess(pQ, SQ(++i), SQ(0)))
+        ;
+      while(!SortQLess(pQ, SQ(--j), SQ(0)))
+        ;
+    }
+    mid = i - 1;
+    SortQSwap(pQ, SQ(0), SQ(mid));
+    nLeft  = mid;
+    nRight = n - mid - 1;
+
+    // unbalanced: shuffle a few elements to break the pattern, or give up and heap sort
+    if(nLeft < n / 8 || nRight < n / 8)
+    {
+      if(--badAllowed == 0)
+      {
+        SortQHeapSort(pQ, pBase, n);
+        return;
+      }
+      if(nLeft >= FLY_SORT_INSERTION_MAX)
+      {
+        SortQSwap(pQ, SQ(0), SQ(nLeft / 4));
+        SortQSwap(pQ, SQ(mid - 1), SQ(mid - nLeft / 4));
+      }
+      if(nRight >= FLY_SORT_INSERTION_MAX)
+      {
+        SortQSwap(pQ, SQ(mid + 1), SQ(mid + 1 + nRight / 4));
+        SortQSwap(pQ, SQ(n - 1), SQ(n - nRight / 4));
+      }
+    }
+
+    // no swaps needed, likely already sorted: check cheaply with a limited insertion sort
+    else if(fPartitioned && SortQInsertion(pQ, pBase, nLeft, FLY_SORT_PARTIAL_MOVES) &&
+            SortQInsertion(pQ, SQ(mid + 1), nRight, FLY_SORT_PARTIAL_MOVES))
+      return;
+
+    if(nLeft < nRight)
+    {
+      SortQLoop(pQ, pBase, nLeft, badAllowed, fLeftmost);
+      pBase     = SQ(mid + 1);
+      n         = nRight;
+      fLeftmost = FALSE;
+    }
+    else
+    {
+      SortQLoop(pQ, SQ(mid + 1), nRight, badAllowed, FALSE);
+      n = nLeft;
+    }
+  }
+
+  #undef SQ
+
+  SortQInsertion(pQ, pBase, n, SIZE_MAX);
+}
+
 /*!------------------------------------------------------------------------------------------------
-  This is just another name for the librarys qsort_r.
+  Sort an array using a compare function with an argument. Not a stable sort.
 
-  NOTE: manpages are often wrong on the order of arguments for the compare function. The correct
-  order is:
+  This is a pattern-defeating quicksort (pdqsort): median-of-3 (or 9) pivots, insertion sort for
+  small ranges, linear time for already sorted input or many equal keys, and a heap sort fallback
+  so the worst case is O(n log n). It doesn't use the library qsort_r(), whose compare argument
+  order differs between glibc and BSD/macOS.
+
+  The correct order for the compare function is:
 
       typedef int  (*pfnSortCmpEx_t)  (void *pArg, const void *pThis, const void *pThat);
 
+  For arrays of a known type, FLY_SORT_DEFINE() in FlySort.h makes a faster, inlined sort.
+
   @param  pArray    ptr to array of items
   @param  nElem     number of elements in the array
   @param  elemSize  size of each element
-  @param  pfnCmp    compare function
   @param  pArg      argument to compare function. Can be NULL.
+  @param  pfnCmp    compare function
   @return none
 *///-----------------------------------------------------------------------------------------------
 void FlySortQSort(void *pArray, size_t nElem, size_t elemSize, void *pArg, pfnSortCmpEx_t pfnCmp)
 {
-  qsort_r(pArray, nElem, elemSize, pArg, pfnCmp);
+  flySortQ_t  q;
+  unsigned    badAllowed = 1;
+  size_t      m;
+
+  if(nElem < 2 || elemSize == 0)
+    return;
+
+  q.elemSize  = elemSize;
+  q.pArg      = pArg;
+  q.pfnCmp    = pfnCmp;
+  q.fWords    = (elemSize % sizeof(size_t) == 0 && ((uintptr_t)pArray % sizeof(size_t)) == 0) ? TRUE : FALSE;
+  for(m = nElem; m > 1; m /= 2)
+    ++badAllowed;
+
+  SortQLoop(&q, pArray, nElem, badAllowed, TRUE);
 }
 
 /*!------------------------------------------------------------------------------------------------
@@ -253,6 +522,174 @@ void * FlySortList(void *pLinkedList, bool_t fIsCircular, bool_t fIsDouble, void
   return pList;
 }
 
+#define SORT_RADIX_BITS   8
+#define SORT_RADIX_SIZE   (1 << SORT_RADIX_BITS)
+
+/*-------------------------------------------------------------------------------------------------
+  Get a key as an unsigned 64-bit value that sorts in the same order as the key. Signed keys flip
+  the sign bit. Doubles flip the sign bit if positive, or all bits if negative.
+-------------------------------------------------------------------------------------------------*/
+static inline uint64_t SortRadixKey(const uint8_t *pKey, flySortKey_t keyType)
+{
+  uint32_t  key32;
+  uint64_t  key64;
+
+  switch(keyType)
+  {
+    case FLYSORT_KEY_U32:
+      memcpy(&key32, pKey, sizeof(key32));
+      return key32;
+    case FLYSORT_KEY_I32:
+      memcpy(&key32, pKey, sizeof(key32));
+      return key32 ^ 0x80000000UL;
+    case FLYSORT_KEY_U64:
+      memcpy(&key64, pKey, sizeof(key64));
+      return key64;
+    case FLYSORT_KEY_I64:
+      memcpy(&key64, pKey, sizeof(key64));
+      return key64 ^ 0x8000000000000000ULL;
+    case FLYSORT_KEY_DOUBLE:
+    default:
+      memcpy(&key64, pKey, sizeof(key64));
+      return (key64 & 0x8000000000000000ULL) ? ~key64 : (key64 | 0x8000000000000000ULL);
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Copy one element. Constant sizes let the compiler use a single load/store for plain keys.
+-------------------------------------------------------------------------------------------------*/
+static inline void SortRadixCopy(uint8_t *pDst, const uint8_t *pSrc, size_t elemSize)
+{
+  if(elemSize == sizeof(uint32_t))
+    memcpy(pDst, pSrc, sizeof(uint32_t));
+  else if(elemSize == sizeof(uint64_t))
+    memcpy(pDst, pSrc, sizeof(uint64_t));
+  else
+    memcpy(pDst, pSrc, elemSize);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Sort an array of numbers with a radix sort. Much faster than FlySortQSort() on large arrays.
+
+  See FlySortRadixEx() for details and for sorting structs.
+
+  @param  pArray    ptr to array of numbers
+  @param  nElem     number of elements in the array
+  @param  keyType   FLYSORT_KEY_U32, FLYSORT_KEY_I32, FLYSORT_KEY_U64, FLYSORT_KEY_I64, FLYSORT_KEY_DOUBLE
+  @param  pScratch  scratch buffer, same size as the array, or NULL to allocate one
+  @return TRUE if sorted, FALSE if the scratch buffer could not be allocated
+*///-----------------------------------------------------------------------------------------------
+bool_t FlySortRadix(void *pArray, size_t nElem, flySortKey_t keyType, void *pScratch)
+{
+  size_t  keySize = (keyType == FLYSORT_KEY_U32 || keyType == FLYSORT_KEY_I32) ? sizeof(uint32_t) : sizeof(uint64_t);
+  return FlySortRadixEx(pArray, nElem, keySize, 0, keyType, pScratch);
+}
+
+/*!------------------------------------------------------------------------------------------------
+  Sort an array of structs by a numeric key in each struct, using an LSD radix sort. The sort is
+  stable: elements with equal keys keep their order.
+
+  The sort takes 1 pass to count all digits, then 1 pass per byte of the key (4 or 8). Bytes that
+  are the same in every key are skipped, so small values in 64-bit keys sort in fewer passes.
+
+  Doubles sort in IEEE-754 total order: -NaN, -Inf, negatives, -0.0, +0.0, positives, +Inf, NaN.
+
+  The scratch buffer must be nElem * elemSize bytes. Provide one to avoid an allocation, for
+  example when sorting many arrays. Example:
+
+      typedef struct { uint64_t timestamp; double value; } sample_t;
+      FlySortRadixEx(aSamples, n, sizeof(sample_t), offsetof(sample_t, timestamp), FLYSORT_KEY_U64, NULL);
+
+  @param  pArray    ptr to array of items
+  @param  nElem     number of elements in the array
+  @param  elemSize  size of each element
+  @param  keyOffset offset of the key in each element, e.g. offsetof(myStruct_t, key)
+  @param  keyType   FLYSORT_KEY_U32, FLYSORT_KEY_I32, FLYSORT_KEY_U64, FLYSORT_KEY_I64, FLYSORT_KEY_DOUBLE
+  @param  pScratch  scratch buffer of nElem * elemSize bytes, or NULL to allocate one
+  @return TRUE if sorted, FALSE if bad parameters or the scratch buffer could not be allocated
+*///-----------------------------------------------------------------------------------------------
+bool_t FlySortRadixEx(void *pArray, size_t nElem, size_t elemSize, size_t keyOffset, flySortKey_t keyType,
+                      void *pScratch)
+{
+  size_t      aCounts[sizeof(uint64_t)][SORT_RADIX_SIZE];
+  size_t     *pCounts;
+  uint8_t    *pSrc      = pArray;
+  uint8_t    *pDst      = pScratch;
+  uint8_t    *pTmp;
+  uint8_t    *pElem;
+  uint64_t    key;
+  uint64_t    firstKey;
+  size_t      keySize;
+  size_t      i;
+  size_t      sum;
+  size_t      count;
+  unsigned    digit;
+  unsigned    shift;
+  bool_t      fAllocated = FALSE;
+
+  keySize = (keyType == FLYSORT_KEY_U32 || keyType == FLYSORT_KEY_I32) ? sizeof(uint32_t) : sizeof(uint64_t);
+  if(keyType > FLYSORT_KEY_DOUBLE || keyOffset + keySize > elemSize)
+    return FALSE;
+  if(nElem < 2)
+    return TRUE;
+
+  if(!pDst)
+  {
+    pDst = FlyAlloc(nElem * elemSize);
+    if(!pDst)
+      return FALSE;
+    fAllocated = TRUE;
+  }
+
+  // count every digit of every key in one pass
+  memset(aCounts, 0, sizeof(aCounts));
+  for(i = 0, pElem = pSrc; i < nElem; ++i, pElem += elemSize)
+  {
+    key = SortRadixKey(pElem + keyOffset, keyType);
+    for(digit = 0; digit < keySize; ++digit)
+      ++aCounts[digit][(key >> (digit * SORT_RADIX_BITS)) & (SORT_RADIX_SIZE - 1)];
+  }
+
+  // one stable scatter per digit, least significant first
+  firstKey = SortRadixKey(pSrc + keyOffset, keyType);
+  for(digit = 0; digit < keySize; ++digit)
+  {
+    shift   = digit * SORT_RADIX_BITS;
+    pCounts = aCounts[digit];
+
+    // all keys have the same value for this digit, nothing to do
+    if(pCounts[(firstKey >> shift) & (SORT_RADIX_SIZE - 1)] == nElem)
+      continue;
+
+    // counts to starting offsets
+    for(i = 0, sum = 0; i < SORT_RADIX_SIZE; ++i)
+    {
+      count      = pCounts[i];
+      pCounts[i] = sum;
+      sum       += count;
+    }
+
+    for(i = 0, pElem = pSrc; i < nElem; ++i, pElem += elemSize)
+    {
+      key = SortRadixKey(pElem + keyOffset, keyType);
+      SortRadixCopy(pDst + pCounts[(key >> shift) & (SORT_RADIX_SIZE - 1)]++ * elemSize, pElem, elemSize);
+    }
+
+    pTmp = pSrc;
+    pSrc = pDst;
+    pDst = pTmp;
+  }
+
+  // odd number of passes, sorted data is in the scratch buffer
+  if(pSrc != pArray)
+    memcpy(pArray, pSrc, nElem * elemSize);
+
+  if(fAllocated)
+    FlyFree(pSrc == pArray ? pDst : pSrc);
+
+  return TRUE;
+}
+
 #ifndef FLY_FLAG_NO_MATH
 /*!------------------------------------------------------------------------------------------------
   Compare two unsigned. Returns -1 if this < that, 0 if same, 1 if this > that.
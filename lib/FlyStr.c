@@ -452,6 +452,95 @@ size_t FlyStrLineLenEx(const char *sz)
   return (size_t)(FlyStrLineNext(sz) - sz);
 }
 
+/*!------------------------------------------------------------------------------------------------
+  Convert line endings in a block of memory. "\n", "\r\n" and lone "\r" all become the chosen
+  ending, "\n" or "\r\n". Lone '\r' (not followed by '\n') are stripped, not converted.
+
+  Line endings are found with memchr(), which the C library vectorizes, and the text between them
+  is copied with memcpy(), so long lines cost about the same as a copy.
+
+  Converts as much as fits in pDst, so a large source can be converted in chunks into a small
+  buffer: call again with pSrc advanced by *pSrcUsed until all of the source is used. A "\r\n"
+  is never split between chunks, so when converting to CRLF size must be at least 2, or a line
+  ending never fits and *pSrcUsed stays 0. The output is NOT '\0' terminated.
+
+  If pDst is NULL, just returns the converted length (size is ignored). When converting to LF,
+  pDst may be the same as pSrc (in place), as the output is never longer than the input.
+
+  @param  pDst      destination buffer or NULL
+  @param  size      size of pDst in bytes, at least 2 for FLYSTR_EOL_CRLF
+  @param  pSrc      source text
+  @param  srcLen    length of source text
+  @param  eol       FLYSTR_EOL_LF or FLYSTR_EOL_CRLF
+  @param  pSrcUsed  returns # of source bytes converted, may be NULL
+  @return length of converted text in pDst
+*///-----------------------------------------------------------------------------------------------
+size_t FlyStrEolConvert(char *pDst, size_t size, const char *pSrc, size_t srcLen, flyStrEol_t eol, size_t *pSrcUsed)
+{
+  const char *p       = pSrc;
+  const char *pEnd    = pSrc + srcLen;
+  const char *pCr;
+  const char *pLf;
+  const char *pStop;
+  size_t      len     = 0;
+  size_t      runLen;
+  size_t      eolLen  = (eol == FLYSTR_EOL_CRLF) ? 2 : 1;
+  size_t      srcEol;
+
+  if(!pDst)
+    size = SIZE_MAX;
+  pCr = memchr(pSrc, '\r', srcLen);
+  pLf = memchr(pSrc, '\n', srcLen);
+
+  while(p < pEnd)
+  {
+    // next '\r' and '\n' are only searched for again once passed
+    if(pCr && pCr < p)
+      pCr = memchr(p, '\r', (size_t)(pEnd - p));
+    if(pLf && pLf < p)
+      pLf = memchr(p, '\n', (size_t)(pEnd - p));
+    pStop = pEnd;
+    if(pCr && pCr < pStop)
+      pStop = pCr;
+    if(pLf && pLf < pStop)
+      pStop = pLf;
+
+    // copy text up to line ending, or as much as fits
+    runLen = (size_t)(pStop - p);
+    if(runLen > size - len)
+      runLen = size - len;
+    if(pDst && runLen)
+      memmove(&pDst[len], p, runLen);
+    len += runLen;
+    p   += runLen;
+    if(p != pStop || p == pEnd)
+      break;
+
+    // line ending, or lone '\r' which is stripped
+    srcEol = (*p == '\r' && p + 1 < pEnd && p[1] == '\n') ? 2 : 1;
+    if(*p == '\r' && srcEol == 1)
+      ++p;
+    else
+    {
+      if(eolLen > size - len)
+        break;
+      if(pDst)
+      {
+        if(eolLen == 2)
+          pDst[len++] = '\r';
+        pDst[len++] = '\n';
+      }
+      else
+        len += eolLen;
+      p += srcEol;
+    }
+  }
+
+  if(pSrcUsed)
+    *pSrcUsed = (size_t)(p - pSrc);
+  return len;
+}
+
 /*!------------------------------------------------------------------------------------------------
   Is this line blank? (nothing but whitespace)?
 
@@ -4290,6 +4379,97 @@ unsigned FlyStrSlug(char *szSlug, const char *szSrc, size_t size, size_t srcLen)
   return len;
 }
 
+// flags for each char, see FlyStrHtmlEscape(). '\0' always stops the scan
+#define FLYSTR_HTML_NUL   0x80
+static const uint8_t m_aHtmlEsc[256] =
+{
+  ['\0'] = FLYSTR_HTML_NUL,
+  ['<']  = FLYSTR_HTML_LT,
+  ['>']  = FLYSTR_HTML_GT,
+  ['&']  = FLYSTR_HTML_AMP,
+  ['"']  = FLYSTR_HTML_QUOTE,
+  ['\''] = FLYSTR_HTML_APOS
+};
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to FlyStrHtmlEscape(). Returns the HTML entity for the given special char.
+*///-----------------------------------------------------------------------------------------------
+static const char * StrHtmlEntity(char c)
+{
+  switch(c)
+  {
+    case '<':   return "&lt;";
+    case '>':   return "&gt;";
+    case '&':   return "&amp;";
+    case '"':   return "&quot;";
+    default:    return "&#39;";
+  }
+}
+
+/*!-------------------------------------------------------------------------------------------------
+  Copy szSrc to szDst, escaping chars that have meaning in HTML, e.g. `a < b` becomes `a &lt; b`.
+
+  Runs of plain text are copied whole, so this is fast even on large buffers. Stops at srcLen,
+  '\0' or when szDst is full. An entity is never split: if it doesn't fit, it is not copied.
+
+  @param  szDst     destination string, or NULL to just get length
+  @param  szSrc     source string
+  @param  size      sizeof szDst (1-n)
+  @param  srcLen    max length of szSrc to escape
+  @param  flags     which chars to escape, e.g. FLYSTR_HTML_LT | FLYSTR_HTML_AMP or FLYSTR_HTML_ALL
+  @return length of szDst (or would have been if szDst == NULL)
+*///------------------------------------------------------------------------------------------------
+size_t FlyStrHtmlEscape(char *szDst, const char *szSrc, size_t size, size_t srcLen, unsigned flags)
+{
+  const char   *szEntity;
+  size_t        len     = 0;
+  size_t        n;
+  size_t        entityLen;
+  uint8_t       mask;
+
+  if(size == 0)
+    return 0;
+
+  // from here on out, size becomes maxLen
+  --size;
+  mask = (uint8_t)((flags & FLYSTR_HTML_ALL) | FLYSTR_HTML_NUL);
+  while(srcLen && len < size)
+  {
+    // find run of plain text
+    n = 0;
+    while(n < srcLen && !(m_aHtmlEsc[(uint8_t)szSrc[n]] & mask))
+      ++n;
+    if(n > size - len)
+      n = size - len;
+    if(n)
+    {
+      if(szDst)
+        memcpy(&szDst[len], szSrc, n);
+      len    += n;
+      szSrc  += n;
+      srcLen -= n;
+    }
+    if(srcLen == 0 || len >= size || *szSrc == '\0')
+      break;
+
+    // special char, replace with entity if it fits
+    szEntity  = StrHtmlEntity(*szSrc);
+    entityLen = strlen(szEntity);
+    if(entityLen > size - len)
+      break;
+    if(szDst)
+      memcpy(&szDst[len], szEntity, entityLen);
+    len += entityLen;
+    ++szSrc;
+    --srcLen;
+  }
+
+  if(szDst)
+    szDst[len] = '\0';
+
+  return len;
+}
+
 /*!-------------------------------------------------------------------------------------------------
   Ask a question, get an answer. Uses fgets() and printf() with stdin and stdout.
 
@@ -5,6 +5,16 @@
 *///***********************************************************************************************
 #include "FlyStr.h"
 
+/*-------------------------------------------------------------------------------------------------
+  Like strnlen(), but portable. Never looks past szSrc[maxLen - 1], so copying a short segment out
+  of a large buffer doesn't scan the whole buffer.
+*///-----------------------------------------------------------------------------------------------
+static size_t StrZNLen(const char *szSrc, size_t maxLen)
+{
+  const char *pszEnd = memchr(szSrc, '\0', maxLen);
+  return pszEnd ? (size_t)(pszEnd - szSrc) : maxLen;
+}
+
 /*!-------------------------------------------------------------------------------------------------
   Copy the szSrc string to szDst. Will not exceed size of szDst. Always '\0' terminates.
 
@@ -38,8 +48,7 @@ size_t FlyStrZNCpy(char *szDst, const char *szSrc, size_t size, size_t srcLen)
   {
     if(srcLen > (size - 1))
       srcLen = (size - 1);
-    if(srcLen > strlen(szSrc))
-      srcLen = strlen(szSrc);
+    srcLen = StrZNLen(szSrc, srcLen);
 
     if(szDst)
     {
@@ -78,7 +87,6 @@ size_t FlyStrZCat(char *szDst, const char *szSrc, size_t size)
 size_t FlyStrZNCat(char *szDst, const char *szSrc, size_t size, size_t srcLen)
 {
   size_t dstLen;
-  size_t n;
 
   // buffer to small
   if(size == 0)
@@ -90,11 +98,9 @@ size_t FlyStrZNCat(char *szDst, const char *szSrc, size_t size, size_t srcLen)
     --size;
 
     // determine size to copy based on both size -1 and length of szSrc
-    n = strlen(szSrc);
-    if(srcLen > n)
-      srcLen = n;
     if(srcLen > size)
       srcLen = size;
+    srcLen = StrZNLen(szSrc, srcLen);
 
     if(szDst)
     {
@@ -3,6 +3,10 @@
   Copyright 2024 Drew Gislason
   License: MIT <https://mit-license.org>
 *///***********************************************************************************************
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 #include "FlyStr.h"
 #include "FlyFile.h"
 #include "FlyTabComplete.h"
@@ -12,6 +16,10 @@
 
   1. Iterate through lists of files/folders
   2. Can handle paths with tilde, e.g. "~/folder/"
+  3. The folder being completed is read once into a sorted listing, reused for every keystroke in
+     that folder until the folder's mtime changes. Matches are found by binary search, so each
+     completion is O(log n + k) even in folders with 50,000 entries
+  4. Paths with wildcards (`*`, `?`, `[`) are expanded with glob() instead
 
   @example FlyTabComplete  Enter a partial path, then tab through all entries
 
@@ -30,13 +38,192 @@
 typedef struct
 {
   unsigned    sanchk;             // sanity check
-  void       *hFileList;          // list of matching files/folders
-  unsigned    index;              // index into list
+  void       *hFileList;          // list of matching files/folders, if wildcards
+  unsigned    index;              // index into list or listing
   bool_t      fReduceHome;        // convert from "/Users/drewg/" to "~/" in user szPath
   unsigned    maxSize;            // max size of szPath
   char       *szPath;             // ptr to path to copy to user string
+  char       *szDir;              // folder of cached listing, as typed but with ~ expanded
+  int64_t     dirTime;            // mtime of folder when listing was read, in ns
+  bool_t      fDirRacy;           // folder changed too recently to trust dirTime
+  char      **aszNames;           // sorted listing of folder, folders end in slash
+  unsigned    nNames;
+  char       *pNames;             // names packed together
+  unsigned    first;              // 1st entry matching prefix
+  unsigned    last;               // 1 past last entry matching prefix
+  bool_t      fHidden;            // include hidden names (prefix starts with a dot)
 } sFlyTabComplete_t;
 
+/*-------------------------------------------------------------------------------------------------
+  Compare names for qsort()
+-------------------------------------------------------------------------------------------------*/
+static int TabCompleteCmp(const void *pThis, const void *pThat)
+{
+  return strcmp(*(const char * const *)pThis, *(const char * const *)pThat);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Forget the cached folder listing
+-------------------------------------------------------------------------------------------------*/
+static void TabCompleteClearDir(sFlyTabComplete_t *pTabComplete)
+{
+  pTabComplete->szDir     = FlyFreeIf(pTabComplete->szDir);
+  pTabComplete->aszNames  = FlyFreeIf(pTabComplete->aszNames);
+  pTabComplete->pNames    = FlyFreeIf(pTabComplete->pNames);
+  pTabComplete->nNames    = 0;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Read the folder into a sorted listing, unless already cached and unchanged. szDir is "" for
+  current folder, otherwise ends in a slash. Returns FALSE if folder can't be read.
+-------------------------------------------------------------------------------------------------*/
+static bool_t TabCompleteLoadDir(sFlyTabComplete_t *pTabComplete, const char *szDir)
+{
+  DIR              *pDir;
+  struct dirent    *pEntry;
+  struct stat       st;
+  flyFileStat_t     stat;
+  char            **aszNew;
+  char             *pNew;
+  size_t            namesLen  = 0;
+  size_t            namesMax  = 0;
+  size_t            len;
+  unsigned          maxNames  = 0;
+  unsigned          i;
+  bool_t            fIsDir;
+  bool_t            fWorked   = TRUE;
+
+  if(!FlyFileStat(&stat, *szDir ? szDir : ".", 0) || !(stat.flags & FLYFILESTAT_IS_DIR))
+    return FALSE;
+
+  // same folder, unchanged, so keystrokes don't re-read it
+  if(pTabComplete->szDir && strcmp(pTabComplete->szDir, szDir) == 0 && pTabComplete->dirTime == stat.mtimeNs &&
+     !pTabComplete->fDirRacy)
+  {
+    return TRUE;
+  }
+
+  TabCompleteClearDir(pTabComplete);
+  pDir = opendir(*szDir ? szDir : ".");
+  if(!pDir)
+    return FALSE;
+
+  // names are stored as offsets until all are read, as pNames moves when it grows
+  while(fWorked && (pEntry = readdir(pDir)) != NULL)
+  {
+    if(strcmp(pEntry->d_name, ".") == 0 || strcmp(pEntry->d_name, "..") == 0)
+      continue;
+
+#ifdef DT_DIR
+    if(pEntry->d_type == DT_DIR)
+      fIsDir = TRUE;
+    else if(pEntry->d_type == DT_LNK || pEntry->d_type == DT_UNKNOWN)
+#endif
+      fIsDir = (fstatat(dirfd(pDir), pEntry->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode)) ? TRUE : FALSE;
+#ifdef DT_DIR
+    else
+      fIsDir = FALSE;
+#endif
+
+    len = strlen(pEntry->d_name) + (fIsDir ? 2 : 1);
+    if(namesLen + len > namesMax)
+    {
+      namesMax = namesMax ? namesMax * 2 : 4096;
+      while(namesMax < namesLen + len)
+        namesMax *= 2;
+      pNew = FlyRealloc(pTabComplete->pNames, namesMax);
+      if(!pNew)
+      {
+        fWorked = FALSE;
+        break;
+      }
+      pTabComplete->pNames = pNew;
+    }
+    if(pTabComplete->nNames >= maxNames)
+    {
+      maxNames = maxNames ? maxNames * 2 : 256;
+      aszNew = FlyRealloc(pTabComplete->aszNames, maxNames * sizeof(char *));
+      if(!aszNew)
+      {
+        fWorked = FALSE;
+        break;
+      }
+      pTabComplete->aszNames = aszNew;
+    }
+
+    strcpy(&pTabComplete->pNames[namesLen], pEntry->d_name);
+    if(fIsDir)
+      strcat(&pTabComplete->pNames[namesLen], "/");
+    pTabComplete->aszNames[pTabComplete->nNames++] = (char *)(uintptr_t)namesLen;
+    namesLen += len;
+  }
+  closedir(pDir);
+
+  if(fWorked)
+    pTabComplete->szDir = FlyStrClone(szDir);
+  if(!fWorked || !pTabComplete->szDir)
+  {
+    TabCompleteClearDir(pTabComplete);
+    return FALSE;
+  }
+
+  for(i = 0; i < pTabComplete->nNames; ++i)
+    pTabComplete->aszNames[i] = &pTabComplete->pNames[(uintptr_t)pTabComplete->aszNames[i]];
+  if(pTabComplete->nNames > 1)
+    qsort(pTabComplete->aszNames, pTabComplete->nNames, sizeof(char *), TabCompleteCmp);
+  pTabComplete->dirTime = stat.mtimeNs;
+
+  // file system clocks are coarse, so a change in the same tick may not alter the mtime
+  pTabComplete->fDirRacy = (stat.mtimeNs / 1000000000LL + 1 >= (int64_t)time(NULL)) ? TRUE : FALSE;
+
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Move index past any hidden names, unless they are wanted. Hidden names can be anywhere in the
+  range, as names may start with characters that sort before a dot, e.g. "#x" or "-dash".
+-------------------------------------------------------------------------------------------------*/
+static void TabCompleteSkipHidden(sFlyTabComplete_t *pTabComplete)
+{
+  if(!pTabComplete->fHidden)
+  {
+    while(pTabComplete->index < pTabComplete->last && *pTabComplete->aszNames[pTabComplete->index] == '.')
+      ++pTabComplete->index;
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Find the range of names starting with szPrefix, using binary search (lower bound). Hidden files
+  are skipped unless the prefix starts with a dot, like glob(). Returns TRUE if any found.
+-------------------------------------------------------------------------------------------------*/
+static bool_t TabCompleteRange(sFlyTabComplete_t *pTabComplete, const char *szPrefix)
+{
+  size_t      len = strlen(szPrefix);
+  unsigned    lo  = 0;
+  unsigned    hi  = pTabComplete->nNames;
+  unsigned    mid;
+
+  while(lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+    if(strncmp(pTabComplete->aszNames[mid], szPrefix, len) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  pTabComplete->first = lo;
+
+  // names with the prefix are all together, so this is O(k)
+  for(hi = lo; hi < pTabComplete->nNames && strncmp(pTabComplete->aszNames[hi], szPrefix, len) == 0; ++hi)
+    ;
+  pTabComplete->last    = hi;
+  pTabComplete->fHidden = (*szPrefix == '.') ? TRUE : FALSE;
+  pTabComplete->index   = pTabComplete->first;
+  TabCompleteSkipHidden(pTabComplete);
+
+  return (pTabComplete->index < pTabComplete->last) ? TRUE : FALSE;
+}
+
 /*!------------------------------------------------------------------------------------------------
   Creates TabComplete state machine
 
@@ -54,7 +241,7 @@ void * FlyTabCompleteNew(unsigned maxSize)
     pTabComplete->sanchk  = FLY_TABCOMPLETE_SANCHK;
     pTabComplete->maxSize = maxSize;
     pTabComplete->szPath  = FlyAlloc(maxSize);
-    if(!pTabComplete)
+    if(!pTabComplete->szPath)
     {
       FlyTabCompleteFree(pTabComplete);
       pTabComplete = NULL;
@@ -97,15 +284,21 @@ bool_t FlyTabCompleteIsTabComplete(void *hTabComplete)
 bool_t FlyTabComplete(void *hTabComplete, char *szPath)
 {
   sFlyTabComplete_t  *pTabComplete  = hTabComplete;
+  const char         *szName        = NULL;
+  char               *pszPrefix;
+  char                c;
   bool_t              fFound        = FALSE;
 
   // not valid state machine
   if(FlyTabCompleteIsTabComplete(hTabComplete))
   {
     // if we are already in the state machine, get next item
-    if((pTabComplete->hFileList != NULL) && strcmp(szPath, pTabComplete->szPath) == 0)
+    if((pTabComplete->hFileList != NULL || pTabComplete->first < pTabComplete->last) &&
+       strcmp(szPath, pTabComplete->szPath) == 0)
     {
-      if(pTabComplete->index < FlyFileListLen(pTabComplete->hFileList))
+      if(pTabComplete->hFileList && pTabComplete->index < FlyFileListLen(pTabComplete->hFileList))
+        fFound = TRUE;
+      else if(!pTabComplete->hFileList && pTabComplete->index < pTabComplete->last)
         fFound = TRUE;
     }
 
@@ -118,34 +311,58 @@ bool_t FlyTabComplete(void *hTabComplete, char *szPath)
         FlyFileListFree(pTabComplete->hFileList);
         pTabComplete->hFileList = NULL;
       }
+      pTabComplete->first = pTabComplete->last = 0;
 
       // expand home folder if needed (because glob() doesn't understand "~/*"
-      FlyStrZNCpy(pTabComplete->szPath, szPath, sizeof(pTabComplete->szPath), pTabComplete->maxSize);
+      FlyStrZCpy(pTabComplete->szPath, szPath, pTabComplete->maxSize);
       pTabComplete->fReduceHome = FALSE;
       if(strncmp(pTabComplete->szPath, "~/", 2) == 0)
         pTabComplete->fReduceHome = TRUE;
       FlyFileHomeExpand(pTabComplete->szPath, pTabComplete->maxSize);
 
-      // implicit wildcard, converts "Doc" to "Doc*", unless user already put in wildcard(s)
-      if((strchr(pTabComplete->szPath, '*') == NULL) && (strchr(pTabComplete->szPath, '?') == NULL))
-        strcat(pTabComplete->szPath, "*");
+      // no wildcards, complete from the cached listing of the folder
+      if(strpbrk(pTabComplete->szPath, "*?[") == NULL)
+      {
+        pszPrefix = FlyStrLastSlash(pTabComplete->szPath);
+        pszPrefix = pszPrefix ? pszPrefix + 1 : pTabComplete->szPath;
+        c = *pszPrefix;
+        *pszPrefix = '\0';
+        fFound = TabCompleteLoadDir(pTabComplete, pTabComplete->szPath);
+        *pszPrefix = c;
+        if(fFound)
+          fFound = TabCompleteRange(pTabComplete, pszPrefix);
+      }
 
-      pTabComplete->hFileList = FlyFileListNew(pTabComplete->szPath);
-      if(FlyFileListLen(pTabComplete->hFileList) > 0)
+      // wildcards given by user, let glob() expand them
+      else
       {
-        pTabComplete->index = 0;
-        fFound = TRUE;
+        pTabComplete->hFileList = FlyFileListNew(pTabComplete->szPath);
+        if(FlyFileListLen(pTabComplete->hFileList) > 0)
+        {
+          pTabComplete->index = 0;
+          fFound = TRUE;
+        }
       }
     }
   }
 
   if(fFound)
   {
-    strcpy(pTabComplete->szPath, FlyFileListGetName(pTabComplete->hFileList, pTabComplete->index));
+    if(pTabComplete->hFileList)
+      FlyStrZCpy(pTabComplete->szPath, FlyFileListGetName(pTabComplete->hFileList, pTabComplete->index),
+                 pTabComplete->maxSize);
+    else
+    {
+      szName = pTabComplete->aszNames[pTabComplete->index];
+      FlyStrZCpy(pTabComplete->szPath, pTabComplete->szDir, pTabComplete->maxSize);
+      FlyStrZCat(pTabComplete->szPath, szName, pTabComplete->maxSize);
+    }
     if(pTabComplete->fReduceHome)
       FlyFileHomeReduce(pTabComplete->szPath);
     strcpy(szPath, pTabComplete->szPath);
     ++pTabComplete->index;
+    if(!pTabComplete->hFileList)
+      TabCompleteSkipHidden(pTabComplete);
   }
 
   return fFound;
@@ -167,6 +384,12 @@ bool_t FlyTabCompleteRewind(void *hTabComplete)
     pTabComplete->index = 0;
     fWorked = TRUE;
   }
+  else if(FlyTabCompleteIsTabComplete(hTabComplete) && pTabComplete->first < pTabComplete->last)
+  {
+    pTabComplete->index = pTabComplete->first;
+    TabCompleteSkipHidden(pTabComplete);
+    fWorked = (pTabComplete->index < pTabComplete->last) ? TRUE : FALSE;
+  }
 
   return fWorked;
 }
@@ -190,6 +413,7 @@ void FlyTabCompleteFree(void *hTabComplete)
     }
     if(pTabComplete->szPath)
       FlyFree(pTabComplete->szPath);    
+    TabCompleteClearDir(pTabComplete);
     memset(pTabComplete, 0, sizeof(sFlyTabComplete_t));
     FlyFree(pTabComplete);
   }
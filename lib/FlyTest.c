@@ -362,7 +362,7 @@ void FlyTestRun(hTestSuite_t hSuite)
   }
 
   // no longer in test suite
-  FlyLogPrintf("%s %s\n\n", m_szMTestEnd), FlyStrDateTimeCur();
+  FlyLogPrintf("%s %s\n\n", m_szMTestEnd, FlyStrDateTimeCur());
   m_pSuite = NULL;
 }
 
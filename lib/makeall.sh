@@ -10,13 +10,23 @@ cc FlyBase64.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyBase64.o
 cc FlyCard.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyCard.o
 cc FlyCli.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyCli.o
 cc FlyFile.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFile.o
+cc FlyFileAtomic.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileAtomic.o
+cc FlyFileCache.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileCache.o
+cc FlyFileCopyTree.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileCopyTree.o
+cc FlyFileHash.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileHash.o
+cc FlyFileLines.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileLines.o
 cc FlyFileList.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileList.o
+cc FlyFileMap.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileMap.o
+cc FlyFilePathCache.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFilePathCache.o
+cc FlyFilePrefetch.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFilePrefetch.o
+cc FlyFileWalk.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyFileWalk.o
 cc FlyJson.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyJson.o
 cc FlyKey.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyKey.o
 cc FlyKeyPrompt.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyKeyPrompt.o
 cc FlyList.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyList.o
 cc FlyLog.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyLog.o
 cc FlyMarkdown.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyMarkdown.o
+cc FlyMarkdownDoc.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyMarkdownDoc.o
 cc FlyMem.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlyMem.o
 cc FlySec.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlySec.o
 cc FlySemVer.c -c -I. -I../inc/ -Wall -Werror -o ./out/FlySemVer.o
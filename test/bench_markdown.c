@@ -0,0 +1,238 @@
+/**************************************************************************************************
+  bench_markdown.c - Markdown to HTML throughput and complexity-regression benchmark
+  Copyright 2024 Drew Gislason
+  License: <https://mit-license.org>
+
+  Generates markdown documents of each kind (mixed, tables, deep lists, long code blocks and
+  adversarial emphasis) at several sizes, converts them to HTML, and reports MB/s.
+
+  Fails (exit code 1) if conversion is not near-linear, that is if doubling the input more than
+  doubles the time by more than the margin, or if the largest document converts much slower per
+  byte than the 1 MB document.
+**************************************************************************************************/
+#include "FlyCli.h"
+#include "FlyMarkdown.h"
+#include "FlyMem.h"
+#include "FlyStr.h"
+#include "FlyTime.h"
+
+static const char m_szVersion[] = "bench_markdown v" FLY_VER;
+static const char m_szHelp[] =
+  "Usage = bench_markdown [-m#] [-r#] [-v]\n"
+  "\n"
+  "-m#      max document size in MB (default 50)\n"
+  "-r#      allowed margin in percent over linear time (default 50)\n"
+  "-v       verbose\n";
+
+#define BENCH_KB          1024UL
+#define BENCH_MB          (1024UL * 1024UL)
+#define BENCH_MIN_MS      200       // repeat small conversions until at least this long
+
+typedef enum
+{
+  BENCH_MD_MIXED = 0,
+  BENCH_MD_TABLES,
+  BENCH_MD_LISTS,
+  BENCH_MD_CODE,
+  BENCH_MD_EMPHASIS,
+  BENCH_MD_SIZEOF
+} benchMdKind_t;
+
+static const char *m_aszKinds[BENCH_MD_SIZEOF] = { "mixed", "tables", "lists", "code", "emphasis" };
+
+/*-------------------------------------------------------------------------------------------------
+  Append one chunk of markdown of the given kind to szMd. Returns length appended.
+-------------------------------------------------------------------------------------------------*/
+static size_t BenchMdChunk(char *szMd, benchMdKind_t kind, unsigned n)
+{
+  char     *psz = szMd;
+  unsigned  i;
+
+  switch(kind)
+  {
+    case BENCH_MD_MIXED:
+      psz += sprintf(psz, "## Heading %u\n\n", n);
+      psz += sprintf(psz, "Some *italic* and **bold** text with `code %u` and a [link](https://x.com/%u).\n", n, n);
+      psz += sprintf(psz, "A second line & a < b, ~~strike~~ and ==highlight== <me@site.com>.  \n\n");
+      psz += sprintf(psz, "> quoted %u\n>> deeper\n\n", n);
+      psz += sprintf(psz, "- item %u\n- item ![img](f.png \"title\")\n  1. sub item\n\n", n);
+    break;
+
+    case BENCH_MD_TABLES:
+      psz += sprintf(psz, "a | b | c | d | e\n--- | :---: | ---: | --- | ---\n");
+      for(i = 0; i < 40; ++i)
+        psz += sprintf(psz, "cell %u | *x* | `y` | [z](w) | %u\n", n, i);
+      psz += sprintf(psz, "\n");
+    break;
+
+    case BENCH_MD_LISTS:
+      for(i = 0; i < 12; ++i)
+        psz += sprintf(psz, "%*s%s item %u.%u\n", (int)(2 * (i < 6 ? i : 11 - i)), "", (i & 1) ? "1." : "-", n, i);
+      psz += sprintf(psz, "\n");
+    break;
+
+    case BENCH_MD_CODE:
+      psz += sprintf(psz, "```c\n");
+      for(i = 0; i < 60; ++i)
+        psz += sprintf(psz, "  for(i = 0; i < %u; ++i)    x <<= 1;  // %u\n", n, i);
+      psz += sprintf(psz, "```\n\n");
+    break;
+
+    case BENCH_MD_EMPHASIS:
+    default:
+      for(i = 0; i < 8; ++i)
+      {
+        psz += sprintf(psz, "***a **b *c ~~d ==e ^f ~g `h [i](j ![k]( <l *** %u\n", n);
+        psz += sprintf(psz, "* * ** ** ***x*** **y* *z** \\* [[[[ ]]]] ```` ==~~^^ %u\n", i);
+      }
+      psz += sprintf(psz, "\n");
+    break;
+  }
+
+  return (size_t)(psz - szMd);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Make a markdown document of the given kind, at least size bytes long. Returns allocated string.
+-------------------------------------------------------------------------------------------------*/
+static char * BenchMdMake(benchMdKind_t kind, size_t size)
+{
+  char     *szMd;
+  size_t    len = 0;
+  unsigned  n   = 0;
+
+  szMd = FlyAlloc(size + 8 * BENCH_KB);
+  if(szMd)
+  {
+    while(len < size)
+      len += BenchMdChunk(&szMd[len], kind, n++);
+    szMd[len] = '\0';
+  }
+
+  return szMd;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Convert the markdown to HTML, repeating until at least BENCH_MIN_MS. Returns ms per conversion.
+-------------------------------------------------------------------------------------------------*/
+static double BenchMdConvert(const char *szMd, size_t *pHtmlLen)
+{
+  char       *szHtml;
+  size_t      mdLen   = strlen(szMd);
+  size_t      htmlLen;
+  flytime_t   timeMs;
+  unsigned    count   = 0;
+
+  htmlLen = FlyMd2HtmlContent(NULL, SIZE_MAX, szMd, szMd + mdLen);
+  szHtml  = FlyAlloc(htmlLen + 1);
+  if(!szHtml)
+    return 0.0;
+
+  timeMs = FlyTimeMsGet();
+  do
+  {
+    FlyMd2HtmlContent(szHtml, htmlLen + 1, szMd, szMd + mdLen);
+    ++count;
+  } while(FlyTimeMsDiff(timeMs) < BENCH_MIN_MS);
+  timeMs = FlyTimeMsDiff(timeMs);
+
+  FlyFree(szHtml);
+  if(pHtmlLen)
+    *pHtmlLen = htmlLen;
+
+  return (double)timeMs / count;
+}
+
+int main(int argc, const char *argv[])
+{
+  // command-line options
+  bool_t              fVerbose  = FALSE;
+  int                 maxMb     = 50;
+  int                 margin    = 50;
+  const flyCliOpt_t   cliOpts[] =
+  {
+    { "-m",      &maxMb,    FLYCLI_INT },
+    { "-r",      &margin,   FLYCLI_INT },
+    { "-v",      &fVerbose, FLYCLI_BOOL },
+  };
+  const flyCli_t cli =
+  {
+    .pArgc      = &argc,
+    .argv       = argv,
+    .nOpts      = NumElements(cliOpts),
+    .pOpts      = cliOpts,
+    .szVersion  = m_szVersion,
+    .szHelp     = m_szHelp
+  };
+
+  size_t          aSizes[]  = { 16 * BENCH_KB, BENCH_MB, 2 * BENCH_MB, 0 };
+  double          aMs[NumElements(aSizes)];
+  char           *szMd;
+  size_t          htmlLen   = 0;
+  size_t          mdLen;
+  double          ratio;
+  double          limit;
+  benchMdKind_t   kind;
+  unsigned        i;
+  bool_t          fFailed   = FALSE;
+
+  if(FlyCliParse(&cli))
+    exit(1);
+  if(maxMb < 2)
+    maxMb = 2;
+  if(margin < 0)
+    margin = 0;
+  aSizes[NumElements(aSizes) - 1] = (size_t)maxMb * BENCH_MB;
+  limit = 1.0 + (double)margin / 100.0;
+
+  printf("%s\n\n", cli.szVersion);
+  printf("%-10s %10s %10s %10s %10s\n", "kind", "md bytes", "html bytes", "ms", "MB/s");
+  for(kind = 0; kind < BENCH_MD_SIZEOF; ++kind)
+  {
+    for(i = 0; i < NumElements(aSizes); ++i)
+    {
+      aMs[i] = 0.0;
+      if(i > 0 && aSizes[i] <= aSizes[i - 1])
+        continue;
+      szMd = BenchMdMake(kind, aSizes[i]);
+      if(!szMd)
+      {
+        printf("out of memory\n");
+        exit(1);
+      }
+      mdLen = strlen(szMd);
+      aMs[i] = BenchMdConvert(szMd, &htmlLen);
+      printf("%-10s %10zu %10zu %10.2f %10.1f\n", m_aszKinds[kind], mdLen, htmlLen, aMs[i],
+        aMs[i] > 0.0 ? ((double)mdLen / BENCH_MB) / (aMs[i] / 1000.0) : 0.0);
+      FlyFree(szMd);
+    }
+
+    // doubling 1 MB to 2 MB should no more than double the time
+    ratio = aMs[1] > 0.0 ? aMs[2] / aMs[1] : 0.0;
+    if(fVerbose)
+      printf("%-10s 1 MB => 2 MB time ratio %.2f (limit %.2f)\n", m_aszKinds[kind], ratio, 2.0 * limit);
+    if(ratio > 2.0 * limit)
+    {
+      printf("FAILED: %s is not linear, doubling input took %.2fx the time\n", m_aszKinds[kind], ratio);
+      fFailed = TRUE;
+    }
+
+    // time per byte for the largest document should be about the same as for 1 MB
+    i = NumElements(aSizes) - 1;
+    if(aMs[i] > 0.0 && aMs[1] > 0.0)
+    {
+      ratio = (aMs[i] / (double)aSizes[i]) / (aMs[1] / (double)aSizes[1]);
+      if(fVerbose)
+        printf("%-10s 1 MB => %d MB time per byte ratio %.2f (limit %.2f)\n", m_aszKinds[kind], maxMb, ratio, limit);
+      if(ratio > limit)
+      {
+        printf("FAILED: %s is not linear, %d MB took %.2fx the time per byte of 1 MB\n", m_aszKinds[kind],
+          maxMb, ratio);
+        fFailed = TRUE;
+      }
+    }
+  }
+
+  printf("\n%s\n", fFailed ? "FAILED" : "PASSED");
+  return fFailed ? 1 : 0;
+}
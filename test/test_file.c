@@ -6,6 +6,9 @@
 #include "FlyTest.h"
 #include "FlyFile.h"
 #include "FlyStr.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 /*-------------------------------------------------------------------------------------------------
   Test file info with various things
@@ -82,6 +85,129 @@ void TcFileExists(void)
   FlyTestEnd();
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileStat() and FlyFileStatBatch()
+-------------------------------------------------------------------------------------------------*/
+void TcFileStat(void)
+{
+  const char     *aszPaths[]  = { "tdata/hello.txt", "tdata_filelist/", "tdata/not_there.txt", "test_file.c" };
+  flyFileStat_t   aStats[NumElements(aszPaths)];
+  struct stat     st;
+  int             dirFd;
+  const char     *szName      = "hello.txt";
+
+  FlyTestBegin();
+
+  if(FlyFileStatBatch(aStats, aszPaths, NumElements(aszPaths), AT_FDCWD, 0) != 3)
+    FlyTestFailed();
+  if(stat(aszPaths[0], &st) != 0 || aStats[0].size != (uint64_t)st.st_size || aStats[0].ino != (uint64_t)st.st_ino ||
+     aStats[0].mtimeNs / 1000000000LL != (int64_t)st.st_mtime || aStats[0].flags != FLYFILESTAT_EXISTS ||
+     aStats[0].szPath != aszPaths[0])
+    FlyTestFailed();
+  if(!(aStats[1].flags & FLYFILESTAT_IS_DIR) || !S_ISDIR(aStats[1].mode))
+    FlyTestFailed();
+  if(aStats[2].flags != 0 || aStats[2].size != 0)
+    FlyTestFailed();
+
+  // read-only from mode bits or from access()
+  if(!FlyFileWrite("tmp_stat.txt", "abc"))
+    FlyTestFailed();
+  chmod("tmp_stat.txt", 0444);
+  if(!FlyFileStat(&aStats[0], "tmp_stat.txt", 0) || !(aStats[0].flags & FLYFILESTAT_RDONLY) || aStats[0].size != 3)
+    FlyTestFailed();
+  if(!FlyFileStat(&aStats[0], "tmp_stat.txt", FLYFILESTAT_OPT_ACCESS) ||
+     ((aStats[0].flags & FLYFILESTAT_RDONLY) != 0) != (access("tmp_stat.txt", W_OK) != 0))
+    FlyTestFailed();
+  remove("tmp_stat.txt");
+
+  // relative to a folder
+  dirFd = open("tdata", O_RDONLY);
+  if(dirFd < 0 || FlyFileStatBatch(aStats, &szName, 1, dirFd, 0) != 1 || aStats[0].size != (uint64_t)st.st_size)
+    FlyTestFailed();
+  if(dirFd >= 0)
+    close(dirFd);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFilePathCache gives the same answers as FlyFileFindInPath() and FlyFileFindInFolder()
+-------------------------------------------------------------------------------------------------*/
+void TcFilePathCache(void)
+{
+  static const char  *aszNames[]    = { "sh", "ls", "cc", "not_a_command_xyz" };
+  char                szExp[PATH_MAX];
+  char                szGot[PATH_MAX];
+  char               *szOldPath;
+  void               *hCache;
+  unsigned            i;
+  unsigned            j;
+  bool_t              fExp;
+  bool_t              fGot;
+
+  FlyTestBegin();
+
+  hCache = FlyFilePathCacheNew(60);
+  if(!FlyFilePathCacheIsCache(hCache))
+    FlyTestFailed();
+
+  // twice, so 2nd is from the cache
+  for(j = 0; j < 2; ++j)
+  {
+    for(i = 0; i < NumElements(aszNames); ++i)
+    {
+      *szExp = *szGot = '\0';
+      fExp = FlyFileFindInPath(szExp, sizeof(szExp), aszNames[i], FALSE);
+      fGot = FlyFilePathCacheFindInPath(hCache, szGot, sizeof(szGot), aszNames[i], FALSE);
+      if(fExp != fGot || (fExp && strcmp(szExp, szGot) != 0))
+      {
+        FlyTestPrintf("%s: exp %u %s, got %u %s\n", aszNames[i], fExp, szExp, fGot, szGot);
+        FlyTestFailed();
+      }
+    }
+
+    fExp = FlyFileFindInFolder(szExp, sizeof(szExp), "Makefile", "tdata_filelist/subdir1");
+    fGot = FlyFilePathCacheFindInFolder(hCache, szGot, sizeof(szGot), "Makefile", "tdata_filelist/subdir1");
+    if(!fExp || !fGot || strcmp(szExp, szGot) != 0)
+      FlyTestFailed();
+    if(FlyFilePathCacheFindInFolder(hCache, szGot, sizeof(szGot), "not_a_file_xyz", NULL))
+      FlyTestFailed();
+  }
+
+  // changing $PATH rebuilds the table
+  FlyFileMakeDir("tmp_pathcache");
+  FlyFileWrite("tmp_pathcache/mytool", "");
+  szOldPath = FlyStrClone(getenv("PATH"));
+  setenv("PATH", "tmp_pathcache", 1);
+  if(!FlyFilePathCacheFindInPath(hCache, szGot, sizeof(szGot), "mytool", FALSE) ||
+     strcmp(szGot, "tmp_pathcache/mytool") != 0 || FlyFilePathCacheFindInPath(hCache, szGot, sizeof(szGot), "sh", FALSE))
+    FlyTestFailed();
+  if(szOldPath)
+    setenv("PATH", szOldPath, 1);
+  FlyFreeIf(szOldPath);
+
+  // cached until flushed
+  FlyFileMakeDir("tmp_pathcache/sub");
+  if(FlyFilePathCacheFindInFolder(hCache, szGot, sizeof(szGot), "mytool2", "tmp_pathcache/sub"))
+    FlyTestFailed();
+  FlyFileWrite("tmp_pathcache/sub/mytool2", "");
+  if(FlyFilePathCacheFindInFolder(hCache, szGot, sizeof(szGot), "mytool2", "tmp_pathcache/sub"))
+    FlyTestFailed();
+  FlyFilePathCacheFlush(hCache);
+  if(!FlyFilePathCacheFindInFolder(hCache, szGot, sizeof(szGot), "mytool2", "tmp_pathcache/sub") ||
+     !FlyFileFindInFolder(szExp, sizeof(szExp), "mytool2", "tmp_pathcache/sub") || strcmp(szExp, szGot) != 0)
+    FlyTestFailed();
+  remove("tmp_pathcache/sub/mytool2");
+  remove("tmp_pathcache/mytool");
+  rmdir("tmp_pathcache/sub");
+  rmdir("tmp_pathcache");
+
+  if(FlyFilePathCacheFree(hCache) != NULL)
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
 /*-------------------------------------------------------------------------------------------------
   Test FlyFileHomeGet(), FlyFileHomeGetLen(), FlyFileHomeExpand(), FlyFileHomeReduce()
 -------------------------------------------------------------------------------------------------*/
@@ -162,6 +288,707 @@ void TcFileHome(void)
   FlyTestEnd();
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Test mapping files, both regular (mmap) and special (read fallback)
+-------------------------------------------------------------------------------------------------*/
+void TcFileMap(void)
+{
+  static const char   szPipeData[]  = "piped\ndata\n";
+  static const char  *aszFiles[]    = { "tdata/hello.txt", "tdata/md2html.md" };
+  flyFileMap_t        map;
+  char               *szFile;
+  char                szPath[32];
+  int                 aFd[2];
+  unsigned            i;
+
+  FlyTestBegin();
+
+  // regular files are mapped, contents match FlyFileRead() and are '\0' terminated
+  for(i = 0; i < NumElements(aszFiles); ++i)
+  {
+    szFile = FlyFileRead(aszFiles[i]);
+    if(!szFile || !FlyFileMap(&map, aszFiles[i], FLYFILEMAP_SEQUENTIAL | FLYFILEMAP_WILLNEED))
+    {
+      FlyTestPrintf("could not read %s\n", aszFiles[i]);
+      FlyTestFailed();
+    }
+    if(!FlyFileMapIsMapped(&map) || map.len != strlen(szFile) || map.pData[map.len] != '\0' ||
+       memcmp(map.pData, szFile, map.len) != 0)
+    {
+      FlyTestPrintf("%s: len %zu, expected %zu\n", aszFiles[i], map.len, strlen(szFile));
+      FlyTestFailed();
+    }
+    FlyFileUnmap(&map);
+    FlyFileUnmap(&map);
+    if(map.pData || map.len)
+      FlyTestFailed();
+    free(szFile);
+  }
+
+  // missing files and folders fail
+  if(FlyFileMap(&map, "tdata/not_there", FLYFILEMAP_NORMAL) || map.pData)
+    FlyTestFailed();
+  if(FlyFileMap(&map, "tdata", FLYFILEMAP_RANDOM) || map.pData)
+    FlyTestFailed();
+
+  // pipes fall back to read()
+  if(pipe(aFd) != 0)
+    FlyTestFailed();
+  if(write(aFd[1], szPipeData, strlen(szPipeData)) != (ssize_t)strlen(szPipeData))
+    FlyTestFailed();
+  close(aFd[1]);
+  snprintf(szPath, sizeof(szPath), "/dev/fd/%d", aFd[0]);
+  if(!FlyFileMap(&map, szPath, FLYFILEMAP_SEQUENTIAL))
+    FlyTestFailed();
+  if(FlyFileMapIsMapped(&map) || map.len != strlen(szPipeData) || strcmp(map.pData, szPipeData) != 0)
+  {
+    FlyTestPrintf("pipe: len %zu, %s\n", map.len, map.pData ? map.pData : "(null)");
+    FlyTestFailed();
+  }
+  FlyFileUnmap(&map);
+  close(aFd[0]);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test 64-bit clean binary reads and writes, whole files and at offsets
+-------------------------------------------------------------------------------------------------*/
+void TcFileBinEx(void)
+{
+  static const char   szTmpFile[]   = "tmp_binex.bin";
+  const size_t        size          = 3 * 1024 * 1024 + 7;
+  uint8_t            *pData;
+  uint8_t            *pFile;
+  uint8_t             aBuf[16];
+  size_t              len;
+  size_t              i;
+  int                 fd;
+
+  FlyTestBegin();
+
+  pData = malloc(size);
+  if(!pData)
+    FlyTestFailed();
+  for(i = 0; i < size; ++i)
+    pData[i] = (uint8_t)(i * 31 + (i >> 8));
+
+  // whole file, including '\0' bytes, is '\0' terminated
+  if(!FlyFileWriteBinEx(szTmpFile, pData, size))
+    FlyTestFailed();
+  pFile = FlyFileReadBinEx(szTmpFile, &len);
+  if(!pFile || len != size || memcmp(pFile, pData, size) != 0 || pFile[size] != '\0')
+    FlyTestFailed();
+  free(pFile);
+
+  // at offsets, past end of file is a short read
+  fd = open(szTmpFile, O_RDWR);
+  if(fd < 0)
+    FlyTestFailed();
+  if(FlyFilePwrite(fd, "hello", 5, 1000000) != 5 || FlyFilePread(fd, aBuf, 5, 1000000) != 5 ||
+     memcmp(aBuf, "hello", 5) != 0)
+  {
+    FlyTestFailed();
+  }
+  if(FlyFilePread(fd, aBuf, sizeof(aBuf), (off_t)size - 3) != 3 || FlyFilePread(fd, aBuf, 1, (off_t)size) != 0)
+    FlyTestFailed();
+  close(fd);
+
+  // empty and missing files
+  if(!FlyFileWriteBinEx(szTmpFile, pData, 0))
+    FlyTestFailed();
+  pFile = FlyFileReadBinEx(szTmpFile, &len);
+  if(!pFile || len != 0)
+    FlyTestFailed();
+  free(pFile);
+  remove(szTmpFile);
+  if(FlyFileReadBinEx(szTmpFile, &len) != NULL || len != 0)
+    FlyTestFailed();
+
+  free(pData);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileWriteEx() line endings, across chunks, and FlyFileReadEx() normalizing them
+-------------------------------------------------------------------------------------------------*/
+void TcFileWriteEx(void)
+{
+  static const char   szTmpFile[]   = "tmp_writeex.txt";
+  static const char  *aszLines[]    = { "line\n", "crlf line\r\n", "cr\rline\n", "\n" };
+  char               *szContents;
+  char               *szExp;
+  char               *szFile;
+  uint8_t            *pFile;
+  const char         *psz;
+  size_t              len;
+  size_t              expLen;
+  size_t              lfLen;
+  long                fileLen;
+  unsigned            i;
+  unsigned            fCrLf;
+
+  FlyTestBegin();
+
+  // over 64k, so a CRLF lands on a chunk boundary somewhere, last line has no ending
+  szContents  = malloc(200000);
+  szExp       = malloc(300000);
+  if(!szContents || !szExp)
+    FlyTestFailed();
+  for(fCrLf = 0; fCrLf < 2; ++fCrLf)
+  {
+    len = expLen = lfLen = 0;
+    for(i = 0; len < 150000; ++i)
+    {
+      psz = aszLines[i % NumElements(aszLines)];
+      strcpy(&szContents[len], psz);
+      len += strlen(psz);
+      for(; *psz; ++psz)
+      {
+        if(*psz == '\n' && fCrLf)
+          szExp[expLen++] = '\r';
+        if(*psz != '\r')
+        {
+          szExp[expLen++] = *psz;
+          ++lfLen;
+        }
+      }
+    }
+    strcpy(&szContents[len], "last");
+    strcpy(&szExp[expLen], fCrLf ? "last\r\n" : "last\n");
+    expLen += strlen(&szExp[expLen]);
+    lfLen  += strlen("last\n");
+
+    if(!FlyFileWriteEx(szTmpFile, szContents, fCrLf))
+      FlyTestFailed();
+    pFile = FlyFileReadBin(szTmpFile, &fileLen);
+    if(!pFile || (size_t)fileLen != expLen || memcmp(pFile, szExp, expLen) != 0)
+    {
+      FlyTestPrintf("fCrLf %u: len %ld, expected %zu, differ at %zu\n", fCrLf, fileLen, expLen,
+                    pFile ? FlyMemDiff(pFile, szExp, expLen) : 0);
+      FlyTestFailed();
+    }
+    free(pFile);
+
+    // reads back as LF only
+    szFile = FlyFileReadEx(szTmpFile, FLYFILE_READ_LF);
+    if(!szFile || strchr(szFile, '\r') || strlen(szFile) != lfLen)
+      FlyTestFailed();
+    free(szFile);
+  }
+
+  // empty file stays empty
+  if(!FlyFileWriteEx(szTmpFile, "", TRUE))
+    FlyTestFailed();
+  szFile = FlyFileRead(szTmpFile);
+  if(!szFile || *szFile)
+    FlyTestFailed();
+  free(szFile);
+
+  remove(szTmpFile);
+  free(szContents);
+  free(szExp);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test reading files line by line with a fixed size buffer
+-------------------------------------------------------------------------------------------------*/
+void TcFileLines(void)
+{
+  static const char   szTmpFile[]   = "tmp_lines.txt";
+  static const char  *aszLines[]    =
+  {
+    "line one", "", "crlf line", "cr line", "0123456789abcdefghijklmnopqrstuvwxyz0123456789", "",
+    "012345678901234", "last"
+  };
+  static const char   szContents[]  =
+    "line one\n\ncrlf line\r\ncr line\r0123456789abcdefghijklmnopqrstuvwxyz0123456789\r\n\r"
+    "012345678901234\r\nlast";
+  static const size_t aBufSizes[]   = { 16, 17, 0 };
+  void               *hLines;
+  const char         *szLine;
+  char               *szFile;
+  const char         *psz;
+  size_t              len;
+  unsigned            i;
+  unsigned            j;
+
+  FlyTestBegin();
+
+  // mixed line endings, lines longer than buffer, CRLF split across buffer boundaries
+  if(!FlyFileWrite(szTmpFile, szContents))
+    FlyTestFailed();
+  for(j = 0; j < NumElements(aBufSizes); ++j)
+  {
+    hLines = FlyFileLinesNew(szTmpFile, aBufSizes[j]);
+    if(!FlyFileLinesIsLines(hLines))
+      FlyTestFailed();
+    for(i = 0; (szLine = FlyFileLinesNext(hLines, &len)) != NULL; ++i)
+    {
+      if(i >= NumElements(aszLines) || len != strlen(aszLines[i]) || strcmp(szLine, aszLines[i]) != 0 ||
+         FlyFileLinesLineNum(hLines) != i + 1)
+      {
+        FlyTestPrintf("bufSize %zu, line %u: got '%s', len %zu\n", aBufSizes[j], i, szLine, len);
+        FlyTestFailed();
+      }
+    }
+    if(i != NumElements(aszLines) || FlyFileLinesError(hLines))
+      FlyTestFailed();
+    if(FlyFileLinesNext(hLines, &len) != NULL || len != 0)
+      FlyTestFailed();
+    if(FlyFileLinesFree(hLines) != NULL)
+      FlyTestFailed();
+  }
+
+  // empty file has no lines
+  if(!FlyFileWrite(szTmpFile, ""))
+    FlyTestFailed();
+  hLines = FlyFileLinesNew(szTmpFile, 0);
+  if(!hLines || FlyFileLinesNext(hLines, NULL) != NULL)
+    FlyTestFailed();
+  FlyFileLinesFree(hLines);
+  remove(szTmpFile);
+
+  // same lines as FlyStrLineNext()
+  szFile = FlyFileRead("tdata/md2html.md");
+  hLines = FlyFileLinesNew("tdata/md2html.md", 32);
+  if(!szFile || !hLines)
+    FlyTestFailed();
+  for(psz = szFile; *psz; psz = FlyStrLineNext(psz))
+  {
+    szLine = FlyFileLinesNext(hLines, &len);
+    if(!szLine || len != FlyStrLineLen(psz) || strncmp(szLine, psz, len) != 0)
+    {
+      FlyTestPrintf("line %zu: %s\n", FlyFileLinesLineNum(hLines), szLine ? szLine : "(null)");
+      FlyTestFailed();
+    }
+  }
+  if(FlyFileLinesNext(hLines, NULL) != NULL)
+    FlyTestFailed();
+  FlyFileLinesFree(hLines);
+  free(szFile);
+
+  // missing file
+  if(FlyFileLinesNew("tdata/not_there", 0) != NULL)
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Are both files the same contents?
+-------------------------------------------------------------------------------------------------*/
+static bool_t TcFileSame(const char *szFile1, const char *szFile2)
+{
+  uint8_t  *pFile1;
+  uint8_t  *pFile2;
+  long      len1    = 0;
+  long      len2    = 0;
+  bool_t    fSame   = FALSE;
+
+  pFile1 = FlyFileReadBin(szFile1, &len1);
+  pFile2 = FlyFileReadBin(szFile2, &len2);
+  if(pFile1 && pFile2 && len1 == len2 && memcmp(pFile1, pFile2, len1) == 0)
+    fSame = TRUE;
+  if(pFile1)
+    free(pFile1);
+  if(pFile2)
+    free(pFile2);
+
+  return fSame;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test copying files and folder trees
+-------------------------------------------------------------------------------------------------*/
+void TcFileCopy(void)
+{
+  static const char   szBigFile[]   = "tmp_copy_big.bin";
+  static const char   szCopyFile[]  = "tmp_copy.bin";
+  static const char  *aszTree[]     = { "tmp_tree_in/a.txt", "tmp_tree_in/sub/b.txt", "tmp_tree_in/sub/c.bin" };
+  struct stat         stIn;
+  struct stat         stOut;
+  uint8_t            *pBig;
+  long                bigLen        = 3 * 1024 * 1024 + 17;
+  char                szPath[64];
+  unsigned            i;
+
+  FlyTestBegin();
+
+  // bigger than the copy buffer
+  pBig = malloc(bigLen);
+  if(!pBig)
+    FlyTestFailed();
+  for(i = 0; i < bigLen; ++i)
+    pBig[i] = (uint8_t)(i * 7 + (i >> 12));
+  if(!FlyFileWriteBin(szBigFile, pBig, bigLen))
+    FlyTestFailed();
+  free(pBig);
+  if(!FlyFileCopy(szCopyFile, szBigFile) || !TcFileSame(szCopyFile, szBigFile))
+    FlyTestFailed();
+
+  // preserve mode and times
+  chmod(szBigFile, 0640);
+  if(!FlyFileCopyEx(szCopyFile, szBigFile, FLYFILE_COPY_PRESERVE) || !TcFileSame(szCopyFile, szBigFile))
+    FlyTestFailed();
+  if(stat(szBigFile, &stIn) != 0 || stat(szCopyFile, &stOut) != 0 || stIn.st_mtime != stOut.st_mtime ||
+     (stIn.st_mode & 07777) != (stOut.st_mode & 07777))
+  {
+    FlyTestFailed();
+  }
+
+  // can't copy onto self, or missing file or folder
+  if(FlyFileCopy(szBigFile, szBigFile) || FlyFileCopy(szCopyFile, "tdata/not_there") || FlyFileCopy(szCopyFile, "tdata"))
+    FlyTestFailed();
+  if(!TcFileSame(szCopyFile, szBigFile))
+    FlyTestFailed();
+  remove(szBigFile);
+  remove(szCopyFile);
+
+  // copy a tree in parallel
+  FlyFileMakeDir("tmp_tree_in");
+  FlyFileMakeDir("tmp_tree_in/sub");
+  for(i = 0; i < NumElements(aszTree); ++i)
+  {
+    if(!FlyFileCopy(aszTree[i], (i & 1) ? "tdata/hello.txt" : "tdata/md2html.md"))
+      FlyTestFailed();
+  }
+  if(!FlyFileCopyTree("tmp_tree_out/", "tmp_tree_in/", FLYFILE_COPY_PRESERVE, 0))
+    FlyTestFailed();
+  for(i = 0; i < NumElements(aszTree); ++i)
+  {
+    snprintf(szPath, sizeof(szPath), "tmp_tree_out/%s", &aszTree[i][strlen("tmp_tree_in/")]);
+    if(!TcFileSame(szPath, aszTree[i]))
+    {
+      FlyTestPrintf("%s differs\n", szPath);
+      FlyTestFailed();
+    }
+    remove(szPath);
+    remove(aszTree[i]);
+  }
+  rmdir("tmp_tree_out/sub");
+  rmdir("tmp_tree_out");
+  rmdir("tmp_tree_in/sub");
+  rmdir("tmp_tree_in");
+
+  if(FlyFileCopyTree("tmp_tree_out", "tdata/not_there", 0, 1))
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test atomic writes and batches
+-------------------------------------------------------------------------------------------------*/
+void TcFileWriteAtomic(void)
+{
+  static const char   szTmpFile[]   = "tmp_atomic.txt";
+  static const char   szLf[]        = "a\nb\r\nc\n\nd\re";
+  static const char   szCrLf[]      = "a\r\nb\r\nc\r\n\r\nde";
+  struct stat         st;
+  char               *szBig;
+  char               *szBigCrLf;
+  char               *szFile;
+  void               *hBatch;
+  char                szPath[32];
+  unsigned            i;
+
+  FlyTestBegin();
+
+  // plain and CRLF conversion
+  if(!FlyFileWriteAtomic(szTmpFile, szLf, strlen(szLf), 0))
+    FlyTestFailed();
+  szFile = FlyFileRead(szTmpFile);
+  if(!szFile || strcmp(szFile, szLf) != 0)
+    FlyTestFailed();
+  FlyFreeIf(szFile);
+  if(!FlyFileWriteAtomic(szTmpFile, szLf, strlen(szLf), FLYFILE_WRITE_CRLF | FLYFILE_WRITE_SYNC))
+    FlyTestFailed();
+  szFile = FlyFileRead(szTmpFile);
+  if(!szFile || strcmp(szFile, szCrLf) != 0)
+    FlyTestFailed();
+  FlyFreeIf(szFile);
+
+  // more than one conversion chunk, mixed LF and CRLF, and existing mode is kept
+  szBig     = malloc(20000 * 8 + 1);
+  szBigCrLf = malloc(20000 * 8 + 1);
+  if(!szBig || !szBigCrLf)
+    FlyTestFailed();
+  *szBig = *szBigCrLf = '\0';
+  for(i = 0; i < 20000; ++i)
+  {
+    sprintf(&szBig[i * 7 + i / 2], (i & 1) ? "l%05u\r\n" : "l%05u\n", i);
+    sprintf(&szBigCrLf[i * 8], "l%05u\r\n", i);
+  }
+  chmod(szTmpFile, 0600);
+  if(!FlyFileWriteAtomic(szTmpFile, szBig, strlen(szBig), FLYFILE_WRITE_CRLF))
+    FlyTestFailed();
+  if(stat(szTmpFile, &st) != 0 || (st.st_mode & 0777) != 0600)
+    FlyTestFailed();
+  szFile = FlyFileRead(szTmpFile);
+  if(!szFile || strcmp(szFile, szBigCrLf) != 0)
+    FlyTestFailed();
+  FlyFreeIf(szFile);
+  free(szBig);
+  free(szBigCrLf);
+
+  // batch is not visible until committed, and discarded if not committed
+  hBatch = FlyFileWriteBatchNew(FLYFILE_WRITE_SYNC);
+  if(!FlyFileWriteBatchIsBatch(hBatch))
+    FlyTestFailed();
+  for(i = 0; i < 100; ++i)
+  {
+    snprintf(szPath, sizeof(szPath), "tmp_batch%u.txt", i);
+    if(!FlyFileWriteBatchAdd(hBatch, szPath, szPath, strlen(szPath)))
+      FlyTestFailed();
+  }
+  if(FlyFileExists("tmp_batch0.txt", NULL) || !FlyFileWriteBatchCommit(hBatch))
+    FlyTestFailed();
+  for(i = 0; i < 100; ++i)
+  {
+    snprintf(szPath, sizeof(szPath), "tmp_batch%u.txt", i);
+    szFile = FlyFileRead(szPath);
+    if(!szFile || strcmp(szFile, szPath) != 0)
+      FlyTestFailed();
+    FlyFreeIf(szFile);
+    remove(szPath);
+  }
+  if(!FlyFileWriteBatchAdd(hBatch, szTmpFile, "new", 3))
+    FlyTestFailed();
+  FlyFileWriteBatchFree(hBatch);
+  szFile = FlyFileRead(szTmpFile);
+  if(!szFile || strncmp(szFile, "l00000", 6) != 0)
+    FlyTestFailed();
+  FlyFreeIf(szFile);
+  remove(szTmpFile);
+
+  // folder doesn't exist
+  if(FlyFileWriteAtomic("tdata/not_there/file.txt", szLf, strlen(szLf), 0))
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test content hashes and the fingerprint database
+-------------------------------------------------------------------------------------------------*/
+void TcFileHash(void)
+{
+  static const char   szTmpFile[]   = "tmp_hash.txt";
+  static const char   szTmpDb[]     = "tmp_hash.db";
+  static const struct
+  {
+    const char   *sz;
+    uint64_t      hash;
+  } aVectors[] =
+  {
+    { "",     0xEF46DB3751D8E999ULL },
+    { "a",    0xD24EC4F1A98C6E5BULL },
+    { "abc",  0x44BC2CF5AD770999ULL },
+  };
+  struct timespec     aTimes[2]     = { { 1000000000, 0 }, { 1000000000, 0 } };
+  flyFileHash_t       state;
+  const char         *aszPaths[]    = { "tdata/hello.txt", szTmpFile, "tdata/not_there.txt" };
+  uint64_t            aHashes[NumElements(aszPaths)];
+  uint64_t            hash;
+  uint64_t            hash2;
+  char               *szData;
+  void               *hDb;
+  unsigned            i;
+  unsigned            j;
+
+  FlyTestBegin();
+
+  // known XXH64 values
+  for(i = 0; i < NumElements(aVectors); ++i)
+  {
+    if(FlyFileHashMem(aVectors[i].sz, strlen(aVectors[i].sz)) != aVectors[i].hash)
+      FlyTestFailed();
+  }
+
+  // streamed in any size pieces is the same as all at once
+  szData = malloc(1000);
+  if(!szData)
+    FlyTestFailed();
+  for(i = 0; i < 1000; ++i)
+    szData[i] = (char)(i * 7);
+  hash = FlyFileHashMem(szData, 1000);
+  for(i = 1; i < 70; i += 3)
+  {
+    FlyFileHashInit(&state, 0);
+    for(j = 0; j < 1000; j += i)
+      FlyFileHashUpdate(&state, &szData[j], (j + i <= 1000) ? i : 1000 - j);
+    if(FlyFileHashFinal(&state) != hash)
+      FlyTestFailed();
+  }
+
+  // files, singly and in parallel
+  if(!FlyFileWriteBin(szTmpFile, (uint8_t *)szData, 1000))
+    FlyTestFailed();
+  if(!FlyFileHashFile(szTmpFile, &hash2) || hash2 != hash || FlyFileHashFile("tdata/not_there.txt", &hash2))
+    FlyTestFailed();
+  if(FlyFileHashFiles(aszPaths, aHashes, NumElements(aszPaths), 0) != 2 || aHashes[1] != hash || aHashes[2] != 0)
+    FlyTestFailed();
+
+  // database: new is changed until updated (e.g. build failed), touched with the same contents is not
+  remove(szTmpDb);
+  hDb = FlyFileHashDbNew(szTmpDb);
+  if(!FlyFileHashDbIsDb(hDb))
+    FlyTestFailed();
+  if(!FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != hash)
+    FlyTestFailed();
+  if(!FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != hash)
+    FlyTestFailed();
+  if(!FlyFileHashDbUpdate(hDb, szTmpFile))
+    FlyTestFailed();
+  if(FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != hash)
+    FlyTestFailed();
+  utimensat(AT_FDCWD, szTmpFile, aTimes, 0);
+  if(FlyFileHashDbCheck(hDb, szTmpFile, NULL))
+    FlyTestFailed();
+  if(!FlyFileHashDbSave(hDb))
+    FlyTestFailed();
+  FlyFileHashDbFree(hDb);
+
+  // reloaded: same size and mtime is trusted without reading, new contents are changed
+  hDb = FlyFileHashDbNew(szTmpDb);
+  szData[0] = 'x';
+  FlyFileWriteBin(szTmpFile, (uint8_t *)szData, 1000);
+  utimensat(AT_FDCWD, szTmpFile, aTimes, 0);
+  if(FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != hash)
+    FlyTestFailed();
+  FlyFileWriteBin(szTmpFile, (uint8_t *)szData, 999);
+  if(!FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != FlyFileHashMem(szData, 999))
+    FlyTestFailed();
+
+  // not updated, so a failed build is retried after a save and reload
+  if(!FlyFileHashDbSave(hDb))
+    FlyTestFailed();
+  FlyFileHashDbFree(hDb);
+  hDb = FlyFileHashDbNew(szTmpDb);
+  if(!FlyFileHashDbCheck(hDb, szTmpFile, NULL) || !FlyFileHashDbUpdate(hDb, szTmpFile) ||
+     FlyFileHashDbCheck(hDb, szTmpFile, NULL))
+  {
+    FlyTestFailed();
+  }
+
+  // deleted is changed, and update removes it
+  remove(szTmpFile);
+  if(!FlyFileHashDbCheck(hDb, szTmpFile, &hash2) || hash2 != 0)
+    FlyTestFailed();
+  if(!FlyFileHashDbUpdate(hDb, szTmpFile) || !FlyFileHashDbCheck(hDb, szTmpFile, NULL))
+    FlyTestFailed();
+  FlyFileHashDbFree(hDb);
+  remove(szTmpDb);
+  free(szData);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Pipeline process function: checks files arrive in order with the right contents
+-------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+  unsigned    n;
+  unsigned    stopAt;
+  bool_t      fOk;
+} tcFilePipe_t;
+
+static bool_t TcFilePipeProcess(unsigned i, const char *szPath, const flyFileMap_t *pMap, void *pData)
+{
+  tcFilePipe_t *pPipe = pData;
+  char          szExp[32];
+
+  snprintf(szExp, sizeof(szExp), "file %u\n", i);
+  if(i != pPipe->n)
+    pPipe->fOk = FALSE;
+  else if(strstr(szPath, "not_there") ? (pMap != NULL) : (!pMap || strcmp(pMap->pData, szExp) != 0))
+    pPipe->fOk = FALSE;
+  ++pPipe->n;
+
+  // give the reader time to get ahead, so stopping has files read but not processed
+  if(i == pPipe->stopAt)
+    usleep(20000);
+
+  return (i == pPipe->stopAt) ? FALSE : TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFilePrefetch() and FlyFilePipeline()
+-------------------------------------------------------------------------------------------------*/
+void TcFilePrefetch(void)
+{
+  static const unsigned aAhead[] = { 0, 1, 2, 100 };
+  const char     *aszPaths[20];
+  char            aszNames[20][32];
+  char            szData[32];
+  tcFilePipe_t    pipe;
+  unsigned        i;
+  unsigned        n;
+
+  FlyTestBegin();
+
+  for(i = 0; i < NumElements(aszPaths); ++i)
+  {
+    if(i == 5)
+      snprintf(aszNames[i], sizeof(aszNames[i]), "tmp_pf_not_there");
+    else
+    {
+      snprintf(aszNames[i], sizeof(aszNames[i]), "tmp_pf%u.txt", i);
+      snprintf(szData, sizeof(szData), "file %u\n", i);
+      FlyFileWrite(aszNames[i], szData);
+    }
+    aszPaths[i] = aszNames[i];
+  }
+
+  if(FlyFilePrefetch(aszPaths, NumElements(aszPaths)) != NumElements(aszPaths) - 1)
+    FlyTestFailed();
+
+  for(i = 0; i < NumElements(aAhead); ++i)
+  {
+    // all files, in order
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.fOk    = TRUE;
+    pipe.stopAt = UINT_MAX;
+    n = FlyFilePipeline(aszPaths, NumElements(aszPaths), aAhead[i], TcFilePipeProcess, &pipe);
+    if(n != NumElements(aszPaths) || pipe.n != n || !pipe.fOk)
+    {
+      FlyTestPrintf("ahead %u: n %u, pipe.n %u, ok %u\n", aAhead[i], n, pipe.n, pipe.fOk);
+      FlyTestFailed();
+    }
+
+    // stop early
+    memset(&pipe, 0, sizeof(pipe));
+    pipe.fOk    = TRUE;
+    pipe.stopAt = 7;
+    n = FlyFilePipeline(aszPaths, NumElements(aszPaths), aAhead[i], TcFilePipeProcess, &pipe);
+    if(n != 8 || pipe.n != 8 || !pipe.fOk)
+    {
+      FlyTestPrintf("stop, ahead %u: n %u, pipe.n %u, ok %u\n", aAhead[i], n, pipe.n, pipe.fOk);
+      FlyTestFailed();
+    }
+  }
+
+  // single file and no files
+  memset(&pipe, 0, sizeof(pipe));
+  pipe.fOk    = TRUE;
+  pipe.stopAt = UINT_MAX;
+  if(FlyFilePipeline(aszPaths, 1, 0, TcFilePipeProcess, &pipe) != 1 || !pipe.fOk ||
+     FlyFilePipeline(aszPaths, 0, 0, TcFilePipeProcess, &pipe) != 0)
+  {
+    FlyTestFailed();
+  }
+
+  for(i = 0; i < NumElements(aszPaths); ++i)
+    remove(aszPaths[i]);
+
+  FlyTestEnd();
+}
+
 /*-------------------------------------------------------------------------------------------------
   Test each function
 -------------------------------------------------------------------------------------------------*/
@@ -172,7 +999,17 @@ int main(int argc, const char *argv[])
   {
     { "TcFileInfo",     TcFileInfo, "M" },
     { "TcFileExists",   TcFileExists },
+    { "TcFileStat",     TcFileStat },
+    { "TcFilePathCache", TcFilePathCache },
     { "TcFileHome",     TcFileHome },
+    { "TcFileMap",      TcFileMap },
+    { "TcFileLines",    TcFileLines },
+    { "TcFileWriteEx",  TcFileWriteEx },
+    { "TcFileBinEx",    TcFileBinEx },
+    { "TcFileCopy",     TcFileCopy },
+    { "TcFileWriteAtomic", TcFileWriteAtomic },
+    { "TcFileHash",     TcFileHash },
+    { "TcFilePrefetch", TcFilePrefetch },
   };
   hTestSuite_t        hSuite;
   int                 ret;
@@ -6,6 +6,9 @@
 #include "FlyTest.h"
 #include "FlyFile.h"
 #include "FlyStr.h"
+#include "FlyTabComplete.h"
+#include <pthread.h>
+#include <unistd.h>
 
 /*-------------------------------------------------------------------------------------------------
   Test file info with various things
@@ -194,8 +197,487 @@ void TcFileListNewExts(void)
         FlyTestPrintf("%s%s\n", aTests[i].szFolder, aTests[i].aszExpList[j]);
       FlyTestFailed();
     }
+    FlyFileListFree(hList);
   }
 
+  // unsorted has the same files, in directory order
+  hList = FlyFileListNewExtsEx("tdata_filelistnewexts/", ".c", 5, FLYFILELIST_OPTS_UNSORTED);
+  if(!hList || FlyFileListLen(hList) != NumElements(aszExpList3))
+    FlyTestFailed();
+  for(i = 0; hList && i < NumElements(aszExpList3); ++i)
+  {
+    FlyStrZCpy(szPath, "tdata_filelistnewexts/", sizeof(szPath));
+    FlyStrZCat(szPath, aszExpList3[i], sizeof(szPath));
+    if(FlyFileListFind(hList, szPath, 0, 0) == FLYFILELIST_NOT_FOUND)
+      FlyTestFailed();
+  }
+  FlyFileListFree(hList);
+
+  // folder must exist
+  if(FlyFileListNewExts("tdata_notthere/", ".c", 5) != NULL)
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  FlyFileWalk() callback, adds path to a list. Threads may call this at the same time.
+-------------------------------------------------------------------------------------------------*/
+typedef struct
+{
+  pthread_mutex_t   mutex;
+  unsigned          n;
+  char              aszPaths[32][64];
+  unsigned          stopAfter;
+} tcFileWalk_t;
+
+static bool_t TcFileWalkVisit(flyFileWalkEntry_t *pEntry, void *pData)
+{
+  tcFileWalk_t   *pWalk = pData;
+  bool_t          fContinue = TRUE;
+
+  pthread_mutex_lock(&pWalk->mutex);
+  if(pWalk->n < NumElements(pWalk->aszPaths))
+    FlyStrZCpy(pWalk->aszPaths[pWalk->n], pEntry->szPath, sizeof(pWalk->aszPaths[0]));
+  ++pWalk->n;
+  if(pWalk->stopAfter && pWalk->n >= pWalk->stopAfter)
+    fContinue = FALSE;
+  if(strcmp(pEntry->szName, "subsubdir1/") == 0)
+    pEntry->fSkip = TRUE;
+  if(pEntry->fIsDir != FlyStrPathIsFolder(pEntry->szPath) || strncmp(pEntry->szPath, "tdata_filelist/", 15) != 0)
+    fContinue = FALSE;
+  pthread_mutex_unlock(&pWalk->mutex);
+
+  return fContinue;
+}
+
+static int TcFileWalkCmp(const void *pThis, const void *pThat)
+{
+  return strcmp(pThis, pThat);
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileListFind() gives the same results with and without an index
+-------------------------------------------------------------------------------------------------*/
+void TcFileListFind(void)
+{
+  static const char  *aszFind[]   = { "../lib/FlyFile.c", "../lib/FLYFILE.C", ".c", ".H", "../lib/FlyStr",
+                                      "../LIB/FLY", "Str.c", "", "nothing", "../lib/" };
+  static const flyFileListOpts_t aOpts[] =
+  {
+    0, FLYFILELIST_OPTS_BEG, FLYFILELIST_OPTS_END, FLYFILELIST_OPTS_NOCASE,
+    FLYFILELIST_OPTS_BEG | FLYFILELIST_OPTS_NOCASE, FLYFILELIST_OPTS_END | FLYFILELIST_OPTS_NOCASE,
+    FLYFILELIST_OPTS_BEG | FLYFILELIST_OPTS_END
+  };
+  void       *hList;
+  void       *hIndexed;
+  unsigned    i, j, k;
+  unsigned    exp;
+  unsigned    got;
+
+  FlyTestBegin();
+
+  hList     = FlyFileListNewExts("../lib/", ".c.h", 0);
+  hIndexed  = FlyFileListNewExts("../lib/", ".c.h", 0);
+  if(FlyFileListLen(hList) < 10 || !FlyFileListIndex(hIndexed))
+    FlyTestFailed();
+
+  for(k = 0; k < 2; ++k)
+  {
+    for(i = 0; i < NumElements(aszFind); ++i)
+    {
+      for(j = 0; j < NumElements(aOpts); ++j)
+      {
+        // every start index, so each match is found in turn
+        exp = got = 0;
+        while(exp != FLYFILELIST_NOT_FOUND)
+        {
+          exp = FlyFileListFind(hList, aszFind[i], got, aOpts[j]);
+          got = FlyFileListFind(hIndexed, aszFind[i], got, aOpts[j]);
+          if(exp != got)
+          {
+            FlyTestPrintf("%s opts %x: expected %u, got %u\n", aszFind[i], aOpts[j], exp, got);
+            FlyTestFailed();
+          }
+          if(got != FLYFILELIST_NOT_FOUND)
+            ++got;
+        }
+      }
+    }
+
+    // sorting changes indexes, so the index must be rebuilt
+    FlyFileListSort(hList, NULL);
+    FlyFileListSort(hIndexed, NULL);
+  }
+
+  FlyFileListFree(hList);
+  FlyFileListFree(hIndexed);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileListSortEx() with each option, and that the default order matches strcmp()
+-------------------------------------------------------------------------------------------------*/
+void TcFileListSort(void)
+{
+  typedef struct
+  {
+    flyFileListOpts_t   opts;
+    const char         *aszExp[6];
+  } tcFileListSort_t;
+  static const tcFileListSort_t aTests[] =
+  {
+    { 0, { "tmp_sort/File1.c", "tmp_sort/a/", "tmp_sort/dir10/", "tmp_sort/dir9/", "tmp_sort/file10.c", "tmp_sort/file2.c" } },
+    { FLYFILELIST_OPTS_NOCASE,
+      { "tmp_sort/a/", "tmp_sort/dir10/", "tmp_sort/dir9/", "tmp_sort/File1.c", "tmp_sort/file10.c", "tmp_sort/file2.c" } },
+    { FLYFILELIST_OPTS_NATURAL,
+      { "tmp_sort/File1.c", "tmp_sort/a/", "tmp_sort/dir9/", "tmp_sort/dir10/", "tmp_sort/file2.c", "tmp_sort/file10.c" } },
+    { FLYFILELIST_OPTS_NATURAL | FLYFILELIST_OPTS_NOCASE | FLYFILELIST_OPTS_DIRSFIRST,
+      { "tmp_sort/a/", "tmp_sort/dir9/", "tmp_sort/dir10/", "tmp_sort/File1.c", "tmp_sort/file2.c", "tmp_sort/file10.c" } },
+  };
+  void       *hList;
+  unsigned    i, j;
+  unsigned    len;
+
+  FlyTestBegin();
+
+  FlyFileMakeDir("tmp_sort");
+  FlyFileMakeDir("tmp_sort/a");
+  FlyFileMakeDir("tmp_sort/dir10");
+  FlyFileMakeDir("tmp_sort/dir9");
+  FlyFileWrite("tmp_sort/file10.c", "");
+  FlyFileWrite("tmp_sort/file2.c", "");
+  FlyFileWrite("tmp_sort/File1.c", "");
+
+  hList = FlyFileListNew("tmp_sort/*");
+  if(FlyFileListLen(hList) != NumElements(aTests[0].aszExp))
+    FlyTestFailed();
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    if(!FlyFileListSortEx(hList, aTests[i].opts))
+      FlyTestFailed();
+    for(j = 0; j < NumElements(aTests[i].aszExp); ++j)
+    {
+      if(strcmp(FlyFileListGetName(hList, j), aTests[i].aszExp[j]) != 0)
+      {
+        FlyTestPrintf("opts %x: %u expected %s, got %s\n", aTests[i].opts, j, aTests[i].aszExp[j], FlyFileListGetName(hList, j));
+        FlyTestFailed();
+      }
+    }
+  }
+  FlyFileListFree(hList);
+  remove("tmp_sort/file10.c");
+  remove("tmp_sort/file2.c");
+  remove("tmp_sort/File1.c");
+  rmdir("tmp_sort/a");
+  rmdir("tmp_sort/dir10");
+  rmdir("tmp_sort/dir9");
+  rmdir("tmp_sort");
+
+  // a larger unsorted list sorts the same as strcmp(), with all strings intact
+  hList = FlyFileListNewExtsEx("../", ".c.h.md.", 2, FLYFILELIST_OPTS_UNSORTED);
+  len   = FlyFileListLen(hList);
+  if(len < 100 || !FlyFileListSortEx(hList, FLYFILELIST_OPTS_NATURAL) || FlyFileListLen(hList) != len)
+    FlyTestFailed();
+  FlyFileListSort(hList, NULL);
+  for(i = 1; i < len; ++i)
+  {
+    if(strcmp(FlyFileListGetName(hList, i - 1), FlyFileListGetName(hList, i)) >= 0)
+    {
+      FlyTestPrintf("%u: %s >= %s\n", i, FlyFileListGetName(hList, i - 1), FlyFileListGetName(hList, i));
+      FlyTestFailed();
+    }
+  }
+  FlyFileListFree(hList);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileWalk(), single and multi-threaded
+-------------------------------------------------------------------------------------------------*/
+void TcFileWalk(void)
+{
+  typedef struct
+  {
+    unsigned      maxDepth;
+    unsigned      opts;
+    unsigned      nThreads;
+    unsigned      len;
+    const char  **aszExpList;
+  } tcFileWalkTest_t;
+
+  const char *aszExpAll[] = { "tdata_filelist/.hidden", "tdata_filelist/file1.txt", "tdata_filelist/file2.txt",
+                              "tdata_filelist/subdir1/", "tdata_filelist/subdir1/subfile1.txt",
+                              "tdata_filelist/subdir1/subsubdir1/", "tdata_filelist/subdir2/",
+                              "tdata_filelist/subdir2/subfile2.txt" };
+  const char *aszExpTop[] = { "tdata_filelist/file1.txt", "tdata_filelist/file2.txt",
+                              "tdata_filelist/subdir1/", "tdata_filelist/subdir2/" };
+  const tcFileWalkTest_t aTests[] =
+  {
+    { UINT_MAX, FLYFILEWALK_HIDDEN, 1, NumElements(aszExpAll), aszExpAll },
+    { UINT_MAX, FLYFILEWALK_HIDDEN, 4, NumElements(aszExpAll), aszExpAll },
+    { 0,        0,                  1, NumElements(aszExpTop), aszExpTop },
+    { 0,        0,                  3, NumElements(aszExpTop), aszExpTop },
+  };
+  tcFileWalk_t    walk;
+  unsigned        i, j;
+
+  FlyTestBegin();
+
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    memset(&walk, 0, sizeof(walk));
+    pthread_mutex_init(&walk.mutex, NULL);
+    if(!FlyFileWalk("tdata_filelist", aTests[i].maxDepth, aTests[i].opts, aTests[i].nThreads, TcFileWalkVisit, &walk))
+      FlyTestFailed();
+    pthread_mutex_destroy(&walk.mutex);
+
+    // order is not defined, so sort before comparing
+    qsort(walk.aszPaths, walk.n, sizeof(walk.aszPaths[0]), TcFileWalkCmp);
+    for(j = 0; j < aTests[i].len && j < walk.n; ++j)
+    {
+      if(strcmp(walk.aszPaths[j], aTests[i].aszExpList[j]) != 0)
+        break;
+    }
+    if(walk.n != aTests[i].len || j != aTests[i].len)
+    {
+      FlyTestPrintf("%u: got %u entries, expected %u\n", i, walk.n, aTests[i].len);
+      for(j = 0; j < walk.n && j < NumElements(walk.aszPaths); ++j)
+        FlyTestPrintf("  %s\n", walk.aszPaths[j]);
+      FlyTestFailed();
+    }
+  }
+
+  // callback can stop the walk
+  memset(&walk, 0, sizeof(walk));
+  pthread_mutex_init(&walk.mutex, NULL);
+  walk.stopAfter = 2;
+  if(FlyFileWalk("tdata_filelist/", UINT_MAX, 0, 1, TcFileWalkVisit, &walk) || walk.n != 2)
+    FlyTestFailed();
+  pthread_mutex_destroy(&walk.mutex);
+
+  // missing folder
+  if(FlyFileWalk("tdata_notthere", UINT_MAX, 0, 1, TcFileWalkVisit, &walk))
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Count paths found by FlyFileCacheFind()
+-------------------------------------------------------------------------------------------------*/
+static bool_t TcFileCacheCount(const char *szPath, void *pData)
+{
+  (void)szPath;
+  ++(*(unsigned *)pData);
+  return TRUE;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyFileCache, both with inotify and with the mtime fallback
+-------------------------------------------------------------------------------------------------*/
+void TcFileCache(void)
+{
+  static const flyFileCacheOpts_t aOpts[] = { 0, FLYFILECACHE_NO_WATCH };
+  const flyFileCacheEntry_t  *pEntry;
+  const flyFileCacheEntry_t  *aEntries;
+  void                       *hCache;
+  unsigned                    i;
+  unsigned                    n;
+  unsigned                    count;
+
+  FlyTestBegin();
+
+  for(i = 0; i < NumElements(aOpts); ++i)
+  {
+    FlyFileMakeDir("tmp_cache");
+    FlyFileMakeDir("tmp_cache/sub");
+    FlyFileWrite("tmp_cache/a.c", "a");
+    FlyFileWrite("tmp_cache/b.h", "b");
+    FlyFileWrite("tmp_cache/sub/d.c", "d");
+
+    hCache = FlyFileCacheNew(aOpts[i]);
+    if(!FlyFileCacheIsCache(hCache))
+      FlyTestFailed();
+
+    // sorted, folders end in slash
+    aEntries = FlyFileCacheDir(hCache, "tmp_cache", &n);
+    if(!aEntries || n != 3 || strcmp(aEntries[0].szName, "a.c") != 0 || strcmp(aEntries[2].szName, "sub/") != 0 ||
+       !aEntries[2].fIsDir || aEntries[0].fIsDir)
+    {
+      FlyTestPrintf("%u: n %u\n", i, n);
+      FlyTestFailed();
+    }
+
+    count = 0;
+    if(!FlyFileCacheFind(hCache, "tmp_cache/", ".c", UINT_MAX, TcFileCacheCount, &count) || count != 2)
+      FlyTestFailed();
+    count = 0;
+    if(!FlyFileCacheFind(hCache, "tmp_cache", ".c.h", 0, TcFileCacheCount, &count) || count != 2)
+      FlyTestFailed();
+
+    // new and deleted files are seen
+    FlyFileWrite("tmp_cache/sub/e.c", "e");
+    count = 0;
+    if(!FlyFileCacheFind(hCache, "tmp_cache/", ".c", UINT_MAX, TcFileCacheCount, &count) || count != 3)
+    {
+      FlyTestPrintf("%u: count %u\n", i, count);
+      FlyTestFailed();
+    }
+    remove("tmp_cache/a.c");
+    count = 0;
+    if(!FlyFileCacheFind(hCache, "tmp_cache/", ".c", UINT_MAX, TcFileCacheCount, &count) || count != 2)
+      FlyTestFailed();
+
+    // stats of files and folders
+    pEntry = FlyFileCacheStat(hCache, "tmp_cache/b.h");
+    if(!pEntry || pEntry->size != 1)
+      FlyTestFailed();
+    pEntry = FlyFileCacheStat(hCache, "tmp_cache/sub");
+    if(!pEntry || !pEntry->fIsDir || !FlyFileCacheStat(hCache, "tmp_cache/sub/") || FlyFileCacheStat(hCache, "tmp_cache/a.c"))
+      FlyTestFailed();
+
+    // folder without slash is found even with "sub.c" sorted between "sub" and "sub/"
+    FlyFileWrite("tmp_cache/sub.c", "s");
+    pEntry = FlyFileCacheStat(hCache, "tmp_cache/sub");
+    if(!pEntry || !pEntry->fIsDir || !FlyFileCacheStat(hCache, "tmp_cache/sub.c") ||
+       FlyFileCacheStat(hCache, "tmp_cache/sub.c/") || FlyFileCacheStat(hCache, "tmp_cache/b.h/"))
+    {
+      FlyTestPrintf("%u: sub not found\n", i);
+      FlyTestFailed();
+    }
+
+    // with inotify, writes to existing files are seen too
+    if(aOpts[i] == 0)
+    {
+      FlyFileWrite("tmp_cache/b.h", "bbbb");
+      pEntry = FlyFileCacheStat(hCache, "tmp_cache/b.h");
+      if(!pEntry || pEntry->size != 4)
+        FlyTestFailed();
+    }
+
+    // flush still leaves a usable cache
+    FlyFileCacheFlush(hCache);
+    if(!FlyFileCacheDir(hCache, "tmp_cache/sub/", &n) || n != 2 || FlyFileCacheDir(hCache, "tmp_notthere", &n) || n)
+      FlyTestFailed();
+    if(FlyFileCacheFree(hCache) != NULL)
+      FlyTestFailed();
+
+    remove("tmp_cache/b.h");
+    remove("tmp_cache/sub.c");
+    remove("tmp_cache/sub/d.c");
+    remove("tmp_cache/sub/e.c");
+    rmdir("tmp_cache/sub");
+    rmdir("tmp_cache");
+  }
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyTabComplete() with and without wildcards
+-------------------------------------------------------------------------------------------------*/
+void TcTabComplete(void)
+{
+  typedef struct
+  {
+    const char   *szPath;
+    unsigned      len;
+    const char   *aszExp[3];
+  } tcTabCompleteTest_t;
+
+  const tcTabCompleteTest_t aTests[] =
+  {
+    { "tdata_filelist/f",     2, { "tdata_filelist/file1.txt", "tdata_filelist/file2.txt" } },
+    { "tdata_filelist/file2", 1, { "tdata_filelist/file2.txt" } },
+    { "tdata_filelist/",      4, { "tdata_filelist/file1.txt", "tdata_filelist/file2.txt",
+                                   "tdata_filelist/subdir1/" } },
+    { "tdata_filelist/.",     1, { "tdata_filelist/.hidden" } },
+    { "tdata_filelist/x",     0, { NULL } },
+    { "tdata_filelist/*1*",   2, { "tdata_filelist/file1.txt", "tdata_filelist/subdir1/" } },
+    { "tdata_notthere/f",     0, { NULL } },
+  };
+  const char *aszHiddenExp[] = { "tmp_tab/#x", "tmp_tab/-dash", "tmp_tab/abc" };
+  char        szPath[PATH_MAX];
+  void       *hTabComplete;
+  unsigned    i;
+  unsigned    j;
+
+  FlyTestBegin();
+
+  hTabComplete = FlyTabCompleteNew(sizeof(szPath));
+  if(!hTabComplete)
+    FlyTestFailed();
+
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    strcpy(szPath, aTests[i].szPath);
+    for(j = 0; FlyTabComplete(hTabComplete, szPath); ++j)
+    {
+      if(j < NumElements(aTests[i].aszExp) && aTests[i].aszExp[j] && strcmp(szPath, aTests[i].aszExp[j]) != 0)
+      {
+        FlyTestPrintf("%u: got %s, expected %s\n", i, szPath, aTests[i].aszExp[j]);
+        FlyTestFailed();
+      }
+    }
+    if(j != aTests[i].len || (j == 0 && strcmp(szPath, aTests[i].szPath) != 0))
+    {
+      FlyTestPrintf("%u: got %u matches, expected %u\n", i, j, aTests[i].len);
+      FlyTestFailed();
+    }
+  }
+
+  // rewind, and a new file in the folder is seen on the next keystroke
+  strcpy(szPath, "tdata_filelist/f");
+  if(!FlyTabComplete(hTabComplete, szPath) || !FlyTabComplete(hTabComplete, szPath) ||
+     !FlyTabCompleteRewind(hTabComplete) || !FlyTabComplete(hTabComplete, szPath) ||
+     strcmp(szPath, "tdata_filelist/file1.txt") != 0)
+  {
+    FlyTestFailed();
+  }
+  FlyFileWrite("tdata_filelist/file0.txt", "");
+  strcpy(szPath, "tdata_filelist/fi");
+  if(!FlyTabComplete(hTabComplete, szPath) || strcmp(szPath, "tdata_filelist/file0.txt") != 0)
+    FlyTestFailed();
+  remove("tdata_filelist/file0.txt");
+
+  // hidden names are skipped wherever they sort, even after names like "#x" and "-dash"
+  FlyFileMakeDir("tmp_tab");
+  FlyFileWrite("tmp_tab/-dash", "");
+  FlyFileWrite("tmp_tab/#x", "");
+  FlyFileWrite("tmp_tab/.hidden", "");
+  FlyFileWrite("tmp_tab/abc", "");
+  strcpy(szPath, "tmp_tab/");
+  for(j = 0; FlyTabComplete(hTabComplete, szPath); ++j)
+  {
+    if(j >= NumElements(aszHiddenExp) || strcmp(szPath, aszHiddenExp[j]) != 0)
+    {
+      FlyTestPrintf("hidden %u: got %s\n", j, szPath);
+      FlyTestFailed();
+    }
+  }
+  if(j != NumElements(aszHiddenExp))
+    FlyTestFailed();
+  if(!FlyTabCompleteRewind(hTabComplete) || !FlyTabComplete(hTabComplete, szPath) ||
+     strcmp(szPath, "tmp_tab/#x") != 0)
+  {
+    FlyTestFailed();
+  }
+  strcpy(szPath, "tmp_tab/.");
+  if(!FlyTabComplete(hTabComplete, szPath) || strcmp(szPath, "tmp_tab/.hidden") != 0 ||
+     FlyTabComplete(hTabComplete, szPath))
+  {
+    FlyTestFailed();
+  }
+  remove("tmp_tab/-dash");
+  remove("tmp_tab/#x");
+  remove("tmp_tab/.hidden");
+  remove("tmp_tab/abc");
+  rmdir("tmp_tab");
+
+  FlyTabCompleteFree(hTabComplete);
 
   FlyTestEnd();
 }
@@ -210,6 +692,11 @@ int main(int argc, const char *argv[])
   {
     { "TcFileListNew",  TcFileListNew },
     { "TcFileListNewExts",  TcFileListNewExts },
+    { "TcFileListFind", TcFileListFind },
+    { "TcFileListSort", TcFileListSort },
+    { "TcFileWalk",     TcFileWalk },
+    { "TcFileCache",    TcFileCache },
+    { "TcTabComplete",  TcTabComplete },
   };
   hTestSuite_t        hSuite;
   int                 ret;
@@ -1738,6 +1738,7 @@ void TcMd2HtmlFile(void)
   size_t      len;
   size_t      len2;
   size_t      allocLen;
+  size_t      size;
   size_t      pos;
   unsigned    line, col;
 
@@ -1816,6 +1817,19 @@ void TcMd2HtmlFile(void)
     FlyTestFailed();
   }
 
+  // a too small buffer is never overrun, and any HTML that doesn't fill it is complete
+  for(size = 1; size <= len + 1; size += 13)
+  {
+    FlyStrZFill(szHtml, 'Q', allocLen, allocLen - 1);
+    FlyMd2HtmlFile(szHtml, size, szFileMd, "md2html.md");
+    if(szHtml[size] != 'Q' || strlen(szHtml) >= size ||
+       (strlen(szHtml) + 1 < size && strcmp(szHtml, szFileHtml) != 0))
+    {
+      FlyTestPrintf("size %zu: len %zu\n", size, strlen(szHtml));
+      FlyTestFailed();
+    }
+  }
+
   FlyTestEnd();
 
   remove(szTmpFile);
@@ -1825,6 +1839,556 @@ void TcMd2HtmlFile(void)
     FlyFree((void *)szFileHtml);
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Helper to TcMdNPBrk(). Simple byte by byte version of FlyMdNPBrk() to compare against.
+-------------------------------------------------------------------------------------------------*/
+static const char * TcMdNPBrkSimple(const char *sz, const char *szEnd, const char *szAccept)
+{
+  const char *szFound     = NULL;
+  bool_t      fInLineCode = FALSE;
+  bool_t      fCodeOk     = strchr(szAccept, '`') ? FALSE : TRUE;
+
+  while(sz < szEnd && *sz)
+  {
+    if(*sz == '\\' && (sz + 1 < szEnd) && (sz[1] > ' ' && sz[1] <= '~'))
+      sz += 2;
+    else
+    {
+      if(fCodeOk && *sz == '`')
+        fInLineCode = !fInLineCode;
+      if(!fInLineCode && strchr(szAccept, *sz))
+      {
+        szFound = sz;
+        break;
+      }
+      ++sz;
+    }
+  }
+
+  return szFound;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlyMdNPBrk()
+-------------------------------------------------------------------------------------------------*/
+void TcMdNPBrk(void)
+{
+  typedef struct
+  {
+    const char *sz;
+    const char *szAccept;
+    int         pos;      // -1 if not found
+  } tcMdNPBrk_t;
+  static const tcMdNPBrk_t aTests[] =
+  {
+    { "Ignores escapes \\? `in-line code!` but finds !this", "?!", 45 },
+    { "no special chars here", "*=~^&<![`", -1 },
+    { "text then `code`", "*=~^&<![`", 10 },
+    { "a \\* b *", "*", 7 },
+    { "ends in \\", "\\", 8 },
+    { "\xff\xfe high bytes &", "&", 14 },
+  };
+  static const char szAlphabet[] = "ab*`\\[&\n\xe9 ";
+  const char   *szAccepts[] = { "*=~^&<![`", "]", "*", "`", "\\" };
+  char          szRand[64];
+  const char   *psz;
+  const char   *pszExp;
+  unsigned      i, j, k;
+
+  FlyTestBegin();
+
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    psz = FlyMdNPBrk(aTests[i].sz, aTests[i].sz + strlen(aTests[i].sz), aTests[i].szAccept);
+    if((aTests[i].pos < 0 && psz) || (aTests[i].pos >= 0 && psz != &aTests[i].sz[aTests[i].pos]))
+    {
+      FlyTestPrintf("%u: %s, got %d, expected %d\n", i, aTests[i].sz, psz ? (int)(psz - aTests[i].sz) : -1,
+        aTests[i].pos);
+      FlyTestFailed();
+    }
+  }
+
+  // compare to simple version on lots of random strings, with random end points
+  srand(1);
+  for(i = 0; i < 2000; ++i)
+  {
+    k = (unsigned)rand() % (sizeof(szRand) - 1);
+    for(j = 0; j < k; ++j)
+      szRand[j] = szAlphabet[(unsigned)rand() % (sizeof(szAlphabet) - 1)];
+    szRand[k] = '\0';
+    j = k ? (unsigned)rand() % (k + 1) : 0;
+    for(k = 0; k < NumElements(szAccepts); ++k)
+    {
+      psz     = FlyMdNPBrk(szRand, szRand + j, szAccepts[k]);
+      pszExp  = TcMdNPBrkSimple(szRand, szRand + j, szAccepts[k]);
+      if(psz != pszExp)
+      {
+        FlyTestPrintf("%u: mismatch '%s', end %u, accept '%s'\n", i, szRand, j, szAccepts[k]);
+        FlyTestFailed();
+      }
+    }
+  }
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test parsing markdown into blocks and inline elements without converting to HTML
+-------------------------------------------------------------------------------------------------*/
+void TcMdParse(void)
+{
+  static const char szMd[] =
+    "# Heading\n"
+    "\n"
+    "Para line 1\n"
+    "line 2\n"
+    "Alt Heading\n"
+    "---\n"
+    "> quote\n"
+    ">> deeper\n"
+    "\n"
+    "- item\n"
+    "  1. sub item\n"
+    "\n"
+    "a | b\n"
+    "--- | ---:\n"
+    "1 | 2\n"
+    "***\n"
+    "```c\n"
+    "code\n"
+    "```\n";
+  static const flyMdBlockType_t aTypes[] =
+  {
+    MD_BLOCK_TYPE_HEADING, MD_BLOCK_TYPE_PARA, MD_BLOCK_TYPE_HEADING, MD_BLOCK_TYPE_BLOCK_QUOTE,
+    MD_BLOCK_TYPE_LIST, MD_BLOCK_TYPE_TABLE, MD_BLOCK_TYPE_HORZ_RULE, MD_BLOCK_TYPE_CODE_BLK
+  };
+  static const unsigned aLevels[] = { 1, 0, 2, 1, 0, 2, 0, 0 };
+  typedef struct
+  {
+    flyMdInlineType_t type;
+    const char       *szMd;
+  } tcMdInline_t;
+  static const char szText[] = "a **b** `c` <x@y.com> [r](l) ![i](f) & ~~d ``";
+  static const tcMdInline_t aInlines[] =
+  {
+    { MD_INLINE_TYPE_TEXT,      "a " },
+    { MD_INLINE_TYPE_EM_OPEN,   "**" },
+    { MD_INLINE_TYPE_TEXT,      "b" },
+    { MD_INLINE_TYPE_EM_CLOSE,  "**" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_CODE,      "`c`" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_QLINK,     "<x@y.com>" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_REF,       "[r](l)" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_IMAGE,     "![i](f)" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_CHARS,     "&" },
+    { MD_INLINE_TYPE_TEXT,      " " },
+    { MD_INLINE_TYPE_CHARS,     "~~" },
+    { MD_INLINE_TYPE_TEXT,      "d " },
+    { MD_INLINE_TYPE_CHARS,     "``" },
+  };
+  flyMdBlock_t    aBlocks[NumElements(aTypes) + 1];
+  flyMdInline_t   mdInline;
+  const char     *szLine;
+  char            szHtml[256];
+  unsigned        nBlocks;
+  unsigned        i;
+
+  FlyTestBegin();
+
+  // blocks are found with right types and levels
+  nBlocks = FlyMdParse(szMd, szMd + strlen(szMd), NULL, 0);
+  if(nBlocks != NumElements(aTypes))
+  {
+    FlyTestPrintf("nBlocks %u, expected %u\n", nBlocks, (unsigned)NumElements(aTypes));
+    FlyTestFailed();
+  }
+  FlyMdParse(szMd, szMd + strlen(szMd), aBlocks, NumElements(aBlocks));
+  for(i = 0; i < nBlocks; ++i)
+  {
+    if(FlyTestVerbose())
+      FlyTestPrintf("%u: type %u, level %u, %.*s\n", i, aBlocks[i].type, aBlocks[i].level,
+        (int)FlyStrLineLen(aBlocks[i].szMd), aBlocks[i].szMd);
+    if(aBlocks[i].type != aTypes[i] || aBlocks[i].level != aLevels[i])
+    {
+      FlyTestPrintf("%u: got type %u level %u, expected type %u level %u\n", i, aBlocks[i].type,
+        aBlocks[i].level, aTypes[i], aLevels[i]);
+      FlyTestFailed();
+    }
+
+    // conversion ends exactly where the parse said the block ends
+    szLine = aBlocks[i].szMd;
+    if(FlyMd2HtmlBlock(NULL, SIZE_MAX - 1, &szLine) == 0 || szLine != aBlocks[i].szMdEnd)
+    {
+      FlyTestPrintf("%u: block end mismatch\n", i);
+      FlyTestFailed();
+    }
+  }
+  if(FlyMdParseBlock("\n  \n", &aBlocks[0]) != NULL || aBlocks[0].type != MD_BLOCK_TYPE_NONE)
+    FlyTestFailed();
+
+  // inline elements
+  i = 0;
+  FlyMdInlineFirst(&mdInline, szText, szText + strlen(szText));
+  while(FlyMdInlineNext(&mdInline))
+  {
+    if(FlyTestVerbose())
+      FlyTestPrintf("%u: type %u, '%.*s'\n", i, mdInline.type, (int)mdInline.len, mdInline.szMd);
+    if(i >= NumElements(aInlines) || mdInline.type != aInlines[i].type ||
+       mdInline.len != strlen(aInlines[i].szMd) || strncmp(mdInline.szMd, aInlines[i].szMd, mdInline.len) != 0)
+    {
+      FlyTestPrintf("%u: bad inline element '%.*s'\n", i, (int)mdInline.len, mdInline.szMd);
+      FlyTestFailed();
+    }
+    ++i;
+  }
+  if(i != NumElements(aInlines))
+    FlyTestFailed();
+
+  // emphasis left open is closed at end of text
+  szLine = "**bold";
+  FlyMdInlineFirst(&mdInline, szLine, szLine + 1);
+  if(!FlyMdInlineNext(&mdInline) || mdInline.type != MD_INLINE_TYPE_CHARS)
+    FlyTestFailed();
+  szLine = "*a* ==b";
+  if(FlyMd2HtmlTextLine(szHtml, sizeof(szHtml), &szLine, szLine + strlen(szLine)) == 0 ||
+     strcmp(szHtml, "<i>a</i> ==b") != 0)
+  {
+    FlyTestPrintf("got %s\n", szHtml);
+    FlyTestFailed();
+  }
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test heading index and table of contents, collected in the same pass as rendering
+-------------------------------------------------------------------------------------------------*/
+void TcMd2HtmlToc(void)
+{
+  static const char szMd[] =
+    "# Title\n"
+    "\n"
+    "Some text\n"
+    "\n"
+    "## Part One\n"
+    "### Detail A\n"
+    "Alt Part Two\n"
+    "------------\n"
+    "#### Too Deep\n"
+    "```\n"
+    "# not a heading\n"
+    "```\n"
+    "# End\n";
+  static const char szTocExp[] =
+    "<ul>\r\n"
+    "<li><a href=\"#Title\">Title</a>\r\n"
+    "<ul>\r\n"
+    "<li><a href=\"#Part-One\">Part One</a>\r\n"
+    "<ul>\r\n"
+    "<li><a href=\"#Detail-A\">Detail A</a></li>\r\n"
+    "</ul></li>\r\n"
+    "<li><a href=\"#Alt-Part-Two\">Alt Part Two</a></li>\r\n"
+    "</ul></li>\r\n"
+    "<li><a href=\"#End\">End</a></li>\r\n"
+    "</ul>\r\n";
+  static const char szMdEsc[] = "# a <b> & c\n";
+  static const char szMdSkip[] = "# A\n### C\n## B\n";
+  static const char szTocSkipExp[] =
+    "<ul>\r\n"
+    "<li><a href=\"#A\">A</a>\r\n"
+    "<ul>\r\n"
+    "<li><a href=\"#C\">C</a></li>\r\n"
+    "<li><a href=\"#B\">B</a></li>\r\n"
+    "</ul></li>\r\n"
+    "</ul>\r\n";
+  static const unsigned aLevels[] = { 1, 2, 3, 2, 4, 1 };
+  flyMdHeading_t  aHeadings[NumElements(aLevels)];
+  flyMdToc_t      toc;
+  char            szToc[128];
+  char           *szHtml    = NULL;
+  char           *szFile    = NULL;
+  char           *szFileExp = NULL;
+  char           *psz;
+  size_t          len;
+  size_t          lenExp;
+  unsigned        i;
+
+  FlyTestBegin();
+
+  // count only
+  memset(&toc, 0, sizeof(toc));
+  lenExp = FlyMd2HtmlContent(NULL, SIZE_MAX, szMd, szMd + strlen(szMd));
+  len = FlyMd2HtmlContentEx(NULL, SIZE_MAX, szMd, szMd + strlen(szMd), &toc);
+  if(len != lenExp || toc.nHeadings != NumElements(aLevels))
+  {
+    FlyTestPrintf("len %zu, expected %zu, nHeadings %u\n", len, lenExp, toc.nHeadings);
+    FlyTestFailed();
+  }
+
+  // heading index offsets point into the HTML
+  szHtml = FlyAlloc(lenExp + 1);
+  if(!szHtml)
+    FlyTestFailed();
+  toc.aHeadings   = aHeadings;
+  toc.maxHeadings = NumElements(aHeadings);
+  FlyMd2HtmlContentEx(szHtml, lenExp + 1, szMd, szMd + strlen(szMd), &toc);
+  for(i = 0; i < NumElements(aLevels); ++i)
+  {
+    if(FlyTestVerbose())
+      FlyTestPrintf("%u: level %u, %.*s, slug %.*s\n", i, aHeadings[i].level, (int)aHeadings[i].textLen,
+        aHeadings[i].szText, (int)aHeadings[i].slugLen, &szHtml[aHeadings[i].slugOffset]);
+    if(aHeadings[i].level != aLevels[i] || strncmp(&szHtml[aHeadings[i].htmlOffset], "<h", 2) != 0 ||
+       szHtml[aHeadings[i].slugOffset + aHeadings[i].slugLen] != '"' ||
+       strncmp(&szHtml[aHeadings[i].slugOffset], aHeadings[i].szText, 3) != 0)
+    {
+      FlyTestPrintf("%u: bad heading\n", i);
+      FlyTestFailed();
+    }
+  }
+
+  // nested table of contents, #### is too deep
+  len = FlyMd2HtmlToc(NULL, SIZE_MAX, &toc, 3);
+  if(len != strlen(szTocExp))
+  {
+    FlyTestPrintf("toc len %zu, expected %zu\n", len, strlen(szTocExp));
+    FlyTestFailed();
+  }
+  psz = FlyAlloc(len + 1);
+  if(!psz)
+    FlyTestFailed();
+  FlyMd2HtmlToc(psz, len + 1, &toc, 3);
+  if(strcmp(psz, szTocExp) != 0)
+  {
+    FlyTestPrintf("got:\n%s\nexpected:\n%s\n", psz, szTocExp);
+    FlyTestFailed();
+  }
+
+  // whole file is head, table of contents, content, end
+  len = FlyMd2HtmlFileToc(NULL, SIZE_MAX, szMd, "Toc", 3);
+  szFile = FlyAlloc(len + 1);
+  lenExp = FlyMd2HtmlFile(NULL, SIZE_MAX, szMd, "Toc");
+  szFileExp = FlyAlloc(lenExp + 1);
+  if(!szFile || !szFileExp || len != lenExp + strlen(szTocExp))
+    FlyTestFailed();
+  FlyMd2HtmlFileToc(szFile, len + 1, szMd, "Toc", 3);
+  FlyMd2HtmlFile(szFileExp, lenExp + 1, szMd, "Toc");
+  i = (unsigned)(strstr(szFileExp, "<h1") - szFileExp);
+  if(strncmp(szFile, szFileExp, i) != 0 || strncmp(&szFile[i], szTocExp, strlen(szTocExp)) != 0 ||
+     strcmp(&szFile[i + strlen(szTocExp)], &szFileExp[i]) != 0)
+  {
+    FlyTestPrintf("got:\n%s\n", szFile);
+    FlyTestFailed();
+  }
+
+  // heading text is escaped in the table of contents, same as in the body
+  memset(&toc, 0, sizeof(toc));
+  toc.aHeadings   = aHeadings;
+  toc.maxHeadings = NumElements(aHeadings);
+  FlyMd2HtmlContentEx(szHtml, lenExp + 1, szMdEsc, szMdEsc + strlen(szMdEsc), &toc);
+  len = FlyMd2HtmlToc(NULL, SIZE_MAX, &toc, 3);
+  if(toc.nHeadings != 1 || len >= sizeof(szToc) || FlyMd2HtmlToc(szToc, sizeof(szToc), &toc, 3) != len ||
+     strstr(szToc, "\">a &lt;b> &amp; c</a>") == NULL)
+  {
+    FlyTestPrintf("nHeadings %u, len %zu, got:\n%s\n", toc.nHeadings, len, szToc);
+    FlyTestFailed();
+  }
+
+  // skipped level, then back up one: B is still nested in A, next to C
+  memset(&toc, 0, sizeof(toc));
+  toc.aHeadings   = aHeadings;
+  toc.maxHeadings = NumElements(aHeadings);
+  FlyMd2HtmlContentEx(szHtml, lenExp + 1, szMdSkip, szMdSkip + strlen(szMdSkip), &toc);
+  len = FlyMd2HtmlToc(NULL, SIZE_MAX, &toc, 3);
+  if(toc.nHeadings != 3 || len >= sizeof(szToc) || FlyMd2HtmlToc(szToc, sizeof(szToc), &toc, 3) != len ||
+     strcmp(szToc, szTocSkipExp) != 0)
+  {
+    FlyTestPrintf("nHeadings %u, len %zu, got:\n%s\nexpected:\n%s\n", toc.nHeadings, len, szToc, szTocSkipExp);
+    FlyTestFailed();
+  }
+
+  FlyFreeIf(szHtml);
+  FlyFreeIf(psz);
+  FlyFreeIf(szFile);
+  FlyFreeIf(szFileExp);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to TcMdDocEdit(). Verify FlyMdDoc HTML is same as rendering the whole markdown.
+-------------------------------------------------------------------------------------------------*/
+static bool_t TcMdDocCmp(void *hDoc)
+{
+  const char *szMd;
+  const char *szHtml;
+  char       *szExp;
+  size_t      mdLen;
+  size_t      htmlLen;
+  size_t      expLen;
+  bool_t      fSame = FALSE;
+
+  szMd    = FlyMdDocMd(hDoc, &mdLen);
+  szHtml  = FlyMdDocHtml(hDoc, &htmlLen);
+  expLen  = FlyMd2HtmlContent(NULL, UINT_MAX, szMd, szMd + mdLen);
+  szExp   = FlyAlloc(expLen + 1);
+  if(szMd && szHtml && szExp)
+  {
+    *szExp = '\0';
+    FlyMd2HtmlContent(szExp, expLen + 1, szMd, szMd + mdLen);
+    if(htmlLen == expLen && strcmp(szHtml, szExp) == 0)
+      fSame = TRUE;
+    else
+    {
+      FlyTestPrintf("\n--- markdown ---\n%s\n--- expected ---\n%s\n--- got ---\n%s\n", szMd, szExp, szHtml);
+    }
+  }
+  if(szExp)
+    FlyFree(szExp);
+
+  return fSame;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test incremental rendering of a markdown document being edited
+-------------------------------------------------------------------------------------------------*/
+void TcMdDocEdit(void)
+{
+  typedef struct
+  {
+    const char *szFind;     // edit at this text
+    size_t      delLen;
+    const char *szIns;
+  } tcMdDocEdit_t;
+
+  static const char szMd[] =
+    "# Heading\n"
+    "\n"
+    "First paragraph with **bold** text\n"
+    "and a second line.\n"
+    "\n"
+    "- item 1\n"
+    "- item 2\n"
+    "\n"
+    "a | b\n"
+    "--- | ---\n"
+    "1 | 2\n"
+    "\n"
+    "Last paragraph\n";
+  static const tcMdDocEdit_t aEdits[] =
+  {
+    { "bold",           4,  "strong" },       // inside paragraph
+    { "item 2",         0,  "- item 1b\n" },  // add list item
+    { "Last",           0,  "Alt Heading\n===\n\n" },
+    { "Last",           0,  "```\n" },        // open a fence, runs to end of file
+    { "# Heading",      0,  "```\n\n" },      // close the fence from above
+    { "First",          0,  "    code\n\n" },  // indented code block
+    { "\n\n- item 1\n",  1,  "" },             // join paragraph with list
+    { "a | b",          5,  "x|y|z" },        // change table columns
+    { "Heading",        7,  "" },             // heading with no text
+    { "\n",             0,  "> quote\n>> deeper\n" },
+  };
+  void         *hDoc    = NULL;
+  const char   *szCur;
+  const char   *psz;
+  char          szLine[32];
+  unsigned      nBlocks;
+  unsigned      i;
+
+  FlyTestBegin();
+
+  // new document is same as full render
+  hDoc = FlyMdDocNew(szMd);
+  if(!FlyMdDocIsDoc(hDoc) || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+  if(FlyMdDocNumBlocks(hDoc) != 5)
+  {
+    FlyTestPrintf("expected 5 blocks, got %u\n", FlyMdDocNumBlocks(hDoc));
+    FlyTestFailed();
+  }
+
+  // each edit must match a full render
+  for(i = 0; i < NumElements(aEdits); ++i)
+  {
+    szCur = FlyMdDocMd(hDoc, NULL);
+    psz = strstr(szCur, aEdits[i].szFind);
+    if(!psz)
+    {
+      FlyTestPrintf("%u: can't find %s\n", i, aEdits[i].szFind);
+      FlyTestFailed();
+    }
+    if(!FlyMdDocEdit(hDoc, psz - szCur, aEdits[i].delLen, aEdits[i].szIns, strlen(aEdits[i].szIns)))
+      FlyTestFailed();
+    if(FlyTestVerbose())
+      FlyTestPrintf("%u: blocks %u, rendered %u\n", i, FlyMdDocNumBlocks(hDoc), FlyMdDocRendered(hDoc));
+    if(!TcMdDocCmp(hDoc))
+    {
+      FlyTestPrintf("%u: edit at %s failed\n", i, aEdits[i].szFind);
+      FlyTestFailed();
+    }
+  }
+
+  // delete everything, then start over with a big document
+  if(!FlyMdDocEdit(hDoc, 0, SIZE_MAX, NULL, 0) || FlyMdDocNumBlocks(hDoc) != 0 || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+  for(i = 0; i < 200; ++i)
+  {
+    snprintf(szLine, sizeof(szLine), "## Title %u\n\nPara %u\n\n", i, i);
+    if(!FlyMdDocEdit(hDoc, FlyStrLineEof(FlyMdDocMd(hDoc, NULL)) - FlyMdDocMd(hDoc, NULL), 0, szLine, strlen(szLine)))
+      FlyTestFailed();
+  }
+  nBlocks = FlyMdDocNumBlocks(hDoc);
+  if(nBlocks != 400 || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+
+  // typing into one paragraph re-renders at most 2 blocks, not the whole document
+  szCur = FlyMdDocMd(hDoc, NULL);
+  psz = strstr(szCur, "Para 100");
+  if(!psz || !FlyMdDocEdit(hDoc, psz - szCur + 4, 0, "graph", 5))
+    FlyTestFailed();
+  if(FlyMdDocRendered(hDoc) > 2 || FlyMdDocNumBlocks(hDoc) != nBlocks || !TcMdDocCmp(hDoc))
+  {
+    FlyTestPrintf("rendered %u blocks, expected at most 2\n", FlyMdDocRendered(hDoc));
+    FlyTestFailed();
+  }
+  psz = FlyMdDocBlockHtml(hDoc, 201, NULL);
+  if(!psz || strcmp(psz, "<p>Paragraph 100</p>\r\n") != 0)
+  {
+    FlyTestPrintf("block 201: %s\n", FlyStrNullOk(psz));
+    FlyTestFailed();
+  }
+
+  // opening a fence affects everything after it, headings 150-199 become 1 code block
+  szCur = FlyMdDocMd(hDoc, NULL);
+  psz = strstr(szCur, "## Title 150");
+  if(!psz || !FlyMdDocEdit(hDoc, psz - szCur, 0, "```\n", 4) || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+  if(FlyMdDocNumBlocks(hDoc) != 301)
+  {
+    FlyTestPrintf("fence left %u blocks, expected 301\n", FlyMdDocNumBlocks(hDoc));
+    FlyTestFailed();
+  }
+  if(!FlyMdDocEdit(hDoc, psz - szCur, 4, NULL, 0) || FlyMdDocNumBlocks(hDoc) != nBlocks || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+
+  // empty document, edits that leave no blocks before or after
+  FlyMdDocFree(hDoc);
+  hDoc = FlyMdDocNew("");
+  if(!FlyMdDocEdit(hDoc, 0, 0, "\n\n", 2) || FlyMdDocNumBlocks(hDoc) != 0 || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+  if(!FlyMdDocEdit(hDoc, 1, 0, "# Hi\n", 5) || FlyMdDocNumBlocks(hDoc) != 1 || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+  if(!FlyMdDocEdit(hDoc, 0, SIZE_MAX, NULL, 0) || FlyMdDocNumBlocks(hDoc) != 0 || !TcMdDocCmp(hDoc))
+    FlyTestFailed();
+
+  FlyTestEnd();
+
+  FlyMdDocFree(hDoc);
+}
+
 /*-------------------------------------------------------------------------------------------------
   Test each function
 -------------------------------------------------------------------------------------------------*/
@@ -1849,6 +2413,10 @@ int main(int argc, const char *argv[])
     { "TcMd2HtmlBlockQuote",  TcMd2HtmlBlockQuote },
     { "TcMd2HtmlContent",     TcMd2HtmlContent },
     { "TcMd2HtmlFile",        TcMd2HtmlFile },
+    { "TcMdNPBrk",            TcMdNPBrk },
+    { "TcMdParse",            TcMdParse },
+    { "TcMd2HtmlToc",         TcMd2HtmlToc },
+    { "TcMdDocEdit",          TcMdDocEdit },
   };
   hTestSuite_t        hSuite;
   int                 ret;
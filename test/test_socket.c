@@ -0,0 +1,165 @@
+/**************************************************************************************************
+  test_socket.c  test cases for FlySocket.c
+  Copyright 2024 Drew Gislason
+  License: MIT <https://mit-license.org>
+**************************************************************************************************/
+#include "FlyTest.h"
+#include "FlyMem.h"
+#include "FlySocket.h"
+#include <sys/socket.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define TC_SOCK_HOST        "127.0.0.1"
+#define TC_SOCK_PORT_FIRST  45400
+#define TC_SOCK_PORT_LAST   45419
+#define TC_SOCK_BUF_SIZE    4096          // small kernel buffers force partial send() and recv()
+#define TC_SOCK_DATA_LEN    (1024 * 1024)
+#define TC_SOCK_PIECE_LEN   1000          // receive in odd sized pieces
+
+typedef struct
+{
+  hFlySock_t      hServer;
+  hFlySockAddr_t  hAddr;
+  uint8_t        *pData;
+  size_t          got;
+  size_t          gotAfterClose;
+} tcSockRx_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Helper to TcSockSendAll(). Receive all the data in pieces, then try for more after other side
+  closes.
+-------------------------------------------------------------------------------------------------*/
+static void * TcSockRxThread(void *pArg)
+{
+  tcSockRx_t *pRx = pArg;
+  uint8_t     extra[16];
+  size_t      len;
+  size_t      n;
+
+  while(pRx->got < TC_SOCK_DATA_LEN)
+  {
+    len = TC_SOCK_DATA_LEN - pRx->got;
+    if(len > TC_SOCK_PIECE_LEN)
+      len = TC_SOCK_PIECE_LEN;
+    n = FlySockReceiveAll(pRx->hServer, pRx->hAddr, &pRx->pData[pRx->got], len);
+    pRx->got += n;
+    if(n != len)
+      break;
+  }
+  pRx->gotAfterClose = FlySockReceiveAll(pRx->hServer, pRx->hAddr, extra, sizeof(extra));
+
+  return NULL;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlySockSendAll() and FlySockReceiveAll() over loopback TCP. Both sides are non-blocking with
+  small kernel buffers, so each call must continue after partial sends, partial receives and
+  EAGAIN.
+-------------------------------------------------------------------------------------------------*/
+void TcSockSendAll(void)
+{
+  char            szPort[8];
+  hFlySock_t      hServer   = NULL;
+  hFlySock_t      hClient   = NULL;
+  hFlySockAddr_t  hAddr     = NULL;
+  uint8_t        *pData;
+  tcSockRx_t      rx;
+  pthread_t       thread;
+  size_t          sent;
+  unsigned        port;
+  int             bufSize   = TC_SOCK_BUF_SIZE;
+  size_t          i;
+
+  FlyTestBegin();
+
+  // find a free port
+  for(port = TC_SOCK_PORT_FIRST; !hServer && port <= TC_SOCK_PORT_LAST; ++port)
+  {
+    snprintf(szPort, sizeof(szPort), "%u", port);
+    hServer = FlySockNew(TC_SOCK_HOST, szPort, FLY_SOCK_TYPE_IPV4_TCP, FLY_SOCK_SERVER);
+  }
+  if(!hServer)
+    FlyTestFailed();
+
+  // accepted socket inherits the small receive buffer and non-blocking from the server
+  setsockopt(FlySockFd(hServer), SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof(bufSize));
+  FlySockSetNonBlock(hServer, TRUE);
+  hClient = FlySockNew(TC_SOCK_HOST, szPort, FLY_SOCK_TYPE_IPV4_TCP, FLY_SOCK_CLIENT);
+  if(!hClient)
+    FlyTestFailed();
+  setsockopt(FlySockFd(hClient), SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof(bufSize));
+  FlySockSetNonBlock(hClient, TRUE);
+  for(i = 0; !hAddr && i < 100; ++i)
+  {
+    hAddr = FlySockAccept(hServer, NULL);
+    if(!hAddr)
+      usleep(10000);
+  }
+  if(!hAddr)
+    FlyTestFailed();
+
+  pData = FlyAlloc(TC_SOCK_DATA_LEN);
+  memset(&rx, 0, sizeof(rx));
+  rx.pData = FlyAlloc(TC_SOCK_DATA_LEN);
+  if(!pData || !rx.pData)
+    FlyTestFailed();
+  for(i = 0; i < TC_SOCK_DATA_LEN; ++i)
+    pData[i] = (uint8_t)(i * 7 + i / 251);
+
+  rx.hServer  = hServer;
+  rx.hAddr    = hAddr;
+  if(pthread_create(&thread, NULL, TcSockRxThread, &rx) != 0)
+    FlyTestFailed();
+
+  // client sends on its own socket, the addr is only needed to identify TCP
+  sent = FlySockSendAll(hClient, hAddr, pData, TC_SOCK_DATA_LEN);
+  hClient = FlySockFree(hClient);
+  pthread_join(thread, NULL);
+
+  if(sent != TC_SOCK_DATA_LEN || rx.got != TC_SOCK_DATA_LEN || memcmp(pData, rx.pData, TC_SOCK_DATA_LEN) != 0)
+  {
+    FlyTestPrintf("sent %zu, got %zu\n", sent, rx.got);
+    FlyTestFailed();
+  }
+
+  // other side closed, nothing more to receive
+  if(rx.gotAfterClose != 0)
+  {
+    FlyTestPrintf("gotAfterClose %zu\n", rx.gotAfterClose);
+    FlyTestFailed();
+  }
+
+  // not a TCP socket or missing buffer
+  if(FlySockSendAll(NULL, hAddr, pData, 1) != 0 || FlySockReceiveAll(hServer, hAddr, NULL, 1) != 0)
+    FlyTestFailed();
+
+  FlyFree(pData);
+  FlyFree(rx.pData);
+  FlySockAddrFree(hAddr);
+  FlySockFree(hServer);
+
+  FlyTestEnd();
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test each function
+-------------------------------------------------------------------------------------------------*/
+int main(int argc, const char *argv[])
+{
+  const char          szName[] = "test_socket";
+  const sTestCase_t   aTestCases[] =
+  {
+    { "TcSockSendAll",  TcSockSendAll },
+  };
+  hTestSuite_t        hSuite;
+  int                 ret;
+
+  FlyTestInit(szName, argc, argv);
+  hSuite = FlyTestNew(szName, NumElements(aTestCases), aTestCases);
+  FlyTestRun(hSuite);
+  ret = FlyTestSummary(hSuite);
+  FlyTestFree(hSuite);
+
+  return ret;
+}
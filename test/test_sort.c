@@ -4,6 +4,7 @@
   License: MIT
   Brief: Test sorting
 **************************************************************************************************/
+#include <stddef.h>
 #include "FlyTest.h"
 #include "FlySort.h"
 
@@ -258,6 +259,210 @@ void TcSortQSort(void)
   FlyTestEnd();
 }
 
+typedef struct
+{
+  unsigned  key;
+  uint8_t   id[3];      // odd size, so FlySortQSort() swaps by bytes
+} sortRec_t;
+
+FLY_SORT_DEFINE(SortInts, int, *a < *b)
+FLY_SORT_DEFINE(SortRecs, sortRec_t, a->key < b->key)
+
+/*-------------------------------------------------------------------------------------------------
+  Compare two sortRec_t by key
+-------------------------------------------------------------------------------------------------*/
+static int CmpRec(void *pArg, const void *pThis, const void *pThat)
+{
+  const sortRec_t *pRecThis = pThis;
+  const sortRec_t *pRecThat = pThat;
+  (void)pArg;
+  if(pRecThis->key == pRecThat->key)
+    return 0;
+  return (pRecThis->key < pRecThat->key) ? -1 : 1;
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Fill an array of n ints with a pattern: 0=random, 1=sorted, 2=reverse, 3=all equal,
+  4=few distinct, 5=organ pipe, 6=sorted with a few out of place
+-------------------------------------------------------------------------------------------------*/
+static void SortFill(int *aInts, unsigned n, unsigned pattern, unsigned *pSeed)
+{
+  unsigned  i;
+
+  for(i = 0; i < n; ++i)
+  {
+    *pSeed = *pSeed * 1103515245 + 12345;
+    switch(pattern)
+    {
+      case 0:  aInts[i] = (int)(*pSeed >> 1); break;
+      case 1:  aInts[i] = (int)i; break;
+      case 2:  aInts[i] = (int)(n - i); break;
+      case 3:  aInts[i] = 7; break;
+      case 4:  aInts[i] = (int)((*pSeed >> 16) % 4); break;
+      case 5:  aInts[i] = (int)(i < n / 2 ? i : n - i); break;
+      default: aInts[i] = (int)((*pSeed >> 16) % 64 == 0 ? (*pSeed >> 8) % n : i); break;
+    }
+  }
+}
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlySortQSort() and FLY_SORT_DEFINE() on larger arrays with patterns that hurt quicksort
+-------------------------------------------------------------------------------------------------*/
+void TcSortPdq(void)
+{
+  static const unsigned aSizes[] = { 0, 1, 2, 3, 24, 25, 129, 1000, 20000 };
+  static int            aInts[20000];
+  static int            aInts2[20000];
+  static sortRec_t      aRecs[20000];
+  unsigned      seed = 1;
+  unsigned      size, pattern, i;
+
+  FlyTestBegin();
+
+  for(size = 0; size < NumElements(aSizes); ++size)
+  {
+    for(pattern = 0; pattern <= 6; ++pattern)
+    {
+      // generic and typed sorts must agree, and be in order
+      SortFill(aInts, aSizes[size], pattern, &seed);
+      memcpy(aInts2, aInts, aSizes[size] * sizeof(int));
+      FlySortQSort(aInts, aSizes[size], sizeof(int), NULL, FlySortCmpIntEx);
+      SortInts(aInts2, aSizes[size]);
+      for(i = 0; i < aSizes[size]; ++i)
+      {
+        if((i > 0 && aInts[i - 1] > aInts[i]) || aInts[i] != aInts2[i])
+        {
+          FlyTestPrintf("size %u, pattern %u, failed at %u: %d %d\n", aSizes[size], pattern, i, aInts[i], aInts2[i]);
+          FlyTestFailed();
+        }
+      }
+
+      // structs: records keep their ids
+      for(i = 0; i < aSizes[size]; ++i)
+      {
+        aRecs[i].key   = (unsigned)aInts2[i] ^ 0x5a5a;
+        aRecs[i].id[0] = (uint8_t)aRecs[i].key;
+      }
+      if(pattern & 1)
+        SortRecs(aRecs, aSizes[size]);
+      else
+        FlySortQSort(aRecs, aSizes[size], sizeof(sortRec_t), NULL, CmpRec);
+      for(i = 0; i < aSizes[size]; ++i)
+      {
+        if((i > 0 && aRecs[i - 1].key > aRecs[i].key) || aRecs[i].id[0] != (uint8_t)aRecs[i].key)
+        {
+          FlyTestPrintf("size %u, pattern %u, rec failed at %u\n", aSizes[size], pattern, i);
+          FlyTestFailed();
+        }
+      }
+    }
+  }
+
+  FlyTestEnd();
+}
+
+typedef struct
+{
+  int64_t   key;
+  unsigned  order;      // original position, to check the sort is stable
+} sortRadixRec_t;
+
+/*-------------------------------------------------------------------------------------------------
+  Test FlySortRadix() and FlySortRadixEx() against FlySortQSort()
+-------------------------------------------------------------------------------------------------*/
+void TcSortRadix(void)
+{
+  static const double aDoubles[]    = { 3.5, -0.0, 1e300, -1e-300, 0.0, -2.25, 1.0 / 0.0, -1.0 / 0.0, 42.0, -42.0 };
+  static const double aDoublesExp[] = { -1.0 / 0.0, -42.0, -2.25, -1e-300, -0.0, 0.0, 3.5, 42.0, 1e300, 1.0 / 0.0 };
+  static int            aInts[5000];
+  static int            aIntsExp[5000];
+  static unsigned       aUnsigned[5000];
+  static unsigned       aUnsignedExp[5000];
+  static uint64_t       aU64[5000];
+  static sortRadixRec_t aRecs[5000];
+  static sortRadixRec_t aScratch[5000];
+  double                aTestDoubles[NumElements(aDoubles)];
+  unsigned              seed = 7;
+  unsigned              i;
+
+  FlyTestBegin();
+
+  // signed ints, positive and negative, scratch allocated
+  for(i = 0; i < NumElements(aInts); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    aInts[i] = (int)seed;
+  }
+  aInts[0] = INT_MIN;
+  aInts[1] = INT_MAX;
+  memcpy(aIntsExp, aInts, sizeof(aInts));
+  FlySortQSort(aIntsExp, NumElements(aIntsExp), sizeof(int), NULL, FlySortCmpIntEx);
+  if(!FlySortRadix(aInts, NumElements(aInts), FLYSORT_KEY_I32, NULL) || memcmp(aInts, aIntsExp, sizeof(aInts)) != 0)
+    FlyTestFailed();
+
+  // unsigned with small values, so upper bytes are skipped, scratch provided
+  for(i = 0; i < NumElements(aUnsigned); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    aUnsigned[i] = (seed >> 16) % 1000;
+  }
+  memcpy(aUnsignedExp, aUnsigned, sizeof(aUnsigned));
+  FlySortQSort(aUnsignedExp, NumElements(aUnsignedExp), sizeof(unsigned), NULL, FlySortCmpUnsignedEx);
+  if(!FlySortRadix(aUnsigned, NumElements(aUnsigned), FLYSORT_KEY_U32, aScratch) ||
+     memcmp(aUnsigned, aUnsignedExp, sizeof(aUnsigned)) != 0)
+    FlyTestFailed();
+
+  // unsigned 64-bit
+  for(i = 0; i < NumElements(aU64); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    aU64[i] = ((uint64_t)seed << 32) | (seed >> 8);
+  }
+  if(!FlySortRadix(aU64, NumElements(aU64), FLYSORT_KEY_U64, NULL))
+    FlyTestFailed();
+  for(i = 1; i < NumElements(aU64); ++i)
+  {
+    if(aU64[i - 1] > aU64[i])
+      FlyTestFailed();
+  }
+
+  // doubles, including signed zero and infinities
+  memcpy(aTestDoubles, aDoubles, sizeof(aDoubles));
+  if(!FlySortRadix(aTestDoubles, NumElements(aTestDoubles), FLYSORT_KEY_DOUBLE, NULL) ||
+     memcmp(aTestDoubles, aDoublesExp, sizeof(aDoublesExp)) != 0)
+  {
+    for(i = 0; i < NumElements(aDoublesExp); ++i)
+      FlyTestPrintf("aTestDoubles[%u] = %g, aDoublesExp[%u] = %g\n", i, aTestDoubles[i], i, aDoublesExp[i]);
+    FlyTestFailed();
+  }
+
+  // structs with a signed 64-bit key and many duplicates: sorted and stable
+  for(i = 0; i < NumElements(aRecs); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    aRecs[i].key   = (int64_t)((seed >> 16) % 50) - 25;
+    aRecs[i].order = i;
+  }
+  if(!FlySortRadixEx(aRecs, NumElements(aRecs), sizeof(sortRadixRec_t), offsetof(sortRadixRec_t, key),
+                     FLYSORT_KEY_I64, aScratch))
+    FlyTestFailed();
+  for(i = 1; i < NumElements(aRecs); ++i)
+  {
+    if(aRecs[i - 1].key > aRecs[i].key || (aRecs[i - 1].key == aRecs[i].key && aRecs[i - 1].order > aRecs[i].order))
+    {
+      FlyTestPrintf("rec %u: key %lld order %u\n", i, (long long)aRecs[i].key, aRecs[i].order);
+      FlyTestFailed();
+    }
+  }
+
+  // bad key offset
+  if(FlySortRadixEx(aRecs, NumElements(aRecs), sizeof(sortRadixRec_t), sizeof(sortRadixRec_t) - 4,
+                    FLYSORT_KEY_I64, NULL))
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
 typedef struct mySingleList
 {
   struct mySingleList  *pNext;
@@ -454,6 +659,8 @@ int main(int argc, const char *argv[])
   {
     { "TcSortBubble",     TcSortBubble },
     { "TcSortQSort",      TcSortQSort },
+    { "TcSortPdq",        TcSortPdq },
+    { "TcSortRadix",      TcSortRadix },
     { "TcSortList",       TcSortList },
   };
   hTestSuite_t        hSuite;
@@ -1057,6 +1057,81 @@ void TcStrHdrFind(void)
     free((void *)szFile);
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Test FlyStrEolConvert(), all at once, in small chunks, size only and in place
+-------------------------------------------------------------------------------------------------*/
+void TcStrEolConvert(void)
+{
+  static const struct
+  {
+    const char   *szSrc;
+    const char   *szLf;
+    const char   *szCrLf;
+  } aTests[] =
+  {
+    { "",                     "",                   "" },
+    { "abc",                  "abc",                "abc" },
+    { "one\ntwo\n",           "one\ntwo\n",         "one\r\ntwo\r\n" },
+    { "one\r\ntwo\r\n",       "one\ntwo\n",         "one\r\ntwo\r\n" },
+    { "a\rb\r\n\r\r\nc\r",     "ab\n\nc",            "ab\r\n\r\nc" },
+    { "\n\n\r\n",             "\n\n\n",             "\r\n\r\n\r\n" },
+  };
+  char          szDst[64];
+  const char   *szExp;
+  size_t        srcLen;
+  size_t        used;
+  size_t        total;
+  size_t        len;
+  size_t        chunk;
+  unsigned      i;
+  unsigned      eol;
+
+  FlyTestBegin();
+
+  // below the minimum size for CRLF, a line ending never fits
+  if(FlyStrEolConvert(szDst, 1, "\nabc", 4, FLYSTR_EOL_CRLF, &used) != 0 || used != 0)
+    FlyTestFailed();
+
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    srcLen = strlen(aTests[i].szSrc);
+    for(eol = FLYSTR_EOL_LF; eol <= FLYSTR_EOL_CRLF; ++eol)
+    {
+      szExp = (eol == FLYSTR_EOL_LF) ? aTests[i].szLf : aTests[i].szCrLf;
+
+      // size only
+      if(FlyStrEolConvert(NULL, 0, aTests[i].szSrc, srcLen, eol, &used) != strlen(szExp) || used != srcLen)
+        FlyTestFailed();
+
+      // chunks of every size down to the minimum, a CRLF is never split, always makes progress
+      for(chunk = (eol == FLYSTR_EOL_CRLF) ? 2 : 1; chunk <= sizeof(szDst); ++chunk)
+      {
+        total = used = 0;
+        while(used < srcLen)
+        {
+          total += FlyStrEolConvert(&szDst[total], chunk, &aTests[i].szSrc[used], srcLen - used, eol, &len);
+          used  += len;
+          if(len == 0)
+            break;
+        }
+        if(used != srcLen || total != strlen(szExp) || memcmp(szDst, szExp, total) != 0)
+        {
+          FlyTestPrintf("%u: eol %u, chunk %zu, total %zu\n", i, eol, chunk, total);
+          FlyTestFailed();
+        }
+      }
+    }
+
+    // in place, to LF
+    strcpy(szDst, aTests[i].szSrc);
+    len = FlyStrEolConvert(szDst, srcLen, szDst, srcLen, FLYSTR_EOL_LF, NULL);
+    if(len != strlen(aTests[i].szLf) || memcmp(szDst, aTests[i].szLf, len) != 0)
+      FlyTestFailed();
+  }
+
+  FlyTestEnd();
+}
+
 /*-------------------------------------------------------------------------------------------------
   Test line functions
 -------------------------------------------------------------------------------------------------*/
@@ -1391,6 +1466,82 @@ void TcStrSlug(void)
   FlyTestEnd();
 }
 
+/*-------------------------------------------------------------------------------------------------
+  Test FlyStrHtmlEscape()
+-------------------------------------------------------------------------------------------------*/
+void TcStrHtmlEscape(void)
+{
+  typedef struct
+  {
+    const char  *sz;
+    size_t       srcLen;
+    unsigned     flags;
+    const char  *szExp;
+  } TcStrHtmlEscape_t;
+  TcStrHtmlEscape_t aTests[] =
+  {
+    { "plain text", SIZE_MAX, FLYSTR_HTML_ALL, "plain text" },
+    { "", SIZE_MAX, FLYSTR_HTML_ALL, "" },
+    { "a < b & c > \"d\" 'e'", SIZE_MAX, FLYSTR_HTML_ALL, "a &lt; b &amp; c &gt; &quot;d&quot; &#39;e&#39;" },
+    { "a < b & c > d", SIZE_MAX, FLYSTR_HTML_LT, "a &lt; b & c > d" },
+    { "a < b & c > d", SIZE_MAX, FLYSTR_HTML_LT | FLYSTR_HTML_AMP, "a &lt; b &amp; c > d" },
+    { "<<>>", SIZE_MAX, 0, "<<>>" },
+    { "<x>", 2, FLYSTR_HTML_ALL, "&lt;x" },
+    { "if(i<3)\nnext", 6, FLYSTR_HTML_LT, "if(i&lt;3" },
+  };
+  char        szDst[64];    // manually sized, see aTests[].szExp above
+  size_t      len;
+  size_t      lenExp;
+  unsigned    i;
+
+  FlyTestBegin();
+
+  for(i = 0; i < NumElements(aTests); ++i)
+  {
+    if(FlyTestVerbose())
+      FlyTestPrintf("\n%u sz '%s', szExp '%s'\n", i, aTests[i].sz, aTests[i].szExp);
+
+    // test getting length only
+    lenExp = strlen(aTests[i].szExp);
+    len = FlyStrHtmlEscape(NULL, aTests[i].sz, sizeof(szDst), aTests[i].srcLen, aTests[i].flags);
+    if(len != lenExp)
+    {
+      FlyTestPrintf("%u: %s, got len %zu, expected %zu\n", i, aTests[i].sz, len, lenExp);
+      FlyTestFailed();
+    }
+
+    FlyStrZFill(szDst, 'A', sizeof(szDst), sizeof(szDst));
+    len = FlyStrHtmlEscape(szDst, aTests[i].sz, sizeof(szDst), aTests[i].srcLen, aTests[i].flags);
+    if((len != lenExp) || (strcmp(szDst, aTests[i].szExp) != 0))
+    {
+      FlyTestPrintf("%u: got %zu,'%s', expected %zu,'%s'\n", i, len, szDst, lenExp, aTests[i].szExp);
+      FlyTestFailed();
+    }
+    if(szDst[lenExp + 1] != 'A')
+      FlyTestFailed();
+  }
+
+  // entities are never split when szDst is too small
+  FlyStrZFill(szDst, 'A', sizeof(szDst), sizeof(szDst));
+  len = FlyStrHtmlEscape(szDst, "ab<c", 6, SIZE_MAX, FLYSTR_HTML_ALL);
+  if((len != 2) || (strcmp(szDst, "ab") != 0))
+  {
+    FlyTestPrintf("small 6 => got %zu,'%s', expected %u,'%s'\n", len, szDst, 2, "ab");
+    FlyTestFailed();
+  }
+  len = FlyStrHtmlEscape(szDst, "ab<c", 7, SIZE_MAX, FLYSTR_HTML_ALL);
+  if((len != 6) || (strcmp(szDst, "ab&lt;") != 0))
+  {
+    FlyTestPrintf("small 7 => got %zu,'%s', expected %u,'%s'\n", len, szDst, 6, "ab&lt;");
+    FlyTestFailed();
+  }
+  len = FlyStrHtmlEscape(szDst, "ab<c", 0, SIZE_MAX, FLYSTR_HTML_ALL);
+  if(len != 0)
+    FlyTestFailed();
+
+  FlyTestEnd();
+}
+
 /*-------------------------------------------------------------------------------------------------
   Test path slash functions
 -------------------------------------------------------------------------------------------------*/
@@ -1883,6 +2034,7 @@ int main(int argc, const char *argv[])
     { "TcStrDump",            TcStrDump },
     { "TcStrHdrFind",         TcStrHdrFind },
     { "TcStrLine",            TcStrLine },
+    { "TcStrEolConvert",      TcStrEolConvert },
     { "TcStrPath",            TcStrPath },
     { "TcStrPathHasExt",      TcStrPathHasExt },
     { "TcStrPathLang",        TcStrPathLang },
@@ -1893,6 +2045,7 @@ int main(int argc, const char *argv[])
     { "TcStrReplace",         TcStrReplace },
     { "TcStrZFill",           TcStrZ },
     { "TcStrSlug",            TcStrSlug },
+    { "TcStrHtmlEscape",      TcStrHtmlEscape },
     { "TcStrEscEndQuoted",    TcStrEscEndQuoted },
     { "TcStrNStr",            TcStrNStr },
     { "TcStrTol",             TcStrTol },
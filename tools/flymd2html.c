@@ -1,99 +1,365 @@
 /**************************************************************************************************
-  flymd2html.c - A tool that converts a single markdown file to a single html file
+  flymd2html.c - A tool that converts markdown files to html files
   Copyright 2024 Drew Gislason
   license: <https://mit-license.org>
 **************************************************************************************************/
+#include <pthread.h>
+#include <unistd.h>
 #include "FlyFile.h"
 #include "FlyMarkdown.h"
 #include "FlyMem.h"
 #include "FlyStr.h"
 #include "FlyCli.h"
+#include "FlyTime.h"
 
 extern bool_t fFlyMarkdownDebug;
 
 static const char m_szVersion[] = "flymd2html v" FLY_VER;
-static const char m_szHelp[] = 
-  "Usage = flymd2html [-v] [-o out] in...\n"
+static const char m_szHelp[] =
+  "Usage = flymd2html [-f] [-j#] [-v] [-o out] in...\n"
   "\n"
-  "-o       output file (if 1 input) or folder/ (2+ inputs)\n"
+  "-f       force, convert even if .html is newer than .md\n"
+  "-j#      number of jobs (threads), default is 1 per core\n"
+  "-o       output file (if 1 input) or folder/ (2+ inputs or folders)\n"
   "-v       verbose\n"
-  "in       input file(s)s\n";
+  "in       input file(s) or folder(s). Folders are searched for *.md files\n";
+
+#define MD2HTML_MAX_JOBS    64
+#define MD2HTML_HEAD_SIZE   8192  // room for <head> and </html>, see FlyMd2HtmlFile()
+
+// a single markdown file to convert
+typedef struct
+{
+  char         *szIn;       // input markdown file
+  char         *szOut;      // output HTML file
+  size_t        mdLen;      // length of markdown, for throughput
+  bool_t        fSkipped;   // HTML was already up to date
+  bool_t        fFailed;    // couldn't convert
+} md2HtmlJob_t;
+
+// the list of files to convert, shared by all worker threads
+typedef struct
+{
+  md2HtmlJob_t     *aJobs;
+  unsigned          nJobs;
+  unsigned          maxJobs;
+  unsigned          nextJob;
+  bool_t            fForce;
+  bool_t            fVerbose;
+  pthread_mutex_t   mutex;
+} md2HtmlBatch_t;
 
 /*
-  Write the file to the same name, but with .html after it.
+  Is the HTML file newer than the markdown file? If so, no need to convert it again. Compares
+  nanosecond times, so an edit in the same second as the last build is still converted.
 */
-bool_t Md2HtmlWriteFile(const char *szInFile, const char *szOutFile)
+bool_t Md2HtmlIsUpToDate(const char *szInFile, const char *szOutFile)
 {
-  const char *szMdFile;
-  char       *szHtml;
-  size_t      htmlLen;
+  flyFileStat_t   statIn;
+  flyFileStat_t   statOut;
+
+  if(!FlyFileStat(&statIn, szInFile, 0) || !FlyFileStat(&statOut, szOutFile, 0) ||
+     (statOut.flags & FLYFILESTAT_IS_DIR))
+    return FALSE;
+  return (statOut.mtimeNs > statIn.mtimeNs) ? TRUE : FALSE;
+}
+
+/*
+  Make any missing folders in the path to szFile, e.g. "out/sub/file.html" makes "out/sub/".
+*/
+bool_t Md2HtmlMakePath(const char *szFile)
+{
+  char    szPath[PATH_MAX];
+  char   *psz;
+  bool_t  fWorked = TRUE;
+
+  FlyStrZCpy(szPath, szFile, sizeof(szPath));
+  FlyStrPathOnly(szPath);
+  psz = szPath;
+  while(fWorked && *psz)
+  {
+    psz = strchr(psz + 1, '/');
+    if(!psz)
+      break;
+    *psz = '\0';
+    if(*szPath && !FlyFileExistsFolder(szPath) && FlyFileMakeDir(szPath) != 0)
+      fWorked = FALSE;
+    *psz = '/';
+  }
+  return fWorked;
+}
+
+/*
+  Write the file to the same name, but with .html after it. Returns length of markdown or 0 if failed.
+
+  Renders once into a buffer sized from the markdown length. The renderers never write past the
+  buffer, and a render that doesn't fit fills it, so in that rare case the buffer grows and the
+  file is rendered again.
+*/
+size_t Md2HtmlWriteFile(const char *szInFile, const char *szOutFile)
+{
+  char       *szMdFile;
+  char       *szHtml    = NULL;
+  char       *pNew;
+  size_t      mdLen     = 0;
+  size_t      htmlLen   = 0;
+  size_t      size;
   const char *pszNameOnly;
   char        szPath[PATH_MAX];
-  bool_t      fWorked = TRUE;
 
   szMdFile = FlyFileRead(szInFile);
   if(!szMdFile)
-  {
     printf("  Cannot open %s\n", szInFile);
-    fWorked = FALSE;
-  }
-  if(fFlyMarkdownDebug)
-    g_szMd = szMdFile;
-  htmlLen = FlyMd2HtmlFile(NULL, UINT_MAX, szMdFile, szInFile);
-  if(!htmlLen)
+  else
   {
-    printf("  %s doesn't appear to be markdown\n", szInFile);
-    fWorked = FALSE;
+    mdLen = strlen(szMdFile);
+
+    // guess at size, usually enough. If the HTML fills the buffer, grow it
+    size = (3 * mdLen) + MD2HTML_HEAD_SIZE;
+    while((pNew = realloc(szHtml, size)) != NULL)
+    {
+      szHtml  = pNew;
+      htmlLen = FlyMd2HtmlFile(szHtml, size, szMdFile, szInFile);
+      if(htmlLen + 1 < size)
+        break;
+      size *= 2;
+    }
+    if(!pNew)
+      htmlLen = 0;
+    if(!htmlLen)
+      printf("  %s doesn't appear to be markdown\n", szInFile);
   }
-  else
+
+  if(szHtml && htmlLen)
   {
-    szHtml = malloc(htmlLen + 1);
-    if(szHtml)
+    pszNameOnly = FlyStrPathNameOnly(szInFile);
+    if(!pszNameOnly)
+    {
+      printf("  internal problem on file %s\n", szInFile);
+      htmlLen = 0;
+    }
+    else
     {
-      memset(szHtml, 0, sizeof(htmlLen + 1));
-      FlyMd2HtmlFile(szHtml, htmlLen + 1, szMdFile, szInFile);
-      pszNameOnly = FlyStrPathNameOnly(szInFile);
-      if(!pszNameOnly)
+      if(szOutFile == NULL)
       {
-        printf("  internal problem on file %s\n", szInFile);
-        fWorked = FALSE;
+        FlyStrZCpy(szPath, pszNameOnly, sizeof(szPath));
+        FlyStrPathChangeExt(szPath, ".html");
+        szOutFile = szPath;
       }
-      else
+      else if(FlyStrPathIsFolder(szOutFile))
       {
-        if(szOutFile == NULL)
-        {
-          FlyStrZCpy(szPath, pszNameOnly, sizeof(szPath));
-          FlyStrPathChangeExt(szPath, ".html");
-          szOutFile = szPath;
-        }
-        else if(FlyStrPathIsFolder(szOutFile))
-        {
-          FlyStrZCpy(szPath, szOutFile, sizeof(szPath));
-          FlyStrPathAppend(szPath, pszNameOnly, sizeof(szPath));
-          FlyStrPathChangeExt(szPath, ".html");
-          szOutFile = szPath;
-        }
-        if(!FlyFileWrite(szOutFile, szHtml))
-        {
-          fWorked = FALSE;
-          printf("  problem writing to file %s\n", szOutFile);
-        }
+        FlyStrZCpy(szPath, szOutFile, sizeof(szPath));
+        FlyStrPathAppend(szPath, pszNameOnly, sizeof(szPath));
+        FlyStrPathChangeExt(szPath, ".html");
+        szOutFile = szPath;
+      }
+      if(!FlyFileWrite(szOutFile, szHtml))
+      {
+        htmlLen = 0;
+        printf("  problem writing to file %s\n", szOutFile);
       }
-      free(szHtml);
     }
   }
+
+  if(szHtml)
+    free(szHtml);
+  if(szMdFile)
+    FlyFree(szMdFile);
+
+  return htmlLen ? (mdLen ? mdLen : 1) : 0;
+}
+
+/*
+  Add a file to the batch. If szOutFolder is NULL, szOutFile is used as is. Otherwise the output
+  file is szOutFolder/szOutFile with a .html extension.
+*/
+bool_t Md2HtmlBatchAdd(md2HtmlBatch_t *pBatch, const char *szInFile, const char *szOutFolder, const char *szOutFile)
+{
+  md2HtmlJob_t   *aJobs;
+  char            szOutPath[PATH_MAX];
+
+  if(pBatch->nJobs >= pBatch->maxJobs)
+  {
+    aJobs = FlyRealloc(pBatch->aJobs, (pBatch->maxJobs + 64) * sizeof(md2HtmlJob_t));
+    if(!aJobs)
+      return FALSE;
+    pBatch->aJobs    = aJobs;
+    pBatch->maxJobs += 64;
+  }
+
+  if(szOutFolder)
+  {
+    FlyStrZCpy(szOutPath, szOutFolder, sizeof(szOutPath));
+    if(!FlyStrPathAppend(szOutPath, szOutFile, sizeof(szOutPath)))
+      return FALSE;
+    FlyStrPathChangeExt(szOutPath, ".html");
+    szOutFile = szOutPath;
+  }
+
+  memset(&pBatch->aJobs[pBatch->nJobs], 0, sizeof(md2HtmlJob_t));
+  pBatch->aJobs[pBatch->nJobs].szIn  = FlyStrAlloc(szInFile);
+  pBatch->aJobs[pBatch->nJobs].szOut = FlyStrAlloc(szOutFile);
+  if(!pBatch->aJobs[pBatch->nJobs].szIn || !pBatch->aJobs[pBatch->nJobs].szOut)
+    return FALSE;
+  ++pBatch->nJobs;
+
+  return TRUE;
+}
+
+/*
+  Add all *.md files in a folder (and subfolders) to the batch. If szOutFolder is empty, the HTML
+  goes next to the markdown file, otherwise the subfolder tree is mirrored in szOutFolder.
+*/
+bool_t Md2HtmlBatchAddFolder(md2HtmlBatch_t *pBatch, const char *szFolder, const char *szOutFolder)
+{
+  void         *hList;
+  const char   *szName;
+  const char   *szRelPath;
+  size_t        len;
+  unsigned      i;
+  bool_t        fWorked = TRUE;
+
+  hList = FlyFileListNewExts(szFolder, ".md", UINT_MAX);
+  if(!hList)
+  {
+    printf("Cannot read folder %s\n", szFolder);
+    return FALSE;
+  }
+
+  len = strlen(szFolder);
+  for(i = 0; fWorked && i < FlyFileListLen(hList); ++i)
+  {
+    szName    = FlyFileListGetName(hList, i);
+    szRelPath = szName;
+    if(strncmp(szName, szFolder, len) == 0)
+    {
+      szRelPath += len;
+      while(isslash(*szRelPath))
+        ++szRelPath;
+    }
+    if(*szOutFolder)
+      fWorked = Md2HtmlBatchAdd(pBatch, szName, szOutFolder, szRelPath);
+    else
+      fWorked = Md2HtmlBatchAdd(pBatch, szName, "", szName);
+  }
+  FlyFileListFree(hList);
+
   return fWorked;
 }
 
+/*
+  Worker thread. Converts files from the batch until there are none left.
+*/
+void * Md2HtmlWorker(void *pData)
+{
+  md2HtmlBatch_t   *pBatch = pData;
+  md2HtmlJob_t     *pJob;
+
+  while(TRUE)
+  {
+    pthread_mutex_lock(&pBatch->mutex);
+    pJob = (pBatch->nextJob < pBatch->nJobs) ? &pBatch->aJobs[pBatch->nextJob++] : NULL;
+    pthread_mutex_unlock(&pBatch->mutex);
+    if(!pJob)
+      break;
+
+    if(!pBatch->fForce && Md2HtmlIsUpToDate(pJob->szIn, pJob->szOut))
+    {
+      pJob->fSkipped = TRUE;
+      if(pBatch->fVerbose)
+        printf("  %s is up to date\n", pJob->szOut);
+      continue;
+    }
+
+    printf("  %s => %s\n", pJob->szIn, pJob->szOut);
+    if(!Md2HtmlMakePath(pJob->szOut))
+    {
+      printf("  Cannot make folder for %s\n", pJob->szOut);
+      pJob->fFailed = TRUE;
+      continue;
+    }
+    pJob->mdLen = Md2HtmlWriteFile(pJob->szIn, pJob->szOut);
+    if(!pJob->mdLen)
+      pJob->fFailed = TRUE;
+  }
+
+  return NULL;
+}
+
+/*
+  Convert all files in the batch with a pool of worker threads, then report throughput.
+  Returns TRUE if all files converted.
+*/
+bool_t Md2HtmlBatchRun(md2HtmlBatch_t *pBatch, unsigned nThreads)
+{
+  pthread_t   aThreads[MD2HTML_MAX_JOBS];
+  flytime_t   timeMs;
+  size_t      mdTotal   = 0;
+  unsigned    nDone     = 0;
+  unsigned    nSkipped  = 0;
+  unsigned    nFailed   = 0;
+  unsigned    i;
+
+  if(nThreads > pBatch->nJobs)
+    nThreads = pBatch->nJobs;
+  if(nThreads > MD2HTML_MAX_JOBS)
+    nThreads = MD2HTML_MAX_JOBS;
+  if(nThreads < 1)
+    nThreads = 1;
+
+  // main thread counts as a worker
+  timeMs = FlyTimeMsGet();
+  pthread_mutex_init(&pBatch->mutex, NULL);
+  for(i = 1; i < nThreads; ++i)
+  {
+    if(pthread_create(&aThreads[i], NULL, Md2HtmlWorker, pBatch) != 0)
+      break;
+  }
+  nThreads = i;
+  Md2HtmlWorker(pBatch);
+  for(i = 1; i < nThreads; ++i)
+    pthread_join(aThreads[i], NULL);
+  pthread_mutex_destroy(&pBatch->mutex);
+  timeMs = FlyTimeMsDiff(timeMs);
+
+  for(i = 0; i < pBatch->nJobs; ++i)
+  {
+    if(pBatch->aJobs[i].fSkipped)
+      ++nSkipped;
+    else if(pBatch->aJobs[i].fFailed)
+      ++nFailed;
+    else
+    {
+      ++nDone;
+      mdTotal += pBatch->aJobs[i].mdLen;
+    }
+  }
+
+  if(pBatch->fVerbose || pBatch->nJobs > 1)
+  {
+    printf("Converted %u file(s), %u up to date, %u failed, %zu bytes of markdown in %zums with %u job(s)",
+      nDone, nSkipped, nFailed, mdTotal, (size_t)timeMs, nThreads);
+    if(timeMs)
+      printf(", %.1f MB/s", ((double)mdTotal / (1024.0 * 1024.0)) / ((double)timeMs / 1000.0));
+    printf("\n");
+  }
+
+  return nFailed ? FALSE : TRUE;
+}
+
 int main(int argc, const char *argv[])
 {
   // command-line options
   bool_t              fVerbose  = FALSE;
   bool_t              fDebug    = FALSE;
+  bool_t              fForce    = FALSE;
+  int                 nJobs     = 0;
   const char         *szOut     = NULL;   // file or folder
   const flyCliOpt_t   cliOpts[] =
   {
     { "--debug", &fDebug,   FLYCLI_BOOL },
+    { "-f",      &fForce,   FLYCLI_BOOL },
+    { "-j",      &nJobs,    FLYCLI_INT },
     { "-o",      &szOut,    FLYCLI_STRING },
     { "-v",      &fVerbose, FLYCLI_BOOL },
   };
@@ -107,12 +373,14 @@ int main(int argc, const char *argv[])
     .szHelp     = m_szHelp
   };
 
-  flyCliErr_t   err;
-  bool_t        fFailed  = FALSE;
-  int           nArgs;
-  int           i;
-  const char   *pszName;
-  char          szOutPath[PATH_MAX];
+  md2HtmlBatch_t  batch;
+  flyCliErr_t     err;
+  bool_t          fFailed  = FALSE;
+  bool_t          fBatch   = FALSE;
+  int             nArgs;
+  int             i;
+  const char     *szArg;
+  char            szOutPath[PATH_MAX];
 
   // bad options?
   err = FlyCliParse(&cli);
@@ -144,7 +412,16 @@ int main(int argc, const char *argv[])
     exit(1);
   }
 
+  // 2+ inputs or any folder means batch mode, output (if any) is a folder
+  for(i = 1; i < nArgs; ++i)
+  {
+    if(FlyFileExistsFolder(FlyCliArg(&cli, i)))
+      fBatch = TRUE;
+  }
   if(nArgs > 2)
+    fBatch = TRUE;
+
+  if(fBatch)
   {
     if(szOut == NULL)
       *szOutPath = '\0';
@@ -165,7 +442,7 @@ int main(int argc, const char *argv[])
     if(fVerbose)
       printf("Storing HTML files in folder %s\n", (*szOutPath == '\0') ? "(current)" : szOutPath);
   }
-  if(nArgs == 2)
+  else
   {
     if(szOut == 0)
     {
@@ -177,28 +454,48 @@ int main(int argc, const char *argv[])
       FlyStrZCpy(szOutPath, szOut, sizeof(szOutPath));
   }
 
-  // parse the input files
-  if(fFlyMarkdownDebug)
-    fVerbose = TRUE;
-  if(fVerbose)
-    printf("Converting files from markdown to HTML...\n");
-  for(i = 1; i < nArgs; ++i)
+  // gather the input files
+  memset(&batch, 0, sizeof(batch));
+  batch.fForce   = fForce;
+  batch.fVerbose = fVerbose;
+  for(i = 1; !fFailed && i < nArgs; ++i)
   {
-    if(nArgs != 2)
+    szArg = FlyCliArg(&cli, i);
+    if(!fBatch)
     {
-      pszName = FlyStrPathNameOnly(FlyCliArg(&cli, i));
-      FlyStrPathOnly(szOutPath);
-      FlyStrPathAppend(szOutPath, pszName, sizeof(szOutPath));
-      FlyStrPathChangeExt(szOutPath, ".html");
+      if(!Md2HtmlBatchAdd(&batch, szArg, NULL, szOutPath))
+        fFailed = TRUE;
     }
-    printf("  %s => %s\n", FlyCliArg(&cli, i), szOutPath);
-
-    if(!Md2HtmlWriteFile(FlyCliArg(&cli, i), szOutPath))
+    else if(FlyFileExistsFolder(szArg))
     {
-      fFailed = TRUE;
-      break;
+      if(!Md2HtmlBatchAddFolder(&batch, szArg, szOutPath))
+        fFailed = TRUE;
     }
+    else if(!Md2HtmlBatchAdd(&batch, szArg, szOutPath, FlyStrPathNameOnly(szArg)))
+      fFailed = TRUE;
+  }
+
+  // markdown debug uses a global, so can only convert one file at a time
+  if(nJobs <= 0)
+    nJobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if(fFlyMarkdownDebug)
+    nJobs = 1;
+
+  // convert the input files
+  if(!fFailed)
+  {
+    if(fVerbose)
+      printf("Converting files from markdown to HTML...\n");
+    if(!Md2HtmlBatchRun(&batch, (unsigned)nJobs))
+      fFailed = TRUE;
+  }
+
+  for(i = 0; (unsigned)i < batch.nJobs; ++i)
+  {
+    FlyFreeIf(batch.aJobs[i].szIn);
+    FlyFreeIf(batch.aJobs[i].szOut);
   }
+  FlyFreeIf(batch.aJobs);
 
   return fFailed ? 1 : 0;
 }